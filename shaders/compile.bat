@@ -1,7 +0,0 @@
-C:\VulkanSDK\1.3.246.1\Bin\glslangValidator.exe -V shader.vert -o vert.spv
-C:\VulkanSDK\1.3.246.1\Bin\glslangValidator.exe -V shader.frag -o frag.spv
-C:\VulkanSDK\1.3.246.1\Bin\glslangValidator.exe -V shader.comp -o comp.spv
-C:\VulkanSDK\1.3.246.1\Bin\glslangValidator.exe -V NoLightingShader.vert -o NoLightingShaderVert.spv
-C:\VulkanSDK\1.3.246.1\Bin\glslangValidator.exe -V NoLightingShader.frag -o NoLightingShaderFrag.spv
-
-
@@ -1,10 +0,0 @@
-#!/bin/sh
-
-#  compile.sh
-#  VulkantTesting
-#
-#  Created by Hamza Lahmimsi on 2021-02-13.
-#  
-
-/Users/hamzalah/VulkanSDK/1.3.239.0/macOS/bin/glslc shader.vert -o vert.spv
-/Users/hamzalah/VulkanSDK/1.3.239.0/macOS/bin/glslc shader.frag -o frag.spv
\ No newline at end of file
@@ -0,0 +1,16 @@
+//entry of the object buffer of a scene, shared by the vertex shaders and cull.comp. has to match PixelObject::DynamicUBObj (std430)
+
+#define OBJECT_FLAG_VISIBLE 1u
+
+struct ObjectData
+{
+    mat4 M;
+    mat4 MinvT;
+    vec4 boundingSphere; //center in object space in xyz, radius in w
+    int texIndex;
+    uint firstIndex; //where the mesh starts in the geometry pool of the scene
+    uint indexCount;
+    int vertexOffset;
+    uint drawGroup; //graphics pipeline the object is drawn with
+    uint flags;
+};
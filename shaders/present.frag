@@ -0,0 +1,61 @@
+#version 450 //glsl version
+
+//the raytraced image and the outline of the picked object, written by outline.comp
+layout(set = 0, binding = 0) uniform sampler2D displayImage;
+layout(set = 0, binding = 1) uniform sampler2D outlineMask;
+
+//has to match PixelPresentPipeline::PObj
+layout(push_constant) uniform PushObject{
+    float exposure;
+    int tonemap;
+    int view;
+} pushObj;
+
+#define TONEMAP_CLAMP 0
+#define TONEMAP_REINHARD 1
+#define TONEMAP_ACES 2
+
+#define VIEW_COLOR 0
+#define VIEW_OUTLINE_MASK 1
+
+layout(location = 0) in vec2 fragTex;
+
+layout(location = 0) out vec4 outColor;
+
+//narkowicz's fit of the aces filmic curve
+vec3 aces(vec3 x)
+{
+    return clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+}
+
+void main()
+{
+    //the display image has the size of the swapchain, one texel per pixel and row 0 at the top like the mouse
+    ivec2 pixel = min(ivec2(gl_FragCoord.xy), textureSize(displayImage, 0) - 1);
+    float outline = texelFetch(outlineMask, pixel, 0).r;
+
+    if(pushObj.view == VIEW_OUTLINE_MASK)
+    {
+        outColor = vec4(vec3(outline), 1.0f);
+        return;
+    }
+
+    //the outline is drawn over the tonemapped color so it stays white
+    if(outline > 0.0f)
+    {
+        outColor = vec4(1.0f);
+        return;
+    }
+
+    vec3 color = texelFetch(displayImage, pixel, 0).rgb * pushObj.exposure;
+    if(pushObj.tonemap == TONEMAP_REINHARD)
+    {
+        color = color / (1.0f + color);
+    }
+    else if(pushObj.tonemap == TONEMAP_ACES)
+    {
+        color = aces(color);
+    }
+
+    outColor = vec4(clamp(color, 0.0f, 1.0f), 1.0f);
+}
@@ -0,0 +1,10 @@
+#version 450 //use glsl 4.5
+
+//a triangle covering the screen, built from the vertex index. no vertex buffer is bound
+layout(location = 0) out vec2 fragTex;
+
+void main()
+{
+    fragTex = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(fragTex * 2.0f - 1.0f, 0.0f, 1.0f);
+}
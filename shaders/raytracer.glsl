@@ -0,0 +1,216 @@
+//intersection code shared by shader.comp, pick.comp and outline.comp. the primitives of the scene are traced by scene.glsl
+
+#define FLT_MAX 3.402823466e+38
+#define FLT_MIN 1.175494351e-38
+#define DBL_MAX 1.7976931348623158e+308
+#define DBL_MIN 2.2250738585072014e-308
+#define PI 3.14159265f
+
+//ids of the scene objects. 0 is the background
+#define OBJECT_NONE 0u
+#define OBJECT_SPHERE_1 1u
+#define OBJECT_SPHERE_2 2u
+#define OBJECT_SPHERE_3 3u
+#define OBJECT_PLANE 4u
+
+//the camera fields are not read anymore, the kernels use the CameraBlock built from them. the block still has to match PixelComputePipeline::PObj
+layout(push_constant) uniform PObj
+{
+    vec3 cameraPos;
+    float fov;
+    vec3 randomOffsets;
+    float focus;
+    vec3 lightPos;
+    float intensity;
+    vec4 lightColor;
+    uint currentSample;
+    uint mouseCoordX;
+    uint mouseCoordY;
+    uint outlineEnabled;
+    vec3 prevCameraPos;
+    float prevFov;
+    uint historyValid;
+    float maxHistoryWeight;
+    uint samplerMode;
+    uint sampleIndex;
+    uvec2 tileOffset; //the dispatch only covers a tile of the image, unless it is the full frame one
+    uint denoised;
+} pushObj;
+
+#define PICK_BUFFER_BINDING 10 //COMPUTE_PICK_BUFFER_BINDING, right after the storage images
+#define CAMERA_BUFFER_BINDING 13 //COMPUTE_CAMERA_BUFFER_BINDING
+
+//what only changes with the view, computed once on the cpu instead of in every invocation. has to match
+//PixelComputePipeline::CameraUniforms
+layout(std140, binding = CAMERA_BUFFER_BINDING) uniform CameraBlock
+{
+    vec3 position;
+    float focus; //distance of the focal plane along the view direction
+    vec3 forwards; //normalized
+    float spreadAngle; //of the ray cone of a pixel
+    vec3 cornerDirection; //pinhole direction through the corner of the first pixel, its forward component is 1
+    float padding0;
+    vec3 pixelRight; //change of the direction from one pixel to the next
+    float padding1;
+    vec3 pixelDown;
+    float padding2;
+    vec3 lensRight; //normalized, the lens samples are taken in this plane
+    float padding3;
+    vec3 lensUp;
+    float padding4;
+    vec3 prevPosition; //camera the history was accumulated with
+    float halfWidth; //of the image, in pixels
+    vec3 prevForwards;
+    float halfHeight;
+    vec3 prevScreenRight; //a point projects to halfWidth + dot(toPoint, prevScreenRight) / its distance along prevForwards
+    float padding5;
+    vec3 prevScreenUp; //and to halfHeight - dot(toPoint, prevScreenUp) / the same distance
+    float padding6;
+} camera;
+
+//what is under the cursor. has to match PixelComputePipeline::PickResult
+struct PickResult {
+    uvec2 mouseCoord;
+    float depth; //along the view direction, what the focus is measured in
+    float distance; //along the mouse ray
+    uint objectId;
+};
+
+struct Sphere {
+    vec3 center;
+    float radius;
+    float metal_factor;
+    vec3 color;
+    uint objectId;
+};
+
+struct Checkerboard{
+    vec3 origin;
+    vec3 normal;
+    vec3 color1;
+    vec3 color2;
+    float metal_factor;
+    uint objectId;
+};
+
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
+struct HitData{
+    vec3 normal;
+    float t;
+    float metal_factor;
+    bool isHit;
+    vec3 position;
+    vec3 color;
+    uint objectId;
+    vec2 uv;
+    float uvDensity; //uv units per world unit around the hit, what the cone of the ray is measured in to pick a texture level
+    float roughness; //set by the material
+};
+
+//pinhole ray through a point of the screen, in pixels. the forward component of the direction is 1
+Ray screenRay(vec2 screenPoint)
+{
+    Ray ray;
+    ray.origin = camera.position;
+    ray.direction = camera.cornerDirection + screenPoint.x * camera.pixelRight + screenPoint.y * camera.pixelDown;
+    return ray;
+}
+
+HitData minHit(HitData hit1, HitData hit2){
+    if(hit1.isHit && !hit2.isHit)
+    {
+        return hit1;
+    } else if(!hit1.isHit && hit2.isHit)
+    {
+        return hit2;
+    }
+    return hit1.t < hit2.t ? hit1 : hit2;
+}
+
+//what a ray that hits nothing returns, the start of the closest hit over a list of primitives
+HitData noHit()
+{
+    HitData data;
+    data.normal = vec3(0.0f);
+    data.t = FLT_MAX;
+    data.metal_factor = 0.0f;
+    data.isHit = false;
+    data.position = vec3(0.0f);
+    data.color = vec3(0.0f);
+    data.objectId = OBJECT_NONE;
+    data.uv = vec2(0.0f);
+    data.uvDensity = 0.0f;
+    data.roughness = 0.0f;
+    return data;
+}
+
+HitData hit(Ray ray, Sphere sphere) {
+
+    float a = dot(ray.direction, ray.direction);
+    float b = 2.0 * dot(ray.direction, ray.origin - sphere.center);
+    float c = dot(ray.origin - sphere.center, ray.origin - sphere.center) - sphere.radius * sphere.radius;
+    float discriminant = b*b - 4.0*a*c;
+    float t =  (-b - sqrt(b*b - 4*a*c)) / (2*a);
+    vec3 position = ray.origin + t * ray.direction;
+    vec3 normal = normalize(position - sphere.center);
+
+    HitData data;
+    data.isHit = discriminant > 0;
+    data.position = position;
+    data.normal = normal;
+    data.t = t >= 0 ? t : FLT_MAX;;
+    data.color = sphere.color;
+    data.metal_factor = sphere.metal_factor;
+    data.objectId = sphere.objectId;
+
+    //longitude and latitude. the texture level is chosen from the ray cone and not from derivatives, so the seam of the
+    //longitude does not show
+    data.uv = vec2(atan(normal.z, normal.x) / (2.0f * PI) + 0.5f, acos(clamp(normal.y, -1.0f, 1.0f)) / PI);
+    data.uvDensity = 1.0f / (sqrt(2.0f) * PI * sphere.radius); //u spans the equator and v half of a meridian, averaged
+
+    return data;
+}
+
+HitData hit(Ray ray, Checkerboard plane)
+{
+    HitData data;
+    data.objectId = plane.objectId;
+
+    // assuming vectors are all normalized
+    float denom = dot(-plane.normal, ray.direction);
+    if (denom > 1e-6) {
+        vec3 p0l0 = plane.origin - ray.origin;
+        float t = dot(p0l0, -plane.normal) / denom;
+
+        data.isHit = (t >= 0);
+        data.normal = plane.normal;
+        data.position = ray.origin + t * ray.direction;
+        data.t = t > 0 ? t : 0;
+        data.metal_factor = plane.metal_factor;
+
+        //one unit of uv per square of the checkerboard
+        data.uv = data.position.xz;
+        data.uvDensity = 1.0f;
+
+
+        float temp_z = mod(floor(data.position.z), 2) < 1 ? 1 : 0;
+        float temp_x = mod(floor(data.position.x + temp_z), 2);
+        if(temp_x == 0)
+        {
+            data.color = plane.color1;
+        } else
+        {
+            data.color = plane.color2;
+        }
+        return data;
+    }
+
+    data.isHit = false;
+    data.t = FLT_MAX;
+    data.metal_factor = plane.metal_factor;
+    return data;
+}
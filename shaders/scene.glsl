@@ -0,0 +1,74 @@
+//the primitives of the scene, read from a storage buffer and tested in a loop. it works for any scene the buffer can hold.
+//for a small scene the renderer replaces this file with the one PixelShaderGenerator writes, the same functions with the
+//primitives as constants and one test per primitive. has to be included after raytracer.glsl
+
+#define SCENE_BUFFER_BINDING 12 //COMPUTE_SCENE_BUFFER_BINDING
+
+//has to match PixelComputePipeline::Primitive
+struct Primitive{
+    vec4 position; //center and radius of a sphere, point of a plane
+    vec4 normal; //of a plane
+    vec4 color1; //metal factor in w
+    vec4 color2; //second color of the checkerboard of a plane
+    uint objectId;
+};
+
+layout(std430, binding = SCENE_BUFFER_BINDING) readonly buffer ScenePrimitives{
+    uint sphereCount;
+    uint planeCount; //after the spheres
+    Primitive primitives[];
+};
+
+Sphere loadSphere(uint index)
+{
+    Primitive primitive = primitives[index];
+
+    Sphere sphere;
+    sphere.center = primitive.position.xyz;
+    sphere.radius = primitive.position.w;
+    sphere.metal_factor = primitive.color1.w;
+    sphere.color = primitive.color1.rgb;
+    sphere.objectId = primitive.objectId;
+    return sphere;
+}
+
+Checkerboard loadPlane(uint index)
+{
+    Primitive primitive = primitives[sphereCount + index];
+
+    Checkerboard plane;
+    plane.origin = primitive.position.xyz;
+    plane.normal = primitive.normal.xyz;
+    plane.color1 = primitive.color1.rgb;
+    plane.color2 = primitive.color2.rgb;
+    plane.metal_factor = primitive.color1.w;
+    plane.objectId = primitive.objectId;
+    return plane;
+}
+
+//the shadows are only cast by the spheres
+HitData traceSpheres(Ray ray)
+{
+    HitData closest = noHit();
+    for(uint i = 0; i < sphereCount; i++)
+    {
+        closest = minHit(closest, hit(ray, loadSphere(i)));
+    }
+    return closest;
+}
+
+//the reflections of the metals only see the planes
+HitData tracePlanes(Ray ray)
+{
+    HitData closest = noHit();
+    for(uint i = 0; i < planeCount; i++)
+    {
+        closest = minHit(closest, hit(ray, loadPlane(i)));
+    }
+    return closest;
+}
+
+HitData traceScene(Ray ray)
+{
+    return minHit(traceSpheres(ray), tracePlanes(ray));
+}
@@ -1,5 +1,9 @@
 #version 450 //use glsl 4.5
 
+#extension GL_GOOGLE_include_directive : require
+
+#include "objects.glsl"
+
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec4 normal;
 layout(location = 2) in vec4 color;
@@ -12,19 +16,11 @@ layout(set = 0, binding = 0) uniform UboVP
     vec4 lightPos;
 } uboVP;
 
-//unused (replaced by push constants)
-layout(set = 0, binding = 1) uniform DynamicUBObj
-{
-    mat4 M;
-    mat4 MinvT;
-    int texIndex;
-} dynamicUBObj;
-
-layout(push_constant) uniform PObj
+//per object, the draw of an object starts at its index in the scene
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
 {
-    mat4 M;
-    mat4 MinvT;
-} pushObj;
+    ObjectData objects[];
+};
 
 layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec4 normalForFP;
@@ -35,16 +31,17 @@ layout(location = 5) out flat int texID;
 
 void main()
 {
-    gl_Position = uboVP.P * uboVP.V * pushObj.M * position;
+    ObjectData object = objects[gl_InstanceIndex];
+    gl_Position = uboVP.P * uboVP.V * object.M * position;
     fragColor = color;
 
     vec4 tempLPos = uboVP.V * uboVP.lightPos;
     lightPos = tempLPos.xyz;
-    vec4 tempPos = uboVP.V * pushObj.M * position;
+    vec4 tempPos = uboVP.V * object.M * position;
     positionForFP = tempPos.xyz;
-    vec4 tempNorm = uboVP.V * pushObj.MinvT * vec4(normal.xyz, 0.0f);
+    vec4 tempNorm = uboVP.V * object.MinvT * vec4(normal.xyz, 0.0f);
     normalForFP = vec4(normalize(tempNorm.xyz),0.0f);
 
     fragTex = texUV;
-    texID = dynamicUBObj.texIndex;
+    texID = object.texIndex;
 }
\ No newline at end of file
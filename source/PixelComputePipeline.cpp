@@ -5,18 +5,44 @@
 #include "PixelComputePipeline.h"
 
 #include <array>
+#include <cmath>
+
+//the basis the shaders always used. right and up are not normalized, their length is the sine of the angle between the view and
+//the vertical, and the image keeps the proportions it always had
+static void lookAtBasis(glm::vec3 position, glm::vec3* forwards, glm::vec3* right, glm::vec3* up)
+{
+    *forwards = glm::normalize(COMPUTE_SCENE_LOOKAT - position);
+    *right = glm::cross(*forwards, glm::vec3(0.0f, 1.0f, 0.0f));
+    *up = glm::cross(*forwards, -*right);
+}
 
-PixelComputePipeline::PixelComputePipeline(PixBackend* backend, VkExtent2D inputExtent): m_backend(backend), m_extent(inputExtent) {
+PixelComputePipeline::PixelComputePipeline(PixBackend* backend, VkExtent2D inputExtent): m_backend(backend), m_extent(inputExtent),
+                                                                                        textureRegistry(backend->logicalDevice, backend->physicalDevice, VK_SHADER_STAGE_COMPUTE_BIT) {
 
 }
 
 void PixelComputePipeline::addComputeShader(const std::string &filename) {
-    computeShaderModule = addShaderModule(m_backend->logicalDevice, filename);
+    computeShaderModule = m_shaderCompiler->createShaderModule(filename);
 
     computeCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     computeCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
     computeCreateShaderInfo.module = computeShaderModule;
     computeCreateShaderInfo.pName = "main"; //the entry point of the shader
+
+    //the pick shader shares the layout and descriptor set of the raytracer
+    pickShaderModule = m_shaderCompiler->createShaderModule("pick.comp");
+
+    pickCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pickCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pickCreateShaderInfo.module = pickShaderModule;
+    pickCreateShaderInfo.pName = "main";
+
+    outlineShaderModule = m_shaderCompiler->createShaderModule("outline.comp");
+
+    outlineCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    outlineCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    outlineCreateShaderInfo.module = outlineShaderModule;
+    outlineCreateShaderInfo.pName = "main";
 }
 
 void PixelComputePipeline::cleanUp() {
@@ -27,16 +53,73 @@ void PixelComputePipeline::cleanUp() {
         raytracedInputTexture.cleanUp();
     }
 
-    if(!customTexture.hasBeenCleaned())
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        if(!customTextures[i].hasBeenCleaned())
+        {
+            //customTextures[i].cleanUp();
+        }
+
+        if(!raytracedOutputTextures[i].hasBeenCleaned())
+        {
+            //raytracedOutputTextures[i].cleanUp();
+        }
+    }
+
+    if(!normalDepthTexture.hasBeenCleaned())
+    {
+        normalDepthTexture.cleanUp();
+    }
+
+    if(!albedoTexture.hasBeenCleaned())
+    {
+        albedoTexture.cleanUp();
+    }
+
+    if(!accumulationTexture.hasBeenCleaned())
+    {
+        accumulationTexture.cleanUp();
+    }
+
+    if(!historyNormalDepthTexture.hasBeenCleaned())
+    {
+        historyNormalDepthTexture.cleanUp();
+    }
+
+    if(!blueNoiseTexture.hasBeenCleaned())
     {
-        //customTexture.cleanUp();
+        blueNoiseTexture.cleanUp();
     }
 
-    if(!raytracedOutputTexture.hasBeenCleaned())
+    if(!objectIdTexture.hasBeenCleaned())
     {
-        //raytracedOutputTexture.cleanUp();
+        objectIdTexture.cleanUp();
     }
 
+    if(!denoisedTexture.hasBeenCleaned())
+    {
+        denoisedTexture.cleanUp();
+    }
+
+    vkUnmapMemory(m_backend->logicalDevice, pickReadbackBufferMemory);
+    vkDestroyBuffer(m_backend->logicalDevice, pickReadbackBuffer, nullptr);
+    vkFreeMemory(m_backend->logicalDevice, pickReadbackBufferMemory, nullptr);
+    vkDestroyBuffer(m_backend->logicalDevice, pickBuffer, nullptr);
+    vkFreeMemory(m_backend->logicalDevice, pickBufferMemory, nullptr);
+
+    vkUnmapMemory(m_backend->logicalDevice, materialBufferMemory);
+    vkDestroyBuffer(m_backend->logicalDevice, materialBuffer, nullptr);
+    vkFreeMemory(m_backend->logicalDevice, materialBufferMemory, nullptr);
+    textureRegistry.cleanUp();
+
+    vkUnmapMemory(m_backend->logicalDevice, sceneBufferMemory);
+    vkDestroyBuffer(m_backend->logicalDevice, sceneBuffer, nullptr);
+    vkFreeMemory(m_backend->logicalDevice, sceneBufferMemory, nullptr);
+    vkDestroyBuffer(m_backend->logicalDevice, cameraBuffer, nullptr);
+    vkFreeMemory(m_backend->logicalDevice, cameraBufferMemory, nullptr);
+
+    vkDestroyPipeline(m_backend->logicalDevice, outlinePipeline, nullptr);
+    vkDestroyPipeline(m_backend->logicalDevice, pickPipeline, nullptr);
     vkDestroyPipeline(m_backend->logicalDevice, computePipeline, nullptr);
     vkDestroyPipelineLayout(m_backend->logicalDevice, computePipelineLayout, nullptr);
 
@@ -54,19 +137,306 @@ void PixelComputePipeline::populatePipelineLayout() {
 }
 
 void PixelComputePipeline::initImageBufferStorage() {
-    uint32_t width = 1024;
-    uint32_t height = 768;
+    createStorageImages();
+
+    blueNoiseTexture = PixelImage(m_backend, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, false);
+    blueNoiseTexture.loadTexture(BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, PixelSampler::generateBlueNoise(BLUE_NOISE_SIZE, SAMPLER_SEED), VK_IMAGE_USAGE_STORAGE_BIT);
+
+    //order of the bindings in shader.comp
+    storageImages = {&raytracedInputTexture, &raytracedOutputTextures[0], &customTextures[0], &normalDepthTexture,
+                     &albedoTexture, &accumulationTexture, &historyNormalDepthTexture, &blueNoiseTexture,
+                     &objectIdTexture, &denoisedTexture};
+}
+
+void PixelComputePipeline::createStorageImages() {
+    //the raytraced images have the size of the swapchain
+    uint32_t width = m_extent.width;
+    uint32_t height = m_extent.height;
+    //the color images hold the accumulation (and its weight in alpha), 8 bits are not enough for a long running average
     raytracedInputTexture = PixelImage(m_backend, width, height, false);
-    raytracedInputTexture.loadEmptyTexture(width, height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
-    raytracedOutputTexture = PixelImage(m_backend, width, height, false);
-    raytracedOutputTexture.loadEmptyTexture(width, height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
-    customTexture = PixelImage(m_backend, width, height, false);
-    customTexture.loadEmptyTexture(width, height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    raytracedInputTexture.loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        raytracedOutputTextures[i] = PixelImage(m_backend, width, height, false);
+        raytracedOutputTextures[i].loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+        customTextures[i] = PixelImage(m_backend, width, height, false);
+        customTextures[i].loadEmptyTexture(width, height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    }
+    normalDepthTexture = PixelImage(m_backend, width, height, false);
+    normalDepthTexture.loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    albedoTexture = PixelImage(m_backend, width, height, false);
+    albedoTexture.loadEmptyTexture(width, height, VK_IMAGE_USAGE_STORAGE_BIT);
+    accumulationTexture = PixelImage(m_backend, width, height, false);
+    accumulationTexture.loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    historyNormalDepthTexture = PixelImage(m_backend, width, height, false);
+    historyNormalDepthTexture.loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+    objectIdTexture = PixelImage(m_backend, width, height, false);
+    objectIdTexture.loadEmptyTexture(width, height, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT);
+    denoisedTexture = PixelImage(m_backend, width, height, false);
+    denoisedTexture.loadEmptyTexture(width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT);
+}
+
+void PixelComputePipeline::resize(VkExtent2D extent) {
+    m_extent = extent;
+
+    //the layout, the pipelines and the pick buffers do not depend on the size. only the images and the descriptors pointing at them are replaced
+    for(PixelImage* image : storageImages)
+    {
+        if(image != &blueNoiseTexture && !image->hasBeenCleaned())
+        {
+            image->cleanUp();
+        }
+    }
+    //the first display buffer is in the storage images, the others are not bound to shader.comp's default set
+    for(uint32_t i = 1; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        if(!raytracedOutputTextures[i].hasBeenCleaned())
+        {
+            raytracedOutputTextures[i].cleanUp();
+        }
+        if(!customTextures[i].hasBeenCleaned())
+        {
+            customTextures[i].cleanUp();
+        }
+    }
+
+    createStorageImages();
+    writeDescriptorSet();
+}
+
+void PixelComputePipeline::createPickBuffers() {
+
+    //the pick buffer is only touched by the gpu. the readback buffer has one slot per frame in flight and stays mapped
+    std::array<VkBuffer*, 2> buffers = {&pickBuffer, &pickReadbackBuffer};
+    std::array<VkDeviceMemory*, 2> memories = {&pickBufferMemory, &pickReadbackBufferMemory};
+    std::array<VkDeviceSize, 2> sizes = {sizeof(PickResult), sizeof(PickResult) * PICK_READBACK_SLOTS};
+    std::array<VkBufferUsageFlags, 2> usages = {VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+    std::array<VkMemoryPropertyFlags, 2> properties = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+
+    for(uint32_t i = 0; i < buffers.size(); i++)
+    {
+        VkBufferCreateInfo bufferCreateInfo{};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = sizes[i];
+        bufferCreateInfo.usage = usages[i];
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if(vkCreateBuffer(m_backend->logicalDevice, &bufferCreateInfo, nullptr, buffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create the pick buffers");
+        }
+
+        VkMemoryRequirements memoryRequirements{};
+        vkGetBufferMemoryRequirements(m_backend->logicalDevice, *buffers[i], &memoryRequirements);
+
+        VkMemoryAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = memoryRequirements.size;
+        allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_backend->physicalDevice, memoryRequirements.memoryTypeBits, properties[i]);
+
+        if(vkAllocateMemory(m_backend->logicalDevice, &allocateInfo, nullptr, memories[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate the pick buffer memory");
+        }
+
+        vkBindBufferMemory(m_backend->logicalDevice, *buffers[i], *memories[i], 0);
+    }
+
+    void* data;
+    vkMapMemory(m_backend->logicalDevice, pickReadbackBufferMemory, 0, sizes[1], 0, &data);
+    mappedPickResults = static_cast<PickResult*>(data);
+    std::memset(mappedPickResults, 0, sizes[1]);
+}
+
+void PixelComputePipeline::createMaterialBuffer() {
+
+    //written once by the cpu before the frames that read it, it stays mapped
+    VkDeviceSize size = sizeof(Material) * COMPUTE_MATERIAL_COUNT;
+
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(m_backend->logicalDevice, &bufferCreateInfo, nullptr, &materialBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create the material buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(m_backend->logicalDevice, materialBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_backend->physicalDevice, memoryRequirements.memoryTypeBits,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if(vkAllocateMemory(m_backend->logicalDevice, &allocateInfo, nullptr, &materialBufferMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate the material buffer memory");
+    }
+
+    vkBindBufferMemory(m_backend->logicalDevice, materialBuffer, materialBufferMemory, 0);
+
+    void* data;
+    vkMapMemory(m_backend->logicalDevice, materialBufferMemory, 0, size, 0, &data);
+    mappedMaterials = static_cast<Material*>(data);
+    for(uint32_t i = 0; i < COMPUTE_MATERIAL_COUNT; i++)
+    {
+        mappedMaterials[i] = Material{};
+    }
+}
+
+void PixelComputePipeline::setMaterial(uint32_t objectId, const Material& material) {
+    if(objectId >= COMPUTE_MATERIAL_COUNT)
+    {
+        throw std::runtime_error("no ray traced object has the id of the material");
+    }
+    mappedMaterials[objectId] = material;
+}
+
+void PixelComputePipeline::createSceneBuffer() {
+
+    //written by the cpu before the frames that read it, it stays mapped. an empty scene until setScene
+    VkDeviceSize size = sizeof(SceneHeader) + sizeof(Primitive) * COMPUTE_MAX_PRIMITIVES;
+
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(m_backend->logicalDevice, &bufferCreateInfo, nullptr, &sceneBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create the scene buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(m_backend->logicalDevice, sceneBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_backend->physicalDevice, memoryRequirements.memoryTypeBits,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if(vkAllocateMemory(m_backend->logicalDevice, &allocateInfo, nullptr, &sceneBufferMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate the scene buffer memory");
+    }
+
+    vkBindBufferMemory(m_backend->logicalDevice, sceneBuffer, sceneBufferMemory, 0);
+
+    vkMapMemory(m_backend->logicalDevice, sceneBufferMemory, 0, size, 0, &mappedScene);
+    std::memset(mappedScene, 0, size);
 }
 
-void PixelComputePipeline::init() {
-    addComputeShader("shaders/comp.spv");
+void PixelComputePipeline::setScene(const RaytracedScene& scene) {
+    if(scene.spheres.size() + scene.planes.size() > COMPUTE_MAX_PRIMITIVES)
+    {
+        throw std::runtime_error("the scene has more primitives than the scene buffer holds");
+    }
+
+    SceneHeader header{static_cast<uint32_t>(scene.spheres.size()), static_cast<uint32_t>(scene.planes.size()), {}};
+    std::memcpy(mappedScene, &header, sizeof(header));
+
+    auto* primitives = reinterpret_cast<Primitive*>(static_cast<char*>(mappedScene) + sizeof(SceneHeader));
+    for(const auto& sphere : scene.spheres)
+    {
+        *primitives++ = {glm::vec4(sphere.center, sphere.radius), glm::vec4(0.0f), glm::vec4(sphere.color, sphere.metalFactor),
+                         glm::vec4(0.0f), sphere.objectId, {}};
+    }
+    for(const auto& plane : scene.planes)
+    {
+        *primitives++ = {glm::vec4(plane.origin, 0.0f), glm::vec4(plane.normal, 0.0f), glm::vec4(plane.color1, plane.metalFactor),
+                         glm::vec4(plane.color2, 0.0f), plane.objectId, {}};
+    }
+}
+
+void PixelComputePipeline::createCameraBuffer() {
+
+    VkBufferCreateInfo bufferCreateInfo{};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(CameraUniforms);
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(m_backend->logicalDevice, &bufferCreateInfo, nullptr, &cameraBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create the camera buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(m_backend->logicalDevice, cameraBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_backend->physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if(vkAllocateMemory(m_backend->logicalDevice, &allocateInfo, nullptr, &cameraBufferMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate the camera buffer memory");
+    }
+
+    vkBindBufferMemory(m_backend->logicalDevice, cameraBuffer, cameraBufferMemory, 0);
+}
+
+PixelComputePipeline::CameraUniforms PixelComputePipeline::getCameraUniforms(const PObj& pushObj, VkExtent2D extent) {
+
+    float width = static_cast<float>(extent.width);
+    float height = static_cast<float>(extent.height);
+
+    glm::vec3 forwards, right, up;
+    lookAtBasis(pushObj.cameraPos, &forwards, &right, &up);
+    float tanFov = std::tan(glm::radians(pushObj.fov));
+
+    CameraUniforms camera{};
+    camera.position = pushObj.cameraPos;
+    camera.focus = pushObj.focus;
+    camera.forwards = forwards;
+    camera.spreadAngle = 2.0f * tanFov / width;
+
+    //direction = forwards + tan(fov) * ((2x - width) * right - (2y - height) * up) / width, split into what depends on the pixel
+    camera.cornerDirection = forwards - tanFov * right + (tanFov * height / width) * up;
+    camera.pixelRight = (2.0f * tanFov / width) * right;
+    camera.pixelDown = (-2.0f * tanFov / width) * up;
+    camera.lensRight = glm::normalize(right);
+    camera.lensUp = glm::normalize(up);
+
+    camera.halfWidth = 0.5f * width;
+    camera.halfHeight = 0.5f * height;
+
+    //the first view has no previous camera, and no history to reproject
+    if(pushObj.prevFov > 0.0f)
+    {
+        glm::vec3 prevForwards, prevRight, prevUp;
+        lookAtBasis(pushObj.prevCameraPos, &prevForwards, &prevRight, &prevUp);
+        float prevTanFov = std::tan(glm::radians(pushObj.prevFov));
+
+        //inverse of the direction above, the three vectors are orthogonal
+        camera.prevPosition = pushObj.prevCameraPos;
+        camera.prevForwards = prevForwards;
+        camera.prevScreenRight = prevRight * (0.5f * width / (glm::dot(prevRight, prevRight) * prevTanFov));
+        camera.prevScreenUp = prevUp * (0.5f * width / (glm::dot(prevUp, prevUp) * prevTanFov));
+    }
+    return camera;
+}
+
+void PixelComputePipeline::initTextureRegistry(VkSampler sampler, PixelImage* fallbackTexture) {
+    textureRegistry.init(sampler, fallbackTexture);
+}
+
+void PixelComputePipeline::init(PixelShaderCompiler* shaderCompiler) {
+    m_shaderCompiler = shaderCompiler;
+    addComputeShader("shader.comp");
     initImageBufferStorage();
+    createPickBuffers();
+    createMaterialBuffer();
+    createSceneBuffer();
+    createCameraBuffer();
     createDescriptorSetLayout();
     createDescriptorPool();
     createDescriptorSets();
@@ -75,25 +445,20 @@ void PixelComputePipeline::init() {
 }
 
 void PixelComputePipeline::createDescriptorSetLayout() {
-    std::array<VkDescriptorSetLayoutBinding, 3> layoutBindings{};
-
-    layoutBindings[0].binding = 0;
-    layoutBindings[0].descriptorCount = 1;
-    layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    layoutBindings[0].pImmutableSamplers = nullptr;
-    layoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    layoutBindings[1].binding = 1;
-    layoutBindings[1].descriptorCount = 1;
-    layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    layoutBindings[1].pImmutableSamplers = nullptr;
-    layoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    layoutBindings[2].binding = 2;
-    layoutBindings[2].descriptorCount = 1;
-    layoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    layoutBindings[2].pImmutableSamplers = nullptr;
-    layoutBindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    std::array<VkDescriptorSetLayoutBinding, COMPUTE_BINDING_COUNT> layoutBindings{};
+
+    for(uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].descriptorType = i < COMPUTE_STORAGE_IMAGE_COUNT ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        if(i == COMPUTE_CAMERA_BUFFER_BINDING)
+        {
+            layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+        layoutBindings[i].pImmutableSamplers = nullptr;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -103,66 +468,120 @@ void PixelComputePipeline::createDescriptorSetLayout() {
     if (vkCreateDescriptorSetLayout(m_backend->logicalDevice, &layoutInfo, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create compute descriptor set layout!");
     }
+
+    //the material textures are set 1, shader.comp is the only one of the pipelines that samples them
+    textureRegistry.createDescriptorSetLayout();
 }
 
 void PixelComputePipeline::createDescriptorSets() {
 
     //allocate info for texture descriptor set. they are not created but allocated from the pool
+    std::array<VkDescriptorSetLayout, DISPLAY_BUFFER_COUNT> setLayouts{};
+    setLayouts.fill(computeDescriptorSetLayout);
     VkDescriptorSetAllocateInfo textureSetAllocateInfo{};
     textureSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     textureSetAllocateInfo.descriptorPool = computeDescriptorPool;
-    textureSetAllocateInfo.descriptorSetCount = 1;
-    textureSetAllocateInfo.pSetLayouts = &computeDescriptorSetLayout;
+    textureSetAllocateInfo.descriptorSetCount = DISPLAY_BUFFER_COUNT;
+    textureSetAllocateInfo.pSetLayouts = setLayouts.data();
     // has to be 1:1 relationship with descriptor sets
 
-    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &textureSetAllocateInfo, &computeDescriptorSet);
+    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &textureSetAllocateInfo, computeDescriptorSets.data());
     if(result != VK_SUCCESS)
     {
         throw std::runtime_error("failed to allocate descriptor set for compute textures");
     }
 
-    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
-
-    VkDescriptorImageInfo inputImageBuffer{};
-    inputImageBuffer.imageView = raytracedInputTexture.getImageView();
-    inputImageBuffer.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    //inputImageBuffer.sampler = VK_NULL_HANDLE;
+    writeDescriptorSet();
+}
 
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = computeDescriptorSet;
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pImageInfo = &inputImageBuffer;
+void PixelComputePipeline::writeDescriptorSet() {
+    for(uint32_t displayBuffer = 0; displayBuffer < DISPLAY_BUFFER_COUNT; displayBuffer++)
+    {
+        writeDescriptorSet(displayBuffer);
+    }
+}
 
-    VkDescriptorImageInfo ouputImageBuffer{};
-    ouputImageBuffer.imageView = raytracedOutputTexture.getImageView();
-    ouputImageBuffer.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    //ouputImageBuffer.sampler = VK_NULL_HANDLE;
+void PixelComputePipeline::writeDescriptorSet(uint32_t displayBuffer) {
 
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = computeDescriptorSet;
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &ouputImageBuffer;
+    std::array<VkDescriptorImageInfo, COMPUTE_STORAGE_IMAGE_COUNT> imageInfos{};
+    std::array<VkWriteDescriptorSet, COMPUTE_BINDING_COUNT> descriptorWrites{};
 
-    VkDescriptorImageInfo customImageBuffer{};
-    customImageBuffer.imageView = customTexture.getImageView();
-    customImageBuffer.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    //ouputImageBuffer.sampler = VK_NULL_HANDLE;
+    //the sets only differ by the display images the outline writes to
+    std::array<PixelImage*, COMPUTE_STORAGE_IMAGE_COUNT> images = storageImages;
+    images[COMPUTE_OUTPUT_BINDING] = &raytracedOutputTextures[displayBuffer];
+    images[COMPUTE_CUSTOM_BINDING] = &customTextures[displayBuffer];
 
-    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[2].dstSet = computeDescriptorSet;
-    descriptorWrites[2].dstBinding = 2;
-    descriptorWrites[2].dstArrayElement = 0;
-    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    descriptorWrites[2].descriptorCount = 1;
-    descriptorWrites[2].pImageInfo = &customImageBuffer;
+    for(uint32_t i = 0; i < COMPUTE_STORAGE_IMAGE_COUNT; i++)
+    {
+        imageInfos[i].imageView = images[i]->getImageView();
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = computeDescriptorSets[displayBuffer];
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
 
-    vkUpdateDescriptorSets(m_backend->logicalDevice, 3, descriptorWrites.data(), 0, nullptr);
+    VkDescriptorBufferInfo pickBufferInfo{};
+    pickBufferInfo.buffer = pickBuffer;
+    pickBufferInfo.offset = 0;
+    pickBufferInfo.range = sizeof(PickResult);
+
+    VkWriteDescriptorSet& pickWrite = descriptorWrites[COMPUTE_PICK_BUFFER_BINDING];
+    pickWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    pickWrite.dstSet = computeDescriptorSets[displayBuffer];
+    pickWrite.dstBinding = COMPUTE_PICK_BUFFER_BINDING;
+    pickWrite.dstArrayElement = 0;
+    pickWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pickWrite.descriptorCount = 1;
+    pickWrite.pBufferInfo = &pickBufferInfo;
+
+    VkDescriptorBufferInfo materialBufferInfo{};
+    materialBufferInfo.buffer = materialBuffer;
+    materialBufferInfo.offset = 0;
+    materialBufferInfo.range = sizeof(Material) * COMPUTE_MATERIAL_COUNT;
+
+    VkWriteDescriptorSet& materialWrite = descriptorWrites[COMPUTE_MATERIAL_BUFFER_BINDING];
+    materialWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    materialWrite.dstSet = computeDescriptorSets[displayBuffer];
+    materialWrite.dstBinding = COMPUTE_MATERIAL_BUFFER_BINDING;
+    materialWrite.dstArrayElement = 0;
+    materialWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materialWrite.descriptorCount = 1;
+    materialWrite.pBufferInfo = &materialBufferInfo;
+
+    VkDescriptorBufferInfo sceneBufferInfo{};
+    sceneBufferInfo.buffer = sceneBuffer;
+    sceneBufferInfo.offset = 0;
+    sceneBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet& sceneWrite = descriptorWrites[COMPUTE_SCENE_BUFFER_BINDING];
+    sceneWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    sceneWrite.dstSet = computeDescriptorSets[displayBuffer];
+    sceneWrite.dstBinding = COMPUTE_SCENE_BUFFER_BINDING;
+    sceneWrite.dstArrayElement = 0;
+    sceneWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    sceneWrite.descriptorCount = 1;
+    sceneWrite.pBufferInfo = &sceneBufferInfo;
+
+    VkDescriptorBufferInfo cameraBufferInfo{};
+    cameraBufferInfo.buffer = cameraBuffer;
+    cameraBufferInfo.offset = 0;
+    cameraBufferInfo.range = sizeof(CameraUniforms);
+
+    VkWriteDescriptorSet& cameraWrite = descriptorWrites[COMPUTE_CAMERA_BUFFER_BINDING];
+    cameraWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    cameraWrite.dstSet = computeDescriptorSets[displayBuffer];
+    cameraWrite.dstBinding = COMPUTE_CAMERA_BUFFER_BINDING;
+    cameraWrite.dstArrayElement = 0;
+    cameraWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cameraWrite.descriptorCount = 1;
+    cameraWrite.pBufferInfo = &cameraBufferInfo;
+
+    vkUpdateDescriptorSets(m_backend->logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
 void PixelComputePipeline::createDescriptorPool() {
@@ -213,15 +632,38 @@ void PixelComputePipeline::createComputePipeline() {
         throw std::runtime_error("Failed to create the compute pipeline");
     }
 
-    //we no longer need it once the pipeline has been created
+    pipelineInfo.stage = pickCreateShaderInfo;
+    result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pickPipeline);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the pick pipeline");
+    }
+
+    pipelineInfo.stage = outlineCreateShaderInfo;
+    result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outlinePipeline);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the outline pipeline");
+    }
+
+    //we no longer need them once the pipelines have been created
     vkDestroyShaderModule(m_backend->logicalDevice, computeShaderModule, nullptr);
+    vkDestroyShaderModule(m_backend->logicalDevice, pickShaderModule, nullptr);
+    vkDestroyShaderModule(m_backend->logicalDevice, outlineShaderModule, nullptr);
+}
+
+VkPipeline PixelComputePipeline::swapPipeline(Kernel kernel, VkPipeline pipeline) {
+    std::array<VkPipeline*, KERNEL_COUNT> pipelines = {&computePipeline, &pickPipeline, &outlinePipeline};
+    std::swap(*pipelines[kernel], pipeline);
+    return pipeline;
 }
 
 void PixelComputePipeline::createComputePipelineLayout() {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &computeDescriptorSetLayout;
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {computeDescriptorSetLayout, *textureRegistry.getDescriptorSetLayout()};
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 1;
     pipelineLayoutInfo.pPushConstantRanges = &PixelComputePipeline::pushComputeConstantRange;
 
@@ -234,24 +676,71 @@ VkPipeline PixelComputePipeline::getPipeline() {
     return computePipeline;
 }
 
+VkPipeline PixelComputePipeline::getPickPipeline() {
+    return pickPipeline;
+}
+
+VkPipeline PixelComputePipeline::getOutlinePipeline() {
+    return outlinePipeline;
+}
+
+VkBuffer PixelComputePipeline::getPickBuffer() {
+    return pickBuffer;
+}
+
+VkBuffer PixelComputePipeline::getPickReadbackBuffer() {
+    return pickReadbackBuffer;
+}
+
+PixelComputePipeline::PickResult PixelComputePipeline::readPickResult(uint32_t slot) {
+    //the memory is coherent, the renderer only calls this once the frame that copied into the slot has finished
+    return mappedPickResults[slot];
+}
+
 VkPipelineLayout PixelComputePipeline::getPipelineLayout() {
     return computePipelineLayout;
 }
 
-VkDescriptorSet PixelComputePipeline::getDescriptorSet() {
-    return computeDescriptorSet;
+VkDescriptorSet PixelComputePipeline::getDescriptorSet(uint32_t displayBuffer) {
+    return computeDescriptorSets[displayBuffer];
 }
 
 PixelImage* PixelComputePipeline::getInputTexture() {
     return &raytracedInputTexture;
 }
 
-PixelImage* PixelComputePipeline::getCustomTexture() {
-    return &customTexture;
+PixelImage* PixelComputePipeline::getCustomTexture(uint32_t displayBuffer) {
+    return &customTextures[displayBuffer];
 }
 
-PixelImage* PixelComputePipeline::getOutputTexture() {
-    return &raytracedOutputTexture;
+PixelImage* PixelComputePipeline::getOutputTexture(uint32_t displayBuffer) {
+    return &raytracedOutputTextures[displayBuffer];
 }
 
+PixelImage* PixelComputePipeline::getNormalDepthTexture() {
+    return &normalDepthTexture;
+}
+
+PixelImage* PixelComputePipeline::getAlbedoTexture() {
+    return &albedoTexture;
+}
 
+PixelImage* PixelComputePipeline::getAccumulationTexture() {
+    return &accumulationTexture;
+}
+
+PixelImage* PixelComputePipeline::getHistoryNormalDepthTexture() {
+    return &historyNormalDepthTexture;
+}
+
+PixelImage* PixelComputePipeline::getBlueNoiseTexture() {
+    return &blueNoiseTexture;
+}
+
+PixelImage* PixelComputePipeline::getObjectIdTexture() {
+    return &objectIdTexture;
+}
+
+PixelImage* PixelComputePipeline::getDenoisedTexture() {
+    return &denoisedTexture;
+}
@@ -6,13 +6,44 @@
 #define PIXELENGINE_PIXELCOMPUTEPIPELINE_H
 
 #include "PixelImage.h"
+#include "PixelSampler.h"
+#include "PixelShaderCompiler.h"
+#include "PixelTextureRegistry.h"
+#include "PixelShaderCompiler.h"
 #include "glm/glm.hpp"
 
+#include <array>
+#include <vector>
+
+const uint32_t COMPUTE_STORAGE_IMAGE_COUNT = 10;
+const uint32_t COMPUTE_PICK_BUFFER_BINDING = COMPUTE_STORAGE_IMAGE_COUNT; //right after the storage images
+const uint32_t COMPUTE_MATERIAL_BUFFER_BINDING = COMPUTE_PICK_BUFFER_BINDING + 1;
+const uint32_t COMPUTE_SCENE_BUFFER_BINDING = COMPUTE_MATERIAL_BUFFER_BINDING + 1;
+const uint32_t COMPUTE_CAMERA_BUFFER_BINDING = COMPUTE_SCENE_BUFFER_BINDING + 1; //the only uniform buffer, the others are storage buffers
+const uint32_t COMPUTE_BINDING_COUNT = COMPUTE_CAMERA_BUFFER_BINDING + 1;
+const uint32_t COMPUTE_MATERIAL_COUNT = 5; //one per object id of raytracer.glsl, the background included
+const uint32_t COMPUTE_MAX_PRIMITIVES = 256; //spheres and planes the scene buffer holds
+const uint32_t PICK_READBACK_SLOTS = 2; //one per frame in flight, so a result is only read once its frame is done
+const uint32_t COMPUTE_LOCAL_SIZE_X = 32; //local size of shader.comp
+const uint32_t COMPUTE_LOCAL_SIZE_Y = 24;
+const uint32_t DISPLAY_BUFFER_COUNT = 2; //the outline writes one display image while the graphics samples the other
+const uint32_t COMPUTE_OUTPUT_BINDING = 1; //bindings of shader.comp that change with the display buffer
+const uint32_t COMPUTE_CUSTOM_BINDING = 2;
+const glm::vec3 COMPUTE_SCENE_LOOKAT = {0.0f, 0.0f, -3.0f}; //the camera always looks at the first sphere
+
 class PixelComputePipeline {
 public:
     PixelComputePipeline(PixBackend* backend, VkExtent2D inputExtent);
     PixelComputePipeline() = default;
 
+    //the kernels share the layout and the descriptor sets, each can be rebuilt on its own when its source changes
+    enum Kernel{
+        KERNEL_TRACE = 0, //shader.comp
+        KERNEL_PICK, //pick.comp
+        KERNEL_OUTLINE, //outline.comp
+        KERNEL_COUNT
+    };
+
     struct PObj{
         glm::vec3 cameraPos;
         float fov;
@@ -25,50 +56,223 @@ public:
         uint32_t mouseCoordX;
         uint32_t mouseCoordY;
         uint32_t outlineEnabled;
+        glm::vec3 prevCameraPos; //camera the history was accumulated with
+        float prevFov;
+        uint32_t historyValid;
+        float maxHistoryWeight;
+        uint32_t samplerMode; //SamplerMode
+        uint32_t sampleIndex; //index in the sobol sequence, counted from the last time the history was dropped
+        glm::uvec2 tileOffset; //first pixel covered by the dispatch
+        uint32_t denoised; //outline.comp composites over the denoised image instead of the accumulated one
+    };
+
+    //written by pick.comp, has to match the struct in raytracer.glsl
+    struct PickResult{
+        glm::uvec2 mouseCoord;
+        float depth; //along the view direction, the focus distance that puts the object in focus
+        float distance; //along the mouse ray
+        uint32_t objectId; //0 when the cursor is over the background
+        uint32_t padding;
+    };
+
+    //read by shader.comp for the object it hit, has to match the struct in shader.comp. the texture indices are in the
+    //registry of the pipeline, the textures that are not TEXTURE_NONE scale the factors
+    struct Material{
+        glm::vec4 albedoFactor{1.0f}; //scales the color of the object
+        float roughnessFactor = 0.5f;
+        float metallicFactor = 0.0f;
+        uint32_t albedoTexture = TEXTURE_NONE;
+        uint32_t roughnessMetallicTexture = TEXTURE_NONE; //roughness in the red channel, metallic in the green one
+        float uvScale = 1.0f; //repetitions of the textures per unit of the object uv
+        uint32_t padding[3]{};
+    };
+
+    //the primitives the ray tracer sees. the ids index the materials and are what picking reports
+    struct RaytracedScene{
+        struct Sphere{
+            glm::vec3 center;
+            float radius;
+            glm::vec3 color;
+            float metalFactor;
+            uint32_t objectId;
+        };
+
+        struct Plane{
+            glm::vec3 origin;
+            glm::vec3 normal;
+            glm::vec3 color1; //the two colors of the checkerboard
+            glm::vec3 color2;
+            float metalFactor;
+            uint32_t objectId;
+        };
+
+        std::vector<Sphere> spheres;
+        std::vector<Plane> planes;
+    };
+
+    //what only changes with the view, has to match the CameraBlock of raytracer.glsl (std140). the kernels read it instead of
+    //building the camera basis and the ray scale factors from the push constants in every invocation
+    struct CameraUniforms{
+        glm::vec3 position;
+        float focus;
+        glm::vec3 forwards; //normalized
+        float spreadAngle; //of the ray cone of a pixel
+        glm::vec3 cornerDirection; //pinhole direction through the corner of the first pixel, its forward component is 1
+        float padding0;
+        glm::vec3 pixelRight; //change of the direction from one pixel to the next
+        float padding1;
+        glm::vec3 pixelDown;
+        float padding2;
+        glm::vec3 lensRight; //normalized, the lens samples are taken in this plane
+        float padding3;
+        glm::vec3 lensUp;
+        float padding4;
+        glm::vec3 prevPosition; //camera the history was accumulated with
+        float halfWidth; //of the image, in pixels
+        glm::vec3 prevForwards;
+        float halfHeight;
+        glm::vec3 prevScreenRight; //projects a point into the image of the previous camera
+        float padding5;
+        glm::vec3 prevScreenUp;
+        float padding6;
+    };
+
+    //one sphere or plane of the scene buffer, has to match the struct in scene.glsl. the spheres come first
+    struct Primitive{
+        glm::vec4 position; //center and radius of a sphere, point of a plane
+        glm::vec4 normal; //of a plane
+        glm::vec4 color1; //metal factor in w
+        glm::vec4 color2;
+        uint32_t objectId;
+        uint32_t padding[3];
+    };
+
+    struct SceneHeader{
+        uint32_t sphereCount;
+        uint32_t planeCount;
+        uint32_t padding[2]; //the primitives are aligned on their vec4
     };
 
     void addComputeShader(const std::string& filename);
     void createDescriptorPool();
     void createDescriptorSets();
     void initImageBufferStorage();
+    void createStorageImages();
+    void writeDescriptorSet();
+    void writeDescriptorSet(uint32_t displayBuffer);
     void populatePipelineLayout();
     void createDescriptorSetLayout();
     void createComputePipeline();
     void createComputePipelineLayout();
-    void init();
+    void createPickBuffers();
+    void createMaterialBuffer();
+    void createSceneBuffer();
+    void createCameraBuffer();
+    void init(PixelShaderCompiler* shaderCompiler);
+    VkPipeline swapPipeline(Kernel kernel, VkPipeline pipeline); //between two frames, returns the one it replaced
+    void initTextureRegistry(VkSampler sampler, PixelImage* fallbackTexture); //once the sampler and the fallback texture exist
+    void resize(VkExtent2D extent);
     void cleanUp();
     static constexpr VkPushConstantRange pushComputeConstantRange {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PObj)};
+    static CameraUniforms getCameraUniforms(const PObj& pushObj, VkExtent2D extent); //for the image of that size
 
     //getters
     VkPipeline getPipeline();
+    VkPipeline getPickPipeline();
+    VkPipeline getOutlinePipeline();
+    VkBuffer getPickBuffer();
+    VkBuffer getPickReadbackBuffer();
+    VkBuffer getCameraBuffer(){return cameraBuffer;}
+    PickResult readPickResult(uint32_t slot);
+    PixelTextureRegistry* getTextureRegistry(){return &textureRegistry;}
     VkPipelineLayout getPipelineLayout();
-    VkDescriptorSet getDescriptorSet();
+    VkDescriptorSet getDescriptorSet(uint32_t displayBuffer = 0);
     PixelImage* getInputTexture();
-    PixelImage* getOutputTexture();
-    PixelImage* getCustomTexture();
+    PixelImage* getOutputTexture(uint32_t displayBuffer = 0);
+    PixelImage* getCustomTexture(uint32_t displayBuffer = 0);
+    PixelImage* getNormalDepthTexture();
+    PixelImage* getAlbedoTexture();
+    PixelImage* getAccumulationTexture();
+    PixelImage* getHistoryNormalDepthTexture();
+    PixelImage* getBlueNoiseTexture();
+    PixelImage* getObjectIdTexture();
+    PixelImage* getDenoisedTexture();
     PObj* getPushObj(){return &test;}
 
     //setters
     void setPushObj(PixelComputePipeline::PObj pObj){test = pObj;}
+    void setMaterial(uint32_t objectId, const Material& material); //before the frames that read it are submitted
+    void setScene(const RaytracedScene& scene); //same
 
 private:
 
     VkExtent2D m_extent{};
     PixelImage raytracedInputTexture;
-    PixelImage raytracedOutputTexture;
-    PixelImage customTexture;
+    std::array<PixelImage, DISPLAY_BUFFER_COUNT> raytracedOutputTextures;
+    std::array<PixelImage, DISPLAY_BUFFER_COUNT> customTextures;
+
+    //G-buffer of the primary hit, used to guide the denoiser
+    PixelImage normalDepthTexture; //world normal in xyz, hit distance in w
+    PixelImage albedoTexture;
+
+    //temporal accumulation. shader.comp writes them and they are copied into the input texture and the history G-buffer after each dispatch
+    PixelImage accumulationTexture;
+    PixelImage historyNormalDepthTexture;
+
+    //shifts the sobol samples of every pixel. generated once and uploaded by the renderer, it is never written to
+    PixelImage blueNoiseTexture;
+
+    //id of the object seen by the pinhole ray, written with the full frame dispatch. outline.comp finds the edges of the picked one in it
+    PixelImage objectIdTexture;
+
+    //written by the last denoise iteration. it is only updated when the accumulation changes, the outline is composited on top of it every frame
+    PixelImage denoisedTexture;
+
+    std::array<PixelImage*, COMPUTE_STORAGE_IMAGE_COUNT> storageImages{}; //with the images of the first display buffer
 
     PObj test = {{0.0f,1.0f,5.0f},35.0f,{0.0f,0.0f,0.0f},0.0f, {3.0f,4.0f,0.0f},0.0f,{1.0f,1.0f,1.0f,1.0f}, 0, 0, 0, 0};
 
     PixBackend* m_backend{};
+    PixelShaderCompiler* m_shaderCompiler{};
     VkPipelineShaderStageCreateInfo computeCreateShaderInfo{};
     VkPipeline computePipeline = VK_NULL_HANDLE;
     VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
     VkPipelineLayoutCreateInfo computePipelineLayoutCreateInfo = {};
     VkShaderModule computeShaderModule = VK_NULL_HANDLE;
     VkDescriptorSetLayout computeDescriptorSetLayout{};
-    VkDescriptorSet computeDescriptorSet{};
+    std::array<VkDescriptorSet, DISPLAY_BUFFER_COUNT> computeDescriptorSets{}; //one per display buffer, the other bindings are the same
     VkDescriptorPool computeDescriptorPool{};
+
+    //picking. the result stays on the gpu for shader.comp and is copied to a persistently mapped buffer for the cpu
+    VkPipelineShaderStageCreateInfo pickCreateShaderInfo{};
+    VkShaderModule pickShaderModule = VK_NULL_HANDLE;
+    VkPipeline pickPipeline = VK_NULL_HANDLE;
+    VkBuffer pickBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory pickBufferMemory = VK_NULL_HANDLE;
+    VkBuffer pickReadbackBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory pickReadbackBufferMemory = VK_NULL_HANDLE;
+    PickResult* mappedPickResults = nullptr;
+
+    //composites the outline of the picked object into the displayed image
+    VkPipelineShaderStageCreateInfo outlineCreateShaderInfo{};
+    VkShaderModule outlineShaderModule = VK_NULL_HANDLE;
+    VkPipeline outlinePipeline = VK_NULL_HANDLE;
+
+    //materials of the ray traced objects, indexed by their id. the textures they sample are in their own bindless array
+    //(set 1), so their indices do not change when the textures of the scenes are streamed
+    VkBuffer materialBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory materialBufferMemory = VK_NULL_HANDLE;
+    Material* mappedMaterials = nullptr;
+    PixelTextureRegistry textureRegistry;
+
+    //read by the data driven scene.glsl. the kernel generated for a small scene has the primitives as constants and ignores it
+    VkBuffer sceneBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory sceneBufferMemory = VK_NULL_HANDLE;
+    void* mappedScene = nullptr;
+
+    //device local, it is written with vkCmdUpdateBuffer when the view changes so it is ordered with the dispatches that read it
+    VkBuffer cameraBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory cameraBufferMemory = VK_NULL_HANDLE;
 };
 
 
@@ -0,0 +1,192 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelCullPipeline.h"
+
+PixelCullPipeline::PixelCullPipeline(PixBackend* backend): m_backend(backend) {
+
+}
+
+void PixelCullPipeline::init(PixelShaderCompiler* shaderCompiler, uint32_t maxDescriptorSets) {
+    m_shaderCompiler = shaderCompiler;
+    addComputeShader("cull.comp");
+    createDescriptorSetLayout();
+    createDescriptorPool(maxDescriptorSets);
+    createComputePipelineLayout();
+    createComputePipeline();
+}
+
+void PixelCullPipeline::cleanUp() {
+    vkDestroyPipeline(m_backend->logicalDevice, computePipeline, nullptr);
+    vkDestroyPipelineLayout(m_backend->logicalDevice, computePipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(m_backend->logicalDevice, computeDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_backend->logicalDevice, computeDescriptorSetLayout, nullptr);
+}
+
+void PixelCullPipeline::addComputeShader(const std::string &filename) {
+    computeShaderModule = m_shaderCompiler->createShaderModule(filename);
+
+    computeCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeCreateShaderInfo.module = computeShaderModule;
+    computeCreateShaderInfo.pName = "main"; //the entry point of the shader
+}
+
+void PixelCullPipeline::createDescriptorSetLayout() {
+    std::array<VkDescriptorSetLayoutBinding, 3> layoutBindings{};
+
+    //object buffer, draw lists and draw counts. all of them are storage buffers
+    for(uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].pImmutableSamplers = nullptr;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_backend->logicalDevice, &layoutInfo, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull descriptor set layout!");
+    }
+}
+
+void PixelCullPipeline::createDescriptorPool(uint32_t maxDescriptorSets) {
+
+    //one set per scene and swapchain image
+    VkDescriptorPoolSize bufferDescriptorSize{};
+    bufferDescriptorSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bufferDescriptorSize.descriptorCount = maxDescriptorSets * 3;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = maxDescriptorSets;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &bufferDescriptorSize;
+
+    VkResult result = vkCreateDescriptorPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &computeDescriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool for cull pipeline");
+    }
+}
+
+void PixelCullPipeline::recreateDescriptorPool(uint32_t maxDescriptorSets) {
+    vkDestroyDescriptorPool(m_backend->logicalDevice, computeDescriptorPool, nullptr);
+    createDescriptorPool(maxDescriptorSets);
+}
+
+VkDescriptorSet PixelCullPipeline::allocateDescriptorSet() {
+
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = computeDescriptorPool;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &computeDescriptorSetLayout;
+
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &setAllocateInfo, &descriptorSet);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor set for the cull pass");
+    }
+
+    return descriptorSet;
+}
+
+void PixelCullPipeline::writeDescriptorSet(VkDescriptorSet descriptorSet, VkBuffer objectBuffer, VkBuffer drawBuffer, VkBuffer countBuffer) {
+
+    std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+    bufferInfos[0].buffer = objectBuffer;
+    bufferInfos[1].buffer = drawBuffer;
+    bufferInfos[2].buffer = countBuffer;
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    for(uint32_t i = 0; i < descriptorWrites.size(); i++)
+    {
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_backend->logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void PixelCullPipeline::createComputePipelineLayout() {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &computeDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &PixelCullPipeline::pushCullConstantRange;
+
+    if (vkCreatePipelineLayout(m_backend->logicalDevice, &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cull pipeline layout!");
+    }
+}
+
+void PixelCullPipeline::createComputePipeline() {
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = computePipelineLayout;
+    pipelineInfo.stage = computeCreateShaderInfo;
+
+    VkResult result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the cull pipeline");
+    }
+
+    //we no longer need it once the pipeline has been created
+    vkDestroyShaderModule(m_backend->logicalDevice, computeShaderModule, nullptr);
+}
+
+VkPipeline PixelCullPipeline::swapPipeline(VkPipeline pipeline) {
+    std::swap(computePipeline, pipeline);
+    return pipeline;
+}
+
+VkPipeline PixelCullPipeline::getPipeline() {
+    return computePipeline;
+}
+
+VkPipelineLayout PixelCullPipeline::getPipelineLayout() {
+    return computePipelineLayout;
+}
+
+PixelCullPipeline::PObj PixelCullPipeline::getPushObj(const glm::mat4& viewProjection, uint32_t objectCount, uint32_t groupCapacity, uint32_t groupCount) {
+
+    //the planes are combinations of the rows of the view projection (Gribb and Hartmann). vulkan clips at -w <= x, y <= w and 0 <= z <= w
+    auto row = [&viewProjection](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    PObj pushObj{};
+    pushObj.frustumPlanes = {row(3) + row(0), row(3) - row(0),
+                             row(3) + row(1), row(3) - row(1),
+                             row(2), row(3) - row(2)};
+    for(auto& plane : pushObj.frustumPlanes)
+    {
+        //normalized so the distance to the plane can be compared with the radius
+        float length = glm::length(glm::vec3(plane));
+        plane /= length > 0.0f ? length : 1.0f;
+    }
+
+    pushObj.objectCount = objectCount;
+    pushObj.groupCapacity = groupCapacity;
+    pushObj.groupCount = groupCount;
+    return pushObj;
+}
@@ -0,0 +1,65 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELCULLPIPELINE_H
+#define PIXELENGINE_PIXELCULLPIPELINE_H
+
+#include "PixelShaderCompiler.h"
+#include "glm/glm.hpp"
+
+#include <array>
+
+const uint32_t CULL_LOCAL_SIZE_X = 64; //local size of cull.comp
+const uint32_t CULL_FRUSTUM_PLANES = 6;
+
+//tests the bounding sphere of every object of a scene against the frustum and writes the draws of the visible ones,
+//so drawing a scene costs the cpu the same whatever its number of objects.
+//the buffers belong to the scenes, the pipeline only holds the descriptor sets pointing at them
+class PixelCullPipeline {
+public:
+    explicit PixelCullPipeline(PixBackend* backend);
+    PixelCullPipeline() = default;
+
+    struct PObj{
+        std::array<glm::vec4, CULL_FRUSTUM_PLANES> frustumPlanes; //world space, normalized, pointing inwards
+        uint32_t objectCount;
+        uint32_t groupCapacity; //draws in the list of a group
+        uint32_t groupCount;
+    };
+
+    void init(PixelShaderCompiler* shaderCompiler, uint32_t maxDescriptorSets);
+    VkPipeline swapPipeline(VkPipeline pipeline); //between two frames, returns the one it replaced
+    void cleanUp();
+    static constexpr VkPushConstantRange pushCullConstantRange {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PObj)};
+
+    VkDescriptorSet allocateDescriptorSet();
+    void recreateDescriptorPool(uint32_t maxDescriptorSets); //frees every set, when the number of swapchain images changes
+    void writeDescriptorSet(VkDescriptorSet descriptorSet, VkBuffer objectBuffer, VkBuffer drawBuffer, VkBuffer countBuffer);
+    static uint32_t getDispatchSize(uint32_t objectCount){return (objectCount + CULL_LOCAL_SIZE_X - 1) / CULL_LOCAL_SIZE_X;} //workgroups covering the objects
+
+    //getters
+    VkPipeline getPipeline();
+    VkPipelineLayout getPipelineLayout();
+    static PObj getPushObj(const glm::mat4& viewProjection, uint32_t objectCount, uint32_t groupCapacity, uint32_t groupCount);
+
+private:
+
+    void addComputeShader(const std::string& filename);
+    void createDescriptorSetLayout();
+    void createDescriptorPool(uint32_t maxDescriptorSets);
+    void createComputePipelineLayout();
+    void createComputePipeline();
+
+    PixBackend* m_backend{};
+    PixelShaderCompiler* m_shaderCompiler{};
+    VkPipelineShaderStageCreateInfo computeCreateShaderInfo{};
+    VkPipeline computePipeline = VK_NULL_HANDLE;
+    VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkDescriptorSetLayout computeDescriptorSetLayout{};
+    VkDescriptorPool computeDescriptorPool{};
+};
+
+
+#endif //PIXELENGINE_PIXELCULLPIPELINE_H
@@ -0,0 +1,259 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelDenoisePipeline.h"
+
+PixelDenoisePipeline::PixelDenoisePipeline(PixBackend* backend, VkExtent2D extent): m_backend(backend), m_extent(extent) {
+
+}
+
+void PixelDenoisePipeline::init(PixelShaderCompiler* shaderCompiler, PixelImage* colorInput, PixelImage* colorOutput, PixelImage* normalDepth, PixelImage* albedo) {
+    m_shaderCompiler = shaderCompiler;
+    normalDepthTexture = normalDepth;
+    albedoTexture = albedo;
+
+    addComputeShader("denoise.comp");
+    initImageBufferStorage();
+
+    colorImages[DENOISE_INPUT] = colorInput;
+    colorImages[DENOISE_PING] = &pingTexture;
+    colorImages[DENOISE_PONG] = &pongTexture;
+    colorImages[DENOISE_OUTPUT] = colorOutput;
+
+    createDescriptorSetLayout();
+    createDescriptorPool();
+    createDescriptorSets();
+    createComputePipelineLayout();
+    createComputePipeline();
+}
+
+void PixelDenoisePipeline::resize(VkExtent2D extent) {
+    m_extent = extent;
+
+    //the caller already recreated the compute images at the new size. the sets are rewritten in place, the pool and the layout stay
+    pingTexture.cleanUp();
+    pongTexture.cleanUp();
+    initImageBufferStorage();
+
+    for(uint32_t src = 0; src < DENOISE_IMAGE_COUNT; src++)
+    {
+        for(uint32_t dst = 0; dst < DENOISE_IMAGE_COUNT; dst++)
+        {
+            if(descriptorSets[src][dst] != VK_NULL_HANDLE)
+            {
+                writeDescriptorSet(descriptorSets[src][dst], static_cast<DenoiseImage>(src), static_cast<DenoiseImage>(dst));
+            }
+        }
+    }
+}
+
+void PixelDenoisePipeline::cleanUp() {
+
+    if(!pingTexture.hasBeenCleaned())
+    {
+        pingTexture.cleanUp();
+    }
+
+    if(!pongTexture.hasBeenCleaned())
+    {
+        pongTexture.cleanUp();
+    }
+
+    vkDestroyPipeline(m_backend->logicalDevice, computePipeline, nullptr);
+    vkDestroyPipelineLayout(m_backend->logicalDevice, computePipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(m_backend->logicalDevice, computeDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_backend->logicalDevice, computeDescriptorSetLayout, nullptr);
+}
+
+void PixelDenoisePipeline::addComputeShader(const std::string &filename) {
+    computeShaderModule = m_shaderCompiler->createShaderModule(filename);
+
+    computeCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeCreateShaderInfo.module = computeShaderModule;
+    computeCreateShaderInfo.pName = "main"; //the entry point of the shader
+}
+
+void PixelDenoisePipeline::initImageBufferStorage() {
+    pingTexture = PixelImage(m_backend, m_extent.width, m_extent.height, false);
+    pingTexture.loadEmptyTexture(m_extent.width, m_extent.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT);
+    pongTexture = PixelImage(m_backend, m_extent.width, m_extent.height, false);
+    pongTexture.loadEmptyTexture(m_extent.width, m_extent.height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT);
+}
+
+void PixelDenoisePipeline::createDescriptorSetLayout() {
+    std::array<VkDescriptorSetLayoutBinding, 4> layoutBindings{};
+
+    //color input, color output, normal/depth and albedo. all of them are storage images
+    for(uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        layoutBindings[i].pImmutableSamplers = nullptr;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_backend->logicalDevice, &layoutInfo, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create denoise descriptor set layout!");
+    }
+}
+
+void PixelDenoisePipeline::createDescriptorPool() {
+
+    //one set per src/dst pair an iteration can use
+    uint32_t MAX_DESCRIPTOR_SETS = DENOISE_IMAGE_COUNT * DENOISE_IMAGE_COUNT;
+
+    VkDescriptorPoolSize imageStorageDescriptorSize{};
+    imageStorageDescriptorSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    imageStorageDescriptorSize.descriptorCount = MAX_DESCRIPTOR_SETS * 4;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = MAX_DESCRIPTOR_SETS;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &imageStorageDescriptorSize;
+
+    VkResult result = vkCreateDescriptorPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &computeDescriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool for denoise pipeline");
+    }
+}
+
+void PixelDenoisePipeline::createDescriptorSets() {
+
+    //every transition getDescriptorSet can ask for
+    descriptorSets[DENOISE_INPUT][DENOISE_PING] = allocateDescriptorSet(DENOISE_INPUT, DENOISE_PING);
+    descriptorSets[DENOISE_INPUT][DENOISE_OUTPUT] = allocateDescriptorSet(DENOISE_INPUT, DENOISE_OUTPUT);
+    descriptorSets[DENOISE_PING][DENOISE_PONG] = allocateDescriptorSet(DENOISE_PING, DENOISE_PONG);
+    descriptorSets[DENOISE_PONG][DENOISE_PING] = allocateDescriptorSet(DENOISE_PONG, DENOISE_PING);
+    descriptorSets[DENOISE_PING][DENOISE_OUTPUT] = allocateDescriptorSet(DENOISE_PING, DENOISE_OUTPUT);
+    descriptorSets[DENOISE_PONG][DENOISE_OUTPUT] = allocateDescriptorSet(DENOISE_PONG, DENOISE_OUTPUT);
+}
+
+VkDescriptorSet PixelDenoisePipeline::allocateDescriptorSet(DenoiseImage src, DenoiseImage dst) {
+
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = computeDescriptorPool;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &computeDescriptorSetLayout;
+
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &setAllocateInfo, &descriptorSet);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor set for the denoiser");
+    }
+
+    writeDescriptorSet(descriptorSet, src, dst);
+
+    return descriptorSet;
+}
+
+void PixelDenoisePipeline::writeDescriptorSet(VkDescriptorSet descriptorSet, DenoiseImage src, DenoiseImage dst) {
+
+    std::array<VkDescriptorImageInfo, 4> imageInfos{};
+    imageInfos[0].imageView = colorImages[src]->getImageView();
+    imageInfos[1].imageView = colorImages[dst]->getImageView();
+    imageInfos[2].imageView = normalDepthTexture->getImageView();
+    imageInfos[3].imageView = albedoTexture->getImageView();
+
+    std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+    for(uint32_t i = 0; i < descriptorWrites.size(); i++)
+    {
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_backend->logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void PixelDenoisePipeline::createComputePipelineLayout() {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &computeDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &PixelDenoisePipeline::pushDenoiseConstantRange;
+
+    if (vkCreatePipelineLayout(m_backend->logicalDevice, &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create denoise pipeline layout!");
+    }
+}
+
+void PixelDenoisePipeline::createComputePipeline() {
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = computePipelineLayout;
+    pipelineInfo.stage = computeCreateShaderInfo;
+
+    VkResult result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the denoise pipeline");
+    }
+
+    //we no longer need it once the pipeline has been created
+    vkDestroyShaderModule(m_backend->logicalDevice, computeShaderModule, nullptr);
+}
+
+VkPipeline PixelDenoisePipeline::swapPipeline(VkPipeline pipeline) {
+    std::swap(computePipeline, pipeline);
+    return pipeline;
+}
+
+VkPipeline PixelDenoisePipeline::getPipeline() {
+    return computePipeline;
+}
+
+VkPipelineLayout PixelDenoisePipeline::getPipelineLayout() {
+    return computePipelineLayout;
+}
+
+VkDescriptorSet PixelDenoisePipeline::getDescriptorSet(uint32_t iteration, uint32_t iterationCount) {
+
+    //iteration 0 writes to ping, 1 to pong, 2 to ping... except for the last one which writes to the output
+    auto target = [iterationCount](uint32_t i) {
+        if(i == iterationCount - 1)
+        {
+            return DENOISE_OUTPUT;
+        }
+        return i % 2 == 0 ? DENOISE_PING : DENOISE_PONG;
+    };
+
+    DenoiseImage src = iteration == 0 ? DENOISE_INPUT : target(iteration - 1);
+    DenoiseImage dst = target(iteration);
+
+    return descriptorSets[src][dst];
+}
+
+PixelDenoisePipeline::PObj PixelDenoisePipeline::getPushObj(uint32_t iteration, float colorPhi) {
+
+    //the step doubles every iteration while the color tolerance is halved, so later iterations only smooth what is left of the noise
+    float iterationScale = 1.0f / static_cast<float>(1 << iteration);
+    return {1 << iteration, colorPhi * iterationScale, DENOISE_NORMAL_PHI, DENOISE_DEPTH_PHI, DENOISE_ALBEDO_PHI};
+}
+
+PixelImage* PixelDenoisePipeline::getPingTexture() {
+    return &pingTexture;
+}
+
+PixelImage* PixelDenoisePipeline::getPongTexture() {
+    return &pongTexture;
+}
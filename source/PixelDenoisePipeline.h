@@ -0,0 +1,90 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELDENOISEPIPELINE_H
+#define PIXELENGINE_PIXELDENOISEPIPELINE_H
+
+#include "PixelImage.h"
+#include "PixelShaderCompiler.h"
+
+#include <array>
+
+const int MAX_DENOISE_ITERATIONS = 5; //the last iteration has a step of 16 pixels, its footprint covers 65x65 pixels
+
+//default edge-stopping parameters. the color one is halved every iteration
+const float DENOISE_COLOR_PHI = 0.4f;
+const float DENOISE_NORMAL_PHI = 0.1f;
+const float DENOISE_DEPTH_PHI = 0.5f;
+const float DENOISE_ALBEDO_PHI = 0.05f;
+
+class PixelDenoisePipeline {
+public:
+    PixelDenoisePipeline(PixBackend* backend, VkExtent2D extent);
+    PixelDenoisePipeline() = default;
+
+    struct PObj{
+        int32_t stepWidth;
+        float colorPhi;
+        float normalPhi;
+        float depthPhi;
+        float albedoPhi;
+    };
+
+    //images an iteration can read from or write to. the first iteration reads the accumulated color,
+    //the last one writes the denoised image the outline is composited over and the ones in between ping-pong between the two denoiser images
+    enum DenoiseImage{
+        DENOISE_INPUT = 0,
+        DENOISE_PING,
+        DENOISE_PONG,
+        DENOISE_OUTPUT,
+        DENOISE_IMAGE_COUNT
+    };
+
+    void init(PixelShaderCompiler* shaderCompiler, PixelImage* colorInput, PixelImage* colorOutput, PixelImage* normalDepth, PixelImage* albedo);
+    VkPipeline swapPipeline(VkPipeline pipeline); //between two frames, returns the one it replaced
+    void resize(VkExtent2D extent);
+    void cleanUp();
+    static constexpr VkPushConstantRange pushDenoiseConstantRange {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PObj)};
+
+    //getters
+    VkPipeline getPipeline();
+    VkPipelineLayout getPipelineLayout();
+    VkDescriptorSet getDescriptorSet(uint32_t iteration, uint32_t iterationCount);
+    PObj getPushObj(uint32_t iteration, float colorPhi);
+    PixelImage* getPingTexture();
+    PixelImage* getPongTexture();
+    VkExtent2D getExtent(){return m_extent;}
+
+private:
+
+    void addComputeShader(const std::string& filename);
+    void initImageBufferStorage();
+    void createDescriptorSetLayout();
+    void createDescriptorPool();
+    void createDescriptorSets();
+    void createComputePipelineLayout();
+    void createComputePipeline();
+    VkDescriptorSet allocateDescriptorSet(DenoiseImage src, DenoiseImage dst);
+    void writeDescriptorSet(VkDescriptorSet descriptorSet, DenoiseImage src, DenoiseImage dst);
+
+    VkExtent2D m_extent{};
+    PixelImage pingTexture;
+    PixelImage pongTexture;
+    std::array<PixelImage*, DENOISE_IMAGE_COUNT> colorImages{};
+    PixelImage* normalDepthTexture = nullptr;
+    PixelImage* albedoTexture = nullptr;
+
+    PixBackend* m_backend{};
+    PixelShaderCompiler* m_shaderCompiler{};
+    VkPipelineShaderStageCreateInfo computeCreateShaderInfo{};
+    VkPipeline computePipeline = VK_NULL_HANDLE;
+    VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkDescriptorSetLayout computeDescriptorSetLayout{};
+    VkDescriptorPool computeDescriptorPool{};
+    std::array<std::array<VkDescriptorSet, DENOISE_IMAGE_COUNT>, DENOISE_IMAGE_COUNT> descriptorSets{}; //indexed by [src][dst]
+};
+
+
+#endif //PIXELENGINE_PIXELDENOISEPIPELINE_H
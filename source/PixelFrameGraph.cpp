@@ -0,0 +1,499 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelFrameGraph.h"
+
+#include <algorithm>
+#include <limits>
+
+PixelFrameGraph::PixelFrameGraph(PixBackend* backend) : m_backend(backend) {
+
+}
+
+void PixelFrameGraph::init(const std::array<VkQueue, FRAME_GRAPH_QUEUE_COUNT>& queues, const std::array<uint32_t, FRAME_GRAPH_QUEUE_COUNT>& queueFamilies) {
+
+    m_queues = queues;
+    m_queueFamilies = queueFamilies;
+
+    for(uint32_t queue = 0; queue < FRAME_GRAPH_QUEUE_COUNT; queue++)
+    {
+        VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+        semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        semaphoreTypeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+        VkResult result = vkCreateSemaphore(m_backend->logicalDevice, &semaphoreCreateInfo, nullptr, &m_timelines[queue]);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create a timeline semaphore");
+        }
+
+        //one pool per queue, the two queues can be of the same family but are recorded for separately
+        VkCommandPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolCreateInfo.queueFamilyIndex = m_queueFamilies[queue];
+
+        result = vkCreateCommandPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &m_commandPools[queue]);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create the frame graph command pool");
+        }
+
+        for(uint32_t slot = 0; slot < FRAME_GRAPH_FRAME_SLOTS; slot++)
+        {
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+            commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            commandBufferAllocateInfo.commandPool = m_commandPools[queue];
+            commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            commandBufferAllocateInfo.commandBufferCount = FRAME_GRAPH_MAX_SUBMITS;
+
+            result = vkAllocateCommandBuffers(m_backend->logicalDevice, &commandBufferAllocateInfo, m_commandBuffers[slot][queue].data());
+            if(result != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate the frame graph command buffers");
+            }
+        }
+    }
+}
+
+void PixelFrameGraph::cleanUp() {
+    for(uint32_t queue = 0; queue < FRAME_GRAPH_QUEUE_COUNT; queue++)
+    {
+        //the command buffers go with their pool
+        vkDestroyCommandPool(m_backend->logicalDevice, m_commandPools[queue], nullptr);
+        vkDestroySemaphore(m_backend->logicalDevice, m_timelines[queue], nullptr);
+    }
+}
+
+uint32_t PixelFrameGraph::addImage(const std::string& name, VkImage image, VkImageLayout layout, FrameGraphQueue owner, bool renderPassLayout) {
+    Resource resource{};
+    resource.name = name;
+    resource.image = image;
+    resource.layout = layout;
+    resource.owner = owner;
+    resource.renderPassLayout = renderPassLayout;
+    m_resources.push_back(resource);
+    return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+void PixelFrameGraph::setImage(uint32_t resource, VkImage image, VkImageLayout layout, FrameGraphQueue owner) {
+    //nothing is in flight, the accesses to the old image do not matter anymore
+    Resource& pixResource = m_resources[resource];
+    pixResource.image = image;
+    pixResource.layout = layout;
+    pixResource.owner = owner;
+    pixResource.hasWrite = false;
+    pixResource.reads.clear();
+}
+
+void PixelFrameGraph::waitExternal(uint32_t resource, VkSemaphore semaphore) {
+    m_resources[resource].externalWait = semaphore;
+}
+
+void PixelFrameGraph::signalExternal(uint32_t resource, VkSemaphore semaphore) {
+    m_resources[resource].externalSignal = semaphore;
+}
+
+void PixelFrameGraph::beginFrame(uint32_t slot) {
+
+    m_slot = slot;
+
+    //the command buffers of the slot can only be recorded again once everything they were submitted with is done
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = FRAME_GRAPH_QUEUE_COUNT;
+    waitInfo.pSemaphores = m_timelines.data();
+    waitInfo.pValues = m_slotValues[slot].data();
+    vkWaitSemaphores(m_backend->logicalDevice, &waitInfo, std::numeric_limits<uint64_t>::max());
+
+    m_usedCommandBuffers = {};
+    m_currentSubmissions.fill(-1);
+    m_passes.clear();
+    m_submissions.clear();
+}
+
+uint32_t PixelFrameGraph::addPass(const std::string& name, FrameGraphQueue queue, std::function<void(VkCommandBuffer)> record) {
+    Pass pass{};
+    pass.name = name;
+    pass.queue = queue;
+    pass.record = std::move(record);
+    m_passes.push_back(pass);
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void PixelFrameGraph::read(uint32_t pass, uint32_t resource, FrameGraphUse use) {
+    m_passes[pass].uses.push_back({resource, use, false});
+}
+
+void PixelFrameGraph::write(uint32_t pass, uint32_t resource, FrameGraphUse use) {
+    m_passes[pass].uses.push_back({resource, use, true});
+}
+
+void PixelFrameGraph::execute() {
+
+    m_barrierCount = 0;
+    std::vector<int32_t> lastUse(m_resources.size(), -1); //submission of the last pass that used each resource
+
+    for(auto& pass : m_passes)
+    {
+        struct Wait{
+            VkSemaphore semaphore;
+            uint64_t value;
+            VkPipelineStageFlags stage;
+        };
+        struct Barrier{
+            VkImageMemoryBarrier barrier;
+            VkPipelineStageFlags srcStage;
+            VkPipelineStageFlags dstStage;
+        };
+        std::vector<Wait> waits;
+        std::vector<Barrier> barriers;
+
+        for(const auto& resourceUse : pass.uses)
+        {
+            Resource& resource = m_resources[resourceUse.resource];
+            const FrameGraphUse& use = resourceUse.use;
+
+            //a read waits for the last write, a write also waits for the reads made since
+            std::vector<Access> dependencies;
+            if(resource.hasWrite)
+            {
+                dependencies.push_back(resource.lastWrite);
+            }
+            if(resourceUse.write)
+            {
+                dependencies.insert(dependencies.end(), resource.reads.begin(), resource.reads.end());
+            }
+
+            //on the same queue the submission order and a barrier are enough, across queues the timeline of the other one is waited on
+            VkPipelineStageFlags srcStage = 0;
+            VkAccessFlags srcAccess = 0;
+            bool queueDependency = false;
+            for(const auto& dependency : dependencies)
+            {
+                if(sameQueue(dependency.queue, pass.queue))
+                {
+                    srcStage |= dependency.stage;
+                    srcAccess |= dependency.write ? dependency.access : 0;
+                    queueDependency = true;
+                }
+                else
+                {
+                    waits.push_back({m_timelines[dependency.queue], dependency.value, use.stage});
+                    srcStage |= use.stage; //chained to the semaphore wait
+                }
+            }
+
+            if(resource.externalWait != VK_NULL_HANDLE)
+            {
+                waits.push_back({resource.externalWait, 0, use.stage});
+                resource.externalWait = VK_NULL_HANDLE;
+            }
+
+            if(resource.renderPassLayout)
+            {
+                continue;
+            }
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = resource.layout;
+            barrier.newLayout = use.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = resource.image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = use.access;
+
+            if(use.discard)
+            {
+                //the old content is dropped: no transfer, and the transition starts from the undefined layout
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.srcAccessMask = 0;
+                resource.owner = pass.queue;
+            }
+
+            if(m_queueFamilies[resource.owner] != m_queueFamilies[pass.queue])
+            {
+                //exclusive images change family through a release on the owner and an acquire here, with the same layouts
+                uint32_t release = releaseOwnership(resource, use, pass.queue);
+                waits.push_back({m_timelines[resource.owner], m_submissions[release].value, use.stage});
+
+                barrier.srcQueueFamilyIndex = m_queueFamilies[resource.owner];
+                barrier.dstQueueFamilyIndex = m_queueFamilies[pass.queue];
+                barrier.srcAccessMask = 0;
+                barriers.push_back({barrier, use.stage, use.stage});
+                resource.owner = pass.queue;
+            }
+            else if(queueDependency || resource.layout != use.layout)
+            {
+                barriers.push_back({barrier, srcStage != 0 ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, use.stage});
+            }
+
+            resource.layout = use.layout;
+        }
+
+        //a pass that waits on another queue starts a submission of its own, so the passes before it do not wait with it.
+        //it also never joins a submission that is followed by one of the other queue, both queues can be the same VkQueue
+        int32_t lastSubmission = static_cast<int32_t>(m_submissions.size()) - 1;
+        if(m_currentSubmissions[pass.queue] < 0 || m_currentSubmissions[pass.queue] != lastSubmission || !waits.empty())
+        {
+            m_currentSubmissions[pass.queue] = static_cast<int32_t>(beginSubmission(pass.queue));
+        }
+        pass.submission = static_cast<uint32_t>(m_currentSubmissions[pass.queue]);
+        Submission& submission = m_submissions[pass.submission];
+
+        for(const auto& wait : waits)
+        {
+            addWait(submission, wait.semaphore, wait.value, wait.stage);
+        }
+
+        for(const auto& barrier : barriers)
+        {
+            vkCmdPipelineBarrier(submission.commandBuffer,
+                                 barrier.srcStage, barrier.dstStage,
+                                 0,
+                                 0, nullptr,
+                                 0, nullptr,
+                                 1, &barrier.barrier);
+        }
+        m_barrierCount += static_cast<uint32_t>(barriers.size());
+
+        pass.record(submission.commandBuffer);
+
+        //the accesses of this pass are the ones the next passes depend on
+        for(const auto& resourceUse : pass.uses)
+        {
+            Resource& resource = m_resources[resourceUse.resource];
+            Access access{pass.queue, submission.value, resourceUse.use.stage, resourceUse.use.access, resourceUse.write};
+            if(resourceUse.write)
+            {
+                resource.hasWrite = true;
+                resource.lastWrite = access;
+                resource.reads.clear();
+            }
+            else
+            {
+                resource.reads.push_back(access);
+            }
+            lastUse[resourceUse.resource] = static_cast<int32_t>(pass.submission);
+        }
+    }
+
+    //the present waits on the submission that last touched the swapchain image
+    for(uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        Resource& resource = m_resources[i];
+        if(resource.externalSignal == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+        if(lastUse[i] < 0)
+        {
+            throw std::runtime_error("frame graph: " + resource.name + " has to be signaled but no pass uses it");
+        }
+        m_submissions[lastUse[i]].signalSemaphores.push_back(resource.externalSignal);
+        resource.externalSignal = VK_NULL_HANDLE;
+    }
+
+    m_waitCount = 0;
+    for(auto& submission : m_submissions)
+    {
+        VkResult result = vkEndCommandBuffer(submission.commandBuffer);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record frame graph command buffer!");
+        }
+
+        std::vector<VkSemaphore> signalSemaphores = submission.signalSemaphores;
+        std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+        signalSemaphores.push_back(m_timelines[submission.queue]);
+        signalValues.push_back(submission.value);
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(submission.waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = submission.waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(submission.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = submission.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = submission.waitStages.data();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        //the submissions are made in the order they were created, so a wait always comes after the signal it waits for
+        result = vkQueueSubmit(m_queues[submission.queue], 1, &submitInfo, VK_NULL_HANDLE);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit frame graph command buffer!");
+        }
+
+        m_slotValues[m_slot][submission.queue] = submission.value;
+        m_waitCount += static_cast<uint32_t>(submission.waitSemaphores.size());
+    }
+
+    m_submitCount = static_cast<uint32_t>(m_submissions.size());
+}
+
+uint64_t PixelFrameGraph::submit(FrameGraphQueue queue, VkCommandBuffer commandBuffer) {
+
+    uint64_t value = ++m_nextValues[queue];
+
+    VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineSubmitInfo.signalSemaphoreValueCount = 1;
+    timelineSubmitInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineSubmitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_timelines[queue];
+
+    VkResult result = vkQueueSubmit(m_queues[queue], 1, &submitInfo, VK_NULL_HANDLE);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+
+    return value;
+}
+
+void PixelFrameGraph::wait(FrameGraphQueue queue, uint64_t value) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timelines[queue];
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(m_backend->logicalDevice, &waitInfo, std::numeric_limits<uint64_t>::max());
+}
+
+bool PixelFrameGraph::isComplete(FrameGraphQueue queue, uint64_t value) {
+    return getCompletedValue(queue) >= value;
+}
+
+uint64_t PixelFrameGraph::getCompletedValue(FrameGraphQueue queue) {
+    uint64_t currentValue = 0;
+    vkGetSemaphoreCounterValue(m_backend->logicalDevice, m_timelines[queue], &currentValue);
+    return currentValue;
+}
+
+uint64_t PixelFrameGraph::getPassValue(uint32_t pass) {
+    return m_submissions[m_passes[pass].submission].value;
+}
+
+uint32_t PixelFrameGraph::beginSubmission(FrameGraphQueue queue) {
+
+    if(m_usedCommandBuffers[queue] >= FRAME_GRAPH_MAX_SUBMITS)
+    {
+        throw std::runtime_error("frame graph: too many submissions in one frame");
+    }
+
+    VkCommandBuffer commandBuffer = m_commandBuffers[m_slot][queue][m_usedCommandBuffers[queue]++];
+
+    VkCommandBufferBeginInfo bufferBeginInfo{};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to being recording frame graph command");
+    }
+
+    //the value is taken now, the submissions of a queue are made in the order they are created
+    Submission submission{};
+    submission.queue = queue;
+    submission.commandBuffer = commandBuffer;
+    submission.value = ++m_nextValues[queue];
+    m_submissions.push_back(submission);
+    return static_cast<uint32_t>(m_submissions.size() - 1);
+}
+
+void PixelFrameGraph::addWait(Submission& submission, VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage) {
+    //one wait per semaphore, on the latest value and for every stage that needs it
+    for(size_t i = 0; i < submission.waitSemaphores.size(); i++)
+    {
+        if(submission.waitSemaphores[i] == semaphore)
+        {
+            submission.waitValues[i] = std::max(submission.waitValues[i], value);
+            submission.waitStages[i] |= stage;
+            return;
+        }
+    }
+
+    submission.waitSemaphores.push_back(semaphore);
+    submission.waitValues.push_back(value);
+    submission.waitStages.push_back(stage);
+}
+
+uint32_t PixelFrameGraph::releaseOwnership(const Resource& resource, FrameGraphUse use, FrameGraphQueue queue) {
+
+    //the release goes at the end of the submission the owner queue has open this frame, it comes after every use there.
+    //only when the owner has not submitted anything yet does it need a submission of its own
+    int32_t current = m_currentSubmissions[resource.owner];
+    uint32_t release = current >= 0 ? static_cast<uint32_t>(current) : beginSubmission(resource.owner);
+    m_currentSubmissions[resource.owner] = static_cast<int32_t>(release);
+
+    //the release comes after the last accesses on the owner queue
+    VkPipelineStageFlags srcStage = 0;
+    VkAccessFlags srcAccess = 0;
+    std::vector<Access> accesses = resource.reads;
+    if(resource.hasWrite)
+    {
+        accesses.push_back(resource.lastWrite);
+    }
+    for(const auto& access : accesses)
+    {
+        if(sameQueue(access.queue, resource.owner))
+        {
+            srcStage |= access.stage;
+            srcAccess |= access.write ? access.access : 0;
+        }
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = resource.layout;
+    barrier.newLayout = use.layout;
+    barrier.srcQueueFamilyIndex = m_queueFamilies[resource.owner];
+    barrier.dstQueueFamilyIndex = m_queueFamilies[queue];
+    barrier.image = resource.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0; //ignored by a release
+
+    vkCmdPipelineBarrier(m_submissions[release].commandBuffer,
+                         srcStage != 0 ? srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+    m_barrierCount++;
+
+    return release;
+}
@@ -0,0 +1,149 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELFRAMEGRAPH_H
+#define PIXELENGINE_PIXELFRAMEGRAPH_H
+
+#include "Utility.h"
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+const uint32_t FRAME_GRAPH_FRAME_SLOTS = 2; //frames in flight the command buffers are allocated for
+const uint32_t FRAME_GRAPH_MAX_SUBMITS = 4; //submissions a queue can get in one frame, ownership releases included
+
+enum FrameGraphQueue{
+    FRAME_GRAPH_COMPUTE = 0,
+    FRAME_GRAPH_GRAPHICS = 1,
+    FRAME_GRAPH_QUEUE_COUNT = 2
+};
+
+//how a pass uses a resource
+struct FrameGraphUse{
+    VkPipelineStageFlags stage;
+    VkAccessFlags access;
+    VkImageLayout layout; //ignored for the images whose layout a render pass handles
+    bool discard = false; //the pass overwrites all of it, so neither the old content nor the family that owned it matter
+};
+
+//the passes of a frame declare what they read and write, and the graph derives the barriers, the layout transitions,
+//the queue ownership transfers and the semaphore waits from the last accesses to each resource.
+//every queue has a timeline semaphore that counts its submissions, so a pass waits for exactly the submission it depends on
+//and the work of the next frame that does not depend on the other queue is free to overlap it
+class PixelFrameGraph {
+public:
+    PixelFrameGraph() = default;
+    explicit PixelFrameGraph(PixBackend* backend);
+
+    void init(const std::array<VkQueue, FRAME_GRAPH_QUEUE_COUNT>& queues, const std::array<uint32_t, FRAME_GRAPH_QUEUE_COUNT>& queueFamilies);
+    void cleanUp();
+
+    //resources live from one frame to the next, the graph keeps their layout, owner and last accesses
+    uint32_t addImage(const std::string& name, VkImage image, VkImageLayout layout, FrameGraphQueue owner, bool renderPassLayout = false);
+    void setImage(uint32_t resource, VkImage image, VkImageLayout layout, FrameGraphQueue owner); //a new image after a resize, only while the device is idle
+    void waitExternal(uint32_t resource, VkSemaphore semaphore); //binary semaphore the next use of the resource waits on
+    void signalExternal(uint32_t resource, VkSemaphore semaphore); //binary semaphore signaled after its last use this frame
+
+    //frames. beginFrame waits until the submissions of the last frame that used the slot are done
+    void beginFrame(uint32_t slot);
+    uint32_t addPass(const std::string& name, FrameGraphQueue queue, std::function<void(VkCommandBuffer)> record);
+    void read(uint32_t pass, uint32_t resource, FrameGraphUse use);
+    void write(uint32_t pass, uint32_t resource, FrameGraphUse use);
+    void execute();
+
+    //work recorded outside of the graph. it is ordered on its queue by its own barriers
+    uint64_t submit(FrameGraphQueue queue, VkCommandBuffer commandBuffer);
+    void wait(FrameGraphQueue queue, uint64_t value);
+    bool isComplete(FrameGraphQueue queue, uint64_t value);
+    uint64_t getCompletedValue(FrameGraphQueue queue);
+    uint64_t getSubmittedValue(FrameGraphQueue queue){return m_nextValues[queue];} //reached once all the work submitted so far is done
+
+    //getters
+    uint64_t getPassValue(uint32_t pass); //timeline value of the pass's queue once it is done, valid after execute
+    uint32_t getSubmitCount(){return m_submitCount;}
+    uint32_t getBarrierCount(){return m_barrierCount;}
+    uint32_t getWaitCount(){return m_waitCount;}
+
+private:
+
+    struct Access{
+        FrameGraphQueue queue;
+        uint64_t value; //timeline value of the submission it is in
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        bool write;
+    };
+
+    struct Resource{
+        std::string name;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        FrameGraphQueue owner = FRAME_GRAPH_GRAPHICS;
+        bool renderPassLayout = false;
+        bool hasWrite = false;
+        Access lastWrite{};
+        std::vector<Access> reads; //since the last write
+        VkSemaphore externalWait = VK_NULL_HANDLE;
+        VkSemaphore externalSignal = VK_NULL_HANDLE;
+    };
+
+    struct ResourceUse{
+        uint32_t resource;
+        FrameGraphUse use;
+        bool write;
+    };
+
+    struct Pass{
+        std::string name;
+        FrameGraphQueue queue;
+        std::function<void(VkCommandBuffer)> record;
+        std::vector<ResourceUse> uses;
+        uint32_t submission = 0;
+    };
+
+    struct Submission{
+        FrameGraphQueue queue;
+        VkCommandBuffer commandBuffer;
+        uint64_t value;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues; //0 for the binary semaphores
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkSemaphore> signalSemaphores; //binary, the timeline of the queue is added when submitting
+    };
+
+    //helper functions
+    uint32_t beginSubmission(FrameGraphQueue queue);
+    void addWait(Submission& submission, VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage);
+    uint32_t releaseOwnership(const Resource& resource, FrameGraphUse use, FrameGraphQueue queue);
+    bool sameQueue(FrameGraphQueue a, FrameGraphQueue b){return m_queues[a] == m_queues[b];}
+
+    std::array<VkQueue, FRAME_GRAPH_QUEUE_COUNT> m_queues{};
+    std::array<uint32_t, FRAME_GRAPH_QUEUE_COUNT> m_queueFamilies{};
+    std::array<VkSemaphore, FRAME_GRAPH_QUEUE_COUNT> m_timelines{};
+    std::array<uint64_t, FRAME_GRAPH_QUEUE_COUNT> m_nextValues{}; //last value submitted on each timeline
+    std::array<VkCommandPool, FRAME_GRAPH_QUEUE_COUNT> m_commandPools{};
+
+    //command buffers of every frame slot, and the values they have to reach before the slot is reused
+    std::array<std::array<std::array<VkCommandBuffer, FRAME_GRAPH_MAX_SUBMITS>, FRAME_GRAPH_QUEUE_COUNT>, FRAME_GRAPH_FRAME_SLOTS> m_commandBuffers{};
+    std::array<std::array<uint64_t, FRAME_GRAPH_QUEUE_COUNT>, FRAME_GRAPH_FRAME_SLOTS> m_slotValues{};
+    std::array<uint32_t, FRAME_GRAPH_QUEUE_COUNT> m_usedCommandBuffers{};
+    std::array<int32_t, FRAME_GRAPH_QUEUE_COUNT> m_currentSubmissions{}; //the one the next pass of each queue joins, -1 for none
+    uint32_t m_slot = 0;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<Submission> m_submissions;
+
+    //the last frame, for the gui
+    uint32_t m_submitCount = 0;
+    uint32_t m_barrierCount = 0;
+    uint32_t m_waitCount = 0;
+
+    PixBackend* m_backend{};
+};
+
+
+#endif //PIXELENGINE_PIXELFRAMEGRAPH_H
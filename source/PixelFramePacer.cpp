@@ -0,0 +1,83 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelFramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+void PixelFramePacer::waitForNextFrame() {
+
+    double now = glfwGetTime();
+
+    if(isLimiting())
+    {
+        //sleep_for can overshoot by a whole scheduler tick, so it is only used while the slowest sleep seen so far still fits
+        while(m_nextFrameTime - now > sleepEstimate())
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(PACER_SLEEP_STEP));
+            double woke = glfwGetTime();
+            addSleepSample(woke - now);
+            now = woke;
+        }
+
+        while(now < m_nextFrameTime)
+        {
+            std::this_thread::yield();
+            now = glfwGetTime();
+        }
+
+        m_wakeErrorMs = static_cast<float>((now - m_nextFrameTime) * 1000.0);
+
+        //a frame that is more than a period late does not make the next ones rush to catch up
+        double period = 1.0 / m_targetFps;
+        m_nextFrameTime = now - m_nextFrameTime > period ? now + period : m_nextFrameTime + period;
+    }
+    else
+    {
+        m_wakeErrorMs = 0.0f;
+        m_nextFrameTime = now;
+    }
+
+    m_frameTimeMs = static_cast<float>((now - m_lastFrameTime) * 1000.0);
+    m_lastFrameTime = now;
+}
+
+double PixelFramePacer::getTimeUntilNextFrame() {
+    return isLimiting() ? std::max(m_nextFrameTime - glfwGetTime(), 0.0) : 0.0;
+}
+
+void PixelFramePacer::inputReceived(double inputTime) {
+    //the oldest input not shown yet is the one that waits the longest
+    if(m_pendingInputTime < 0.0)
+    {
+        m_pendingInputTime = inputTime;
+    }
+}
+
+void PixelFramePacer::framePresented(double presentTime, float gpuMs, float displayMs) {
+    if(m_pendingInputTime < 0.0)
+    {
+        return;
+    }
+
+    float latencyMs = static_cast<float>((presentTime - m_pendingInputTime) * 1000.0) + gpuMs + displayMs;
+    m_latencyMs = m_latencyMs == 0.0f ? latencyMs : m_latencyMs + PACER_LATENCY_SMOOTHING * (latencyMs - m_latencyMs);
+    m_pendingInputTime = -1.0;
+}
+
+double PixelFramePacer::sleepEstimate() {
+    return m_sleepMean + std::sqrt(m_sleepVariance);
+}
+
+void PixelFramePacer::addSleepSample(double seconds) {
+    //exact mean and variance for the first samples, then an exponential average so a change of timer resolution is picked up
+    m_sleepCount = std::min(m_sleepCount + 1, PACER_SLEEP_SAMPLES);
+    double weight = 1.0 / m_sleepCount;
+    double delta = seconds - m_sleepMean;
+    m_sleepMean += weight * delta;
+    m_sleepVariance = (1.0 - weight) * (m_sleepVariance + weight * delta * delta);
+}
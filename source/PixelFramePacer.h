@@ -0,0 +1,62 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELFRAMEPACER_H
+#define PIXELENGINE_PIXELFRAMEPACER_H
+
+#include "Utility.h"
+
+#include <cstdint>
+
+const float DEFAULT_TARGET_FPS = 60.0f;
+const double PACER_SLEEP_STEP = 0.001; //seconds. short sleeps so the os overshoot stays small, the end of the wait is spun
+const uint32_t PACER_SLEEP_SAMPLES = 256; //sleeps the overshoot estimate is averaged over before it starts forgetting
+const float PACER_LATENCY_SMOOTHING = 0.1f; //weight of a new frame in the latency readout
+
+//limits the rate frames are started at and estimates the latency from input to photon.
+//everything is in seconds of glfwGetTime, except the readouts that are in ms
+class PixelFramePacer {
+public:
+    PixelFramePacer() = default;
+
+    //blocks until the next frame is due. sleeps in PACER_SLEEP_STEP steps while more than the mean plus one standard deviation
+    //of the measured step length is left, then spins the rest
+    void waitForNextFrame();
+    double getTimeUntilNextFrame(); //0 when the limiter is off or the frame is late
+
+    //the input is the first event since the last frame that was presented. the photon estimate adds the gpu time of the frame
+    //and the time the display takes to show it
+    void inputReceived(double inputTime);
+    void framePresented(double presentTime, float gpuMs, float displayMs);
+
+    bool isLimiting(){return m_targetFps > 0.0f;}
+
+    //getters
+    float* getTargetFps(){return &m_targetFps;} //0 for no limit
+    float getLatencyMs(){return m_latencyMs;}
+    float getFrameTimeMs(){return m_frameTimeMs;}
+    float getWakeErrorMs(){return m_wakeErrorMs;} //how late the last wait returned
+    float getSleepOvershootMs(){return static_cast<float>(sleepEstimate() * 1000.0);}
+
+private:
+    double sleepEstimate();
+    void addSleepSample(double seconds);
+
+    float m_targetFps = DEFAULT_TARGET_FPS;
+    double m_nextFrameTime = 0.0;
+    double m_lastFrameTime = 0.0;
+
+    //running mean and variance of how long a PACER_SLEEP_STEP sleep actually takes
+    uint32_t m_sleepCount = 0;
+    double m_sleepMean = PACER_SLEEP_STEP;
+    double m_sleepVariance = 0.0;
+
+    double m_pendingInputTime = -1.0; //-1 when no input is waiting to be presented
+    float m_latencyMs = 0.0f;
+    float m_frameTimeMs = 0.0f;
+    float m_wakeErrorMs = 0.0f;
+};
+
+
+#endif //PIXELENGINE_PIXELFRAMEPACER_H
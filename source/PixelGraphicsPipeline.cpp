@@ -7,18 +7,17 @@
 #include <array>
 
 void PixelGraphicsPipeline::addVertexShader(const std::string &filename) {
-    vertexShaderModule = addShaderModule(m_device, filename);
+    vertexShaderModule = m_shaderCompiler->createShaderModule(filename);
+    vertexShaderFilename = filename;
 }
 
 void PixelGraphicsPipeline::addFragmentShader(const std::string &filename) {
-    fragmentShaderModule = addShaderModule(m_device, filename);
+    fragmentShaderModule = m_shaderCompiler->createShaderModule(filename);
+    fragmentShaderFilename = filename;
 }
 
 void PixelGraphicsPipeline::createGraphicsPipeline(const VkRenderPass& inputRenderPass) {
 
-    //the shader create infos have to be passed in as an array
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertexCreateShaderInfo, fragmentCreateShaderInfo};
-
     VkResult result = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
     if(result != VK_SUCCESS)
     {
@@ -38,6 +37,45 @@ void PixelGraphicsPipeline::createGraphicsPipeline(const VkRenderPass& inputRend
     }
 
 
+    result = createPipeline(vertexShaderModule, fragmentShaderModule, &graphicsPipeline);
+
+    vkDestroyShaderModule(m_device, vertexShaderModule, nullptr);
+    vkDestroyShaderModule(m_device, fragmentShaderModule, nullptr);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics pipeline");
+    }
+}
+
+VkPipeline PixelGraphicsPipeline::buildPipeline(const std::vector<uint32_t>& vertexSpirv, const std::vector<uint32_t>& fragmentSpirv) {
+
+    VkShaderModule vertexModule = m_shaderCompiler->createShaderModule(vertexSpirv);
+    VkShaderModule fragmentModule = m_shaderCompiler->createShaderModule(fragmentSpirv);
+
+    VkPipeline pipeline;
+    VkResult result = createPipeline(vertexModule, fragmentModule, &pipeline);
+
+    vkDestroyShaderModule(m_device, vertexModule, nullptr);
+    vkDestroyShaderModule(m_device, fragmentModule, nullptr);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to rebuild graphics pipeline");
+    }
+    return pipeline;
+}
+
+VkPipeline PixelGraphicsPipeline::swapPipeline(VkPipeline pipeline) {
+    std::swap(graphicsPipeline, pipeline);
+    return pipeline;
+}
+
+VkResult PixelGraphicsPipeline::createPipeline(VkShaderModule vertexModule, VkShaderModule fragmentModule, VkPipeline* pipeline) {
+
+    //the shader create infos have to be passed in as an array
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertexCreateShaderInfo, fragmentCreateShaderInfo};
+    shaderStages[0].module = vertexModule;
+    shaderStages[1].module = fragmentModule;
+
     //graphics pipeline info
     VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
     graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -46,7 +84,7 @@ void PixelGraphicsPipeline::createGraphicsPipeline(const VkRenderPass& inputRend
     graphicsPipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo; //all fixed functions pipeline stages
     graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
     graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-    graphicsPipelineCreateInfo.pDynamicState = VK_NULL_HANDLE; //&dynamicStateCreateInfo;
+    graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo; //viewport and scissor follow the swapchain, the pipeline survives a resize
     graphicsPipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
     graphicsPipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
     graphicsPipelineCreateInfo.pColorBlendState = &blendStateCreateInfo;
@@ -59,14 +97,7 @@ void PixelGraphicsPipeline::createGraphicsPipeline(const VkRenderPass& inputRend
     graphicsPipelineCreateInfo.basePipelineIndex = -1; //or index pipeline from of multiple pipelines created once suing specfic funciton
 
     //create graphics pipeline
-    result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &graphicsPipeline);
-    if(result != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create graphics pipeline");
-    }
-
-    vkDestroyShaderModule(m_device, vertexShaderModule, nullptr);
-    vkDestroyShaderModule(m_device, fragmentShaderModule, nullptr);
+    return vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, pipeline);
 }
 
 void PixelGraphicsPipeline::cleanUp() {
@@ -144,7 +175,8 @@ void PixelGraphicsPipeline::createRenderPass() {
     }
 }
 
-PixelGraphicsPipeline::PixelGraphicsPipeline(VkDevice device, VkExtent2D inputExtent) : m_device(device), extent(inputExtent) {
+PixelGraphicsPipeline::PixelGraphicsPipeline(VkDevice device, VkExtent2D inputExtent, PixelShaderCompiler* shaderCompiler)
+        : m_device(device), m_shaderCompiler(shaderCompiler), extent(inputExtent) {
 
 }
 
@@ -223,12 +255,10 @@ void PixelGraphicsPipeline::populateGraphicsPipelineInfo() {
     viewportStateCreateInfo.pScissors = &scissor;
 
     //dynamic state
-    /*
-    //point to somethings you may change dynamically
+    //point to somethings you may change dynamically. the viewport above is only a placeholder, vkCmdSetViewport sets the real one
     dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicstates.size());
     dynamicStateCreateInfo.pDynamicStates = dynamicstates.data();
-     */
 
     // depth stencil create info
     depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -293,8 +323,8 @@ void PixelGraphicsPipeline::populatePipelineLayout(PixelScene* scene) {
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(scene->getAllDescriptorSetLayouts()->size());
     pipelineLayoutCreateInfo.pSetLayouts = scene->getAllDescriptorSetLayouts()->data();
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-    pipelineLayoutCreateInfo.pPushConstantRanges = &PixelObject::pushConstantRange;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 0; //the transforms are in the dynamic uniform buffer
+    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
 }
 
 VkPipelineLayout PixelGraphicsPipeline::getPipelineLayout() {
@@ -303,12 +333,12 @@ VkPipelineLayout PixelGraphicsPipeline::getPipelineLayout() {
 
 void
 PixelGraphicsPipeline::addRenderpassColorAttachment(VkFormat imageFormat, VkImageLayout initialLayout, VkImageLayout finalLayout, VkAttachmentStoreOp attachmentStoreOp,
-                                               VkImageLayout attachmentReferenceLayout) {
+                                               VkImageLayout attachmentReferenceLayout, VkAttachmentLoadOp attachmentLoadOp) {
 
     PixRenderpassAttachement attachment{};
     attachment.attachmentDescription.format = imageFormat;
     attachment.attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachment.attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; //this clears the buffer when we start the renderpass
+    attachment.attachmentDescription.loadOp = attachmentLoadOp; //default clears the buffer when we start the renderpass
     attachment.attachmentDescription.storeOp = attachmentStoreOp; //we want to present the result so we keep it
     attachment.attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachment.attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -6,19 +6,22 @@
 #define PIXELENGINE_PIXELGRAPHICSPIPELINE_H
 
 #include "PixelScene.h"
+#include "PixelShaderCompiler.h"
 
 #include <vector>
 
 class PixelGraphicsPipeline {
 public:
-    PixelGraphicsPipeline(VkDevice device, VkExtent2D inputExtent);
+    PixelGraphicsPipeline(VkDevice device, VkExtent2D inputExtent, PixelShaderCompiler* shaderCompiler);
     //PixelGraphicsPipeline(const PixelGraphicsPipeline&) = delete;
-    void addVertexShader(const std::string& filename);
+    void addVertexShader(const std::string& filename); //in SHADER_SOURCE_DIRECTORY, compiled by the shader compiler
     void addFragmentShader(const std::string& filename);
     void populateGraphicsPipelineInfo();
     void populatePipelineLayout(PixelScene* scene);
     void createGraphicsPipeline(const VkRenderPass& inputRenderPass);
-    void addRenderpassColorAttachment(VkFormat imageFormat, VkImageLayout initialLayout, VkImageLayout finalLayout, VkAttachmentStoreOp attachmentStoreOp, VkImageLayout attachmentReferenceLayout);
+    VkPipeline buildPipeline(const std::vector<uint32_t>& vertexSpirv, const std::vector<uint32_t>& fragmentSpirv); //from any thread, once created
+    VkPipeline swapPipeline(VkPipeline pipeline); //between two frames, returns the one it replaced
+    void addRenderpassColorAttachment(VkFormat imageFormat, VkImageLayout initialLayout, VkImageLayout finalLayout, VkAttachmentStoreOp attachmentStoreOp, VkImageLayout attachmentReferenceLayout, VkAttachmentLoadOp attachmentLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR);
     void addRenderpassDepthAttachment(VkFormat depthImageFormat);
     void createRenderPass();
     void setScreenDimensions(float x0, float x1, float y0, float y1);
@@ -29,8 +32,12 @@ public:
     VkRenderPass getRenderPass();
     VkPipeline getPipeline();
     VkPipelineLayout getPipelineLayout();
+    const std::string& getVertexShader(){return vertexShaderFilename;}
+    const std::string& getFragmentShader(){return fragmentShaderFilename;}
 private:
 
+    VkResult createPipeline(VkShaderModule vertexModule, VkShaderModule fragmentModule, VkPipeline* pipeline); //same state as the first one
+
     struct PixRenderpassAttachement
     {
         bool hasBeenDefined = false;
@@ -67,10 +74,13 @@ private:
     PixRenderpassAttachement renderPassDepthAttachment = {}; //only one attachment can be used per renderpass/subpass
 
     VkDevice m_device;
+    PixelShaderCompiler* m_shaderCompiler{};
     VkRenderPass renderPass = VK_NULL_HANDLE;
     VkPipeline graphicsPipeline = VK_NULL_HANDLE;
     VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
     VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+    std::string vertexShaderFilename; //the sources the pipeline is rebuilt from
+    std::string fragmentShaderFilename;
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
 
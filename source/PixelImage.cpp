@@ -48,7 +48,7 @@ void PixelImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlags
     //Subresource allow the view to view only a part of an image
     imageViewCreateInfo.subresourceRange.aspectMask = aspectFlags; //which aspect of image to use (color bit for viewing color)
     imageViewCreateInfo.subresourceRange.baseMipLevel = 0; //start mip map level to view from
-    imageViewCreateInfo.subresourceRange.levelCount = 1; //levels of mip map to view
+    imageViewCreateInfo.subresourceRange.levelCount = m_mipLevels; //levels of mip map to view
     imageViewCreateInfo.subresourceRange.baseArrayLayer = 0; //start array level to view from
     imageViewCreateInfo.subresourceRange.layerCount = 1; //layers to view
 
@@ -66,6 +66,48 @@ void PixelImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlags
     m_ressourcesCleaned = false;
 }
 
+VkImageView PixelImage::createLevelView(uint32_t level)
+{
+    VkImageViewCreateInfo imageViewCreateInfo = {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = m_image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = m_format;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = level;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    VkImageView levelView = VK_NULL_HANDLE;
+    VkResult result = vkCreateImageView(m_device->logicalDevice, &imageViewCreateInfo, nullptr, &levelView);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Was not able to create a mip level view for image: " + imageName);
+    }
+
+    return levelView;
+}
+
+uint32_t PixelImage::computeMipLevels(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for(uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+bool PixelImage::supportsLinearBlit()
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_device->physicalDevice, m_format, &formatProperties);
+
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
 std::string PixelImage::getName()
 {
     return imageName;
@@ -96,7 +138,7 @@ void PixelImage::createImage(VkImageTiling imageTiling, VkImageUsageFlags useFla
     imageCreateInfo.extent.width = m_width;
     imageCreateInfo.extent.height = m_height;
     imageCreateInfo.extent.depth = 1; //no 3D aspect
-    imageCreateInfo.mipLevels = 1; //TODO: implement mipmap
+    imageCreateInfo.mipLevels = m_mipLevels;
     imageCreateInfo.arrayLayers = 1;
     imageCreateInfo.format = m_format;
     imageCreateInfo.tiling = imageTiling;
@@ -129,37 +171,221 @@ void PixelImage::createImage(VkImageTiling imageTiling, VkImageUsageFlags useFla
 
     //connect image to memory
     vkBindImageMemory(m_device->logicalDevice, m_image, m_imageMemory, 0);
+    m_memorySize = imageMemoryRequirements.size;
 }
 
 VkFormat PixelImage::getFormat() {
     return m_format;
 }
 
-void PixelImage::loadTexture(std::string filename) {
+void PixelImage::loadTexture(std::string filename, bool normalMap, bool streamed) {
 
     int channels, width, height;
 
     std::string fileLocation = "Textures/" + filename;
-    stbi_uc* image = stbi_load(fileLocation.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    std::string cachePath = PixelTextureCompressor::getCachePath(filename, normalMap);
+    std::string sourceStamp = PixelTextureCompressor::getSourceStamp(fileLocation);
+
+    if(loadCachedTexture(cachePath, sourceStamp, streamed))
+    {
+        return;
+    }
 
-    m_width = (int)width;
-    m_height = (int) height;
+    stbi_uc* image = stbi_load(fileLocation.c_str(), &width, &height, &channels, STBI_rgb_alpha);
 
     if(!image)
     {
         throw std::runtime_error("Failed to load texture file: " + fileLocation);
     }
 
+    loadDecodedTexture(image, width, height, cachePath, sourceStamp, normalMap, streamed);
+}
+
+void PixelImage::loadPackedTexture(std::string redFilename, std::string greenFilename, bool streamed) {
+
+    std::string redLocation = "Textures/" + redFilename;
+    std::string greenLocation = "Textures/" + greenFilename;
+
+    //the two channels are independent like the two of a normal map, they are encoded the same way (bc5)
+    std::string cachePath = PixelTextureCompressor::getCachePath(redFilename + "+" + greenFilename, true);
+    std::string redStamp = PixelTextureCompressor::getSourceStamp(redLocation);
+    std::string greenStamp = PixelTextureCompressor::getSourceStamp(greenLocation);
+    std::string sourceStamp = redStamp.empty() || greenStamp.empty() ? "" : redStamp + "+" + greenStamp;
+
+    if(loadCachedTexture(cachePath, sourceStamp, streamed))
+    {
+        return;
+    }
+
+    int channels, width, height, greenWidth, greenHeight;
+    stbi_uc* red = stbi_load(redLocation.c_str(), &width, &height, &channels, STBI_grey);
+    if(!red)
+    {
+        throw std::runtime_error("Failed to load texture file: " + redLocation);
+    }
+    stbi_uc* green = stbi_load(greenLocation.c_str(), &greenWidth, &greenHeight, &channels, STBI_grey);
+    if(!green)
+    {
+        stbi_image_free(red);
+        throw std::runtime_error("Failed to load texture file: " + greenLocation);
+    }
+    if(greenWidth != width || greenHeight != height)
+    {
+        stbi_image_free(red);
+        stbi_image_free(green);
+        throw std::runtime_error("the packed textures " + redLocation + " and " + greenLocation + " do not have the same size");
+    }
+
+    //same ownership as an image loaded by stb, it is released with stbi_image_free
+    size_t texelCount = static_cast<size_t>(width) * height;
+    auto* image = static_cast<stbi_uc*>(malloc(texelCount * 4));
+    for(size_t i = 0; i < texelCount; i++)
+    {
+        image[i * 4] = red[i];
+        image[i * 4 + 1] = green[i];
+        image[i * 4 + 2] = 0;
+        image[i * 4 + 3] = 255;
+    }
+    stbi_image_free(red);
+    stbi_image_free(green);
+
+    loadDecodedTexture(image, width, height, cachePath, sourceStamp, true, streamed);
+}
+
+bool PixelImage::loadCachedTexture(const std::string& cachePath, const std::string& sourceStamp, bool streamed) {
+
+    //a texture compressed by an earlier run is uploaded as is, the source is not decoded at all.
+    //only the smallest levels of a streamed one are read, the streamer reads the others when the texture gets big enough on screen
+    PixelTextureCompressor::CompressedTexture compressed;
+    if(!PixelTextureCompressor::readCacheInfo(cachePath, sourceStamp, &compressed) || !PixelTextureCompressor::isSupported(m_device->physicalDevice, compressed.format) ||
+       !PixelTextureCompressor::readCache(cachePath, sourceStamp, &compressed, streamed ? tailLevelOf(compressed.width, compressed.height) : 0))
+    {
+        return false;
+    }
+
+    if(streamed)
+    {
+        m_cachePath = cachePath;
+        m_sourceStamp = sourceStamp;
+    }
+    loadCompressedTexture(std::move(compressed));
+    return true;
+}
+
+void PixelImage::loadDecodedTexture(stbi_uc* image, uint32_t width, uint32_t height, const std::string& cachePath, const std::string& sourceStamp, bool normalMap, bool streamed) {
+
+    m_width = width;
+    m_height = height;
+
+    VkFormat compressedFormat = PixelTextureCompressor::chooseFormat(m_device->physicalDevice,
+                                                                     PixelTextureCompressor::hasAlpha(image, static_cast<size_t>(m_width) * m_height), normalMap);
+    if(compressedFormat != VK_FORMAT_UNDEFINED)
+    {
+        PixelTextureCompressor::CompressedTexture compressed = PixelTextureCompressor::compress(image, m_width, m_height, compressedFormat);
+        stbi_image_free(image);
+
+        //without a cache file the texture cannot be streamed, it stays fully resident
+        if(!PixelTextureCompressor::writeCache(cachePath, sourceStamp, compressed))
+        {
+            std::cout<<"could not write the texture cache "<<cachePath<<", the texture will not be streamed"<<std::endl;
+        } else if(streamed)
+        {
+            m_cachePath = cachePath;
+            m_sourceStamp = sourceStamp;
+            PixelTextureCompressor::dropLevels(&compressed, tailLevelOf(compressed.width, compressed.height));
+        }
+
+        loadCompressedTexture(std::move(compressed));
+        return;
+    }
+
     m_imageSize = m_width * m_height * 4;
     m_imageData = image;
 
     //now that the image data and the information about the imagefile has been stored, we create the VkImage and the VkImageView for our texture
     m_format = VK_FORMAT_R8G8B8A8_UNORM; //here we set the format manually, we do not need to check if it is compatible with other features
 
+    //the full mip chain is generated once the first level is uploaded. it is blitted from level to level when the format can be
+    //filtered linearly, and downsampled by a compute shader writing the levels as storage images otherwise
+    m_mipLevels = computeMipLevels(m_width, m_height);
+    VkImageUsageFlags mipUsage = supportsLinearBlit() ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : VK_IMAGE_USAGE_STORAGE_BIT;
+
+    createImage(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | mipUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    createImageView(m_format, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void PixelImage::loadCompressedTexture(PixelTextureCompressor::CompressedTexture&& compressed) {
+
+    m_compressed = std::move(compressed);
+    m_firstResidentLevel = m_compressed.firstLevel;
+    m_width = std::max(m_compressed.width >> m_firstResidentLevel, 1u);
+    m_height = std::max(m_compressed.height >> m_firstResidentLevel, 1u);
+    m_format = m_compressed.format;
+    m_mipLevels = static_cast<uint32_t>(m_compressed.levelOffsets.size()); //the chain was encoded with the texture
+    m_imageSize = m_compressed.data.size();
+
     createImage(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     createImageView(m_format, VK_IMAGE_ASPECT_COLOR_BIT);
 }
 
+uint32_t PixelImage::tailLevelOf(uint32_t width, uint32_t height) {
+    uint32_t level = 0;
+    while(std::max(width >> level, height >> level) > TEXTURE_STREAM_TAIL_SIZE)
+    {
+        level++;
+    }
+    return level;
+}
+
+uint32_t PixelImage::getTailLevel() {
+    return isStreamable() ? tailLevelOf(m_compressed.width, m_compressed.height) : 0;
+}
+
+VkDeviceSize PixelImage::getResidentSize(uint32_t firstLevel) {
+    VkDeviceSize size = 0;
+    for(uint32_t level = firstLevel; level < PixelTextureCompressor::getLevelCount(getBaseWidth(), getBaseHeight()); level++)
+    {
+        size += PixelTextureCompressor::getLevelSize(m_format, std::max(getBaseWidth() >> level, 1u), std::max(getBaseHeight() >> level, 1u));
+    }
+    return size;
+}
+
+PixelImage::ImageHandles PixelImage::swapResidentLevels(PixelTextureCompressor::CompressedTexture&& levels) {
+    ImageHandles previous{m_image, m_imageView, m_imageMemory};
+    loadCompressedTexture(std::move(levels));
+    return previous;
+}
+
+void PixelImage::releaseHostData() {
+    stbi_image_free(m_imageData);
+    m_imageData = nullptr;
+
+    //the level offsets are kept, they only describe the image
+    m_compressed.data.clear();
+    m_compressed.data.shrink_to_fit();
+}
+
+void PixelImage::loadTexture(uint32_t width, uint32_t height, const std::vector<uint8_t>& texels, VkImageUsageFlags flags) {
+
+    m_width = width;
+    m_height = height;
+    m_imageSize = width * height * 4;
+
+    if(texels.size() != m_imageSize)
+    {
+        throw std::runtime_error("texel data does not match the size of the texture");
+    }
+
+    //same ownership as an image loaded by stb, it is released with stbi_image_free in cleanUp
+    m_imageData = static_cast<stbi_uc*>(malloc(m_imageSize));
+    memcpy(m_imageData, texels.data(), m_imageSize);
+
+    m_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    createImage(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    createImageView(m_format, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
 void PixelImage::loadEmptyTexture() {
     m_width = 1;
     m_height = 1;
@@ -171,10 +397,14 @@ void PixelImage::loadEmptyTexture() {
 }
 
 void PixelImage::loadEmptyTexture(uint32_t width, uint32_t height, VkImageUsageFlags flags) {
+    loadEmptyTexture(width, height, VK_FORMAT_R8G8B8A8_UNORM, flags);
+}
+
+void PixelImage::loadEmptyTexture(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags flags) {
     m_width = width;
     m_height = height;
-    m_imageSize = width * height * 4;
-    m_format = VK_FORMAT_R8G8B8A8_UNORM; //here we set the format manually, we do not need to check if it is compatible with other features
+    m_imageSize = width * height * (format == VK_FORMAT_R16G16B16A16_SFLOAT ? 8 : 4);
+    m_format = format; //the caller is responsible for picking a format that supports the given usage
 
     createImage(VK_IMAGE_TILING_OPTIMAL, flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     createImageView(m_format, VK_IMAGE_ASPECT_COLOR_BIT);
@@ -11,11 +11,21 @@
 
 #include "stb_image.h"
 #include "Utility.h"
+#include "PixelTextureCompressor.h"
 
 #include <iostream>
 
+const uint32_t TEXTURE_STREAM_TAIL_SIZE = 128; //the levels of a streamed texture this size and smaller are always resident
+
 class PixelImage {
 public:
+    //what a texture that changed its resident levels gives back, destroyed once no frame in flight samples it
+    struct ImageHandles{
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
     PixelImage(PixBackend* devices, uint32_t width, uint32_t height, bool isSwapChainImage);
     PixelImage() = default;
 
@@ -25,6 +35,7 @@ public:
     //create functions
     void createImage(VkImageTiling imageTiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags);
     void createImageView(VkFormat format, VkImageAspectFlags aspectFlags);
+    VkImageView createLevelView(uint32_t level); //view of a single mip level, destroyed by the caller
     void createDepthBufferImage();
     void createTexture(std::string fileName);
 
@@ -37,30 +48,67 @@ public:
     std::string getName();
     uint32_t getWidth(){return m_width;}
     uint32_t getHeight(){return m_height;}
+    uint32_t getMipLevels(){return m_mipLevels;} //of the vk image, the resident levels of a streamed texture
     VkImage getImage() { return m_image;}
     VkImageView getImageView() {return m_imageView;}
     VkDeviceMemory getImageDeviceMemory() {return m_imageMemory;}
     VkFormat getFormat();
     VkDeviceSize getImageBufferSize(){return m_imageSize;}
     stbi_uc* getImageData(){return m_imageData;}
+    const uint8_t* getCompressedData(){return m_compressed.data.data();} //every level of the image, in the order of the level offsets
+    VkDeviceSize getLevelOffset(uint32_t level){return m_compressed.levelOffsets[level];}
+    bool isCompressed(){return PixelTextureCompressor::getBlockBytes(m_format) != 0;}
+    VkDeviceSize getMemorySize(){return m_memorySize;} //of the vk image
+
+    //streaming. the image of a streamed texture only holds the levels from the first resident one down, the others are read
+    //from the texture cache when they are needed
+    bool isStreamable(){return !m_cachePath.empty();}
+    uint32_t getBaseWidth(){return isStreamable() ? m_compressed.width : m_width;} //of level 0, resident or not
+    uint32_t getBaseHeight(){return isStreamable() ? m_compressed.height : m_height;}
+    uint32_t getFirstResidentLevel(){return m_firstResidentLevel;}
+    uint32_t getTailLevel(); //the first level that is always resident
+    VkDeviceSize getResidentSize(uint32_t firstLevel); //the blocks of the levels from firstLevel down
+    const std::string& getCachePath(){return m_cachePath;}
+    const std::string& getSourceStamp(){return m_sourceStamp;}
+    ImageHandles swapResidentLevels(PixelTextureCompressor::CompressedTexture&& levels); //creates the image for the given levels, their blocks are uploaded by the caller
+    void releaseHostData(); //once uploaded, the cpu copy of the texels is no longer needed
+    void stopStreaming(){m_cachePath.clear();} //the cache file is gone, the resident levels are all the texture will have
     bool hasBeenInitialized(){return m_ImageInitialized;}
     bool hasBeenCleaned(){return m_ressourcesCleaned;}
 
     //helper functions
+    static uint32_t computeMipLevels(uint32_t width, uint32_t height); //down to a 1x1 level
+    bool supportsLinearBlit(); //the mip chain can be generated with vkCmdBlitImage
 
     //loader functions
-    void loadTexture(std::string filename);
+    void loadTexture(std::string filename, bool normalMap = false, bool streamed = true); //a texture that is not streamed is loaded with all its levels
+    void loadPackedTexture(std::string redFilename, std::string greenFilename, bool streamed = true); //two grayscale files in the red and green channels of one texture
+    void loadTexture(uint32_t width, uint32_t height, const std::vector<uint8_t>& texels, VkImageUsageFlags flags); //RGBA8 texels generated on the cpu
     void loadEmptyTexture();
     void loadEmptyTexture(uint32_t width, uint32_t height, VkImageUsageFlags flags);
+    void loadEmptyTexture(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags flags);
 
 private:
 
+    bool loadCachedTexture(const std::string& cachePath, const std::string& sourceStamp, bool streamed); //false when the cache file is missing or stale
+    void loadDecodedTexture(stbi_uc* image, uint32_t width, uint32_t height, const std::string& cachePath, const std::string& sourceStamp, bool normalMap, bool streamed); //takes the RGBA8 texels
+    void loadCompressedTexture(PixelTextureCompressor::CompressedTexture&& compressed);
+    static uint32_t tailLevelOf(uint32_t width, uint32_t height);
+
     //image data
     stbi_uc* m_imageData = nullptr;
+    PixelTextureCompressor::CompressedTexture m_compressed; //with the levels of the image, m_imageData stays null
+
+    //streaming, the cache file the levels are read from. empty for a texture that is always fully resident
+    std::string m_cachePath{};
+    std::string m_sourceStamp{};
+    uint32_t m_firstResidentLevel = 0;
 
     //image info
     uint32_t m_width{};
     uint32_t m_height{};
+    uint32_t m_mipLevels = 1;
+    VkDeviceSize m_memorySize = 0;
     std::string imageName{};
     bool m_IsSwapChainImage = false;
     bool m_ImageInitialized = false;
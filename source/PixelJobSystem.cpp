@@ -0,0 +1,130 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelJobSystem.h"
+
+#include <algorithm>
+
+PixelJobSystem::~PixelJobSystem() {
+    cleanUp();
+}
+
+void PixelJobSystem::init(uint32_t workerCount) {
+
+    cleanUp();
+
+    if(workerCount == 0)
+    {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workerCount = std::min(workerCount, JOB_SYSTEM_MAX_WORKERS);
+
+    m_stop = false;
+    for(uint32_t worker = 1; worker < workerCount; worker++)
+    {
+        m_threads.emplace_back(&PixelJobSystem::workerLoop, this, worker);
+    }
+}
+
+void PixelJobSystem::cleanUp() {
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for(auto& thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void PixelJobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job) {
+
+    if(count == 0)
+    {
+        return;
+    }
+
+    //a single job is not worth waking anyone up for
+    if(m_threads.empty() || count == 1)
+    {
+        for(uint32_t index = 0; index < count; index++)
+        {
+            job(0, index);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_nextIndex = 0;
+        m_busyWorkers = static_cast<uint32_t>(m_threads.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runJobs(0);
+
+    //the job is owned by the caller, it has to outlive every worker that may still be running it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{return m_busyWorkers == 0;});
+    m_job = nullptr;
+
+    if(m_exception)
+    {
+        std::exception_ptr exception = m_exception;
+        m_exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+void PixelJobSystem::workerLoop(uint32_t worker) {
+
+    uint64_t seenGeneration = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seenGeneration]{return m_stop || m_generation != seenGeneration;});
+            if(m_stop)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        runJobs(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void PixelJobSystem::runJobs(uint32_t worker) {
+
+    for(uint32_t index = m_nextIndex++; index < m_count; index = m_nextIndex++)
+    {
+        try
+        {
+            (*m_job)(worker, index);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_exception)
+            {
+                m_exception = std::current_exception();
+            }
+            m_nextIndex = m_count;
+        }
+    }
+}
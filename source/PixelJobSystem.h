@@ -0,0 +1,58 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELJOBSYSTEM_H
+#define PIXELENGINE_PIXELJOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const uint32_t JOB_SYSTEM_MAX_WORKERS = 8; //the calling thread included
+
+//a fixed set of worker threads that run the indices of a parallel for. the thread that calls parallelFor is worker 0
+//and takes jobs too, so a job system of one worker runs everything inline.
+//jobs are handed out one index at a time, the worker index tells a job which of the per-thread resources it can use
+class PixelJobSystem {
+public:
+    PixelJobSystem() = default;
+    PixelJobSystem(const PixelJobSystem&) = delete;
+    PixelJobSystem& operator=(const PixelJobSystem&) = delete;
+    ~PixelJobSystem();
+
+    void init(uint32_t workerCount); //0 for one per hardware thread, up to JOB_SYSTEM_MAX_WORKERS
+    void cleanUp();
+
+    //runs job(worker, index) for every index below count and returns once they are all done. not reentrant.
+    //the first exception a job throws is rethrown here, the indices no worker had started yet are skipped
+    void parallelFor(uint32_t count, const std::function<void(uint32_t worker, uint32_t index)>& job);
+
+    //getters
+    uint32_t getWorkerCount(){return static_cast<uint32_t>(m_threads.size()) + 1;}
+
+private:
+    void workerLoop(uint32_t worker);
+    void runJobs(uint32_t worker);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(uint32_t, uint32_t)>* m_job = nullptr;
+    uint32_t m_count = 0;
+    std::atomic<uint32_t> m_nextIndex{0};
+    uint32_t m_busyWorkers = 0; //threads that have not finished the current parallel for
+    uint64_t m_generation = 0; //counts the parallel fors, a worker wakes up once per generation
+    bool m_stop = false;
+    std::exception_ptr m_exception;
+};
+
+
+#endif //PIXELENGINE_PIXELJOBSYSTEM_H
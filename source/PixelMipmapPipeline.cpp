@@ -0,0 +1,283 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelMipmapPipeline.h"
+
+#include <array>
+
+//the levels are sampled by the rasterized objects and the ray tracer
+const VkPipelineStageFlags MIPMAP_READ_STAGES = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+PixelMipmapPipeline::PixelMipmapPipeline(PixBackend* backend): m_backend(backend) {
+
+}
+
+void PixelMipmapPipeline::init(PixelShaderCompiler* shaderCompiler) {
+    m_shaderCompiler = shaderCompiler;
+    addComputeShader("mipmap.comp");
+    createDescriptorSetLayout();
+    createDescriptorPool();
+    createComputePipelineLayout();
+    createComputePipeline();
+}
+
+void PixelMipmapPipeline::cleanUp() {
+    releaseLevels();
+
+    vkDestroyPipeline(m_backend->logicalDevice, computePipeline, nullptr);
+    vkDestroyPipelineLayout(m_backend->logicalDevice, computePipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(m_backend->logicalDevice, computeDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_backend->logicalDevice, computeDescriptorSetLayout, nullptr);
+}
+
+VkPipeline PixelMipmapPipeline::swapPipeline(VkPipeline pipeline) {
+    std::swap(computePipeline, pipeline);
+    return pipeline;
+}
+
+void PixelMipmapPipeline::addComputeShader(const std::string &filename) {
+    computeShaderModule = m_shaderCompiler->createShaderModule(filename);
+
+    computeCreateShaderInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeCreateShaderInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeCreateShaderInfo.module = computeShaderModule;
+    computeCreateShaderInfo.pName = "main"; //the entry point of the shader
+}
+
+void PixelMipmapPipeline::createDescriptorSetLayout() {
+    std::array<VkDescriptorSetLayoutBinding, 2> layoutBindings{};
+
+    //the source level and the level written from it
+    for(uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        layoutBindings[i].pImmutableSamplers = nullptr;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_backend->logicalDevice, &layoutInfo, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create mipmap descriptor set layout!");
+    }
+}
+
+void PixelMipmapPipeline::createDescriptorPool() {
+
+    //one set per level of the texture being downsampled
+    VkDescriptorPoolSize imageDescriptorSize{};
+    imageDescriptorSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    imageDescriptorSize.descriptorCount = MAX_MIP_LEVELS * 2;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = MAX_MIP_LEVELS;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &imageDescriptorSize;
+
+    VkResult result = vkCreateDescriptorPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &computeDescriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool for mipmap pipeline");
+    }
+}
+
+void PixelMipmapPipeline::createComputePipelineLayout() {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &computeDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+    if (vkCreatePipelineLayout(m_backend->logicalDevice, &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create mipmap pipeline layout!");
+    }
+}
+
+void PixelMipmapPipeline::createComputePipeline() {
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = computePipelineLayout;
+    pipelineInfo.stage = computeCreateShaderInfo;
+
+    VkResult result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the mipmap pipeline");
+    }
+
+    //we no longer need it once the pipeline has been created
+    vkDestroyShaderModule(m_backend->logicalDevice, computeShaderModule, nullptr);
+}
+
+void PixelMipmapPipeline::levelBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel, uint32_t levelCount,
+                                       VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                       VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+    VkImageMemoryBarrier imageMemoryBarrier{};
+    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.oldLayout = oldLayout;
+    imageMemoryBarrier.newLayout = newLayout;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image = image;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = baseLevel;
+    imageMemoryBarrier.subresourceRange.levelCount = levelCount;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    imageMemoryBarrier.subresourceRange.layerCount = 1;
+    imageMemoryBarrier.srcAccessMask = srcAccess;
+    imageMemoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+void PixelMipmapPipeline::recordBlits(VkCommandBuffer commandBuffer, PixelImage* image, VkImageLayout finalLayout) {
+
+    int32_t width = static_cast<int32_t>(image->getWidth());
+    int32_t height = static_cast<int32_t>(image->getHeight());
+
+    for(uint32_t level = 1; level < image->getMipLevels(); level++)
+    {
+        //the level above is done being written, it becomes the source of this one
+        levelBarrier(commandBuffer, image->getImage(), level - 1, 1,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        int32_t levelWidth = std::max(width / 2, 1);
+        int32_t levelHeight = std::max(height / 2, 1);
+
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.srcOffsets[1] = {width, height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        blit.dstOffsets[1] = {levelWidth, levelHeight, 1};
+
+        vkCmdBlitImage(commandBuffer, image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        //nothing reads the level above anymore
+        levelBarrier(commandBuffer, image->getImage(), level - 1, 1,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, finalLayout,
+                     VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT, MIPMAP_READ_STAGES);
+
+        width = levelWidth;
+        height = levelHeight;
+    }
+
+    //the last level is only ever written
+    levelBarrier(commandBuffer, image->getImage(), image->getMipLevels() - 1, 1,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT, MIPMAP_READ_STAGES);
+
+    m_blittedCount++;
+}
+
+void PixelMipmapPipeline::recordDownsamples(VkCommandBuffer commandBuffer, PixelImage* image, VkImageLayout finalLayout) {
+
+    uint32_t mipLevels = image->getMipLevels();
+    if(mipLevels > MAX_MIP_LEVELS)
+    {
+        throw std::runtime_error("too many mip levels to downsample for image: " + image->getName());
+    }
+
+    //storage images are written in the general layout
+    levelBarrier(commandBuffer, image->getImage(), 0, mipLevels,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    for(uint32_t level = 0; level < mipLevels; level++)
+    {
+        m_levelViews.push_back(image->createLevelView(level));
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(mipLevels - 1, computeDescriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(mipLevels - 1);
+
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = computeDescriptorPool;
+    setAllocateInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+    setAllocateInfo.pSetLayouts = setLayouts.data();
+
+    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &setAllocateInfo, descriptorSets.data());
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets for the mipmap pass");
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+
+    uint32_t width = image->getWidth();
+    uint32_t height = image->getHeight();
+    for(uint32_t level = 1; level < mipLevels; level++)
+    {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+
+        std::array<VkDescriptorImageInfo, 2> imageInfos{};
+        imageInfos[0].imageView = m_levelViews[level - 1];
+        imageInfos[1].imageView = m_levelViews[level];
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        for(uint32_t i = 0; i < descriptorWrites.size(); i++)
+        {
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].dstSet = descriptorSets[level - 1];
+            descriptorWrites[i].dstBinding = i;
+            descriptorWrites[i].dstArrayElement = 0;
+            descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrites[i].descriptorCount = 1;
+            descriptorWrites[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(m_backend->logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout,
+                                0, 1, &descriptorSets[level - 1], 0, nullptr);
+        vkCmdDispatch(commandBuffer, (width + MIPMAP_LOCAL_SIZE - 1) / MIPMAP_LOCAL_SIZE, (height + MIPMAP_LOCAL_SIZE - 1) / MIPMAP_LOCAL_SIZE, 1);
+
+        //the next level is downsampled from this one
+        if(level + 1 < mipLevels)
+        {
+            levelBarrier(commandBuffer, image->getImage(), level, 1,
+                         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                         VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+    }
+
+    levelBarrier(commandBuffer, image->getImage(), 0, mipLevels,
+                 VK_IMAGE_LAYOUT_GENERAL, finalLayout,
+                 VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, MIPMAP_READ_STAGES);
+
+    m_downsampledCount++;
+}
+
+void PixelMipmapPipeline::releaseLevels() {
+    if(m_levelViews.empty())
+    {
+        return;
+    }
+
+    for(auto levelView : m_levelViews)
+    {
+        vkDestroyImageView(m_backend->logicalDevice, levelView, nullptr);
+    }
+    m_levelViews.clear();
+
+    vkResetDescriptorPool(m_backend->logicalDevice, computeDescriptorPool, 0);
+}
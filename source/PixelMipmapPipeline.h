@@ -0,0 +1,65 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELMIPMAPPIPELINE_H
+#define PIXELENGINE_PIXELMIPMAPPIPELINE_H
+
+#include "PixelImage.h"
+#include "PixelShaderCompiler.h"
+
+#include <vector>
+
+const uint32_t MIPMAP_LOCAL_SIZE = 8; //local size of mipmap.comp in x and y
+const uint32_t MAX_MIP_LEVELS = 16; //a 32768x32768 texture
+
+//generates the mip chain of a texture once its first level is uploaded. the levels are blitted one from the other when the
+//format supports linear blits, and downsampled by mipmap.comp otherwise.
+//both expect every level in the transfer dst layout and leave them in the given layout, readable by the fragment and compute shaders
+class PixelMipmapPipeline {
+public:
+    explicit PixelMipmapPipeline(PixBackend* backend);
+    PixelMipmapPipeline() = default;
+
+    void init(PixelShaderCompiler* shaderCompiler);
+    VkPipeline swapPipeline(VkPipeline pipeline); //between two frames, returns the one it replaced
+    void cleanUp();
+
+    void recordBlits(VkCommandBuffer commandBuffer, PixelImage* image, VkImageLayout finalLayout);
+    void recordDownsamples(VkCommandBuffer commandBuffer, PixelImage* image, VkImageLayout finalLayout);
+    void releaseLevels(); //once the command buffer of recordDownsamples is done, frees its level views and descriptor sets
+
+    //getters
+    VkPipelineLayout getPipelineLayout(){return computePipelineLayout;}
+    uint32_t getBlittedCount(){return m_blittedCount;}
+    uint32_t getDownsampledCount(){return m_downsampledCount;}
+
+private:
+
+    void addComputeShader(const std::string& filename);
+    void createDescriptorSetLayout();
+    void createDescriptorPool();
+    void createComputePipelineLayout();
+    void createComputePipeline();
+    static void levelBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel, uint32_t levelCount,
+                             VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                             VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
+    PixBackend* m_backend{};
+    PixelShaderCompiler* m_shaderCompiler{};
+    VkPipelineShaderStageCreateInfo computeCreateShaderInfo{};
+    VkPipeline computePipeline = VK_NULL_HANDLE;
+    VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkDescriptorSetLayout computeDescriptorSetLayout{};
+    VkDescriptorPool computeDescriptorPool{}; //reset after every texture
+
+    std::vector<VkImageView> m_levelViews; //of the texture being downsampled
+
+    //textures whose chain was generated by each path, for the gui
+    uint32_t m_blittedCount = 0;
+    uint32_t m_downsampledCount = 0;
+};
+
+
+#endif //PIXELENGINE_PIXELMIPMAPPIPELINE_H
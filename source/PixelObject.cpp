@@ -6,23 +6,20 @@
 
 #include <utility>
 #include <fstream>
+#include <algorithm>
 
 
 PixelObject::PixelObject(PixBackend* device, std::vector<Vertex> vertices, std::vector<uint32_t> indices): m_device(device), m_vertices(std::move(vertices)), m_indices(std::move(indices)) {
     //create the vertex buffer form the vertices
     printf("PixelObject user constructed\n");
     //createVertexBuffer(vertices);
+    computeBoundingSphere();
 }
 
 void PixelObject::cleanup() {
 
-    for(auto texture : m_textures)
-    {
-        if(!texture.hasBeenCleaned())
-        {
-            texture.cleanUp();
-        }
-    }
+    //the textures belong to the texture cache or to the compute pipeline, the object only drops its handles
+    m_textures.clear();
 
     vkFreeMemory(m_device->logicalDevice, vertexBufferMemory, nullptr);
     vkDestroyBuffer(m_device->logicalDevice, vertexBuffer, nullptr);
@@ -72,14 +69,73 @@ VkDeviceMemory *PixelObject::getIndexBufferMemory() {
 
 void PixelObject::setDynamicUBObj(DynamicUBObj pushObjData) {
     dynamicUBO = pushObjData;
+    markChanged();
+}
+
+void PixelObject::setTexID(int texID) {
+    //set every frame by the renderer, it is only an update when it actually changes
+    if(dynamicUBO.texIndex != texID)
+    {
+        dynamicUBO.texIndex = texID;
+        markChanged();
+    }
 }
 
-PixelObject::PObj* PixelObject::getPushObj() {
+PixelObject::DynamicUBObj PixelObject::getObjectData() {
+    DynamicUBObj objectData = dynamicUBO;
+    objectData.M = pushObj.M;
+    objectData.MinvT = pushObj.MinvT;
+    objectData.boundingSphere = m_boundingSphere;
+    objectData.texIndex = -1;
+    if(dynamicUBO.texIndex >= 0 && dynamicUBO.texIndex < static_cast<int>(m_textureIndices.size()) && m_textureIndices[dynamicUBO.texIndex] != TEXTURE_NONE)
+    {
+        objectData.texIndex = static_cast<int>(m_textureIndices[dynamicUBO.texIndex]);
+    }
+    objectData.indexCount = static_cast<uint32_t>(m_indices.size());
+    objectData.drawGroup = static_cast<uint32_t>(graphicsPipelineIndex);
+    objectData.flags = m_isHidden ? 0 : OBJECT_FLAG_VISIBLE;
+    return objectData;
+}
+
+void PixelObject::setGeometryOffsets(uint32_t firstIndex, int32_t vertexOffset) {
+    dynamicUBO.firstIndex = firstIndex;
+    dynamicUBO.vertexOffset = vertexOffset;
+    markChanged();
+}
+
+void PixelObject::computeBoundingSphere() {
+
+    if(m_vertices.empty())
+    {
+        m_boundingSphere = glm::vec4(0.0f);
+        return;
+    }
+
+    //centered on the bounding box. not the smallest sphere, but close enough to cull with and cheap to find
+    glm::vec3 minCorner = glm::vec3(m_vertices[0].position);
+    glm::vec3 maxCorner = minCorner;
+    for(const auto& vertex : m_vertices)
+    {
+        minCorner = glm::min(minCorner, glm::vec3(vertex.position));
+        maxCorner = glm::max(maxCorner, glm::vec3(vertex.position));
+    }
+
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+    float radius = 0.0f;
+    for(const auto& vertex : m_vertices)
+    {
+        radius = std::max(radius, glm::length(glm::vec3(vertex.position) - center));
+    }
+    m_boundingSphere = glm::vec4(center, radius);
+}
+
+const PixelObject::PObj* PixelObject::getPushObj() {
     return &pushObj;
 }
 
 PixelObject::PixelObject(PixBackend *device, std::string filename) : m_device(device){
     importFile(filename);
+    computeBoundingSphere();
 }
 
 void PixelObject::importFile(const std::string& filename) {
@@ -147,28 +203,31 @@ void PixelObject::importFile(const std::string& filename) {
 void PixelObject::addTransform(glm::mat4 matTransform) {
     pushObj.M = matTransform * pushObj.M;
     pushObj.MinvT = glm::transpose(glm::inverse(pushObj.M));
+    markChanged();
 }
 
 void PixelObject::setTransform(glm::mat4 matTransform) {
     pushObj.M = matTransform;
     pushObj.MinvT = glm::transpose(glm::inverse(pushObj.M));
+    markChanged();
 }
 
 void PixelObject::setPushObj(PixelObject::PObj pushObjData) {
     pushObj = PObj(pushObjData);
+    markChanged();
 }
 
-PixelObject::DynamicUBObj* PixelObject::getDynamicUBObj() {
+const PixelObject::DynamicUBObj* PixelObject::getDynamicUBObj() {
     return &dynamicUBO;
 }
 
-void PixelObject::addTexture(std::string textureFile) {
-    PixelImage textureImage = PixelImage(m_device, 0, 0, false);
-    textureImage.loadTexture(textureFile);
+void PixelObject::addTexture(PixelTextureCache* textureCache, const std::string& textureFile, bool normalMap) {
 
     setTexID(0);
 
-    m_textures.push_back(textureImage);
+    //loaded once, the objects using the same file share it
+    m_textures.push_back(textureCache->acquire(textureFile, normalMap));
+    m_textureIndices.push_back(TEXTURE_NONE);
 
 }
 
@@ -176,7 +235,20 @@ void PixelObject::addTexture(PixelImage* pixImage) {
 
     setTexID(0);
 
-    m_textures.push_back(*pixImage);
+    //a handle that never deletes, the owner of the image destroys it
+    m_textures.push_back(TextureHandle(pixImage, [](PixelImage*){}));
+    m_textureIndices.push_back(TEXTURE_NONE);
+
+}
+
+void PixelObject::setTexture(uint32_t index, PixelImage* pixImage) {
+
+    m_textures[index] = TextureHandle(pixImage, [](PixelImage*){});
+
+}
 
+void PixelObject::setTextureIndex(uint32_t slot, uint32_t registryIndex) {
+    m_textureIndices[slot] = registryIndex;
+    markChanged();
 }
 
@@ -13,6 +13,8 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "PixelImage.h"
+#include "PixelTextureCache.h"
+#include "PixelTextureRegistry.h"
 
 #include <string>
 #include <array>
@@ -22,15 +24,28 @@ class PixelObject {
 public:
 
     // this should noe change every frame, but can change per individual object/mesh.
-    //Dynamic Uniform Buffer Object
+    //entry of the object buffer of the scene, has to match ObjectData in shaders/objects.glsl (std430)
     struct DynamicUBObj{
         glm::mat4 M{};
         glm::mat4 MinvT{};
-        int texIndex = -1;
+        glm::vec4 boundingSphere{}; //center in object space in xyz, radius in w
+        int texIndex = -1; //of the texture of the object, getObjectData turns it into its index in the texture registry of the scene
+        uint32_t firstIndex = 0; //where the mesh starts in the geometry pool of the scene
+        uint32_t indexCount = 0;
+        int32_t vertexOffset = 0;
+        uint32_t drawGroup = 0; //graphics pipeline index, the gpu-driven draws are sorted by it
+        uint32_t flags = 0;
+        int padding[2]{}; //std430 rounds the struct up to the alignment of its matrices
+    };
+    static_assert(sizeof(DynamicUBObj) == 176, "DynamicUBObj has to match the std430 layout of ObjectData");
+
+    //bits of DynamicUBObj::flags, OBJECT_FLAG_* in objects.glsl
+    enum ObjectFlags{
+        OBJECT_FLAG_VISIBLE = 1
     };
 
     // this can change every frame, and can change per individual object/mesh.
-    //Dynamic Uniform Buffer Object
+    //the transform of the object, the scene copies it into the dynamic uniform buffer of the frame
     struct PObj{
         glm::mat4 M{};
         glm::mat4 MinvT{};
@@ -69,17 +84,21 @@ public:
     VkDeviceSize getIndexBufferSize();
     VkBuffer* getIndexBuffer();
     VkDeviceMemory* getIndexBufferMemory();
-    PObj* getPushObj();
-    DynamicUBObj* getDynamicUBObj();
-    std::vector<PixelImage> getTextures(){return m_textures;}
+    const PObj* getPushObj();
+    const DynamicUBObj* getDynamicUBObj();
+    DynamicUBObj getObjectData(); //what the object buffer holds for it, with the current transform
+    uint64_t getVersion(){return m_version;} //changes whenever the object data does
+    std::vector<TextureHandle>* getTextures(){return &m_textures;}
+    uint32_t getTextureIndex(uint32_t slot){return m_textureIndices[slot];} //in the texture registry, TEXTURE_NONE before it is registered
     int getGraphicsPipelineIndex(){return graphicsPipelineIndex;};
-    static constexpr VkPushConstantRange pushConstantRange {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PObj)};
+    glm::vec4 getBoundingSphere(){return m_boundingSphere;}
 
     //setters
     void setDynamicUBObj(DynamicUBObj pushObjData);
-    void setTexID(int texID){dynamicUBO.texIndex = texID;};
+    void setTexID(int texID);
     void setPushObj(PObj pushObjData);
-    void setGraphicsPipelineIndex(int pipelineIndx){graphicsPipelineIndex = pipelineIndx;};
+    void setGraphicsPipelineIndex(int pipelineIndx){graphicsPipelineIndex = pipelineIndx; markChanged();};
+    void setGeometryOffsets(uint32_t firstIndex, int32_t vertexOffset); //where the scene put the mesh in its geometry pool
 
     //cleanup
     void cleanup();
@@ -91,11 +110,12 @@ public:
     void setGenericColor(glm::vec4 color);
     void addTransform(glm::mat4 matTransform);
     void setTransform(glm::mat4 matTransform);
-    void addTexture(std::string textureFile);
-    void addTexture(PixelImage* pixImage);
-    void setTextureIDOffset(int offset){texIDOffset = offset;};
-    void hide(){m_isHidden = true;};
-    void unhide(){m_isHidden = false;};
+    void addTexture(PixelTextureCache* textureCache, const std::string& textureFile, bool normalMap = false);
+    void addTexture(PixelImage* pixImage); //not owned, e.g. an image of the compute pipeline
+    void setTexture(uint32_t index, PixelImage* pixImage); //replaces a texture that was recreated, e.g. at a new size
+    void setTextureIndex(uint32_t slot, uint32_t registryIndex);
+    void hide(){m_isHidden = true; markChanged();}; //the cull pass reads the visibility from the object buffer
+    void unhide(){m_isHidden = false; markChanged();};
     bool isHidden(){return m_isHidden;};
 
 
@@ -105,6 +125,10 @@ private:
     std::vector<uint32_t> m_indices{};
     std::string name{};
     bool m_isHidden = false;
+    glm::vec4 m_boundingSphere{}; //of the vertices, in object space
+
+    //helper functions
+    void computeBoundingSphere();
 
     //transforms
     DynamicUBObj dynamicUBO = {};
@@ -117,12 +141,18 @@ private:
     VkBuffer indexBuffer = VK_NULL_HANDLE;
     VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
 
-    //texture used
-    std::vector<PixelImage> m_textures;
-    int texIDOffset = 0;
+    //the scene only copies the data of the objects whose version it has not written yet. the counter is shared
+    //so that two objects never have the same version
+    inline static uint64_t s_versionCounter = 0;
+    uint64_t m_version = ++s_versionCounter;
+    void markChanged(){m_version = ++s_versionCounter;}
+
+    //texture used, shared with the other objects using the same file
+    std::vector<TextureHandle> m_textures;
+    std::vector<uint32_t> m_textureIndices; //one per texture, handed out by the texture registry of the scene
 
     //pipeline used
-    int graphicsPipelineIndex;
+    int graphicsPipelineIndex = 0;
 };
 
 
@@ -0,0 +1,328 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelPresentPipeline.h"
+
+PixelPresentPipeline::PixelPresentPipeline(PixBackend* backend, VkFormat swapchainFormat): m_swapchainFormat(swapchainFormat), m_backend(backend) {
+
+}
+
+void PixelPresentPipeline::init(PixelShaderCompiler* shaderCompiler, VkSampler sampler) {
+    m_shaderCompiler = shaderCompiler;
+    m_sampler = sampler;
+    createRenderPass();
+    createDescriptorSetLayout();
+    createDescriptorPool();
+    createDescriptorSets();
+    createPipelineLayout();
+    pipeline = buildPipeline(m_shaderCompiler->compile(PRESENT_VERTEX_SHADER), m_shaderCompiler->compile(PRESENT_FRAGMENT_SHADER));
+}
+
+void PixelPresentPipeline::cleanUp() {
+    destroyFramebuffers();
+
+    vkDestroyPipeline(m_backend->logicalDevice, pipeline, nullptr);
+    vkDestroyPipelineLayout(m_backend->logicalDevice, pipelineLayout, nullptr);
+    vkDestroyRenderPass(m_backend->logicalDevice, renderPass, nullptr);
+
+    vkDestroyDescriptorPool(m_backend->logicalDevice, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_backend->logicalDevice, descriptorSetLayout, nullptr);
+}
+
+void PixelPresentPipeline::createRenderPass() {
+
+    //every pixel is written by the triangle, the previous content of the swapchain image is never loaded
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = m_swapchainFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; //the render passes of the scenes load it
+
+    VkAttachmentReference colorReference{};
+    colorReference.attachment = 0;
+    colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpassDescription{};
+    subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpassDescription.colorAttachmentCount = 1;
+    subpassDescription.pColorAttachments = &colorReference;
+
+    //the image is acquired at the color output stage. the passes drawn on top of it wait for the triangle to be written
+    std::array<VkSubpassDependency, 2> subpassDependencies{};
+    subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[0].srcAccessMask = 0;
+    subpassDependencies[0].dstSubpass = 0;
+    subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    subpassDependencies[1].srcSubpass = 0;
+    subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo renderPassCreateInfo{};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = 1;
+    renderPassCreateInfo.pAttachments = &colorAttachment;
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpassDescription;
+    renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+    renderPassCreateInfo.pDependencies = subpassDependencies.data();
+
+    if(vkCreateRenderPass(m_backend->logicalDevice, &renderPassCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the present renderpass");
+    }
+}
+
+void PixelPresentPipeline::createDescriptorSetLayout() {
+    std::array<VkDescriptorSetLayoutBinding, 2> layoutBindings{};
+
+    //the display image and the outline mask
+    for(uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        layoutBindings[i].pImmutableSamplers = nullptr;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_backend->logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create present descriptor set layout!");
+    }
+}
+
+void PixelPresentPipeline::createDescriptorPool() {
+
+    VkDescriptorPoolSize samplerDescriptorSize{};
+    samplerDescriptorSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerDescriptorSize.descriptorCount = DISPLAY_BUFFER_COUNT * 2;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = DISPLAY_BUFFER_COUNT;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &samplerDescriptorSize;
+
+    VkResult result = vkCreateDescriptorPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &descriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool for present pipeline");
+    }
+}
+
+void PixelPresentPipeline::createDescriptorSets() {
+
+    std::array<VkDescriptorSetLayout, DISPLAY_BUFFER_COUNT> setLayouts{};
+    setLayouts.fill(descriptorSetLayout);
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = descriptorPool;
+    setAllocateInfo.descriptorSetCount = DISPLAY_BUFFER_COUNT;
+    setAllocateInfo.pSetLayouts = setLayouts.data();
+
+    VkResult result = vkAllocateDescriptorSets(m_backend->logicalDevice, &setAllocateInfo, descriptorSets.data());
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets for the present pipeline");
+    }
+}
+
+void PixelPresentPipeline::writeDescriptorSet(uint32_t displayBuffer, PixelImage* displayImage, PixelImage* outlineMask) {
+
+    std::array<VkDescriptorImageInfo, 2> imageInfos{};
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    std::array<PixelImage*, 2> images = {displayImage, outlineMask};
+
+    for(uint32_t i = 0; i < images.size(); i++)
+    {
+        //the graphics queue reads them in the layout the frame graph leaves them in for the fragment shader
+        imageInfos[i].imageView = images[i]->getImageView();
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfos[i].sampler = m_sampler;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = descriptorSets[displayBuffer];
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_backend->logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void PixelPresentPipeline::createPipelineLayout() {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &PixelPresentPipeline::pushPresentConstantRange;
+
+    if (vkCreatePipelineLayout(m_backend->logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create present pipeline layout!");
+    }
+}
+
+VkPipeline PixelPresentPipeline::buildPipeline(const std::vector<uint32_t>& vertexSpirv, const std::vector<uint32_t>& fragmentSpirv) {
+
+    VkShaderModule vertexShaderModule = m_shaderCompiler->createShaderModule(vertexSpirv);
+    VkShaderModule fragmentShaderModule = m_shaderCompiler->createShaderModule(fragmentSpirv);
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertexShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragmentShaderModule;
+    shaderStages[1].pName = "main";
+
+    //the vertices come from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{};
+    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{};
+    inputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    //viewport and scissor follow the swapchain, the pipeline survives a resize
+    VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
+    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCreateInfo.viewportCount = 1;
+    viewportStateCreateInfo.scissorCount = 1;
+
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
+    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_NONE;
+    rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo{};
+    multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    //the triangle overwrites the image, nothing is blended
+    VkPipelineColorBlendAttachmentState blendAttachmentState{};
+    blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blendAttachmentState.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo blendStateCreateInfo{};
+    blendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blendStateCreateInfo.attachmentCount = 1;
+    blendStateCreateInfo.pAttachments = &blendAttachmentState;
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineCreateInfo.pStages = shaderStages.data();
+    pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
+    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
+    pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+    pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+    pipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
+    pipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
+    pipelineCreateInfo.pColorBlendState = &blendStateCreateInfo;
+    pipelineCreateInfo.pDepthStencilState = nullptr; //no depth attachment
+    pipelineCreateInfo.layout = pipelineLayout;
+    pipelineCreateInfo.renderPass = renderPass;
+    pipelineCreateInfo.subpass = 0;
+
+    VkPipeline presentPipeline;
+    VkResult result = vkCreateGraphicsPipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &presentPipeline);
+
+    //we no longer need them once the pipeline has been created
+    vkDestroyShaderModule(m_backend->logicalDevice, vertexShaderModule, nullptr);
+    vkDestroyShaderModule(m_backend->logicalDevice, fragmentShaderModule, nullptr);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create the present pipeline");
+    }
+    return presentPipeline;
+}
+
+VkPipeline PixelPresentPipeline::swapPipeline(VkPipeline newPipeline) {
+    std::swap(pipeline, newPipeline);
+    return newPipeline;
+}
+
+void PixelPresentPipeline::createFramebuffers(std::vector<PixelImage>& swapchainImages, VkExtent2D extent) {
+
+    m_extent = extent;
+    framebuffers.resize(swapchainImages.size());
+    for(size_t i = 0; i < framebuffers.size(); i++)
+    {
+        VkImageView attachment = swapchainImages[i].getImageView();
+
+        VkFramebufferCreateInfo framebufferCreateInfo{};
+        framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferCreateInfo.renderPass = renderPass;
+        framebufferCreateInfo.attachmentCount = 1;
+        framebufferCreateInfo.pAttachments = &attachment;
+        framebufferCreateInfo.width = extent.width;
+        framebufferCreateInfo.height = extent.height;
+        framebufferCreateInfo.layers = 1;
+
+        if(vkCreateFramebuffer(m_backend->logicalDevice, &framebufferCreateInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create present framebuffer");
+        }
+    }
+}
+
+void PixelPresentPipeline::destroyFramebuffers() {
+    for(auto framebuffer : framebuffers)
+    {
+        vkDestroyFramebuffer(m_backend->logicalDevice, framebuffer, nullptr);
+    }
+    framebuffers.clear();
+}
+
+void PixelPresentPipeline::recordPresent(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t displayBuffer) {
+
+    VkRenderPassBeginInfo renderPassBeginInfo{};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = renderPass;
+    renderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+    renderPassBeginInfo.renderArea.offset = {0,0};
+    renderPassBeginInfo.renderArea.extent = m_extent;
+    renderPassBeginInfo.clearValueCount = 0;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport = {0.0f, 0.0f, (float)m_extent.width, (float)m_extent.height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0,0}, m_extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[displayBuffer], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, pushPresentConstantRange.stageFlags, 0, pushPresentConstantRange.size, &m_pushObj);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(commandBuffer);
+}
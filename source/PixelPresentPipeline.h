@@ -0,0 +1,85 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELPRESENTPIPELINE_H
+#define PIXELENGINE_PIXELPRESENTPIPELINE_H
+
+#include "PixelComputePipeline.h"
+
+#include <array>
+#include <vector>
+
+const std::string PRESENT_VERTEX_SHADER = "present.vert";
+const std::string PRESENT_FRAGMENT_SHADER = "present.frag";
+
+//draws the raytraced image into the swapchain image with a single triangle covering the screen. the triangle is generated
+//from the vertex index, so there is no vertex buffer, no depth attachment and nothing per object to update.
+//the fragment shader reads the display image texel by texel and tonemaps it. it is the first render pass of the frame,
+//the render passes of the scenes and the gui load its result and draw on top of it
+class PixelPresentPipeline {
+public:
+    PixelPresentPipeline(PixBackend* backend, VkFormat swapchainFormat);
+    PixelPresentPipeline() = default;
+
+    //has to match present.frag
+    enum Tonemap{
+        TONEMAP_CLAMP = 0, //the color as the compute shaders wrote it
+        TONEMAP_REINHARD,
+        TONEMAP_ACES,
+        TONEMAP_COUNT
+    };
+
+    enum View{
+        VIEW_COLOR = 0,
+        VIEW_OUTLINE_MASK
+    };
+
+    struct PObj{
+        float exposure;
+        int32_t tonemap; //Tonemap
+        int32_t view; //View
+    };
+
+    void init(PixelShaderCompiler* shaderCompiler, VkSampler sampler);
+    VkPipeline buildPipeline(const std::vector<uint32_t>& vertexSpirv, const std::vector<uint32_t>& fragmentSpirv); //from any thread
+    VkPipeline swapPipeline(VkPipeline newPipeline); //between two frames, returns the one it replaced
+    void cleanUp();
+    void createFramebuffers(std::vector<PixelImage>& swapchainImages, VkExtent2D extent);
+    void destroyFramebuffers();
+    void writeDescriptorSet(uint32_t displayBuffer, PixelImage* displayImage, PixelImage* outlineMask); //again when the images are recreated
+    void recordPresent(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t displayBuffer); //the whole render pass
+    static constexpr VkPushConstantRange pushPresentConstantRange {VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PObj)};
+
+    //getters
+    VkRenderPass getRenderPass(){return renderPass;}
+    float* getExposure(){return &m_pushObj.exposure;}
+    int32_t* getTonemap(){return &m_pushObj.tonemap;}
+    int32_t* getView(){return &m_pushObj.view;}
+
+private:
+
+    void createRenderPass();
+    void createDescriptorSetLayout();
+    void createDescriptorPool();
+    void createDescriptorSets();
+    void createPipelineLayout();
+
+    VkFormat m_swapchainFormat = VK_FORMAT_UNDEFINED;
+    VkExtent2D m_extent{};
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    PObj m_pushObj = {1.0f, TONEMAP_CLAMP, VIEW_COLOR};
+
+    PixBackend* m_backend{};
+    PixelShaderCompiler* m_shaderCompiler{};
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptorSetLayout{};
+    VkDescriptorPool descriptorPool{};
+    std::array<VkDescriptorSet, DISPLAY_BUFFER_COUNT> descriptorSets{}; //the display image and outline mask of each display buffer
+    std::vector<VkFramebuffer> framebuffers; //one per swapchain image, the color attachment only
+};
+
+
+#endif //PIXELENGINE_PIXELPRESENTPIPELINE_H
@@ -0,0 +1,258 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelProfiler.h"
+
+#include <algorithm>
+
+PixelProfiler::PixelProfiler(PixBackend* backend) : m_backend(backend) {
+
+}
+
+void PixelProfiler::init(bool hostQueryResetEnabled) {
+
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(m_backend->physicalDevice, &deviceProperties);
+    m_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+    //we reset the queries from the host so that no command buffer has to know which one comes first in a frame
+    m_gpuTimingSupported = deviceProperties.limits.timestampComputeAndGraphics == VK_TRUE && hostQueryResetEnabled;
+    if(!m_gpuTimingSupported)
+    {
+        std::cout<<"gpu timestamps are not supported on this device, gpu timings will not be reported"<<std::endl;
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo{};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = PROFILER_FRAME_SLOTS * PROFILER_MAX_QUERIES_PER_FRAME;
+
+    VkResult result = vkCreateQueryPool(m_backend->logicalDevice, &queryPoolCreateInfo, nullptr, &m_queryPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create the timestamp query pool");
+    }
+
+    vkResetQueryPool(m_backend->logicalDevice, m_queryPool, 0, queryPoolCreateInfo.queryCount);
+}
+
+void PixelProfiler::cleanUp() {
+    if(m_queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_backend->logicalDevice, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+}
+
+void PixelProfiler::tick(bool idle) {
+
+    double now = glfwGetTime();
+    if(m_lastTick < 0.0)
+    {
+        m_lastTick = now;
+        m_currentIdle = idle;
+        return;
+    }
+
+    double elapsed = now - m_lastTick;
+    m_lastTick = now;
+
+    StateTimes& times = m_currentIdle ? m_idleTimes : m_activeTimes;
+    times.wallTime += elapsed;
+    m_windowTime += elapsed;
+    m_currentIdle = idle;
+
+    if(m_windowTime >= PROFILER_REPORT_INTERVAL)
+    {
+        publishReport(m_activeTimes, m_activeReport);
+        publishReport(m_idleTimes, m_idleReport);
+        m_windowTime = 0.0;
+    }
+}
+
+void PixelProfiler::addWaitTime(double seconds) {
+    StateTimes& times = m_currentIdle ? m_idleTimes : m_activeTimes;
+    times.waitTime += seconds;
+}
+
+void PixelProfiler::addSkippedFrame() {
+    StateTimes& times = m_currentIdle ? m_idleTimes : m_activeTimes;
+    times.framesSkipped++;
+}
+
+void PixelProfiler::publishReport(StateTimes& times, Utilization& report) {
+
+    //if we did not spend any time in this state during the window, keep the last report
+    if(times.wallTime <= 0.0)
+    {
+        return;
+    }
+
+    double cpuBusyTime = std::max(0.0, times.wallTime - times.waitTime);
+    report.cpuPercent = (float)(100.0 * cpuBusyTime / times.wallTime);
+    report.gpuPercent = (float)std::min(100.0, 100.0 * times.gpuBusyTime / times.wallTime);
+    report.framesDrawnPerSecond = (float)(times.framesDrawn / times.wallTime);
+    report.framesSkippedPerSecond = (float)(times.framesSkipped / times.wallTime);
+
+    times = {};
+}
+
+void PixelProfiler::beginFrame() {
+
+    StateTimes& times = m_currentIdle ? m_idleTimes : m_activeTimes;
+    times.framesDrawn++;
+
+    if(!m_gpuTimingSupported)
+    {
+        return;
+    }
+
+    m_currentSlot = (m_currentSlot + 1) % PROFILER_FRAME_SLOTS;
+    resolveSlot(m_currentSlot);
+
+    vkResetQueryPool(m_backend->logicalDevice, m_queryPool, m_currentSlot * PROFILER_MAX_QUERIES_PER_FRAME, PROFILER_MAX_QUERIES_PER_FRAME);
+    m_slots[m_currentSlot].scopes.clear();
+    m_slots[m_currentSlot].queryCount = 0;
+    m_slots[m_currentSlot].idle = m_currentIdle;
+}
+
+void PixelProfiler::resolveSlot(uint32_t slot) {
+
+    //unlike the times, the work items only describe the frame that was just read back
+    m_gpuWorkItems.clear();
+
+    FrameSlot& frameSlot = m_slots[slot];
+    if(frameSlot.queryCount == 0)
+    {
+        return;
+    }
+
+    //every query of the slot has been written by a command buffer submitted PROFILER_FRAME_SLOTS frames ago. waiting here is free.
+    std::vector<uint64_t> timestamps(frameSlot.queryCount);
+    VkResult result = vkGetQueryPoolResults(m_backend->logicalDevice, m_queryPool,
+                                            slot * PROFILER_MAX_QUERIES_PER_FRAME, frameSlot.queryCount,
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if(result != VK_SUCCESS)
+    {
+        return;
+    }
+
+    if(m_measureOverlap)
+    {
+        m_previousGpuIntervals = std::move(m_gpuIntervals);
+        m_gpuIntervals.clear();
+    }
+
+    //scopes with the same name are summed over the frame
+    std::map<std::string, float> frameTimes;
+    double busyTime = 0.0;
+    for(const auto& scope : frameSlot.scopes)
+    {
+        if(!scope.ended)
+        {
+            continue;
+        }
+
+        uint64_t begin = timestamps[scope.beginQuery];
+        uint64_t end = timestamps[scope.endQuery];
+        float milliseconds = end > begin ? (float)((double)(end - begin) * m_timestampPeriod / 1000000.0) : 0.0f;
+
+        frameTimes[scope.name] += milliseconds;
+        m_gpuWorkItems[scope.name] += scope.workItems;
+        if(m_measureOverlap && end > begin)
+        {
+            m_gpuIntervals[scope.name].push_back({(double)begin * m_timestampPeriod / 1000000.0, (double)end * m_timestampPeriod / 1000000.0});
+        }
+        busyTime += milliseconds / 1000.0;
+    }
+
+    for(const auto& frameTime : frameTimes)
+    {
+        m_gpuTimes[frameTime.first] = frameTime.second;
+    }
+
+    StateTimes& times = frameSlot.idle ? m_idleTimes : m_activeTimes;
+    times.gpuBusyTime += busyTime;
+}
+
+uint32_t PixelProfiler::writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage) {
+
+    FrameSlot& frameSlot = m_slots[m_currentSlot];
+    uint32_t query = frameSlot.queryCount++;
+    vkCmdWriteTimestamp(commandBuffer, stage, m_queryPool, m_currentSlot * PROFILER_MAX_QUERIES_PER_FRAME + query);
+
+    return query;
+}
+
+uint32_t PixelProfiler::beginGpuScope(VkCommandBuffer commandBuffer, const std::string& name, uint32_t workItems) {
+
+    //a scope needs two queries. if the slot is full, the scope is simply not timed
+    if(!m_gpuTimingSupported || m_slots[m_currentSlot].queryCount + 2 > PROFILER_MAX_QUERIES_PER_FRAME)
+    {
+        return UINT32_MAX;
+    }
+
+    GpuScope scope{};
+    scope.name = name;
+    scope.workItems = workItems;
+    scope.beginQuery = writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    m_slots[m_currentSlot].scopes.push_back(scope);
+    return static_cast<uint32_t>(m_slots[m_currentSlot].scopes.size() - 1);
+}
+
+void PixelProfiler::endGpuScope(VkCommandBuffer commandBuffer, uint32_t scopeIndex) {
+
+    if(!m_gpuTimingSupported || scopeIndex >= m_slots[m_currentSlot].scopes.size() ||
+       m_slots[m_currentSlot].queryCount + 1 > PROFILER_MAX_QUERIES_PER_FRAME)
+    {
+        return;
+    }
+
+    GpuScope& scope = m_slots[m_currentSlot].scopes[scopeIndex];
+    scope.endQuery = writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    scope.ended = true;
+}
+
+float PixelProfiler::getGpuTime(const std::string& name) {
+    auto gpuTime = m_gpuTimes.find(name);
+    return gpuTime != m_gpuTimes.end() ? gpuTime->second : 0.0f;
+}
+
+uint32_t PixelProfiler::getGpuWorkItems(const std::string& name) {
+    auto workItems = m_gpuWorkItems.find(name);
+    return workItems != m_gpuWorkItems.end() ? workItems->second : 0;
+}
+
+float PixelProfiler::getGpuOverlap(const std::string& name, const std::string& otherName) {
+
+    auto intervals = m_gpuIntervals.find(name);
+    if(intervals == m_gpuIntervals.end())
+    {
+        return 0.0f;
+    }
+
+    //the work of a frame can run next to the work of the frame before it on the other queue
+    std::vector<GpuInterval> otherIntervals;
+    for(const auto* frameIntervals : {&m_previousGpuIntervals, &m_gpuIntervals})
+    {
+        auto other = frameIntervals->find(otherName);
+        if(other != frameIntervals->end())
+        {
+            otherIntervals.insert(otherIntervals.end(), other->second.begin(), other->second.end());
+        }
+    }
+
+    double overlap = 0.0;
+    for(const auto& interval : intervals->second)
+    {
+        for(const auto& otherInterval : otherIntervals)
+        {
+            overlap += std::max(0.0, std::min(interval.end, otherInterval.end) - std::max(interval.begin, otherInterval.begin));
+        }
+    }
+    return static_cast<float>(overlap);
+}
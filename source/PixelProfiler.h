@@ -0,0 +1,117 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELPROFILER_H
+#define PIXELENGINE_PIXELPROFILER_H
+
+#include "Utility.h"
+
+#include <array>
+#include <string>
+#include <vector>
+#include <map>
+
+//the gpu results of a frame are only read back when its query slot comes around again,
+//so by then the frame has long finished and reading the queries never stalls the queue.
+const uint32_t PROFILER_FRAME_SLOTS = 4;
+const uint32_t PROFILER_MAX_QUERIES_PER_FRAME = 64;
+const double PROFILER_REPORT_INTERVAL = 1.0; //seconds between two utilization reports
+
+class PixelProfiler {
+public:
+    PixelProfiler() = default;
+    explicit PixelProfiler(PixBackend* backend);
+
+    struct Utilization{
+        float cpuPercent = 0.0f;
+        float gpuPercent = 0.0f;
+        float framesDrawnPerSecond = 0.0f;
+        float framesSkippedPerSecond = 0.0f;
+    };
+
+    void init(bool hostQueryResetEnabled);
+    void cleanUp();
+
+    //cpu side. tick is called once per loop iteration, the time elapsed since the last tick goes to the state of the last iteration
+    void tick(bool idle);
+    void addWaitTime(double seconds); //time blocked waiting for events, not counted as busy
+    void addSkippedFrame();
+
+    //gpu side. beginFrame moves to the next query slot and reads back the frame that used it last
+    void beginFrame();
+    uint32_t beginGpuScope(VkCommandBuffer commandBuffer, const std::string& name, uint32_t workItems = 1);
+    void endGpuScope(VkCommandBuffer commandBuffer, uint32_t scopeIndex);
+
+    //getters
+    float getGpuTime(const std::string& name); //in ms, from the latest frame read back
+    uint32_t getGpuWorkItems(const std::string& name); //work items the scopes of that name covered in the frame read back by the last beginFrame, 0 if none
+    Utilization getUtilization(bool idle){return idle ? m_idleReport : m_activeReport;}
+    bool isGpuTimingSupported(){return m_gpuTimingSupported;}
+
+    //overlap measurement. the start and end of every scope are kept, so the time two queues ran at once can be measured.
+    //timestamps of different queues are only comparable on devices that share one counter between them, which desktop gpus do
+    void setOverlapMeasurement(bool enabled){m_measureOverlap = enabled;}
+    float getGpuOverlap(const std::string& name, const std::string& otherName); //in ms, scopes of the latest frame against the other ones of it and of the frame before
+
+private:
+
+    struct GpuScope{
+        std::string name;
+        uint32_t workItems = 1;
+        uint32_t beginQuery = 0;
+        uint32_t endQuery = 0;
+        bool ended = false;
+    };
+
+    struct FrameSlot{
+        std::vector<GpuScope> scopes;
+        uint32_t queryCount = 0;
+        bool idle = false;
+    };
+
+    struct GpuInterval{
+        double begin; //ms
+        double end;
+    };
+
+    struct StateTimes{
+        double wallTime = 0.0;
+        double waitTime = 0.0;
+        double gpuBusyTime = 0.0;
+        uint32_t framesDrawn = 0;
+        uint32_t framesSkipped = 0;
+    };
+
+    //helper functions
+    void resolveSlot(uint32_t slot);
+    uint32_t writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage);
+    void publishReport(StateTimes& times, Utilization& report);
+
+    //cpu timing
+    double m_lastTick = -1.0;
+    double m_windowTime = 0.0;
+    bool m_currentIdle = false;
+    StateTimes m_activeTimes{};
+    StateTimes m_idleTimes{};
+    Utilization m_activeReport{};
+    Utilization m_idleReport{};
+
+    //gpu timing
+    std::array<FrameSlot, PROFILER_FRAME_SLOTS> m_slots{};
+    uint32_t m_currentSlot = 0;
+    std::map<std::string, float> m_gpuTimes;
+    std::map<std::string, uint32_t> m_gpuWorkItems;
+    bool m_measureOverlap = false;
+    std::map<std::string, std::vector<GpuInterval>> m_gpuIntervals;
+    std::map<std::string, std::vector<GpuInterval>> m_previousGpuIntervals;
+    float m_timestampPeriod = 1.0f; //nanoseconds per timestamp tick
+    bool m_gpuTimingSupported = false;
+
+    //vulkan components
+    PixBackend* m_backend{};
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+};
+
+
+#endif //PIXELENGINE_PIXELPROFILER_H
@@ -40,6 +40,17 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     return VK_FALSE;
 }
 
+static const char* presentModeName(VkPresentModeKHR presentMode) {
+    switch(presentMode)
+    {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+        default: return "other";
+    }
+}
+
 int PixelRenderer::initRenderer()
 {
 	pixWindow.initWindow("PixelRenderer", 1024, 768);
@@ -49,18 +60,25 @@ int PixelRenderer::initRenderer()
 		setupDebugMessenger();
 		setupPhysicalDevice();
 		createLogicalDevice();
+        init_profiler();
         createSwapChain();
         createDepthBuffer();
         createCommandPools();
         createTextureSampler();
-        createCommandBuffers();
-        createComputeCommandBuffers();
         init_compute();
         createScene();
+        init_culling(); //the scenes allocate their cull descriptor sets from its pool
+        init_mipmaps(); //the textures are given their mip chain as they are uploaded
+        init_streaming();
         initializeScenes();
+        createMaterials();
         createGraphicsPipelines(); //needs the descriptor set layout of the scene
         createFramebuffers(); //need the renderbuffer for the graphics pipeline
+        init_present(); //needs the swapchain images and the compute images
         createSynchronizationObjects();
+        init_frameGraph(); //needs the compute images
+        init_recording();
+        init_refinement();
         init_io();
         init_imgui();
 	}
@@ -80,52 +98,54 @@ bool PixelRenderer::windowShouldClose()
 
 void PixelRenderer::cleanup()
 {
+    stopRefinementThread();
     vkDeviceWaitIdle(mainDevice.logicalDevice); //wait that no action is running before destroying the objects
 
     vkDestroySampler(mainDevice.logicalDevice, imageSampler, nullptr);
 
+    shaderCompiler.cleanUp(); //its thread builds pipelines with the layouts and render passes of the other pipelines
+
     emptyTexture.cleanUp();
     computePipeline.cleanUp();
+    denoisePipeline.cleanUp();
+    cullPipeline.cleanUp();
+    mipmapPipeline.cleanUp();
+    presentPipeline.cleanUp();
+    textureStreamer.cleanUp();
+    profiler.cleanUp();
+    frameGraph.cleanUp();
 
     for(auto scene : scenes)
     {
         scene.cleanup();
     }
+    materialTextures.clear();
+    textureCache.cleanUp(); //once no object holds its textures
 
     vkDestroyDescriptorPool(mainDevice.logicalDevice, imguiPool, nullptr);
     ImGui_ImplVulkan_Shutdown();
 
     for(size_t i = 0; i<MAX_FRAME_DRAWS; i++)
     {
-        vkDestroyFence(mainDevice.logicalDevice, inFlightDrawFences[i], nullptr);
-        vkDestroyFence(mainDevice.logicalDevice, inFlightComputeFences[i], nullptr);
         vkDestroySemaphore(mainDevice.logicalDevice, renderFinishedSemaphore[i], nullptr);
         vkDestroySemaphore(mainDevice.logicalDevice, imageAvailableSemaphore[i], nullptr);
-        vkDestroySemaphore(mainDevice.logicalDevice, computeFinishedSemaphore[i], nullptr);
     }
 
     vkDestroyCommandPool(mainDevice.logicalDevice, graphicsCommandPool, nullptr);
-    vkDestroyCommandPool(mainDevice.logicalDevice, computeCommandPool, nullptr);
-
-    for (auto frameBuffer : swapchainFramebuffers)
+    vkDestroyCommandPool(mainDevice.logicalDevice, refinementCommandPool, nullptr);
+    jobSystem.cleanUp();
+    for(auto& context : recordingContexts)
     {
-        vkDestroyFramebuffer(mainDevice.logicalDevice, frameBuffer, nullptr);
+        vkDestroyCommandPool(mainDevice.logicalDevice, context.commandPool, nullptr);
     }
 
+    cleanupSwapChainImages();
+
     for (const auto& graphicsPipeline : graphicsPipelines)
     {
         graphicsPipeline->cleanUp();
     }
 
-
-
-    //cleaning up all swapchain images and depth image
-    depthImage.cleanUp();
-	for (PixelImage image : swapChainImages)
-	{
-		image.cleanUp();
-	}
-
 	vkDestroySwapchainKHR(mainDevice.logicalDevice, swapChain, nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkDestroyDevice(mainDevice.logicalDevice, nullptr);
@@ -225,11 +245,16 @@ void PixelRenderer::setupPhysicalDevice()
 	{
 		if (checkIfPhysicalDeviceSuitable(device))
 		{
-			mainDevice.physicalDevice = deviceList[0];
+			mainDevice.physicalDevice = device;
 			break;
 		}
 	}
 
+	if (mainDevice.physicalDevice == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Cannot find a GPU device that supports the renderer (Vulkan 1.2 with timeline semaphores and descriptor indexing)\n");
+	}
+
 }
 
 void PixelRenderer::createLogicalDevice()
@@ -258,8 +283,23 @@ void PixelRenderer::createLogicalDevice()
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()); //these are logical device extensions
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	//the memory budget is optional, the texture streamer falls back to its own budget without it
+	std::vector<const char*> enabledExtensions = deviceExtensions;
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(mainDevice.physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(mainDevice.physicalDevice, nullptr, &extensionCount, extensions.data());
+	for(const auto& extension : extensions)
+	{
+		if(strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+		{
+			memoryBudgetSupported = true;
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+	}
+
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()); //these are logical device extensions
+	deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 	deviceCreateInfo.enabledLayerCount = 0; //validation layers
 	deviceCreateInfo.ppEnabledLayerNames = nullptr;
 
@@ -276,6 +316,36 @@ void PixelRenderer::createLogicalDevice()
 
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
+    //vulkan 1.2 features are chained through pNext
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedDeviceFeatures2{};
+    supportedDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedDeviceFeatures2.pNext = &supportedVulkan12Features;
+    vkGetPhysicalDeviceFeatures2(mainDevice.physicalDevice, &supportedDeviceFeatures2);
+
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.hostQueryReset = supportedVulkan12Features.hostQueryReset; //lets the profiler reset its timestamp queries from the cpu
+    vulkan12Features.timelineSemaphore = VK_TRUE; //checked by checkIfPhysicalDeviceSuitable
+
+    //the textures of a scene are one bindless array, checked by checkIfPhysicalDeviceSuitable
+    vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    //the gpu-driven draws are counted by the cull pass, and their first instance is the index of the object. without it every object is drawn from the cpu
+    gpuDrivenSupported = supportedVulkan12Features.drawIndirectCount == VK_TRUE && supportedDeviceFeatures.multiDrawIndirect == VK_TRUE &&
+                         supportedDeviceFeatures.drawIndirectFirstInstance == VK_TRUE;
+    if(gpuDrivenSupported)
+    {
+        vulkan12Features.drawIndirectCount = VK_TRUE;
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+    deviceCreateInfo.pNext = &vulkan12Features;
+
 	//create logical device for the given phyisical device
 	VkResult result = vkCreateDevice(mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &mainDevice.logicalDevice);
 	if (result != VK_SUCCESS)
@@ -307,7 +377,7 @@ void PixelRenderer::createSwapChain()
 	SwapchainDetails swapChainDetails = getSwapChainDetails(mainDevice.physicalDevice);
 
 	VkSurfaceFormatKHR surfaceFormat = chooseBestSurfaceFormat(swapChainDetails.format);
-	VkPresentModeKHR surfacePresentationMode = chooseBestPresentationMode(swapChainDetails.presentationMode);
+	VkPresentModeKHR surfacePresentationMode = chooseBestPresentationMode(swapChainDetails.presentationMode, requestedPresentMode);
 	VkExtent2D surfaceExtent = chooseSwapChainExtent(swapChainDetails.surfaceCapabilities);
 
 	//how many images are in the swapchain. get 1 more then the minimum for triple buffering
@@ -352,7 +422,8 @@ void PixelRenderer::createSwapChain()
 	}
 
 	//if old swapchain been destroyed and this one replaces it, then link old swapchain to hand over responsibilities
-	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	VkSwapchainKHR oldSwapChain = swapChain; //VK_NULL_HANDLE the first time
+	swapChainCreateInfo.oldSwapchain = oldSwapChain;
 	swapChainCreateInfo.surface = surface;
 
 	VkResult result = vkCreateSwapchainKHR(mainDevice.logicalDevice, &swapChainCreateInfo, nullptr, &swapChain);
@@ -361,9 +432,17 @@ void PixelRenderer::createSwapChain()
 		throw std::runtime_error("failed to create a swapChain\n");
 	}
 
+	//the old swapchain is retired by the creation. the device is idle when we recreate, nothing is still presenting from it
+	if (oldSwapChain != VK_NULL_HANDLE)
+	{
+		vkDestroySwapchainKHR(mainDevice.logicalDevice, oldSwapChain, nullptr);
+	}
+
 	//store for later reference
 	swapChainImageFormat = surfaceFormat.format;
 	swapChainExtent = surfaceExtent;
+	presentMode = surfacePresentationMode;
+	supportedPresentModes = swapChainDetails.presentationMode;
 
 	//get the vkImages from the swapChain
 	uint32_t swapChainImageCount;
@@ -371,6 +450,9 @@ void PixelRenderer::createSwapChain()
 	std::vector<VkImage> images(swapChainImageCount);
 	vkGetSwapchainImagesKHR(mainDevice.logicalDevice, swapChain, &swapChainImageCount, images.data());
 
+	//the uniform buffers and descriptor sets are allocated per swapchain image. recreateSwapChain allocates them again when the count changes
+	swapChainImageTotal = swapChainImageCount;
+
 	for (VkImage image : images)
 	{
 		PixelImage swapChainImage = {&mainDevice, swapChainExtent.width, swapChainExtent.height, true};
@@ -408,37 +490,48 @@ QueueFamilyIndices PixelRenderer::setupQueueFamilies(VkPhysicalDevice device)
 	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
 
+	//the raytracer prefers a family without graphics: its queue then runs next to the raster work instead of behind it.
+	//every family is looked at, the dedicated compute family usually comes after the graphics one
+	int dedicatedComputeFamily = -1;
+	int sharedComputeFamily = -1;
+
 	//go through each q family and check if it has one of the required types of queue
 	int i = 0;
 	for (const auto& queueFamily : queueFamilyList)
 	{
 		//check validity of graphics q family
-		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if (indices.graphicsFamily < 0 && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
 		{
 			indices.graphicsFamily = i; //if queue family is valid, we keep its index
 		}
 
-        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
-            indices.computeFamily = i;
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+        {
+            bool hasGraphics = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            if (!hasGraphics && dedicatedComputeFamily < 0)
+            {
+                dedicatedComputeFamily = i;
+            }
+            else if (hasGraphics && sharedComputeFamily < 0)
+            {
+                sharedComputeFamily = i;
+            }
         }
 
 		//check if queue family supports presentation
 		VkBool32 presentationSupport = false;
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
 
-		if (queueFamilyCount > 0 && presentationSupport)
+		if (indices.presentationFamily < 0 && queueFamilyCount > 0 && presentationSupport)
 		{
 			indices.presentationFamily = i;
 		}
 
-		if (indices.isValid())
-		{
-			break;
-		}
-
 		i++;
 	}
 
+	indices.computeFamily = dedicatedComputeFamily >= 0 ? dedicatedComputeFamily : sharedComputeFamily;
+
 	return indices;
 }
 
@@ -454,6 +547,34 @@ bool PixelRenderer::checkIfPhysicalDeviceSuitable(VkPhysicalDevice device)
 
 	QueueFamilyIndices indices = setupQueueFamilies(device);
 
+	//the frame graph synchronizes the queues with timeline semaphores, there is no fallback
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedDeviceFeatures2{};
+	supportedDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedDeviceFeatures2.pNext = &supportedVulkan12Features;
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		vkGetPhysicalDeviceFeatures2(device, &supportedDeviceFeatures2);
+	}
+
+	if (supportedVulkan12Features.timelineSemaphore != VK_TRUE)
+	{
+		std::cout << "skipping " << deviceProperties.deviceName << ": it does not support Vulkan 1.2 timeline semaphores" << std::endl;
+		return false;
+	}
+
+	//the textures of a scene are one bindless array. the slots that are not handed out are left unwritten, and new ones are written
+	//while the recorded command buffers that bind the array are pending
+	if (supportedVulkan12Features.runtimeDescriptorArray != VK_TRUE || supportedVulkan12Features.descriptorBindingPartiallyBound != VK_TRUE ||
+		supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE ||
+		supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending != VK_TRUE ||
+		supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing != VK_TRUE)
+	{
+		std::cout << "skipping " << deviceProperties.deviceName << ": it does not support bindless textures (Vulkan 1.2 descriptor indexing)" << std::endl;
+		return false;
+	}
+
 	bool extensionsSupported = checkDeviceExtensionSupport(device);
 	bool swapChainValid = false;
 	if (extensionsSupported)
@@ -526,8 +647,8 @@ VkExtent2D PixelRenderer::chooseSwapChainExtent(const VkSurfaceCapabilitiesKHR s
 		newExtent.height = static_cast<uint32_t>(height);
 
 		//surface also defines max and min. we need to stay within boundary
-		newExtent.width = std::max(std::min(surfaceCapabilities.maxImageExtent.width, newExtent.width), surfaceCapabilities.maxImageExtent.width);
-		newExtent.height = std::max(std::min(surfaceCapabilities.maxImageExtent.height, newExtent.height), surfaceCapabilities.maxImageExtent.height);
+		newExtent.width = std::max(std::min(surfaceCapabilities.maxImageExtent.width, newExtent.width), surfaceCapabilities.minImageExtent.width);
+		newExtent.height = std::max(std::min(surfaceCapabilities.maxImageExtent.height, newExtent.height), surfaceCapabilities.minImageExtent.height);
 
 		return newExtent;
 	}
@@ -561,17 +682,122 @@ SwapchainDetails PixelRenderer::getSwapChainDetails(VkPhysicalDevice device)
 	return swapChainDetails;
 }
 
+void PixelRenderer::cleanupSwapChainImages() {
+
+    for (auto frameBuffer : swapchainFramebuffers)
+    {
+        vkDestroyFramebuffer(mainDevice.logicalDevice, frameBuffer, nullptr);
+    }
+    swapchainFramebuffers.clear();
+    presentPipeline.destroyFramebuffers();
+
+    //cleaning up all swapchain images and depth image. the swapchain itself is kept to be passed as the old one
+    depthImage.cleanUp();
+	for (PixelImage image : swapChainImages)
+	{
+		image.cleanUp();
+	}
+    swapChainImages.clear();
+}
+
+void PixelRenderer::recreateSwapChain() {
+
+    //a minimized window has a 0x0 framebuffer, there is nothing to present until it comes back
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(pixWindow.getWindow(), &width, &height);
+    while (width == 0 || height == 0)
+    {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(pixWindow.getWindow(), &width, &height);
+    }
+
+    double resizeStart = glfwGetTime();
+
+    //the framebuffers and the compute images may still be in use by the frames in flight
+    vkDeviceWaitIdle(mainDevice.logicalDevice);
+    double idleTime = glfwGetTime();
+
+    //the render passes, pipelines and descriptor set layouts do not depend on the size and are kept
+    uint32_t previousImageCount = swapChainImageTotal;
+    cleanupSwapChainImages();
+    createSwapChain();
+    createDepthBuffer();
+    createFramebuffers();
+
+    //a surface may give another number of images after a resize or a change of present mode
+    if(swapChainImageTotal != previousImageCount)
+    {
+        reallocateImageResources();
+    }
+
+    //the raytraced images follow the swapchain so the image stays sharp. the history is lost, the next frame restarts the accumulation
+    VkExtent2D computeExtent = {swapChainExtent.width, swapChainExtent.height};
+    computePipeline.resize(computeExtent);
+    denoisePipeline.resize(computeExtent);
+    initComputeImageLayouts();
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        transitionImageLayout(computePipeline.getOutputTexture(i)->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        transitionImageLayout(computePipeline.getCustomTexture(i)->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    tileScheduler.init(computeExtent.width, computeExtent.height);
+    hasRendered = false;
+
+    //the static draws were recorded with the old framebuffers
+    invalidateStaticCommands();
+
+    //the device is idle, the new images start without any access to wait on
+    frameGraph.setImage(accumulatorResource, computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, FRAME_GRAPH_GRAPHICS);
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        frameGraph.setImage(displayResources[i], computePipeline.getOutputTexture(i)->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, FRAME_GRAPH_GRAPHICS);
+        frameGraph.setImage(outlineMaskResources[i], computePipeline.getCustomTexture(i)->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, FRAME_GRAPH_GRAPHICS);
+    }
+
+    //the present pass draws into the new swapchain images and reads the new compute images.
+    //the device is idle, so its descriptor sets can be rewritten in place
+    presentPipeline.createFramebuffers(swapChainImages, swapChainExtent);
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        presentPipeline.writeDescriptorSet(i, computePipeline.getOutputTexture(i), computePipeline.getCustomTexture(i));
+    }
+
+    double resizeEnd = glfwGetTime();
+    lastResize.waitMs = static_cast<float>((idleTime - resizeStart) * 1000.0);
+    lastResize.recreateMs = static_cast<float>((resizeEnd - idleTime) * 1000.0);
+    lastResize.extent = swapChainExtent;
+    lastResize.count++;
+}
+
+void PixelRenderer::reallocateImageResources() {
+
+    //the device is idle. the command buffers belong to the frames of the frame graph, not to the images, and are kept.
+    //the texture sets do not depend on the number of images either. the cull sets of every scene come from one pool,
+    //it is recreated once for all of them
+    cullPipeline.recreateDescriptorPool(static_cast<uint32_t>(scenes.size() * swapChainImages.size()));
+    for(auto& scene : scenes)
+    {
+        scene.destroyImageBuffers();
+        vkDestroyDescriptorPool(mainDevice.logicalDevice, *scene.getDescriptorPool(), nullptr);
+
+        createUniformBuffers(&scene);
+        createDescriptorPool(&scene);
+        allocateImageDescriptorSets(&scene);
+    }
+}
+
 void PixelRenderer::createGraphicsPipelines() {
 
+    //the scenes are drawn over the raytraced image the present pass wrote, their render passes load it instead of clearing it
     //pipeline1
-    auto graphicsPipeline1 = std::make_unique<PixelGraphicsPipeline>(mainDevice.logicalDevice, swapChainExtent);
-    graphicsPipeline1->addVertexShader("shaders/vert.spv");
-    graphicsPipeline1->addFragmentShader("shaders/frag.spv");
+    auto graphicsPipeline1 = std::make_unique<PixelGraphicsPipeline>(mainDevice.logicalDevice, swapChainExtent, &shaderCompiler);
+    graphicsPipeline1->addVertexShader("shader.vert");
+    graphicsPipeline1->addFragmentShader("shader.frag");
     graphicsPipeline1->populateGraphicsPipelineInfo();
     graphicsPipeline1->addRenderpassColorAttachment(swapChainImages[0].getFormat(),
-                                                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                                                    VK_ATTACHMENT_STORE_OP_STORE,
-                                                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                                                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ATTACHMENT_LOAD_OP_LOAD);
     graphicsPipeline1->addRenderpassDepthAttachment(depthImage.getFormat());
     graphicsPipeline1->populatePipelineLayout(&scenes[0]); //populate the pipeline layout based on the scene's descriptor set
 
@@ -579,14 +805,14 @@ void PixelRenderer::createGraphicsPipelines() {
     graphicsPipeline1->createGraphicsPipeline(VK_NULL_HANDLE); //creates a renderpass if none were provided
 
     //pipeline1
-    auto computeGraphicsPipeline = std::make_unique<PixelGraphicsPipeline>(mainDevice.logicalDevice, swapChainExtent);
-    computeGraphicsPipeline->addVertexShader("shaders/NoLightingShaderVert.spv");
-    computeGraphicsPipeline->addFragmentShader("shaders/NoLightingShaderFrag.spv");
+    auto computeGraphicsPipeline = std::make_unique<PixelGraphicsPipeline>(mainDevice.logicalDevice, swapChainExtent, &shaderCompiler);
+    computeGraphicsPipeline->addVertexShader("NoLightingShader.vert");
+    computeGraphicsPipeline->addFragmentShader("NoLightingShader.frag");
     computeGraphicsPipeline->populateGraphicsPipelineInfo();
     computeGraphicsPipeline->addRenderpassColorAttachment(swapChainImages[0].getFormat(),
-                                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                                                     VK_ATTACHMENT_STORE_OP_STORE,
-                                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ATTACHMENT_LOAD_OP_LOAD);
     computeGraphicsPipeline->addRenderpassDepthAttachment(depthImage.getFormat());
     computeGraphicsPipeline->populatePipelineLayout(&scenes[0]); //populate the pipeline layout based on the scene's descriptor set
 
@@ -596,6 +822,19 @@ void PixelRenderer::createGraphicsPipelines() {
     graphicsPipelines.push_back(std::move(graphicsPipeline1));
     graphicsPipelines.push_back(std::move(computeGraphicsPipeline));
 
+    //each stage is watched, the pipeline is rebuilt with the other stage as it is on disk. the secondaries bound the old one
+    for(auto& graphicsPipeline : graphicsPipelines)
+    {
+        PixelGraphicsPipeline* pipeline = graphicsPipeline.get();
+        auto swap = [this, pipeline](VkPipeline newPipeline){invalidateStaticCommands(); return pipeline->swapPipeline(newPipeline);};
+        shaderCompiler.watch({pipeline->getVertexShader(),
+                              [this, pipeline](const std::vector<uint32_t>& spirv){return pipeline->buildPipeline(spirv, shaderCompiler.compile(pipeline->getFragmentShader()));},
+                              swap});
+        shaderCompiler.watch({pipeline->getFragmentShader(),
+                              [this, pipeline](const std::vector<uint32_t>& spirv){return pipeline->buildPipeline(shaderCompiler.compile(pipeline->getVertexShader()), spirv);},
+                              swap});
+    }
+
 }
 
 void PixelRenderer::createFramebuffers() {
@@ -643,63 +882,24 @@ void PixelRenderer::createCommandPools() {
         throw std::runtime_error("Failed to create Graphics Command Pool");
     }
 
-    VkCommandPoolCreateInfo computePoolCreateInfo{};
-    computePoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    computePoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; //automatically forces reset when a vkBeginCmdBuffer is called
-    computePoolCreateInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
-
-    result = vkCreateCommandPool(mainDevice.logicalDevice, &computePoolCreateInfo, nullptr, &computeCommandPool);
-    if(result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create Compute Command Pool");
-    }
-}
-
-void PixelRenderer::createCommandBuffers() {
-
-    //one commandbuffer per swapchain images
-    commandBuffers.resize(swapChainImages.size());
-
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = graphicsCommandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //submitted straight to the queue. Secondary cannot be called by a queue, but can only be called by other commands buffers
-    commandBufferAllocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-    VkResult result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &commandBufferAllocateInfo, commandBuffers.data()); //we create all the command buffers simultaneously
-    if(result != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate command buffers");
-    }
-    //no need to dealocate or destroyed the command buffers. they are destroy along the command pool
-}
-
-void PixelRenderer::createComputeCommandBuffers() {
-
-    //one commandbuffer per swapchain images
-    computeCommandBuffers.resize(swapChainImages.size());
+    //the gui is recorded every frame into the secondary command buffer of the frame slot
+    VkCommandBufferAllocateInfo guiAllocateInfo{};
+    guiAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    guiAllocateInfo.commandPool = graphicsCommandPool;
+    guiAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    guiAllocateInfo.commandBufferCount = static_cast<uint32_t>(guiCommandBuffers.size());
 
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = computeCommandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //submitted straight to the queue. Secondary cannot be called by a queue, but can only be called by other commands buffers
-    commandBufferAllocateInfo.commandBufferCount = static_cast<uint32_t>(computeCommandBuffers.size());
-
-    VkResult result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &commandBufferAllocateInfo, computeCommandBuffers.data()); //we create all the command buffers simultaneously
+    result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &guiAllocateInfo, guiCommandBuffers.data());
     if(result != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to allocate command buffers");
+        throw std::runtime_error("failed to allocate the gui command buffers!");
     }
-    //no need to dealocate or destroyed the command buffers. they are destroy along the command pool
 }
 
-void PixelRenderer::recordCommands(uint32_t currentImageIndex) {
+void PixelRenderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t currentImageIndex) {
 
-    //info about how to begin each command buffer
-    VkCommandBufferBeginInfo bufferBeginInfo{};
-    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    //flag not needed because fences are now implemented; no commandbuffer for the same frame will be submitted twice.
-    //bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; //if one of our command buffer is already on the queue, can it be in submitted again.
+    //the frame graph begins and ends the command buffer, and orders it after the compute passes it reads from
+    double recordStart = glfwGetTime();
 
     //the clear values for the renderpass attachment
     std::array<VkClearValue,2> clearValues = {};
@@ -715,285 +915,862 @@ void PixelRenderer::recordCommands(uint32_t currentImageIndex) {
     renderPassBeginInfo.pClearValues = clearValues.data();
     renderPassBeginInfo.framebuffer = swapchainFramebuffers[currentImageIndex]; // the framebuffer changes per swapchain image (ie command buffer)
 
-        VkResult result = vkBeginCommandBuffer(commandBuffers[currentImageIndex], &bufferBeginInfo);
-        if(result != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to being recording command");
-        }
+    //the gui is the only part of the render pass that changes every frame. the command buffer of this frame slot is free,
+    //the frame graph waited for the frame that used it last
+    VkCommandBuffer guiCommandBuffer = guiCommandBuffers[currentFrame];
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = graphicsPipelines[0]->getRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = swapchainFramebuffers[currentImageIndex];
+
+    VkCommandBufferBeginInfo guiBeginInfo{};
+    guiBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    guiBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    guiBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VkResult result = vkBeginCommandBuffer(guiCommandBuffer, &guiBeginInfo);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to start recording the gui command buffer!");
+    }
+    ImGui_ImplVulkan_RenderDrawData(draw_data, guiCommandBuffer);
+    result = vkEndCommandBuffer(guiCommandBuffer);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record the gui command buffer!");
+    }
 
-        //transitionImageLayoutUsingCommandBuffer(commandBuffers[currentImageIndex], computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        //transitionImageLayoutUsingCommandBuffer(commandBuffers[currentImageIndex], computePipeline.getOutputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        /*
-         * Series of command to record
-         * */
-        {
-            //one pipeline can be attached per subpass. if we say we need to go to another subpass, we need to bind another pipeline.
-                //there is one graphics pipeline per scene
-                for(int sceneIndx = 0; sceneIndx < scenes.size(); sceneIndx++)
-                {
-                    renderPassBeginInfo.renderPass = graphicsPipelines[sceneIndx]->getRenderPass();
-
-                    //begin the renderpass
-                    vkCmdBeginRenderPass(commandBuffers[currentImageIndex], &renderPassBeginInfo,
-                                         VK_SUBPASS_CONTENTS_INLINE); //our renderpass contains only primary commands
-
-                    for(int objIndex = 0; objIndex < scenes[sceneIndx].getNumObjects(); objIndex++) {
-                        auto currentObject = scenes[sceneIndx].getObjectAt(objIndex);
-                        if(currentObject->isHidden())
-                        {
-                            continue;
-                        }
-                        VkPipeline currentGraphicsPipeline = graphicsPipelines[currentObject->getGraphicsPipelineIndex()]->getPipeline();
-                        VkPipelineLayout currentPipelineLayout = graphicsPipelines[currentObject->getGraphicsPipelineIndex()]->getPipelineLayout();
-
-                        //bind the pipeline
-                        vkCmdBindPipeline(commandBuffers[currentImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                          currentGraphicsPipeline);
-
-
-                            VkBuffer vertexBuffers[] = {
-                                    *(currentObject->getVertexBuffer())}; //buffers to bind
-                            VkBuffer indexBuffer = *currentObject->getIndexBuffer();
-                            VkDeviceSize offsets[] = {0};                                 //offsets into buffers
-                            vkCmdBindVertexBuffers(commandBuffers[currentImageIndex], 0, 1, vertexBuffers, offsets);
-                            vkCmdBindIndexBuffer(commandBuffers[currentImageIndex], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-                            //bind the push constant
-                            vkCmdPushConstants(commandBuffers[currentImageIndex],
-                                               currentPipelineLayout,
-                                               VK_SHADER_STAGE_VERTEX_BIT,
-                                               0,
-                                               PixelObject::pushConstantRange.size,
-                                               currentObject->getPushObj());
-
-                            //dynamic offset ammount
-                            uint32_t dynamicOffset = static_cast<uint32_t>(scenes[sceneIndx].getMinAlignment()) * objIndex;
-
-                            std::array<VkDescriptorSet, 2> descriptorSets = {
-                                    *scenes[sceneIndx].getUniformDescriptorSetAt(currentImageIndex),
-                                    *scenes[sceneIndx].getTextureDescriptorSet()};
-
-                            //bind the descriptor sets
-                            vkCmdBindDescriptorSets(commandBuffers[currentImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                                    currentPipelineLayout,
-                                                    0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
-                                                    1, &dynamicOffset);
-                            //note here that we bound one descriptor set that contains both a static descriptor and a dynamic descriptor. Only the dynamic descriptors will be off-set for each object, not the static ones.
-
-                            //execute the pipeline
-                            vkCmdDrawIndexed(commandBuffers[currentImageIndex],
-                                             static_cast<uint32_t>(currentObject->getIndexCount()), 1, 0, 0, 0);
-                    }
-
-                    if(sceneIndx == 0)
-                    {
-                        ImGui_ImplVulkan_RenderDrawData(draw_data, commandBuffers[currentImageIndex]);
-                    }
-
-
-
-                    //end the Renderpass
-                    vkCmdEndRenderPass(commandBuffers[currentImageIndex]);
-                }
-        }
-        /*
-         * End of the series of command to record
-         * */
+    //the draw lists of this swapchain image are filled right before the render passes that draw them
+    if(staticGpuDriven)
+    {
+        recordCullCommands(commandBuffer, currentImageIndex);
+    }
 
-        result = vkEndCommandBuffer(commandBuffers[currentImageIndex]);
-        if(result != VK_SUCCESS)
+    uint32_t graphicsScope = profiler.beginGpuScope(commandBuffer, "graphics");
+
+    //the raytraced image covers the whole swapchain image, the scenes and the gui are drawn over it
+    presentPipeline.recordPresent(commandBuffer, currentImageIndex, displayBuffer);
+
+    //one render pass per scene, its content is only secondary command buffers
+    for(size_t sceneIndx = 0; sceneIndx < scenes.size(); sceneIndx++)
+    {
+        renderPassBeginInfo.renderPass = graphicsPipelines[sceneIndx]->getRenderPass();
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        //the object ranges in the order they were split, then the gui on top
+        std::vector<VkCommandBuffer> secondaryCommandBuffers = staticCommandBuffers[currentImageIndex][sceneIndx];
+        if(sceneIndx == 0)
         {
-            throw std::runtime_error("failed to end recording command");
+            secondaryCommandBuffers.push_back(guiCommandBuffer);
         }
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
 
-}
+        vkCmdEndRenderPass(commandBuffer);
+    }
 
-void PixelRenderer::draw() {
+    profiler.endGpuScope(commandBuffer, graphicsScope);
 
-    //time measurements
-    float deltaTime = (float)glfwGetTime() - currentTime;
-    currentTime = (float)glfwGetTime();
+    recordTiming.frameMs = static_cast<float>((glfwGetTime() - recordStart) * 1000.0);
+}
 
+void PixelRenderer::recordStaticCommands() {
 
+    double recordStart = glfwGetTime();
 
-    //get the next available image to draw to and set something to signal when we are finished with the image
-    //submit the command buffer to the queue for execution make sure to wait for image to be signal as available before drawing to it. it then signals when it is finished rendering
-    //present image to screen when image is signaled as finished rendering
+    //the buffers are only re-recorded when something they depend on changed, the graphics queue is waited on so none is in use
+    vkQueueWaitIdle(graphicsQueue);
+    resetRecordingContexts();
+    staticGpuDriven = isGpuDriven();
 
-    glm::vec3 cameraPos = {0.0f, 2.0f, 10.0f};
+    //every scene of every swapchain image is split in ranges of objects, each range is a job that records its own secondary.
+    //gpu-driven, a scene is a single job whatever its number of objects
+    std::vector<RecordJob> jobs;
+    staticCommandBuffers.assign(swapchainFramebuffers.size(), std::vector<std::vector<VkCommandBuffer>>(scenes.size()));
+    for(uint32_t imageIndex = 0; imageIndex < swapchainFramebuffers.size(); imageIndex++)
+    {
+        for(uint32_t sceneIndx = 0; sceneIndx < scenes.size(); sceneIndx++)
+        {
+            uint32_t objectCount = static_cast<uint32_t>(scenes[sceneIndx].getNumObjects());
+            if(staticGpuDriven)
+            {
+                staticCommandBuffers[imageIndex][sceneIndx].resize(1);
+                jobs.push_back({imageIndex, sceneIndx, 0, 0, true});
+                continue;
+            }
+            uint32_t rangeCount = std::max(1u, (objectCount + RECORD_DRAWS_PER_JOB - 1) / RECORD_DRAWS_PER_JOB);
+            staticCommandBuffers[imageIndex][sceneIndx].resize(rangeCount);
+            for(uint32_t range = 0; range < rangeCount; range++)
+            {
+                uint32_t firstDraw = range * RECORD_DRAWS_PER_JOB;
+                jobs.push_back({imageIndex, sceneIndx, firstDraw, std::min(RECORD_DRAWS_PER_JOB, objectCount - firstDraw)});
+            }
+        }
+    }
 
+    std::vector<VkCommandBuffer> recorded = recordJobs(jobs, true);
 
-    // Compute submission
-    for(uint32_t i = 0 ; i < MAX_COMPUTE_SAMPLE ; i++)
+    size_t job = 0;
+    for(auto& imageCommandBuffers : staticCommandBuffers)
     {
-        // Compute submission
-        vkWaitForFences(mainDevice.logicalDevice, 1, &inFlightComputeFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-        vkResetFences(mainDevice.logicalDevice, 1, &inFlightComputeFences[currentFrame]);
-
-        //uint32_t currentSample = computePipeline.getPushObj()->currentSample;
+        for(auto& sceneCommandBuffers : imageCommandBuffers)
+        {
+            for(auto& commandBuffer : sceneCommandBuffers)
+            {
+                commandBuffer = recorded[job++];
+            }
+        }
+    }
 
-        float currentZPos = (scroll*0.5f) + 10.0f;
-        float distance = sqrt(2*2 + (currentZPos + 3.0f)*(currentZPos + 3.0f));
-        if(distance == 0)
+    staticObjectsVisible.clear();
+    for(auto& scene : scenes)
+    {
+        for(int objIndex = 0; objIndex < scene.getNumObjects(); objIndex++)
         {
-            distance = 0.01f;
+            staticObjectsVisible.push_back(!scene.getObjectAt(objIndex)->isHidden());
         }
+    }
+    staticCommandsValid = true;
+
+    recordTiming.staticMs = static_cast<float>((glfwGetTime() - recordStart) * 1000.0);
+    recordTiming.staticCount++;
+}
 
-        float fov = glm::degrees(atan(5.0f / distance));
-        cameraPos.z = currentZPos;
+std::vector<VkCommandBuffer> PixelRenderer::recordJobs(const std::vector<RecordJob>& jobs, bool parallel) {
 
-        float uiWindowX = (((float)lastClicked.x - 28) - 100)  / 20.0f;
-        float uiWindowY = (((float)lastClicked.y - 156) - 100) / 20.0f;
+    std::vector<VkCommandBuffer> recorded(jobs.size());
 
-        //std::cout<<uiWindowX<<","<<uiWindowY<<std::endl;
+    //a job only touches the command pool of the worker that runs it, and its own slot of the result
+    auto recordJob = [this, &jobs, &recorded](uint32_t worker, uint32_t index){
+        const RecordJob& job = jobs[index];
+        VkCommandBuffer commandBuffer = acquireRecordingCommandBuffer(worker);
 
-        glm::vec3 lightPos = {uiWindowX,4.0f,uiWindowY};
-        float lightIntensity = 1.0f;
-        glm::vec4 lightColor = {1.0f,1.0f,1.0f,1.0f};
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = graphicsPipelines[job.sceneIndex]->getRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = swapchainFramebuffers[job.imageIndex];
 
-        if(MAX_COMPUTE_SAMPLE <= 1)
-        {
-            computePipeline.setPushObj({cameraPos, fov, {0.0f,0.0f,0.0f}, dofFocus , lightPos, lightIntensity, lightColor, i, mouseCoord.x,mouseCoord.y, 1});
-        }else
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        if(result != VK_SUCCESS)
         {
-            computePipeline.setPushObj({cameraPos, fov, {randomArray[i].x,randomArray[i].y,0.0f}, dofFocus , lightPos, lightIntensity, lightColor , i, mouseCoord.x,mouseCoord.y, 1});
+            throw std::runtime_error("failed to start recording a static command buffer!");
         }
 
-        recordComputeCommands(currentFrame);
-
-        VkSubmitInfo computeSubmitInfo{};
-        computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        computeSubmitInfo.commandBufferCount = 1;
-        computeSubmitInfo.pCommandBuffers = &computeCommandBuffers[currentFrame];
-        computeSubmitInfo.signalSemaphoreCount = 1;
-        computeSubmitInfo.pSignalSemaphores = &computeFinishedSemaphore[currentFrame];
-        int indx = (currentFrame + 1) % MAX_FRAME_DRAWS;
-        VkSemaphore waitSemaphores[] = { computeFinishedSemaphore[indx] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
-        if(i != 0)
+        if(job.indirect)
         {
-            computeSubmitInfo.waitSemaphoreCount = 1;
-            computeSubmitInfo.pWaitSemaphores = waitSemaphores;
-            computeSubmitInfo.pWaitDstStageMask = waitStages;
+            recordIndirectDraws(commandBuffer, job.imageIndex, job.sceneIndex);
+        }
+        else
+        {
+            recordObjectDraws(commandBuffer, job.imageIndex, job.sceneIndex, job.firstDraw, job.drawCount);
         }
 
+        result = vkEndCommandBuffer(commandBuffer);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record a static command buffer!");
+        }
+        recorded[index] = commandBuffer;
+    };
 
-        if (vkQueueSubmit(computeQueue, 1, &computeSubmitInfo, inFlightComputeFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit compute command buffer!");
-        };
-
-        //currentSample++;
-        currentFrame = ( currentFrame + 1 ) % MAX_FRAME_DRAWS;
+    if(parallel)
+    {
+        jobSystem.parallelFor(static_cast<uint32_t>(jobs.size()), recordJob);
+    }
+    else
+    {
+        for(uint32_t index = 0; index < jobs.size(); index++)
+        {
+            recordJob(0, index);
+        }
     }
-    currentFrame = ( currentFrame + 1 ) % MAX_FRAME_DRAWS;
 
+    return recorded;
+}
 
-    //graphics submission
-    //the only thing that will open this fence is the vkQueueSubmit
-    vkWaitForFences(mainDevice.logicalDevice, 1, &inFlightDrawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-    vkResetFences(mainDevice.logicalDevice, 1, &inFlightDrawFences[currentFrame]);
+void PixelRenderer::recordObjectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t sceneIndx, uint32_t firstDraw, uint32_t drawCount) {
 
-    //Get index of the next image to draw to and signal semaphore
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(mainDevice.logicalDevice,
-                          swapChain,
-                          std::numeric_limits<uint64_t>::max(),
-                          imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    //nothing in here changes from frame to frame: the transforms and texture ids are in the dynamic uniform buffer
+    //of the swapchain image, which is updated before the frame is submitted.
+    //draws past the last object wrap around to the first one, the benchmark records more draws than the scene has objects
+    PixelScene& scene = scenes[sceneIndx];
+    int objectCount = scene.getNumObjects();
+    if(objectCount == 0)
+    {
+        return;
+    }
 
+    //the viewport is dynamic so the pipeline does not have to be rebuilt when the swapchain is resized.
+    //secondary command buffers do not inherit it
+    VkViewport viewport = {0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0,0}, swapChainExtent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    PixelScene::UboVP newVP1{};
-    newVP1.P = glm::perspective(glm::radians(35.0f), (float)swapChainExtent.height/(float)swapChainExtent.height, 0.01f, 100.0f);
-    newVP1.V = glm::lookAt(glm::vec3(0.0f,0.0f,10.0f), glm::vec3(0.0f,0.0f,0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    newVP1.lightPos = glm::vec4(0.0f,5.0f,25.0f,1.0f);
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for(uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++)
+    {
+        int objIndex = static_cast<int>(draw % static_cast<uint32_t>(objectCount));
+        auto currentObject = scene.getObjectAt(objIndex);
+        if(currentObject->isHidden())
+        {
+            continue;
+        }
+        VkPipeline currentGraphicsPipeline = graphicsPipelines[currentObject->getGraphicsPipelineIndex()]->getPipeline();
+        VkPipelineLayout currentPipelineLayout = graphicsPipelines[currentObject->getGraphicsPipelineIndex()]->getPipelineLayout();
 
-    PixelScene::UboVP newVP2{};
-    newVP2.P = glm::mat4(1.0f);
-    newVP2.V = glm::mat4(1.0f);
-    //newVP2.lightPos = glm::vec4(0.0f,0.0f,5.0f,1.0f);
+        //bind the pipeline
+        if(currentGraphicsPipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentGraphicsPipeline);
+            boundPipeline = currentGraphicsPipeline;
+        }
 
-    scenes[0].setSceneVP(newVP2);
-    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), deltaTime,glm::vec3(1.0f,0.0f,0.0f))});
-    glm::mat4 objTransform = glm::mat4(1.0f);
-    objTransform = glm::scale(glm::mat4(1.0f),glm::vec3(1.0f)) * objTransform;
-    objTransform = glm::rotate(glm::mat4(1.0f), std::sin(currentTime*1.5f)*0.5f,glm::vec3(0.0f,1.0f,0.0f)) * objTransform;
-    objTransform = glm::rotate(glm::mat4(1.0f), std::cos(currentTime*1.5f)*0.5f,glm::vec3(1.0f,0.0f,0.0f)) * objTransform;
-    //objTransform = translate(glm::mat4(1.0f),glm::vec3(0.0f,sin(currentTime*1.5f)*0.3f,0.0f)) * objTransform;
+        VkBuffer vertexBuffers[] = {*(currentObject->getVertexBuffer())}; //buffers to bind
+        VkBuffer indexBuffer = *currentObject->getIndexBuffer();
+        VkDeviceSize offsets[] = {0};                                      //offsets into buffers
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), currentTime,glm::vec3(0.0f,1.0f,0.0f))});
-    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), glm::radians(45.0f),glm::vec3(1.0f,1.0f,0.0f))});
-    //scenes[0]->getObjectAt(0)->setTransform({objTransform});
-    scenes[0].getObjectAt(0)->setTexID(texIndex);
-    scenes[0].updateDynamicUniformBuffer(imageIndex);
-    scenes[0].updateUniformBuffer(imageIndex);
+        std::array<VkDescriptorSet, 2> descriptorSets = {
+                *scene.getUniformDescriptorSetAt(static_cast<int>(imageIndex)),
+                *scene.getTextureDescriptorSet()};
 
-    //we do not want to update all command buffers. only update the current command buffer being written to.
-    recordCommands(imageIndex);
+        //bind the descriptor sets. they are the same for every object, the object buffer is indexed with the instance index
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                currentPipelineLayout,
+                                0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                                0, nullptr);
 
-    //we have to wait for the compute queue to finish submitting
-    std::array<VkSemaphore,2> waitSemaphores = { computeFinishedSemaphore[currentFrame], imageAvailableSemaphore[currentFrame] };
-    VkPipelineStageFlags waitStages[] = {
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-    };
+        //execute the pipeline. the first instance is the index of the object in the object buffer
+        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(currentObject->getIndexCount()), 1, 0, 0, static_cast<uint32_t>(objIndex));
+    }
+}
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
-    submitInfo.pWaitSemaphores = waitSemaphores.data(); //list of semaphores to wait on
-    submitInfo.pWaitDstStageMask = waitStages; //stage to check semaphores at
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex]; //command buffer to submit
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &renderFinishedSemaphore[currentFrame]; //semaphores to signal when the command buffer is finished
+void PixelRenderer::recordIndirectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t sceneIndx) {
 
-    //submit this commandBuffer[imageIndex] to this graphicsQueue. it's essentially our execute function
-    VkResult result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightDrawFences[currentFrame]);
-    if(result != VK_SUCCESS)
+    //the draws come from the lists the cull pass writes every frame, so nothing here depends on the objects but the capacity
+    //of the object buffers and the geometry pool, which both invalidate the static command buffers when they are recreated
+    PixelScene& scene = scenes[sceneIndx];
+    if(scene.getNumObjects() == 0 || *scene.getGeometryVertexBuffer() == VK_NULL_HANDLE)
     {
-        throw std::runtime_error("failed to submit queue");
+        return;
     }
 
-    //present the rendered image to the screen
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &renderFinishedSemaphore[currentFrame]; //semaphore to wait for
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &swapChain;
-    presentInfo.pImageIndices = &imageIndex;
-
-    result = vkQueuePresentKHR(graphicsQueue, &presentInfo);
-    if(result != VK_SUCCESS)
+    VkViewport viewport = {0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0,0}, swapChainExtent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    //every graphics pipeline is created from the set layouts of the scene, so the sets stay bound across the pipeline changes
+    std::array<VkDescriptorSet, 2> descriptorSets = {
+            *scene.getUniformDescriptorSetAt(static_cast<int>(imageIndex)),
+            *scene.getTextureDescriptorSet()};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            graphicsPipelines[0]->getPipelineLayout(),
+                            0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                            0, nullptr);
+
+    //one vertex and index buffer for the whole scene, the draws offset into them
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, scene.getGeometryVertexBuffer(), offsets);
+    vkCmdBindIndexBuffer(commandBuffer, *scene.getGeometryIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    //one list per pipeline, an empty list draws nothing
+    uint32_t groupCount = std::min(static_cast<uint32_t>(graphicsPipelines.size()), MAX_DRAW_GROUPS);
+    for(uint32_t group = 0; group < groupCount; group++)
     {
-        throw std::runtime_error("failed to present image");
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelines[group]->getPipeline());
+        vkCmdDrawIndexedIndirectCount(commandBuffer,
+                                      scene.getDrawBuffer(static_cast<int>(imageIndex)), scene.getDrawGroupOffset(static_cast<int>(imageIndex), group),
+                                      scene.getDrawCountBuffer(static_cast<int>(imageIndex)), sizeof(uint32_t) * group,
+                                      scene.getObjectCapacity(static_cast<int>(imageIndex)), sizeof(VkDrawIndexedIndirectCommand));
     }
-
-    currentFrame = ( currentFrame + 1 ) % MAX_FRAME_DRAWS;
 }
 
-void PixelRenderer::run() {
-
-    //keyboard input
+void PixelRenderer::recordCullCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
 
+    uint32_t cullScope = profiler.beginGpuScope(commandBuffer, "cull");
 
-    while (!glfwWindowShouldClose(pixWindow.getWindow()))
+    //the draws of the last frame that used the lists of this swapchain image have to be done before they are cleared and refilled.
+    //it is a write after read, the execution dependency is enough
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+    for(auto& scene : scenes)
     {
-        glfwPollEvents();
+        vkCmdFillBuffer(commandBuffer, scene.getDrawCountBuffer(static_cast<int>(imageIndex)), 0, VK_WHOLE_SIZE, 0);
+    }
 
-        //imgui new frame
-        ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
 
-        ImGui::NewFrame();
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.getPipeline());
+    uint32_t groupCount = std::min(static_cast<uint32_t>(graphicsPipelines.size()), MAX_DRAW_GROUPS);
+    for(auto& scene : scenes)
+    {
+        uint32_t objectCount = static_cast<uint32_t>(scene.getNumObjects());
+        if(objectCount == 0)
+        {
+            continue;
+        }
 
-        preDraw();
+        //the y flip the uniform buffer gets does not change the frustum, its top and bottom planes only swap
+        PixelScene::UboVP sceneVP = scene.getSceneVP();
+        PixelCullPipeline::PObj pushObj = PixelCullPipeline::getPushObj(sceneVP.P * sceneVP.V, objectCount, scene.getObjectCapacity(static_cast<int>(imageIndex)), groupCount);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.getPipelineLayout(),
+                                0, 1, scene.getCullDescriptorSetAt(static_cast<int>(imageIndex)), 0, nullptr);
+        vkCmdPushConstants(commandBuffer, cullPipeline.getPipelineLayout(), PixelCullPipeline::pushCullConstantRange.stageFlags,
+                           0, sizeof(PixelCullPipeline::PObj), &pushObj);
+        vkCmdDispatch(commandBuffer, PixelCullPipeline::getDispatchSize(objectCount), 1, 1);
+    }
+
+    //the lists and counts are read as indirect parameters by the render passes that follow
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                         0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+    profiler.endGpuScope(commandBuffer, cullScope);
+}
+
+void PixelRenderer::resetRecordingContexts() {
+
+    //none of their command buffers may be pending
+    for(auto& context : recordingContexts)
+    {
+        vkResetCommandPool(mainDevice.logicalDevice, context.commandPool, 0);
+        context.used = 0;
+    }
+}
+
+VkCommandBuffer PixelRenderer::acquireRecordingCommandBuffer(uint32_t worker) {
+
+    //only called from the thread running as that worker, the pool of a context is never shared
+    RecordingContext& context = recordingContexts[worker];
+    if(context.used == context.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = context.commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VkResult result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &allocateInfo, &commandBuffer);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate a recording command buffer!");
+        }
+        context.commandBuffers.push_back(commandBuffer);
+    }
+    return context.commandBuffers[context.used++];
+}
+
+void PixelRenderer::benchmarkRecording() {
+
+    //the same draws recorded by one thread and by the job system, with the objects of the first scene repeated up to each count.
+    //the buffers are never submitted, the static ones are recorded again afterwards since the pools are reset
+    recordBenchmarks.clear();
+    vkQueueWaitIdle(graphicsQueue);
+
+    for(uint32_t draws = 10; draws <= RECORD_BENCHMARK_MAX_DRAWS; draws *= 10)
+    {
+        std::vector<RecordJob> jobs;
+        for(uint32_t firstDraw = 0; firstDraw < draws; firstDraw += RECORD_DRAWS_PER_JOB)
+        {
+            jobs.push_back({0, 0, firstDraw, std::min(RECORD_DRAWS_PER_JOB, draws - firstDraw)});
+        }
+
+        RecordBenchmark benchmark{draws};
+        resetRecordingContexts();
+        double start = glfwGetTime();
+        recordJobs(jobs, false);
+        benchmark.singleMs = static_cast<float>((glfwGetTime() - start) * 1000.0);
+
+        resetRecordingContexts();
+        start = glfwGetTime();
+        recordJobs(jobs, true);
+        benchmark.parallelMs = static_cast<float>((glfwGetTime() - start) * 1000.0);
+
+        recordBenchmarks.push_back(benchmark);
+    }
+
+    invalidateStaticCommands();
+}
+
+void PixelRenderer::init_culling() {
+
+    //one descriptor set per scene and swapchain image, they point at the object buffer and the draw lists of that image
+    cullPipeline = PixelCullPipeline(&mainDevice);
+    cullPipeline.init(&shaderCompiler, static_cast<uint32_t>(scenes.size() * swapChainImages.size()));
+    shaderCompiler.watch({"cull.comp",
+                          [this](const std::vector<uint32_t>& spirv){return shaderCompiler.createComputePipeline(cullPipeline.getPipelineLayout(), spirv);},
+                          [this](VkPipeline pipeline){return cullPipeline.swapPipeline(pipeline);}});
+}
+
+void PixelRenderer::init_mipmaps() {
+
+    mipmapPipeline = PixelMipmapPipeline(&mainDevice);
+    mipmapPipeline.init(&shaderCompiler);
+    shaderCompiler.watch({"mipmap.comp",
+                          [this](const std::vector<uint32_t>& spirv){return shaderCompiler.createComputePipeline(mipmapPipeline.getPipelineLayout(), spirv);},
+                          [this](VkPipeline pipeline){return mipmapPipeline.swapPipeline(pipeline);}});
+}
+
+void PixelRenderer::init_present() {
+
+    presentPipeline = PixelPresentPipeline(&mainDevice, swapChainImageFormat);
+    presentPipeline.init(&shaderCompiler, imageSampler);
+    shaderCompiler.watch({PRESENT_VERTEX_SHADER,
+                          [this](const std::vector<uint32_t>& spirv){return presentPipeline.buildPipeline(spirv, shaderCompiler.compile(PRESENT_FRAGMENT_SHADER));},
+                          [this](VkPipeline pipeline){return presentPipeline.swapPipeline(pipeline);}});
+    shaderCompiler.watch({PRESENT_FRAGMENT_SHADER,
+                          [this](const std::vector<uint32_t>& spirv){return presentPipeline.buildPipeline(shaderCompiler.compile(PRESENT_VERTEX_SHADER), spirv);},
+                          [this](VkPipeline pipeline){return presentPipeline.swapPipeline(pipeline);}});
+    presentPipeline.createFramebuffers(swapChainImages, swapChainExtent);
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        presentPipeline.writeDescriptorSet(i, computePipeline.getOutputTexture(i), computePipeline.getCustomTexture(i));
+    }
+}
+
+void PixelRenderer::init_streaming() {
+    QueueFamilyIndices queueFamilyIndices = setupQueueFamilies(mainDevice.physicalDevice);
+    textureStreamer = PixelTextureStreamer(&mainDevice, graphicsQueue, queueFamilyIndices.graphicsFamily, memoryBudgetSupported);
+    textureStreamer.init();
+}
+
+void PixelRenderer::init_recording() {
+
+    jobSystem.init(0);
+
+    //one graphics command pool per worker, command pools are not shared between threads
+    QueueFamilyIndices queueFamilyIndices = setupQueueFamilies(mainDevice.physicalDevice);
+    recordingContexts.resize(jobSystem.getWorkerCount());
+    for(auto& context : recordingContexts)
+    {
+        VkCommandPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreateInfo.flags = 0; //the whole pool is reset at once before a re-record
+        poolCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+        VkResult result = vkCreateCommandPool(mainDevice.logicalDevice, &poolCreateInfo, nullptr, &context.commandPool);
+        if(result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create a recording command pool!");
+        }
+    }
+}
+
+bool PixelRenderer::staticCommandsOutdated() {
+
+    if(!staticCommandsValid || staticCommandBuffers.size() != swapchainFramebuffers.size() || staticGpuDriven != isGpuDriven())
+    {
+        return true;
+    }
+
+    //the cull pass reads the visibility and the number of objects from the object buffers every frame
+    if(staticGpuDriven)
+    {
+        return false;
+    }
+
+    //objects added, removed, hidden or shown
+    size_t objectIndex = 0;
+    for(auto& scene : scenes)
+    {
+        for(int objIndex = 0; objIndex < scene.getNumObjects(); objIndex++, objectIndex++)
+        {
+            if(objectIndex >= staticObjectsVisible.size() || staticObjectsVisible[objectIndex] == scene.getObjectAt(objIndex)->isHidden())
+            {
+                return true;
+            }
+        }
+    }
+    return objectIndex != staticObjectsVisible.size();
+}
+
+void PixelRenderer::draw() {
+
+    //time measurements
+    float deltaTime = (float)glfwGetTime() - currentTime;
+    currentTime = (float)glfwGetTime();
+
+    //the command buffers of this frame slot are reused once the timelines have reached the frame that last used it
+    frameGraph.beginFrame(currentFrame);
+
+    //the pipelines saved since the last frame are swapped in before anything is recorded with them. a new ray tracing kernel
+    //traces the image again from scratch, a new scene pipeline has the static command buffers recorded again
+    if(shaderCompiler.applyReloads())
+    {
+        sceneKernelSpecialized = specializeScene && PixelShaderGenerator::canSpecialize(raytracedScene);
+    }
+
+    //Get index of the next image to draw to and signal semaphore. it is acquired before the compute submission:
+    //when the swapchain is out of date nothing is submitted this frame, so no semaphore is left signaled without a waiter
+    uint32_t imageIndex;
+    VkResult acquireResult = vkAcquireNextImageKHR(mainDevice.logicalDevice,
+                                                   swapChain,
+                                                   std::numeric_limits<uint64_t>::max(),
+                                                   imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    if(acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        recreateSwapChain();
+        return;
+    }
+    if(acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+    {
+        throw std::runtime_error("failed to acquire a swapchain image");
+    }
+
+    //get the next available image to draw to and set something to signal when we are finished with the image
+    //submit the command buffer to the queue for execution make sure to wait for image to be signal as available before drawing to it. it then signals when it is finished rendering
+    //present image to screen when image is signaled as finished rendering
+
+    glm::vec3 cameraPos = {0.0f, 2.0f, 10.0f};
+
+    float currentZPos = (scroll*0.5f) + 10.0f;
+    float distance = sqrt(2*2 + (currentZPos + 3.0f)*(currentZPos + 3.0f));
+    if(distance == 0)
+    {
+        distance = 0.01f;
+    }
+
+    float fov = glm::degrees(atan(5.0f / distance));
+    cameraPos.z = currentZPos;
+
+    float uiWindowX = (((float)lastClicked.x - 28) - 100)  / 20.0f;
+    float uiWindowY = (((float)lastClicked.y - 156) - 100) / 20.0f;
+
+    //std::cout<<uiWindowX<<","<<uiWindowY<<std::endl;
+
+    glm::vec3 lightPos = {uiWindowX,4.0f,uiWindowY};
+    float lightIntensity = 1.0f;
+    glm::vec4 lightColor = {1.0f,1.0f,1.0f,1.0f};
+
+    PixelComputePipeline::PObj framePushObj = {cameraPos, fov, {0.0f,0.0f,0.0f}, dofFocus , lightPos, lightIntensity, lightColor, 0, mouseCoord.x,mouseCoord.y, 1};
+
+    //the last image is reprojected into the new view as long as only the camera moved. anything else changes the shading of every pixel
+    const PixelComputePipeline::PObj& last = lastRenderedPushObj;
+    bool historyValid = temporalReprojection && hasRendered && last.focus == dofFocus &&
+                        last.lightPos == lightPos && last.intensity == lightIntensity && last.lightColor == lightColor;
+    framePushObj.prevCameraPos = last.cameraPos;
+    framePushObj.prevFov = last.fov;
+    framePushObj.historyValid = historyValid ? 1 : 0;
+    framePushObj.maxHistoryWeight = maxHistoryWeight;
+
+    //the raytraced image only depends on the compute parameters. when one of them changes the whole frame is dispatched once,
+    //then the tiles keep refining it within the compute budget until every pixel has the target number of samples
+    bool denoiseChanged = lastRenderedDenoiseIterations != (denoiseEnabled ? denoiseIterations : 0) || lastRenderedDenoiseStrength != denoiseStrength;
+    bool restart = needsRestart(framePushObj) || measureOverlap;
+    uint32_t targetSamples = getTargetSamples();
+    //the outline is composited from the object ids, moving the cursor only needs a new pick and a new composite
+    bool outlineChanged = hasRendered && (last.mouseCoordX != framePushObj.mouseCoordX || last.mouseCoordY != framePushObj.mouseCoordY ||
+                                          last.outlineEnabled != framePushObj.outlineEnabled);
+    //the tiles the refinement thread added since the last frame only show once they are composited
+    bool refined = refinedTilesSinceFrame > 0;
+    lastFrameRefinedTiles = refinedTilesSinceFrame;
+    refinedTilesSinceFrame = 0;
+    //a pending autofocus needs a pick under the cursor, even if the image itself is done
+    bool computeNeeded = restart || denoiseChanged || outlineChanged || refined || !tileScheduler.isConverged(targetSamples) || !autoFocusFinished;
+
+    profiler.setOverlapMeasurement(measureOverlap);
+    profiler.beginFrame();
+
+    //the gpu times of a few frames ago tell how many tiles fit in the budget
+    if(profiler.getGpuWorkItems("compute restart") > 0)
+    {
+        tileScheduler.reportFullFrameTime(profiler.getGpuTime("compute restart"));
+        sceneKernelMs[sceneKernelSpecialized ? 1 : 0] = profiler.getGpuTime("compute restart");
+    }
+    tileScheduler.reportTileTime(profiler.getGpuTime("compute tiles"), profiler.getGpuWorkItems("compute tiles"));
+
+    // Compute passes
+    uint32_t tracePass = UINT32_MAX;
+    if(computeNeeded)
+    {
+        if(restart)
+        {
+            tileScheduler.restart(historyValid);
+        }
+
+        //the refinement is centered on the cursor, that is where the user is looking
+        std::vector<std::vector<PixelTileScheduler::TileDispatch>> rounds = tileScheduler.scheduleBatch(glm::vec2(mouseCoord), targetSamples, restart);
+
+        framePushObj.samplerMode = SAMPLER_PINHOLE;
+        if((MAX_COMPUTE_SAMPLE > 1 || temporalReprojection) && lowDiscrepancySampling)
+        {
+            framePushObj.samplerMode = SAMPLER_SOBOL_BLUE_NOISE;
+        } else if(MAX_COMPUTE_SAMPLE > 1 || temporalReprojection)
+        {
+            framePushObj.samplerMode = SAMPLER_RANDOM;
+        }
+
+        //the denoised image is kept as long as the accumulation it was filtered from does not change
+        bool denoise = denoiseEnabled && (restart || denoiseChanged || refined || !rounds.empty());
+        framePushObj.denoised = denoiseEnabled ? 1 : 0;
+
+        //the passes are recorded when the graph executes, they get a copy of what they need
+        uint32_t pickSlot = static_cast<uint32_t>(currentFrame);
+        PixelComputePipeline::PObj passPushObj = framePushObj;
+
+        //the camera basis and the ray scale factors only change with the view, the kernels read them from a uniform buffer
+        VkExtent2D traceExtent = {computePipeline.getOutputTexture()->getWidth(), computePipeline.getOutputTexture()->getHeight()};
+        PixelComputePipeline::CameraUniforms passCamera = PixelComputePipeline::getCameraUniforms(framePushObj, traceExtent);
+
+        //the trace only touches the accumulation and the G-buffer, so it does not wait for the graphics of the last frame
+        tracePass = frameGraph.addPass("trace", FRAME_GRAPH_COMPUTE, [this, passPushObj, passCamera, restart, denoise, rounds, pickSlot](VkCommandBuffer commandBuffer){
+            recordTraceCommands(commandBuffer, passPushObj, passCamera, restart, denoise, rounds, pickSlot);
+        });
+        frameGraph.write(tracePass, accumulatorResource, {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                          VK_IMAGE_LAYOUT_GENERAL});
+        frameGraph.read(tracePass, blueNoiseResource, {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL});
+
+        //the outline writes the display buffer the graphics of the last frame is not sampling, so it only waits for the frame before.
+        //every pixel is rewritten, the old content is discarded instead of being transferred back from the graphics family
+        uint32_t targetBuffer = (displayBuffer + 1) % DISPLAY_BUFFER_COUNT;
+        uint32_t outlinePass = frameGraph.addPass("outline", FRAME_GRAPH_COMPUTE, [this, passPushObj, targetBuffer](VkCommandBuffer commandBuffer) mutable {
+            recordOutlineCommands(commandBuffer, passPushObj, targetBuffer);
+        });
+        FrameGraphUse outlineWrite = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+        frameGraph.read(outlinePass, accumulatorResource, {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL});
+        frameGraph.write(outlinePass, displayResources[targetBuffer], outlineWrite);
+        frameGraph.write(outlinePass, outlineMaskResources[targetBuffer], outlineWrite);
+        displayBuffer = targetBuffer;
+
+        pickPending[currentFrame] = true;
+        pickOverGui[currentFrame] = ImGui::GetIO().WantCaptureMouse;
+        pickFrame[currentFrame] = ++computeFrameCount;
+
+        framePushObj.currentSample = 0;
+        framePushObj.sampleIndex = 0;
+        framePushObj.randomOffsets = {0.0f,0.0f,0.0f};
+        framePushObj.tileOffset = {0,0};
+        lastRenderedPushObj = framePushObj;
+        lastRenderedDenoiseIterations = denoiseEnabled ? denoiseIterations : 0;
+        lastRenderedDenoiseStrength = denoiseStrength;
+        hasRendered = true;
+    }
+
+
+    //graphics submission
+
+    PixelScene::UboVP newVP1{};
+    newVP1.P = glm::perspective(glm::radians(35.0f), (float)swapChainExtent.height/(float)swapChainExtent.height, 0.01f, 100.0f);
+    newVP1.V = glm::lookAt(glm::vec3(0.0f,0.0f,10.0f), glm::vec3(0.0f,0.0f,0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    newVP1.lightPos = glm::vec4(0.0f,5.0f,25.0f,1.0f);
+
+    PixelScene::UboVP newVP2{};
+    newVP2.P = glm::mat4(1.0f);
+    newVP2.V = glm::mat4(1.0f);
+    //newVP2.lightPos = glm::vec4(0.0f,0.0f,5.0f,1.0f);
+
+    scenes[0].setSceneVP(newVP2);
+    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), deltaTime,glm::vec3(1.0f,0.0f,0.0f))});
+    glm::mat4 objTransform = glm::mat4(1.0f);
+    objTransform = glm::scale(glm::mat4(1.0f),glm::vec3(1.0f)) * objTransform;
+    objTransform = glm::rotate(glm::mat4(1.0f), std::sin(currentTime*1.5f)*0.5f,glm::vec3(0.0f,1.0f,0.0f)) * objTransform;
+    objTransform = glm::rotate(glm::mat4(1.0f), std::cos(currentTime*1.5f)*0.5f,glm::vec3(1.0f,0.0f,0.0f)) * objTransform;
+    //objTransform = translate(glm::mat4(1.0f),glm::vec3(0.0f,sin(currentTime*1.5f)*0.3f,0.0f)) * objTransform;
+
+    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), currentTime,glm::vec3(0.0f,1.0f,0.0f))});
+    //firstScene->getObjectAt(0)->addTransform({glm::rotate(glm::mat4(1.0f), glm::radians(45.0f),glm::vec3(1.0f,1.0f,0.0f))});
+    //scenes[0]->getObjectAt(0)->setTransform({objTransform});
+    //the streamed textures that changed their levels get a new index, written to the object buffers below
+    textureStreamer.update(scenes, swapChainExtent);
+
+    for(auto& scene : scenes)
+    {
+        //a scene that outgrew the object buffer of this image gets a bigger one. the frames that rendered to the image are done
+        //since it was acquired, so its descriptor set is free to rewrite, but the frames still in flight on the other images
+        //may read the old buffer until the graphics timeline passes them
+        scene.destroyRetiredBuffers(frameGraph.getCompletedValue(FRAME_GRAPH_GRAPHICS));
+        if(scene.needsObjectBufferGrowth(imageIndex))
+        {
+            scene.growObjectBuffer(imageIndex, frameGraph.getSubmittedValue(FRAME_GRAPH_GRAPHICS));
+            updateObjectBufferDescriptor(&scene, imageIndex);
+            invalidateStaticCommands(); //the static draws of the image were recorded with the old descriptor
+        }
+        //the geometry pool gets new buffers once objects were added to it, the old ones are retired the same way
+        if(scene.needsGeometryUpload())
+        {
+            scene.retireGeometryBuffers(frameGraph.getSubmittedValue(FRAME_GRAPH_GRAPHICS));
+            createGeometryBuffers(&scene);
+            invalidateStaticCommands();
+        }
+        scene.updateObjectBuffer(imageIndex);
+
+        //textures streamed in or out since the last frame, only their slots are written
+        scene.registerTextures();
+        scene.getTextureRegistry()->flush();
+    }
+    scenes[0].updateUniformBuffer(imageIndex);
+
+    if(staticCommandsOutdated())
+    {
+        recordStaticCommands();
+    }
+
+    //the raytraced images are only read by the present fragment shader, the swapchain image is only written at color output.
+    //the render pass transitions the swapchain image itself, the graph orders it between the acquire and the present
+    uint32_t displayPass = frameGraph.addPass("display", FRAME_GRAPH_GRAPHICS, [this, imageIndex](VkCommandBuffer commandBuffer){
+        recordCommands(commandBuffer, imageIndex);
+    });
+    frameGraph.read(displayPass, displayResources[displayBuffer], {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    frameGraph.read(displayPass, outlineMaskResources[displayBuffer], {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    frameGraph.write(displayPass, swapchainResource, {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED});
+    frameGraph.waitExternal(swapchainResource, imageAvailableSemaphore[currentFrame]);
+    frameGraph.signalExternal(swapchainResource, renderFinishedSemaphore[currentFrame]);
+
+    frameGraph.execute();
+    if(tracePass != UINT32_MAX)
+    {
+        pickValue[currentFrame] = frameGraph.getPassValue(tracePass);
+    }
+
+    //present the rendered image to the screen
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphore[currentFrame]; //semaphore to wait for
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapChain;
+    presentInfo.pImageIndices = &imageIndex;
+
+    //a suboptimal swapchain still presents, it is recreated right after so the next frame matches the window
+    VkResult result = vkQueuePresentKHR(graphicsQueue, &presentInfo);
+
+    float gpuMs = profiler.isGpuTimingSupported() ? profiler.getGpuTime("compute") + profiler.getGpuTime("outline") + profiler.getGpuTime("cull") + profiler.getGpuTime("graphics") : 0.0f;
+    framePacer.framePresented(glfwGetTime(), gpuMs, getDisplayLatencyMs());
+
+    //the present mode is part of the swapchain, changing it goes through the same recreation as a resize
+    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || WINDOW_RESIZED || presentModeChanged)
+    {
+        WINDOW_RESIZED = false;
+        presentModeChanged = false;
+        recreateSwapChain();
+    }
+    else if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to present image");
+    }
+
+    currentFrame = ( currentFrame + 1 ) % MAX_FRAME_DRAWS;
+}
+
+void PixelRenderer::run() {
+
+    //keyboard input
+
+
+    //the refinement thread only runs while this thread waits
+    std::unique_lock<std::mutex> lock(renderMutex);
+
+    while (!glfwWindowShouldClose(pixWindow.getWindow()))
+    {
+        bool idle = isIdle();
+        profiler.tick(idle);
+
+        if(idle)
+        {
+            //the image has converged: sleep until something happens instead of spinning on the same frame
+            double waitStart = glfwGetTime();
+            lock.unlock();
+            glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+            lock.lock();
+            profiler.addWaitTime(glfwGetTime() - waitStart);
+        }
+        else
+        {
+            //the time left before the next frame is given to the refinement thread
+            double waitStart = glfwGetTime();
+            refinementRequested = framePacer.isLimiting();
+            refinementDeadline = waitStart + framePacer.getTimeUntilNextFrame();
+            lock.unlock();
+            refinementWake.notify_one();
+            framePacer.waitForNextFrame();
+            lock.lock();
+            refinementRequested = false;
+            profiler.addWaitTime(glfwGetTime() - waitStart);
+
+            glfwPollEvents();
+        }
+
+        if(INPUT_RECEIVED)
+        {
+            framePacer.inputReceived(INPUT_TIME);
+            INPUT_RECEIVED = false;
+            activeFramesRemaining = IDLE_GRACE_FRAMES;
+        }
+        else if(idle && !shaderCompiler.hasPendingReloads())
+        {
+            profiler.addSkippedFrame();
+            continue;
+        }
+
+        //imgui new frame
+        ImGui_ImplVulkan_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+
+        ImGui::NewFrame();
+
+        preDraw();
 
         ImGui::Render();
 
         draw_data = ImGui::GetDrawData();
 
         draw();
+
+        if(activeFramesRemaining > 0)
+        {
+            activeFramesRemaining--;
+        }
+    }
+}
+
+bool PixelRenderer::isIdle() {
+    //the autofocus animates the focus distance without any input, so we keep drawing until it lands
+    //the tiles also keep refining the image on their own while the camera is still
+    return powerSaving && !measureOverlap && hasRendered && autoFocusFinished && activeFramesRemaining <= 0 && tileScheduler.isConverged(getTargetSamples());
+}
+
+uint32_t PixelRenderer::getTargetSamples() {
+    //with the reprojection on, the history keeps growing until it reaches its maximum weight
+    uint32_t targetSamples = static_cast<uint32_t>(std::max(MAX_COMPUTE_SAMPLE, 1));
+    if(temporalReprojection)
+    {
+        targetSamples = std::max(targetSamples, static_cast<uint32_t>(maxHistoryWeight));
+    }
+    return targetSamples;
+}
+
+bool PixelRenderer::needsRestart(const PixelComputePipeline::PObj& pushObj) {
+
+    if(!hasRendered)
+    {
+        return true;
     }
+
+    //currentSample, sampleIndex, randomOffsets and tileOffset change within a frame, they are not part of the comparison.
+    //neither is the cursor, the outline does not go through the raytracer
+    const PixelComputePipeline::PObj& last = lastRenderedPushObj;
+    return last.cameraPos != pushObj.cameraPos || last.fov != pushObj.fov || last.focus != pushObj.focus ||
+           last.lightPos != pushObj.lightPos || last.intensity != pushObj.intensity || last.lightColor != pushObj.lightColor;
 }
 
 
@@ -1001,17 +1778,11 @@ void PixelRenderer::createSynchronizationObjects() {
 
     imageAvailableSemaphore.resize(MAX_FRAME_DRAWS);
     renderFinishedSemaphore.resize(MAX_FRAME_DRAWS);
-    computeFinishedSemaphore.resize(MAX_FRAME_DRAWS);
-    inFlightDrawFences.resize(MAX_FRAME_DRAWS);
-    inFlightComputeFences.resize(MAX_FRAME_DRAWS);
 
     VkSemaphoreCreateInfo semaphoreCreateInfo{};
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceCreateInfo{};
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
+    //the frames in flight are tracked by the timeline semaphores of the frame graph, only the swapchain needs binary ones
     VkResult result;
 
     for(size_t i = 0; i<MAX_FRAME_DRAWS; i++)
@@ -1027,24 +1798,6 @@ void PixelRenderer::createSynchronizationObjects() {
         {
             throw std::runtime_error("Failed to create the renderFinished Semaphore");
         }
-
-        result = vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &computeFinishedSemaphore[i]);
-        if(result != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create the computeFinished Semaphore");
-        }
-
-        result = vkCreateFence(mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &inFlightComputeFences[i]);
-        if(result != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create the inflight compute fences");
-        }
-
-        result = vkCreateFence(mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &inFlightDrawFences[i]);
-        if(result != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create the inflight draw fences");
-        }
     }
 }
 
@@ -1134,7 +1887,7 @@ void PixelRenderer::createVertexBuffer(PixelObject* pixObject) {
     vkFreeMemory(mainDevice.logicalDevice, stagingBufferMemory, nullptr);
 }
 
-void PixelRenderer::createTextureBuffer(PixelImage* pixImage) {
+void PixelRenderer::createTextureBuffer(PixelImage* pixImage, VkImageLayout finalLayout) {
 
     //temporary buffer to stage the vertex buffer before being transfered to the GPU
     VkBuffer stagingBuffer;
@@ -1145,7 +1898,18 @@ void PixelRenderer::createTextureBuffer(PixelImage* pixImage) {
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                  &stagingBuffer, &stagingBufferMemory);
 
-    if(pixImage->getImageData() != nullptr)
+    if(pixImage->isCompressed())
+    {
+        //block compressed textures come with their whole mip chain, every level is copied from the staging buffer
+        void *data;
+        vkMapMemory(mainDevice.logicalDevice, stagingBufferMemory, 0, pixImage->getImageBufferSize(), 0, &data);
+        memcpy(data, pixImage->getCompressedData(), static_cast<size_t>(pixImage->getImageBufferSize()));
+        vkUnmapMemory(mainDevice.logicalDevice, stagingBufferMemory);
+
+        transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        copySrcBuffertoDstImageLevels(stagingBuffer, pixImage);
+        transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout);
+    } else if(pixImage->getImageData() != nullptr)
     {
         //Map memory to staging buffer
         void *data; //create a pointer to a point in normal memory
@@ -1159,17 +1923,26 @@ void PixelRenderer::createTextureBuffer(PixelImage* pixImage) {
         //graphics queues are also transfer queues & graphics command pool are also transfer command pools
         copySrcBuffertoDstImage(stagingBuffer, pixImage->getImage(), pixImage->getWidth(), pixImage->getHeight());
 
-        //transition the image from image layout transfer bit so it can be read by the shader.
-        transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        //transition the image from image layout transfer bit so it can be read by the shader. storage images are read in the general layout
+        if(pixImage->getMipLevels() > 1)
+        {
+            generateMipmaps(pixImage, finalLayout); //the levels are transitioned as they are written
+        } else
+        {
+            transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout);
+        }
     } else
     {
-        transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        transitionImageLayout(pixImage->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
     }
 
 
     //cleanup transferbuffer
     vkDestroyBuffer(mainDevice.logicalDevice, stagingBuffer, nullptr);
     vkFreeMemory(mainDevice.logicalDevice, stagingBufferMemory, nullptr);
+
+    //the texels are on the gpu now, a streamed texture reads its other levels from its cache file
+    pixImage->releaseHostData();
 }
 
 void PixelRenderer::createIndexBuffer(PixelObject *pixObject)
@@ -1208,6 +1981,52 @@ void PixelRenderer::initializeObjectBuffers(PixelObject *pixObject) {
     createIndexBuffer(pixObject);
 }
 
+void PixelRenderer::createGeometryBuffers(PixelScene *pixScene) {
+
+    //the meshes of the scene one after the other, staged the same way as the buffers of a single object
+    std::vector<PixelObject::Vertex>* vertices = pixScene->getGeometryVertices();
+    std::vector<uint32_t>* indices = pixScene->getGeometryIndices();
+    if(vertices->empty() || indices->empty())
+    {
+        return;
+    }
+
+    VkDeviceSize vertexBufferSize = sizeof(PixelObject::Vertex) * vertices->size();
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices->size();
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(vertexBufferSize + indexBufferSize,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &stagingBuffer, &stagingBufferMemory);
+
+    //the vertices then the indices, in a single staging buffer
+    char *data;
+    vkMapMemory(mainDevice.logicalDevice, stagingBufferMemory, 0, vertexBufferSize + indexBufferSize, 0, reinterpret_cast<void**>(&data));
+    memcpy(data, vertices->data(), static_cast<size_t>(vertexBufferSize));
+    memcpy(data + vertexBufferSize, indices->data(), static_cast<size_t>(indexBufferSize));
+    vkUnmapMemory(mainDevice.logicalDevice, stagingBufferMemory);
+
+    createBuffer(vertexBufferSize,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 pixScene->getGeometryVertexBuffer(), pixScene->getGeometryVertexBufferMemory());
+    createBuffer(indexBufferSize,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 pixScene->getGeometryIndexBuffer(), pixScene->getGeometryIndexBufferMemory());
+
+    VkCommandBuffer transferCommandBuffer = beginSingleUseCommandBuffer();
+    VkBufferCopy vertexCopy = {0, 0, vertexBufferSize};
+    VkBufferCopy indexCopy = {vertexBufferSize, 0, indexBufferSize};
+    vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, *pixScene->getGeometryVertexBuffer(), 1, &vertexCopy);
+    vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, *pixScene->getGeometryIndexBuffer(), 1, &indexCopy);
+    submitAndEndSingleUseCommandBuffer(&transferCommandBuffer);
+
+    vkDestroyBuffer(mainDevice.logicalDevice, stagingBuffer, nullptr);
+    vkFreeMemory(mainDevice.logicalDevice, stagingBufferMemory, nullptr);
+
+    pixScene->setGeometryUploaded();
+}
+
 void PixelRenderer::createUniformBuffers(PixelScene *pixScene) {
 
     pixScene->resizeBuffers(swapChainImages.size());
@@ -1218,11 +2037,12 @@ void PixelRenderer::createUniformBuffers(PixelScene *pixScene) {
                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                      pixScene->getUniformBuffers(i), pixScene->getUniformBufferMemories(i));
+    }
 
-        createBuffer(pixScene->getDynamicUniformBufferSize(),
-                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     pixScene->getDynamicUniformBuffers(i), pixScene->getDynamicUniformBufferMemories(i));
+    //the per object data, sized for the objects already in the scene. nothing is retired, the buffers are new
+    for(uint32_t i = 0; i < swapChainImages.size(); i++)
+    {
+        pixScene->growObjectBuffer(i, 0);
     }
 }
 
@@ -1233,52 +2053,97 @@ void PixelRenderer::initializeScenes() {
     emptyTexture.loadEmptyTexture();
     createTextureBuffer(&emptyTexture);
 
-    //initialize all objects in the scene
+    //initialize all objects in the scene. a texture shared by several objects, or scenes, is only uploaded once
+    std::unordered_set<PixelImage*> uploadedTextures;
     for(auto& scene : scenes)
     {
         for(int i = 0 ; i < scene.getNumObjects(); i++)
         {
             initializeObjectBuffers(scene.getObjectAt(i)); //depends on graphics command pool
-            for(auto texture : scene.getObjectAt(i)->getTextures())
+            for(auto& texture : *scene.getObjectAt(i)->getTextures())
             {
-                createTextureBuffer(&texture);
+                if(uploadedTextures.insert(texture.get()).second)
+                {
+                    createTextureBuffer(texture.get());
+                }
             }
         }
 
+        createGeometryBuffers(&scene);
         createUniformBuffers(&scene);
         createDescriptorPool(&scene);
-        createDescriptorSets(&scene);
+        allocateImageDescriptorSets(&scene);
     }
 
 
 }
 
-void PixelRenderer::createScene() {
+void PixelRenderer::createMaterials() {
 
-    //create scene
-    PixelScene scene1 = PixelScene(mainDevice.logicalDevice, mainDevice.physicalDevice);
+    //the ray tracer samples its textures at any distance, so they are loaded with all their levels instead of being streamed.
+    //their indices never change and the material buffer is written once, before the first frame
+    computePipeline.initTextureRegistry(imageSampler, &emptyTexture);
+    PixelTextureRegistry* registry = computePipeline.getTextureRegistry();
+
+    //roughness and metallic are sampled together, they are packed in the red and green channels of one texture
+    std::array<TextureHandle, 2> textures = {textureCache.acquire("rock.jpg", false, false),
+                                             textureCache.acquirePacked("Rock01_Roughness.png", "Rock01_Metallic.png", false)};
+    std::array<uint32_t, 2> indices{};
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        createTextureBuffer(textures[i].get());
+        indices[i] = registry->add(textures[i].get());
+        materialTextures.push_back(textures[i]);
+    }
+
+    //the spheres keep the metal factor they had before the materials, the large one is made of rock
+    PixelComputePipeline::Material metal{};
+    metal.metallicFactor = 0.5f;
+    computePipeline.setMaterial(1, metal); //OBJECT_SPHERE_1
+    computePipeline.setMaterial(3, metal); //OBJECT_SPHERE_3
+
+    PixelComputePipeline::Material rock{};
+    rock.roughnessFactor = 1.0f;
+    rock.metallicFactor = 1.0f;
+    rock.albedoTexture = indices[0];
+    rock.roughnessMetallicTexture = indices[1];
+    rock.uvScale = 2.0f;
+    computePipeline.setMaterial(2, rock); //OBJECT_SPHERE_2
 
-    //create mesh
-    std::vector<PixelObject::Vertex> vertices = {
-            {{-1.0f,-1.0f,0.0f,1.0f},    {0.0f,0.0f,1.0f,0.0f},{1.0f, 1.0f, 0.0f, 1.0f},{0.0f, 1.0f}}, //0
-            {{1.0f,-1.0f,0.0f,1.0f},     {0.0f,0.0f,1.0f,0.0f},{0.0f, 1.0f, 1.0f, 1.0f},{1.0f, 1.0f}}, //1
-            {{1.0f,1.0f,0.0f,1.0f},     {0.0f,0.0f,1.0f,0.0f},{1.0f, 0.0f, 1.0f, 1.0f},{1.0f, 0.0f}},  //2
-            {{-1.0f,1.0f,0.0f,1.0f},    {0.0f,0.0f,1.0f,0.0f},{1.0f, 0.0f, 0.0f, 1.0f},{0.0f, 0.0f}}    //3
+    computePipeline.setMaterial(4, PixelComputePipeline::Material{}); //OBJECT_PLANE, a rough dielectric
+
+    registry->flush();
+}
+
+void PixelRenderer::createRaytracedScene() {
+
+    //the ids are the ones of raytracer.glsl, the materials are set by createMaterials
+    raytracedScene.spheres = {
+            {{0.0f, 0.0f, -3.0f}, 1.0f, {1.0f, 0.0f, 0.0f}, 0.5f, 1}, //OBJECT_SPHERE_1, the camera looks at it
+            {{2.0f, 1.0f, -8.0f}, 2.0f, {1.0f, 0.3f, 0.0f}, 0.5f, 2}, //OBJECT_SPHERE_2
+            {{-2.0f, -0.5f, -1.0f}, 0.5f, {0.0f, 0.5f, 1.0f}, 0.5f, 3} //OBJECT_SPHERE_3
     };
-    std::vector<uint32_t> indices{
-            1,2,0,
-            2,3,0
+    raytracedScene.planes = {
+            {{0.0f, -1.0f, -5.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, 0.0f, 4} //OBJECT_PLANE
     };
+}
 
-    auto square = PixelObject(&mainDevice, vertices, indices);
+void PixelRenderer::updateSceneKernel() {
 
-    square.setGraphicsPipelineIndex(1);
-    square.addTexture(computePipeline.getOutputTexture());
-    square.addTexture(computePipeline.getCustomTexture());
+    //an empty include goes back to the file on disk. the kernels are rebuilt in the background and swapped in by draw
+    bool specialized = specializeScene && PixelShaderGenerator::canSpecialize(raytracedScene);
+    shaderCompiler.setGeneratedInclude(SCENE_INCLUDE, specialized ? PixelShaderGenerator::generateScene(raytracedScene) : "");
+}
+
+void PixelRenderer::createScene() {
 
-    //firstScene->addObject(object1);
-    scene1.addObject(square);
+    //the objects load their textures through it, each file once
+    textureCache = PixelTextureCache(&mainDevice);
+
+    //create scene
+    PixelScene scene1 = PixelScene(mainDevice.logicalDevice, mainDevice.physicalDevice);
 
+    //the raytraced image is drawn by the present pass, the scene only holds what is rasterized over it
     //mug.setTexID(1); //TODO:problem there. value not copied
 
     scenes.push_back(scene1);
@@ -1287,7 +2152,6 @@ void PixelRenderer::createScene() {
 
 void PixelRenderer::createDescriptorPool(PixelScene* pixScene) {
 
-    size_t numTextureDescriptorSet = 1;
     size_t numUniformDescriptorSets = swapChainImages.size();
 
     //number of descriptors and not descriptor sets. combined, it makes the pool size
@@ -1296,19 +2160,16 @@ void PixelRenderer::createDescriptorPool(PixelScene* pixScene) {
     vpPoolSize.descriptorCount = static_cast<uint32_t>(numUniformDescriptorSets); //one descriptor per swapchain image
 
     VkDescriptorPoolSize dynamicModelPoolSize{};
-    dynamicModelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    dynamicModelPoolSize.descriptorCount = static_cast<uint32_t>(numUniformDescriptorSets); //one descriptor per swapchain image
+    dynamicModelPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    dynamicModelPoolSize.descriptorCount = static_cast<uint32_t>(numUniformDescriptorSets); //one object buffer per swapchain image
 
-    VkDescriptorPoolSize samplerPoolSize{};
-    samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSize.descriptorCount = static_cast<uint32_t>(MAX_OBJECTS * MAX_TEXTURE_PER_OBJECT); //one descriptor per swapchain image
-
-    std::array<VkDescriptorPoolSize, 3> poolSizes = {vpPoolSize, dynamicModelPoolSize, samplerPoolSize};
+    //the texture set comes from the pool of the texture registry
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {vpPoolSize, dynamicModelPoolSize};
 
     //includes info about the descriptor set that contains the descriptor
     VkDescriptorPoolCreateInfo poolCreateInfo{};
     poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolCreateInfo.maxSets = static_cast<uint32_t>(numUniformDescriptorSets + numTextureDescriptorSet); //maximum number of descriptor sets that can be created from pool
+    poolCreateInfo.maxSets = static_cast<uint32_t>(numUniformDescriptorSets); //maximum number of descriptor sets that can be created from pool
     poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolCreateInfo.pPoolSizes = poolSizes.data();
 
@@ -1321,6 +2182,16 @@ void PixelRenderer::createDescriptorPool(PixelScene* pixScene) {
 }
 
 void PixelRenderer::createDescriptorSets(PixelScene *pixScene)
+{
+    allocateImageDescriptorSets(pixScene);
+
+    //the texture set is allocated by the registry from a pool of its own, the textures get their index in it
+    pixScene->getTextureRegistry()->init(imageSampler, &emptyTexture);
+    pixScene->registerTextures();
+    pixScene->getTextureRegistry()->flush();
+}
+
+void PixelRenderer::allocateImageDescriptorSets(PixelScene *pixScene)
 {
     //we have 1 Descriptor Set and 2 bindings. one binding for the VP matrices. one binding for the dynamic buffer object for M matrix.
     const size_t numImages = swapChainImages.size();
@@ -1345,18 +2216,10 @@ void PixelRenderer::createDescriptorSets(PixelScene *pixScene)
         throw std::runtime_error("failed to allocate descriptor set for ubos");
     }
 
-    //allocate info for texture descriptor set. they are not created but allocated from the pool
-    VkDescriptorSetAllocateInfo textureSetAllocateInfo{};
-    textureSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    textureSetAllocateInfo.descriptorPool = *pixScene->getDescriptorPool();
-    textureSetAllocateInfo.descriptorSetCount = 1;
-    textureSetAllocateInfo.pSetLayouts = pixScene->getDescriptorSetLayout(TEXTURES);  //matches the number of swapchain images but they are all the same.
-    // has to be 1:1 relationship with descriptor sets
-
-    result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &textureSetAllocateInfo, pixScene->getTextureDescriptorSet());
-    if(result != VK_SUCCESS)
+    //the cull sets come from the pool of the cull pipeline, they are written with the object buffers
+    for(size_t i = 0; i < numImages; i++)
     {
-        throw std::runtime_error("failed to allocate descriptor set for textures");
+        *pixScene->getCullDescriptorSetAt(static_cast<int>(i)) = cullPipeline.allocateDescriptorSet();
     }
 
     //all of the descriptor pool and descriptor set created are used to build these following struct
@@ -1378,63 +2241,35 @@ void PixelRenderer::createDescriptorSets(PixelScene *pixScene)
         vpBufferSet.descriptorCount = 1;
         vpBufferSet.pBufferInfo = &descriptorBufferInfo;
 
-        //BINDING 1 of SET 0 --------
-        VkDescriptorBufferInfo descriptorDynamicBufferInfo{};
-        descriptorDynamicBufferInfo.buffer = *pixScene->getDynamicUniformBuffers(i); //buffer to get data from
-        descriptorDynamicBufferInfo.offset = 0;
-        descriptorDynamicBufferInfo.range = pixScene->getMinAlignment(); //what is the size of one chunk of memory
-
-        VkWriteDescriptorSet dynamicBufferSet{};
-        dynamicBufferSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        dynamicBufferSet.dstSet = *pixScene->getUniformDescriptorSetAt(i);
-        dynamicBufferSet.dstBinding = 1; //matches layout(binding = 0)
-        dynamicBufferSet.dstArrayElement = 0; //index in the array we want to update. we don't have an array to update here
-        dynamicBufferSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        dynamicBufferSet.descriptorCount = 1;
-        dynamicBufferSet.pBufferInfo = &descriptorDynamicBufferInfo;
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites = {vpBufferSet, dynamicBufferSet};
-
         //update the descriptor sets with new buffer binding info
-        vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-    }
+        vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &vpBufferSet, 0, nullptr);
 
-    //BINDING 0 of SET 1 --------
-    std::array<VkDescriptorImageInfo, MAX_TEXTURE_PER_OBJECT> textureSamplerDescriptorInfos{};
-    //VkDescriptorImageInfo textureSamplerDescriptorInfo{};
-    for(int i = 0 ; i < textureSamplerDescriptorInfos.size(); i++)
-    {
-        if(i < pixScene->getAllTextures().size())
-        {
-            if(pixScene->getAllTextures()[i].hasBeenInitialized()) //TODO:make sure we go through all the scenes
-            {
-                textureSamplerDescriptorInfos[i].imageView = pixScene->getAllTextures()[i].getImageView(); //image view of the texture
-            }
-            else
-            {
-                textureSamplerDescriptorInfos[i].imageView = emptyTexture.getImageView(); //image view of the texture
-            }
-        }else
-        {
-            textureSamplerDescriptorInfos[i].imageView = emptyTexture.getImageView(); //image view of the texture
-        }
-        textureSamplerDescriptorInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; //what is the image layout when in use
-        textureSamplerDescriptorInfos[i].sampler = imageSampler; //the image sampler
+        updateObjectBufferDescriptor(pixScene, static_cast<uint32_t>(i));
     }
+}
 
-
-    VkWriteDescriptorSet textureSamplerDescriptorSet{};
-    textureSamplerDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    textureSamplerDescriptorSet.dstSet = *pixScene->getTextureDescriptorSet();
-    textureSamplerDescriptorSet.dstBinding = 0; //matches layout(binding = 0)
-    textureSamplerDescriptorSet.dstArrayElement = 0; //index in the array we want to update. we don't have an array to update here
-    textureSamplerDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    textureSamplerDescriptorSet.descriptorCount = static_cast<uint32_t>(textureSamplerDescriptorInfos.size()); //number of textures
-    textureSamplerDescriptorSet.pImageInfo = textureSamplerDescriptorInfos.data();
-
-    //update the descriptor sets with new buffer binding info
-    vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &textureSamplerDescriptorSet, 0, nullptr);
-
+void PixelRenderer::updateObjectBufferDescriptor(PixelScene *pixScene, uint32_t imageIndex)
+{
+    //BINDING 1 of SET 0 --------
+    VkDescriptorBufferInfo objectBufferInfo{};
+    objectBufferInfo.buffer = pixScene->getObjectBuffer(static_cast<int>(imageIndex)); //buffer to get data from
+    objectBufferInfo.offset = 0;
+    objectBufferInfo.range = VK_WHOLE_SIZE; //the shader indexes the whole table
+
+    VkWriteDescriptorSet objectBufferSet{};
+    objectBufferSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    objectBufferSet.dstSet = *pixScene->getUniformDescriptorSetAt(static_cast<int>(imageIndex));
+    objectBufferSet.dstBinding = 1; //matches layout(binding = 1)
+    objectBufferSet.dstArrayElement = 0; //index in the array we want to update. we don't have an array to update here
+    objectBufferSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    objectBufferSet.descriptorCount = 1;
+    objectBufferSet.pBufferInfo = &objectBufferInfo;
+
+    vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &objectBufferSet, 0, nullptr);
+
+    //the cull pass of the same swapchain image reads it and fills the draw lists next to it
+    cullPipeline.writeDescriptorSet(*pixScene->getCullDescriptorSetAt(static_cast<int>(imageIndex)), pixScene->getObjectBuffer(static_cast<int>(imageIndex)),
+                                    pixScene->getDrawBuffer(static_cast<int>(imageIndex)), pixScene->getDrawCountBuffer(static_cast<int>(imageIndex)));
 }
 
 void PixelRenderer::createDepthBuffer() {
@@ -1497,7 +2332,7 @@ void PixelRenderer::copySrcBuffertoDstImage(VkBuffer srcBuffer, VkImage dstImage
     bufferCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     bufferCopy.imageSubresource.layerCount = 1;
     bufferCopy.imageSubresource.baseArrayLayer = 0;
-    bufferCopy.imageSubresource.mipLevel = 0; //TODO:: implement mipmap level for textures
+    bufferCopy.imageSubresource.mipLevel = 0; //the other levels are generated from it
     bufferCopy.imageOffset = {0,0,0}; //start at the origin. no offset
     bufferCopy.imageExtent = {width, height, 1}; //size of the region to copy
 
@@ -1508,6 +2343,45 @@ void PixelRenderer::copySrcBuffertoDstImage(VkBuffer srcBuffer, VkImage dstImage
     submitAndEndSingleUseCommandBuffer(&transferCommandBuffer);
 }
 
+void PixelRenderer::generateMipmaps(PixelImage* pixImage, VkImageLayout finalLayout) {
+
+    VkCommandBuffer commandBuffer = beginSingleUseCommandBuffer();
+
+    //the format decides the path, the image was created with the usage it needs
+    if(pixImage->supportsLinearBlit())
+    {
+        mipmapPipeline.recordBlits(commandBuffer, pixImage, finalLayout);
+    } else
+    {
+        mipmapPipeline.recordDownsamples(commandBuffer, pixImage, finalLayout);
+    }
+
+    submitAndEndSingleUseCommandBuffer(&commandBuffer);
+    mipmapPipeline.releaseLevels();
+}
+
+void PixelRenderer::copySrcBuffertoDstImageLevels(VkBuffer srcBuffer, PixelImage* pixImage) {
+
+    VkCommandBuffer transferCommandBuffer = beginSingleUseCommandBuffer();
+
+    //one region per mip level, packed one after the other in the buffer
+    std::vector<VkBufferImageCopy> bufferCopies(pixImage->getMipLevels());
+    for(uint32_t level = 0; level < pixImage->getMipLevels(); level++)
+    {
+        bufferCopies[level].bufferOffset = pixImage->getLevelOffset(level);
+        bufferCopies[level].bufferRowLength = 0;
+        bufferCopies[level].bufferImageHeight = 0;
+        bufferCopies[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        bufferCopies[level].imageOffset = {0,0,0};
+        bufferCopies[level].imageExtent = {std::max(pixImage->getWidth() >> level, 1u), std::max(pixImage->getHeight() >> level, 1u), 1};
+    }
+
+    vkCmdCopyBufferToImage(transferCommandBuffer, srcBuffer, pixImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+
+    submitAndEndSingleUseCommandBuffer(&transferCommandBuffer);
+}
+
 void PixelRenderer::transitionImageLayout(VkImage imageToTransition, VkImageLayout currentLayout, VkImageLayout newLayout)
 {
 
@@ -1525,8 +2399,8 @@ void PixelRenderer::transitionImageLayout(VkImage imageToTransition, VkImageLayo
     imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     imageMemoryBarrier.subresourceRange.layerCount = 1;
     imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
-    imageMemoryBarrier.subresourceRange.levelCount = 1;
-    imageMemoryBarrier.subresourceRange.baseMipLevel = 0; //TODO:: implement mipmap level for textures
+    imageMemoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS; //the whole mip chain
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
 
     VkPipelineStageFlags srcStage;
     VkPipelineStageFlags dstStage;
@@ -1547,6 +2421,13 @@ void PixelRenderer::transitionImageLayout(VkImage imageToTransition, VkImageLayo
 
         srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }else if(currentLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+    {
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; //the upload has to be done before the compute shader reads the image
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     }else if(currentLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
     {
         imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
@@ -1592,8 +2473,8 @@ void PixelRenderer::transitionImageLayoutUsingCommandBuffer(VkCommandBuffer comm
     imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     imageMemoryBarrier.subresourceRange.layerCount = 1;
     imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
-    imageMemoryBarrier.subresourceRange.levelCount = 1;
-    imageMemoryBarrier.subresourceRange.baseMipLevel = 0; //TODO:: implement mipmap level for textures
+    imageMemoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS; //the whole mip chain
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
 
     VkPipelineStageFlags srcStage;
     VkPipelineStageFlags dstStage;
@@ -1640,12 +2521,18 @@ void PixelRenderer::transitionImageLayoutUsingCommandBuffer(VkCommandBuffer comm
         dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     } else if(currentLayout == VK_IMAGE_LAYOUT_GENERAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
     {
-        imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; //we want the transfer to happen before this stage
-        //transfer write bit are operations like transfering memory from staging buffer to image buffer.
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; //the compute shader has to be done writing before the fragment shader samples the image
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         srcStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
         dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if(currentLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+    {
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT; //the content is kept, the fragment shader of the last frame only has to be done reading it
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     } else if(currentLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
     {
         imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
@@ -1656,35 +2543,31 @@ void PixelRenderer::transitionImageLayoutUsingCommandBuffer(VkCommandBuffer comm
         dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     }else if(currentLayout == VK_IMAGE_LAYOUT_GENERAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
     {
-        imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; //we want the transfer to happen before this stage
-        //transfer write bit are operations like transfering memory from staging buffer to image buffer.
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; //the compute shader has to be done writing before we copy from the image
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        srcStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
     }else if(currentLayout == VK_IMAGE_LAYOUT_GENERAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
     {
-        imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; //we want the transfer to happen before this stage
-        //transfer write bit are operations like transfering memory from staging buffer to image buffer.
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT; //the compute shader has to be done with the image before we copy over it
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        srcStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
     }else if(currentLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_GENERAL)
     {
-        imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; //we want the transfer to happen before this stage
-        //transfer write bit are operations like transfering memory from staging buffer to image buffer.
+        imageMemoryBarrier.srcAccessMask = 0; //the copy only read the image, an execution dependency is enough before writing to it
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     }else if(currentLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_GENERAL)
     {
-        imageMemoryBarrier.srcAccessMask = 0; //from the very start. there is no specified stage.
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; //we want the transfer to happen before this stage
-        //transfer write bit are operations like transfering memory from staging buffer to image buffer.
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; //the copy has to land before a compute shader reads the image
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     } else
     {
@@ -1712,12 +2595,16 @@ void PixelRenderer::createTextureSampler() {
     samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK; //not used because we use repeat
     samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR; //TODO:Implement Mip Map
+    samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR; //trilinear, blends the two closest levels
     samplerCreateInfo.mipLodBias = 0.0f; //adding an offset to the mip map level
-    samplerCreateInfo.minLod = 0.0f; //TODO:Implement Mip Map
-    samplerCreateInfo.maxLod = 0.0f; //TODO:Implement Mip Map
-    samplerCreateInfo.anisotropyEnable = VK_TRUE;
-    samplerCreateInfo.maxAnisotropy = 16; //number of samples taken for the anisotropy filtering
+    samplerCreateInfo.minLod = 0.0f;
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE; //every level of the chain, the view of each texture clamps it to its own
+
+    //only when the feature was enabled, and within what the device allows
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+    samplerCreateInfo.anisotropyEnable = deviceFeatures.samplerAnisotropy;
+    samplerCreateInfo.maxAnisotropy = std::min(16.0f, deviceProperties.limits.maxSamplerAnisotropy); //number of samples taken for the anisotropy filtering
 
     VkResult result = vkCreateSampler(mainDevice.logicalDevice, &samplerCreateInfo, nullptr, &imageSampler);
     if(result != VK_SUCCESS)
@@ -1803,7 +2690,7 @@ void PixelRenderer::init_imgui() {
 void PixelRenderer::imGuiParameters() {
     ImGui::Begin("Simple Render Engine!", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);                          // Create a window called "Hello, world!" and append into it.
 
-    ImGui::SetWindowSize(ImVec2(350.0f,390.0f),0);
+    ImGui::SetWindowSize(ImVec2(350.0f,720.0f),0);
 
     //ImGui::Text("Fog Effect intensity.");               // Display some text (you can use a format strings too)
     //static float test = 0.0f;
@@ -1869,43 +2756,184 @@ void PixelRenderer::imGuiParameters() {
     ImGui::Text("Number of samples");
     ImGui::SliderInt("samples", &MAX_COMPUTE_SAMPLE, 1.0, 256.0f);
 
+    //the button focuses on the last object the cursor was over in the scene, the cursor is on the button by now
     autoFocus = ImGui::Button("Autofocus", {100.0f,25.0f});
-    glm::vec3 lookat = {0.0f,0.0f,-3.0f};
-    PixelComputePipeline::PObj pushObj = *computePipeline.getPushObj();
-    float scale = dofFocus / glm::length(lookat - pushObj.cameraPos);
+    if(autoFocus && scenePick.objectId != 0)
+    {
+        dofFocus = scenePick.depth;
+    }
+    ImGui::SameLine();
+    ImGui::Text("or middle click");
 
-    currentTime = (float)glfwGetTime();
-    double t = currentTime;
+    ColorPicker("test box", &color);
 
-    if(autoFocus && autoFocusFinished)
+    guiItemHovered = ImGui::IsItemHovered();
+
+    ImGui::Text("\nApplication average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+    //utilization is reported separately while the image is still changing and once it has converged
+    ImGui::Checkbox("power saving", &powerSaving);
+    PixelProfiler::Utilization activeUsage = profiler.getUtilization(false);
+    PixelProfiler::Utilization idleUsage = profiler.getUtilization(true);
+    ImGui::Text("active: cpu %.0f%% gpu %.0f%% (%.1f drawn/s)", activeUsage.cpuPercent, activeUsage.gpuPercent, activeUsage.framesDrawnPerSecond);
+    ImGui::Text("idle:   cpu %.0f%% gpu %.0f%% (%.1f drawn/s, %.1f skipped/s)", idleUsage.cpuPercent, idleUsage.gpuPercent, idleUsage.framesDrawnPerSecond, idleUsage.framesSkippedPerSecond);
+    if(profiler.isGpuTimingSupported())
     {
-        autoFocusFinished = false; //autofocus initiated
-        t = currentTime - (float)glfwGetTime();
+        ImGui::Text("gpu compute %.3f ms, outline %.3f ms, graphics %.3f ms", profiler.getGpuTime("compute"), profiler.getGpuTime("outline"), profiler.getGpuTime("graphics"));
     }
 
-    if(!autoFocusFinished)
+    ImGui::Checkbox("denoise", &denoiseEnabled);
+    ImGui::SliderInt("iterations", &denoiseIterations, 1, MAX_DENOISE_ITERATIONS);
+    ImGui::SliderFloat("strength", &denoiseStrength, 0.01f, 2.0f);
+    if(denoiseEnabled && profiler.isGpuTimingSupported())
     {
-        if( scale >= 1.01f)
+        float denoiseTime = 0.0f;
+        for(int i = 0; i < denoiseIterations; i++)
         {
-            deltaFocus = -sqrt(scale - 1);
-        } else if (scale <= 0.99f)
-        {
-            deltaFocus = sqrt(1 - scale);
-        } else
+            float passTime = profiler.getGpuTime("denoise pass " + std::to_string(i));
+            ImGui::Text("  pass %d (step %d): %.3f ms", i, 1 << i, passTime);
+            denoiseTime += passTime;
+        }
+        ImGui::Text("denoise total %.3f ms", denoiseTime);
+    }
+
+    ImGui::Checkbox("temporal reprojection", &temporalReprojection);
+    ImGui::Checkbox("low-discrepancy sampling", &lowDiscrepancySampling);
+    ImGui::SliderFloat("max history", &maxHistoryWeight, 1.0f, 256.0f);
+
+    //the tiles are refined within this much gpu time per frame, the rest is left to the graphics pass
+    ImGui::SliderFloat("compute budget (ms)", tileScheduler.getBudget(), 1.0f, 33.0f);
+    ImGui::Text("tiles: %u this frame, %.3f ms/tile", tileScheduler.getLastBatchSize(), tileScheduler.getTileTimeEstimate());
+    ImGui::Text("samples: %u / %u per pixel", tileScheduler.getMinSampleCount(), getTargetSamples());
+
+    //the pick is read back without waiting, so it trails the cursor by the frames in flight
+    ImGui::Text("pick: object %u, depth %.2f (%llu frames ago)", latestPick.objectId, latestPick.depth,
+                static_cast<unsigned long long>(computeFrameCount - latestPickFrame));
+
+    //the hitch is the wait for the frames in flight plus the recreation of everything that depends on the size
+    if(ImGui::Button("fullscreen (F11)"))
+    {
+        FULLSCREEN_TOGGLE = true;
+    }
+    ImGui::Text("resize %ux%u: %.2f ms (wait %.2f ms), %u so far", lastResize.extent.width, lastResize.extent.height,
+                lastResize.waitMs + lastResize.recreateMs, lastResize.waitMs, lastResize.count);
+
+    //the modes the surface does not support are greyed out
+    if(ImGui::BeginCombo("present mode", presentModeName(presentMode)))
+    {
+        for(VkPresentModeKHR mode : {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR})
         {
-            deltaFocus = 0.0f;
-            autoFocusFinished = true;
+            bool supported = std::find(supportedPresentModes.begin(), supportedPresentModes.end(), mode) != supportedPresentModes.end();
+            if(ImGui::Selectable(presentModeName(mode), mode == presentMode, supported ? 0 : ImGuiSelectableFlags_Disabled))
+            {
+                requestedPresentMode = mode;
+                presentModeChanged = mode != presentMode;
+            }
         }
+        ImGui::EndCombo();
+    }
+    ImGui::SliderFloat("fps limit (0 = off)", framePacer.getTargetFps(), 0.0f, 240.0f, "%.0f");
+    ImGui::Text("frame %.2f ms, woke %.3f ms late (sleep overshoot %.3f ms)", framePacer.getFrameTimeMs(), framePacer.getWakeErrorMs(), framePacer.getSleepOvershootMs());
+    ImGui::Text("refined between frames: %u tiles", lastFrameRefinedTiles);
+    ImGui::Text("input to photon: %.1f ms (estimate)", framePacer.getLatencyMs());
+
+    ImGui::Text("command recording: %.3f ms per frame, %.3f ms for a full re-record (%u so far)",
+                recordTiming.frameMs, recordTiming.staticMs + recordTiming.frameMs, recordTiming.staticCount);
+    ImGui::Text("objects: %d, object buffer capacity %u, %u entries written last frame",
+                scenes[0].getNumObjects(), scenes[0].getObjectCapacity(0), scenes[0].getLastObjectWrites());
+    ImGui::Text("textures: %u of %u bindless slots, %u written last frame", scenes[0].getTextureRegistry()->getCount(),
+                scenes[0].getTextureRegistry()->getCapacity(), scenes[0].getTextureRegistry()->getLastWrites());
+    if(ImGui::Button("benchmark recording"))
+    {
+        benchmarkRecording();
+    }
+    for(const auto& benchmark : recordBenchmarks)
+    {
+        ImGui::Text("%u draws: %.3f ms on 1 thread, %.3f ms on %u (x%.1f)", benchmark.draws, benchmark.singleMs, benchmark.parallelMs,
+                    jobSystem.getWorkerCount(), benchmark.parallelMs > 0.0f ? benchmark.singleMs / benchmark.parallelMs : 0.0f);
     }
 
-    dofFocus += deltaFocus;
+    //what the frame graph derived for the last frame
+    ImGui::Text("frame graph: %u submissions, %u barriers, %u waits", frameGraph.getSubmitCount(), frameGraph.getBarrierCount(), frameGraph.getWaitCount());
+    QueueFamilyIndices queueFamilyIndices = setupQueueFamilies(mainDevice.physicalDevice);
+    bool dedicatedCompute = queueFamilyIndices.computeFamily != queueFamilyIndices.graphicsFamily;
+    ImGui::Text("compute queue family %d (%s), graphics %d", queueFamilyIndices.computeFamily, dedicatedCompute ? "dedicated" : "shared", queueFamilyIndices.graphicsFamily);
 
-    ColorPicker("test box", &color);
+    //traces a full frame every frame, so the compute of a frame has something to overlap the graphics of the one before with
+    ImGui::Checkbox("measure async compute overlap", &measureOverlap);
+    if(measureOverlap && profiler.isGpuTimingSupported())
+    {
+        float computeMs = profiler.getGpuTime("compute");
+        float overlapMs = profiler.getGpuOverlap("compute", "graphics");
+        ImGui::Text("compute overlaps graphics %.3f ms of %.3f ms (%.0f%%)", overlapMs, computeMs, computeMs > 0.0f ? 100.0f * overlapMs / computeMs : 0.0f);
+    }
 
-    guiItemHovered = ImGui::IsItemHovered();
+    //the objects are culled on the gpu and drawn with one indirect draw per pipeline, the static command buffers no longer grow with the scene
+    ImGui::BeginDisabled(!gpuDrivenSupported);
+    ImGui::Checkbox("gpu-driven rendering", &gpuDrivenRendering);
+    ImGui::EndDisabled();
+    if(!gpuDrivenSupported)
+    {
+        ImGui::Text("(needs drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance)");
+    }
+    else if(isGpuDriven() && profiler.isGpuTimingSupported())
+    {
+        ImGui::Text("gpu cull %.3f ms", profiler.getGpuTime("cull"));
+    }
 
-    ImGui::Text("\nApplication average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("mip chains: %u blitted, %u downsampled in compute", mipmapPipeline.getBlittedCount(), mipmapPipeline.getDownsampledCount());
+
+    //the streamed textures keep the levels their objects need on screen within the budget, the least visible ones are evicted first
+    const PixelTextureStreamer::Stats& streamStats = textureStreamer.getStats();
+    const float megabyte = 1024.0f * 1024.0f;
+    ImGui::SliderInt("texture budget (MB)", textureStreamer.getBudgetMB(), 16, 4096);
+    ImGui::Text("textures: %.1f MB resident of %.1f MB, %.1f MB retiring", streamStats.residentBytes / megabyte, streamStats.budgetBytes / megabyte,
+                streamStats.retiredBytes / megabyte);
+    if(textureStreamer.isMemoryBudgetSupported())
+    {
+        ImGui::Text("device local: %.1f MB used of a %.1f MB budget", streamStats.driverUsageBytes / megabyte, streamStats.driverBudgetBytes / megabyte);
+    } else
+    {
+        ImGui::Text("(no VK_EXT_memory_budget, only the slider limits the textures)");
+    }
+    ImGui::Text("%u of %u textures streamed, %u missing levels, %u uploads pending", streamStats.streamedCount, streamStats.textureCount,
+                streamStats.partialCount, streamStats.pendingUploads);
+    ImGui::Text("streamed in %u, out %u", streamStats.streamedIn, streamStats.streamedOut);
+    ImGui::Text("texture cache: %u loaded, %u reused, %u handles", textureCache.getTextureCount(), textureCache.getHitCount(), textureCache.getReferenceCount());
+
+    //applied by the present pass, the accumulation is not restarted
+    const char* tonemapNames[PixelPresentPipeline::TONEMAP_COUNT] = {"clamp", "reinhard", "aces"};
+    const char* viewNames[] = {"color", "outline mask"};
+    ImGui::SliderFloat("exposure", presentPipeline.getExposure(), 0.1f, 8.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    ImGui::Combo("tonemap", presentPipeline.getTonemap(), tonemapNames, PixelPresentPipeline::TONEMAP_COUNT);
+    ImGui::Combo("view", presentPipeline.getView(), viewNames, IM_ARRAYSIZE(viewNames));
+
+    //the kernels are rebuilt when their sources are saved, a shader that does not compile keeps its pipeline and shows its errors here
+    bool hotReload = shaderCompiler.isHotReloading();
+    if(ImGui::Checkbox("hot reload shaders", &hotReload))
+    {
+        shaderCompiler.setHotReload(hotReload);
+    }
+    PixelShaderCompiler::Stats shaderStats = shaderCompiler.getStats();
+    ImGui::Text("shaders: %u compiled (last %.1f ms), %u from the cache, %u reloaded, %u failed", shaderStats.compiled, shaderStats.lastCompileMs,
+                shaderStats.cacheHits, shaderStats.reloads, shaderStats.failures);
+    if(!shaderStats.lastError.empty())
+    {
+        ImGui::TextWrapped("%s", shaderStats.lastError.c_str());
+    }
 
+    //the generated kernel has the primitives as constants. the times are the last full frame traced with each, the speedup of this scene size
+    size_t primitiveCount = raytracedScene.spheres.size() + raytracedScene.planes.size();
+    if(ImGui::Checkbox("specialize the scene kernel", &specializeScene))
+    {
+        updateSceneKernel();
+    }
+    ImGui::Text("%zu primitives (up to %u specialized), %s kernel", primitiveCount, SCENE_SPECIALIZE_MAX_PRIMITIVES,
+                sceneKernelSpecialized ? "generated" : "data driven");
+    if(profiler.isGpuTimingSupported() && sceneKernelMs[0] > 0.0f && sceneKernelMs[1] > 0.0f)
+    {
+        ImGui::Text("full frame: data driven %.3f ms, generated %.3f ms (%.2fx)", sceneKernelMs[0], sceneKernelMs[1], sceneKernelMs[0] / sceneKernelMs[1]);
+    }
 
     ImGui::End();
 }
@@ -1917,9 +2945,45 @@ void PixelRenderer::addScene(PixelScene *pixScene) {
 
 void PixelRenderer::init_compute() {
 
-    computePipeline = PixelComputePipeline(&mainDevice, {});
-    computePipeline.init();
-    //transitionImageLayout(computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    shaderCompiler.init(&mainDevice);
+
+    //the kernels that include scene.glsl are compiled with the one generated for the scene from the start
+    createRaytracedScene();
+    updateSceneKernel();
+    sceneKernelSpecialized = specializeScene && PixelShaderGenerator::canSpecialize(raytracedScene);
+
+    computePipeline = PixelComputePipeline(&mainDevice, swapChainExtent);
+    computePipeline.init(&shaderCompiler);
+    computePipeline.setScene(raytracedScene);
+
+    //the denoiser reads the accumulated color that is copied to the input texture. outline.comp copies its result to the displayed output texture
+    denoisePipeline = PixelDenoisePipeline(&mainDevice, {computePipeline.getOutputTexture()->getWidth(), computePipeline.getOutputTexture()->getHeight()});
+    denoisePipeline.init(&shaderCompiler, computePipeline.getInputTexture(), computePipeline.getDenoisedTexture(),
+                         computePipeline.getNormalDepthTexture(), computePipeline.getAlbedoTexture());
+
+    //saving one of the kernels, or a file it includes, rebuilds its pipeline in the background. the layouts do not change
+    const std::array<std::pair<const char*, PixelComputePipeline::Kernel>, PixelComputePipeline::KERNEL_COUNT> kernels = {{
+            {"shader.comp", PixelComputePipeline::KERNEL_TRACE},
+            {"pick.comp", PixelComputePipeline::KERNEL_PICK},
+            {"outline.comp", PixelComputePipeline::KERNEL_OUTLINE}
+    }};
+    for(const auto& kernel : kernels)
+    {
+        PixelComputePipeline::Kernel kernelIndex = kernel.second;
+        shaderCompiler.watch({kernel.first,
+                              [this](const std::vector<uint32_t>& spirv){return shaderCompiler.createComputePipeline(computePipeline.getPipelineLayout(), spirv);},
+                              [this, kernelIndex](VkPipeline pipeline){hasRendered = false; return computePipeline.swapPipeline(kernelIndex, pipeline);}});
+    }
+    shaderCompiler.watch({"denoise.comp",
+                          [this](const std::vector<uint32_t>& spirv){return shaderCompiler.createComputePipeline(denoisePipeline.getPipelineLayout(), spirv);},
+                          [this](VkPipeline pipeline){hasRendered = false; return denoisePipeline.swapPipeline(pipeline);}});
+
+    initComputeImageLayouts();
+
+    tileScheduler.init(computePipeline.getOutputTexture()->getWidth(), computePipeline.getOutputTexture()->getHeight());
+
+    //the blue-noise texture is uploaded once and read as a storage image
+    createTextureBuffer(computePipeline.getBlueNoiseTexture(), VK_IMAGE_LAYOUT_GENERAL);
     //transitionImageLayout(computePipeline.getOutputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
 
     for(int i = 0; i < 512; i++)
@@ -1931,46 +2995,331 @@ void PixelRenderer::init_compute() {
     }
 }
 
-void PixelRenderer::recordComputeCommands(uint32_t currentImageIndex) {
+void PixelRenderer::initComputeImageLayouts() {
+
+    //the history textures keep their content from one frame to the next, they are moved to the general layout once and stay there
+    transitionImageLayout(computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(computePipeline.getAccumulationTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(computePipeline.getHistoryNormalDepthTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    //the G-buffer is only rewritten tile by tile, so it stays in the general layout as well
+    transitionImageLayout(computePipeline.getNormalDepthTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(computePipeline.getAlbedoTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(computePipeline.getObjectIdTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(computePipeline.getDenoisedTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+void PixelRenderer::recordTraceCommands(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj pushObj, const PixelComputePipeline::CameraUniforms& camera,
+                                        bool restart, bool denoise, const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds, uint32_t pickSlot) {
+
+    //the tiles only rewrite part of the images, so every image keeps its content from one frame to the next.
+    //none of the images written here are sampled by the fragment shader, they stay in the general layout
+    computeProfilerScope = profiler.beginGpuScope(commandBuffer, "compute");
+
+    //the view only changes with a restart. the tiles of the frames in between, and the ones of the refinement thread, keep the camera it wrote
+    if(restart)
+    {
+        recordCameraUpdate(commandBuffer, camera);
+    }
+
+    std::array<VkDescriptorSet, 2> descriptorSets = {
+            computePipeline.getDescriptorSet(), *computePipeline.getTextureRegistry()->getDescriptorSet()};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, 0);
+
+    pushObj.tileOffset = {0,0};
+    computePipeline.setPushObj(pushObj);
+    recordPickCommands(commandBuffer, pickSlot);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipeline());
+
+    if(restart)
+    {
+        //first sample of the new view, reprojected from the last one if possible
+        uint32_t scope = profiler.beginGpuScope(commandBuffer, "compute restart");
+
+        pushObj.currentSample = 0;
+        pushObj.sampleIndex = tileScheduler.getSequenceOffset();
+        pushObj.tileOffset = {0,0};
+        pushComputeSample(commandBuffer, pushObj);
+
+        VkExtent2D extent = {computePipeline.getOutputTexture()->getWidth(), computePipeline.getOutputTexture()->getHeight()};
+        vkCmdDispatch(commandBuffer, (extent.width + COMPUTE_LOCAL_SIZE_X - 1) / COMPUTE_LOCAL_SIZE_X, (extent.height + COMPUTE_LOCAL_SIZE_Y - 1) / COMPUTE_LOCAL_SIZE_Y, 1);
+
+        profiler.endGpuScope(commandBuffer, scope);
+
+        //the accumulation becomes the history of the next sample, and the G-buffer the one the next view is reprojected against
+        copySrcImagetoDstImage(commandBuffer, computePipeline.getAccumulationTexture(), computePipeline.getInputTexture());
+        copySrcImagetoDstImage(commandBuffer, computePipeline.getNormalDepthTexture(), computePipeline.getHistoryNormalDepthTexture());
+    }
+
+    recordTileRounds(commandBuffer, pushObj, rounds, true);
+
+    profiler.endGpuScope(commandBuffer, computeProfilerScope);
+
+    //the input texture now holds the accumulated color. the denoiser filters all of it into the denoised texture, refined tiles or not.
+    if(denoise)
+    {
+        recordDenoiseCommands(commandBuffer);
+    }
+}
+
+void PixelRenderer::recordCameraUpdate(VkCommandBuffer commandBuffer, const PixelComputePipeline::CameraUniforms& camera) {
+
+    //the dispatches already submitted read the old camera, the ones after the update the new one
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = 0; //only reads before, an execution dependency is enough
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = computePipeline.getCameraBuffer();
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, nullptr,
+                         1, &bufferBarrier,
+                         0, nullptr);
+
+    vkCmdUpdateBuffer(commandBuffer, computePipeline.getCameraBuffer(), 0, sizeof(camera), &camera);
+
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         1, &bufferBarrier,
+                         0, nullptr);
+}
+
+void PixelRenderer::recordTileRounds(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj,
+                                     const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds, bool profiled) {
+
+    for(const auto& round : rounds)
+    {
+        //the dispatches of a round cover different tiles, they only have to wait for the previous round
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1, &memoryBarrier,
+                             0, nullptr,
+                             0, nullptr);
+
+        uint32_t scope = profiled ? profiler.beginGpuScope(commandBuffer, "compute tiles", static_cast<uint32_t>(round.size())) : 0;
+
+        std::vector<VkRect2D> tileRegions;
+        for(const auto& dispatch : round)
+        {
+            const PixelTileScheduler::Tile& tile = tileScheduler.getTile(dispatch.tileIndex);
+
+            pushObj.currentSample = dispatch.sampleCount;
+            pushObj.sampleIndex = tileScheduler.getSequenceOffset() + dispatch.sampleCount;
+            pushObj.tileOffset = tile.offset;
+            pushComputeSample(commandBuffer, pushObj);
+
+            vkCmdDispatch(commandBuffer, TILE_WIDTH / COMPUTE_LOCAL_SIZE_X, TILE_HEIGHT / COMPUTE_LOCAL_SIZE_Y, 1);
+
+            //the last row and column of tiles can stick out of the image when its size is not a multiple of the tile size
+            VkExtent2D tileExtent = {std::min(TILE_WIDTH, computePipeline.getOutputTexture()->getWidth() - tile.offset.x),
+                                     std::min(TILE_HEIGHT, computePipeline.getOutputTexture()->getHeight() - tile.offset.y)};
+            tileRegions.push_back({{static_cast<int32_t>(tile.offset.x), static_cast<int32_t>(tile.offset.y)}, tileExtent});
+        }
+
+        if(profiled)
+        {
+            profiler.endGpuScope(commandBuffer, scope);
+        }
+
+        copySrcImagetoDstImage(commandBuffer, computePipeline.getAccumulationTexture(), computePipeline.getInputTexture(), tileRegions);
+    }
+}
+
+void PixelRenderer::recordRefinementCommands(PixelComputePipeline::PObj pushObj, const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds) {
+    VkCommandBuffer commandBuffer = refinementCommandBuffer;
+
     VkCommandBufferBeginInfo bufferBeginInfo{};
     bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    VkResult result = vkBeginCommandBuffer(computeCommandBuffers[currentImageIndex], &bufferBeginInfo);
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
     if(result != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to being recording compute command");
+        throw std::runtime_error("failed to being recording refinement command");
+    }
+
+    //only the accumulation, the G-buffer and the input texture are written. the textures the fragment shader samples are
+    //left alone, so this never has to wait for the graphics queue. the profiler only times the frames
+    std::array<VkDescriptorSet, 2> descriptorSets = {
+            computePipeline.getDescriptorSet(), *computePipeline.getTextureRegistry()->getDescriptorSet()};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, 0);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipeline());
+
+    recordTileRounds(commandBuffer, pushObj, rounds, false);
+
+    //the next frame is submitted to the same queue after this, it composites the refined input texture
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         1, &memoryBarrier,
+                         0, nullptr,
+                         0, nullptr);
+
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to record refinement command buffer!");
+    }
+}
+
+void PixelRenderer::recordPickCommands(VkCommandBuffer commandBuffer, uint32_t slot) {
+
+    //the outline pass of the last frame may still be reading the pick buffer
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = 0; //only reads before, an execution dependency is enough
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = computePipeline.getPickBuffer();
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         1, &bufferBarrier,
+                         0, nullptr);
+
+    //a single invocation traces the ray under the cursor
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPickPipeline());
+    vkCmdPushConstants(commandBuffer,
+                       computePipeline.getPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       0,
+                       PixelComputePipeline::pushComputeConstantRange.size,
+                       computePipeline.getPushObj());
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    //outline.comp reads the picked object at the end of the frame, and the result is copied out for the cpu
+    bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, nullptr,
+                         1, &bufferBarrier,
+                         0, nullptr);
+
+    VkBufferCopy bufferCopy{};
+    bufferCopy.srcOffset = 0;
+    bufferCopy.dstOffset = slot * sizeof(PixelComputePipeline::PickResult);
+    bufferCopy.size = sizeof(PixelComputePipeline::PickResult);
+    vkCmdCopyBuffer(commandBuffer, computePipeline.getPickBuffer(), computePipeline.getPickReadbackBuffer(), 1, &bufferCopy);
+
+    //the copy has to be visible to the host once the compute timeline reaches the value of this frame
+    VkBufferMemoryBarrier readbackBarrier{};
+    readbackBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.buffer = computePipeline.getPickReadbackBuffer();
+    readbackBarrier.offset = bufferCopy.dstOffset;
+    readbackBarrier.size = bufferCopy.size;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         0, nullptr,
+                         1, &readbackBarrier,
+                         0, nullptr);
+}
+
+void PixelRenderer::readBackPicks() {
+
+    //oldest frame first, so the latest result is the one that stays
+    std::array<uint32_t, MAX_FRAME_DRAWS> slots{};
+    for(uint32_t i = 0; i < MAX_FRAME_DRAWS; i++)
+    {
+        slots[i] = i;
     }
+    std::sort(slots.begin(), slots.end(), [this](uint32_t a, uint32_t b){return pickFrame[a] < pickFrame[b];});
 
+    for(uint32_t slot : slots)
+    {
+        //never waits: a slot is only read once the compute timeline has reached the frame that wrote it
+        if(!pickPending[slot] || !frameGraph.isComplete(FRAME_GRAPH_COMPUTE, pickValue[slot]))
+        {
+            continue;
+        }
+        pickPending[slot] = false;
 
+        latestPick = computePipeline.readPickResult(slot);
+        latestPickFrame = pickFrame[slot];
+        if(!pickOverGui[slot])
+        {
+            scenePick = latestPick;
+        }
 
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getOutputTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getCustomTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        //the autofocus snaps to the first pick made after it was requested
+        if(!autoFocusFinished && pickFrame[slot] > focusRequestFrame)
+        {
+            if(latestPick.objectId != 0)
+            {
+                dofFocus = latestPick.depth;
+            }
+            autoFocusFinished = true;
+        }
+    }
+}
 
-    vkCmdBindPipeline(computeCommandBuffers[currentImageIndex], VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipeline());
+void PixelRenderer::pushComputeSample(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj) {
 
-    std::array<VkDescriptorSet, 1> descriptorSets = {
-            computePipeline.getDescriptorSet()};
-    vkCmdBindDescriptorSets(computeCommandBuffers[currentImageIndex], VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, 0);
+    //the legacy sampler takes the next gaussian lens offset for every sample, so the history never sees the same one twice in a row
+    if(pushObj.samplerMode == SAMPLER_RANDOM)
+    {
+        glm::vec3 offset = randomArray[accumulatedSampleIndex];
+        pushObj.randomOffsets = {offset.x,offset.y,0.0f};
+        accumulatedSampleIndex = (accumulatedSampleIndex + 1) % randomArray.size();
+    }
 
-    vkCmdPushConstants(computeCommandBuffers[currentImageIndex],
+    computePipeline.setPushObj(pushObj);
+    vkCmdPushConstants(commandBuffer,
                        computePipeline.getPipelineLayout(),
                        VK_SHADER_STAGE_COMPUTE_BIT,
                        0,
                        PixelComputePipeline::pushComputeConstantRange.size,
                        computePipeline.getPushObj());
+}
 
-    vkCmdDispatch(computeCommandBuffers[currentImageIndex], 32, 32, 1);
+void PixelRenderer::copySrcImagetoDstImage(VkCommandBuffer commandBuffer, PixelImage* srcImage, PixelImage* dstImage) {
+    copySrcImagetoDstImage(commandBuffer, srcImage, dstImage, {{{0,0}, {dstImage->getWidth(), dstImage->getHeight()}}});
+}
 
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getOutputTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+void PixelRenderer::copySrcImagetoDstImage(VkCommandBuffer commandBuffer, PixelImage* srcImage, PixelImage* dstImage, const std::vector<VkRect2D>& regions) {
 
+    //both images are used by the compute shaders in the general layout, and go back to it after the copy
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, srcImage->getImage(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, dstImage->getImage(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
+    std::vector<VkImageCopy> imageCopies;
+    for(const auto& region : regions)
+    {
+        //the tiles on the right and bottom edges can go past the image
+        uint32_t width = std::min(region.extent.width, dstImage->getWidth() - static_cast<uint32_t>(region.offset.x));
+        uint32_t height = std::min(region.extent.height, dstImage->getHeight() - static_cast<uint32_t>(region.offset.y));
 
         VkImageCopy imageCopy{};
-        imageCopy.srcOffset = {0,0,0};
-        imageCopy.dstOffset = {0,0,0}; //for data spacing
-        imageCopy.extent = {computePipeline.getInputTexture()->getWidth(), computePipeline.getInputTexture()->getHeight(), 1};
+        imageCopy.srcOffset = {region.offset.x, region.offset.y, 0};
+        imageCopy.dstOffset = {region.offset.x, region.offset.y, 0}; //for data spacing
+        imageCopy.extent = {width, height, 1};
         imageCopy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         imageCopy.srcSubresource.layerCount = 1;
         imageCopy.srcSubresource.baseArrayLayer = 0;
@@ -1979,23 +3328,96 @@ void PixelRenderer::recordComputeCommands(uint32_t currentImageIndex) {
         imageCopy.dstSubresource.layerCount = 1;
         imageCopy.dstSubresource.baseArrayLayer = 0;
         imageCopy.dstSubresource.mipLevel = 0; //TODO:: implement mipmap level for textures
+        imageCopies.push_back(imageCopy);
+    }
+
+    vkCmdCopyImage(commandBuffer,
+                   srcImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   dstImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
 
-        vkCmdCopyImage(computeCommandBuffers[currentImageIndex],
-                       computePipeline.getOutputTexture()->getImage(),VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                       computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                       1, &imageCopy);
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, srcImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, dstImage->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+}
 
+void PixelRenderer::recordDenoiseCommands(VkCommandBuffer commandBuffer) {
 
+    //the ping-pong images do not carry anything over from the last frame
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, denoisePipeline.getPingTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayoutUsingCommandBuffer(commandBuffer, denoisePipeline.getPongTexture()->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
 
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getCustomTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    transitionImageLayoutUsingCommandBuffer(computeCommandBuffers[currentImageIndex], computePipeline.getOutputTexture()->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, denoisePipeline.getPipeline());
 
-    result = vkEndCommandBuffer(computeCommandBuffers[currentImageIndex]);
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("failed to record compute command buffer!");
+    uint32_t iterationCount = static_cast<uint32_t>(glm::clamp(denoiseIterations, 1, MAX_DENOISE_ITERATIONS));
+    VkExtent2D extent = denoisePipeline.getExtent();
+
+    for(uint32_t i = 0; i < iterationCount; i++)
+    {
+        //every iteration reads what the previous one (or the raytracer for the G-buffer) wrote
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1, &memoryBarrier,
+                             0, nullptr,
+                             0, nullptr);
+
+        uint32_t scope = profiler.beginGpuScope(commandBuffer, "denoise pass " + std::to_string(i));
+
+        VkDescriptorSet descriptorSet = denoisePipeline.getDescriptorSet(i, iterationCount);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, denoisePipeline.getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+
+        PixelDenoisePipeline::PObj pushObj = denoisePipeline.getPushObj(i, denoiseStrength);
+        vkCmdPushConstants(commandBuffer,
+                           denoisePipeline.getPipelineLayout(),
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           0,
+                           PixelDenoisePipeline::pushDenoiseConstantRange.size,
+                           &pushObj);
+
+        vkCmdDispatch(commandBuffer, (extent.width + 15) / 16, (extent.height + 15) / 16, 1);
+
+        profiler.endGpuScope(commandBuffer, scope);
     }
+}
+
+void PixelRenderer::recordOutlineCommands(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj, uint32_t targetBuffer) {
+
+    //reads the accumulated or denoised color, the object ids and the pick written earlier in the command buffer
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1, &memoryBarrier,
+                         0, nullptr,
+                         0, nullptr);
+
+    uint32_t scope = profiler.beginGpuScope(commandBuffer, "outline");
+
+    //the denoiser bound its own set, the outline pass uses the one of the raytracer that writes to the target display buffer
+    VkDescriptorSet descriptorSet = computePipeline.getDescriptorSet(targetBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.getOutlinePipeline());
+
+    pushObj.tileOffset = {0,0};
+    computePipeline.setPushObj(pushObj);
+    vkCmdPushConstants(commandBuffer,
+                       computePipeline.getPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       0,
+                       PixelComputePipeline::pushComputeConstantRange.size,
+                       computePipeline.getPushObj());
+
+    VkExtent2D extent = {computePipeline.getOutputTexture()->getWidth(), computePipeline.getOutputTexture()->getHeight()};
+    vkCmdDispatch(commandBuffer, (extent.width + 15) / 16, (extent.height + 15) / 16, 1);
 
+    profiler.endGpuScope(commandBuffer, scope);
 }
 
 void PixelRenderer::updateComputeTextureDescriptor() {
@@ -2022,18 +3444,177 @@ void PixelRenderer::init_io() {
     glfwSetKeyCallback(pixWindow.getWindow(),key_callback);
     glfwSetMouseButtonCallback(pixWindow.getWindow(), mouse_callback);
     glfwSetScrollCallback(pixWindow.getWindow(), scroll_callback);
+    glfwSetCursorPosCallback(pixWindow.getWindow(), cursor_callback);
+    glfwSetWindowRefreshCallback(pixWindow.getWindow(), window_refresh_callback);
+    glfwSetFramebufferSizeCallback(pixWindow.getWindow(), framebuffer_size_callback);
+}
+
+void PixelRenderer::init_profiler() {
+    profiler = PixelProfiler(&mainDevice);
+    profiler.init(vulkan12Features.hostQueryReset == VK_TRUE);
+}
+
+void PixelRenderer::init_frameGraph() {
+
+    QueueFamilyIndices queueFamilyIndices = setupQueueFamilies(mainDevice.physicalDevice);
+
+    frameGraph = PixelFrameGraph(&mainDevice);
+    frameGraph.init({computeQueue, graphicsQueue}, {static_cast<uint32_t>(queueFamilyIndices.computeFamily), static_cast<uint32_t>(queueFamilyIndices.graphicsFamily)});
+
+    //the images were created and transitioned with single use command buffers of the graphics queue.
+    //the other compute images are never read before the trace rewrites them, so they move to the compute family without a transfer
+    accumulatorResource = frameGraph.addImage("accumulator", computePipeline.getInputTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, FRAME_GRAPH_GRAPHICS);
+    blueNoiseResource = frameGraph.addImage("blue noise", computePipeline.getBlueNoiseTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL, FRAME_GRAPH_GRAPHICS);
+    for(uint32_t i = 0; i < DISPLAY_BUFFER_COUNT; i++)
+    {
+        displayResources[i] = frameGraph.addImage("display " + std::to_string(i), computePipeline.getOutputTexture(i)->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, FRAME_GRAPH_GRAPHICS);
+        outlineMaskResources[i] = frameGraph.addImage("outline mask " + std::to_string(i), computePipeline.getCustomTexture(i)->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, FRAME_GRAPH_GRAPHICS);
+    }
+    swapchainResource = frameGraph.addImage("swapchain", VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, FRAME_GRAPH_GRAPHICS, true);
+}
+
+void PixelRenderer::init_refinement() {
+
+    QueueFamilyIndices queueFamilyIndices = setupQueueFamilies(mainDevice.physicalDevice);
+
+    VkCommandPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCreateInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
+
+    VkResult result = vkCreateCommandPool(mainDevice.logicalDevice, &poolCreateInfo, nullptr, &refinementCommandPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Refinement Command Pool");
+    }
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = refinementCommandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+
+    result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &commandBufferAllocateInfo, &refinementCommandBuffer);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate the refinement command buffer");
+    }
+
+    refinementThread = std::thread(&PixelRenderer::runRefinementThread, this);
+}
+
+void PixelRenderer::runRefinementThread() {
+
+    std::unique_lock<std::mutex> lock(renderMutex);
+    while(true)
+    {
+        //woken by the render thread when it starts waiting for the next frame, the mutex is free until that frame starts
+        refinementWake.wait(lock, [this]{return refinementThreadStop || refinementRequested;});
+        if(refinementThreadStop)
+        {
+            break;
+        }
+
+        //the batch has to be done before the next frame needs the queue, a little is left for the submission itself
+        float budgetMs = std::min(*tileScheduler.getBudget(), static_cast<float>((refinementDeadline - glfwGetTime()) * 1000.0) - 1.0f);
+        uint32_t targetSamples = getTargetSamples();
+        if(!hasRendered || tileScheduler.isConverged(targetSamples) || budgetMs < tileScheduler.getTileTimeEstimate())
+        {
+            refinementRequested = false;
+            continue;
+        }
+
+        std::vector<std::vector<PixelTileScheduler::TileDispatch>> rounds = tileScheduler.scheduleRefinement(glm::vec2(mouseCoord), targetSamples, budgetMs);
+        if(rounds.empty())
+        {
+            refinementRequested = false;
+            continue;
+        }
+
+        recordRefinementCommands(lastRenderedPushObj, rounds);
+        uint64_t refinementValue = frameGraph.submit(FRAME_GRAPH_COMPUTE, refinementCommandBuffer);
+
+        for(const auto& round : rounds)
+        {
+            refinedTilesSinceFrame += static_cast<uint32_t>(round.size());
+        }
+
+        //the command buffer is reused by the next batch. the render thread can start its frame meanwhile
+        lock.unlock();
+        frameGraph.wait(FRAME_GRAPH_COMPUTE, refinementValue);
+        lock.lock();
+    }
+}
+
+void PixelRenderer::stopRefinementThread() {
+
+    if(!refinementThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        refinementThreadStop = true;
+    }
+    refinementWake.notify_one();
+    refinementThread.join();
+}
+
+float PixelRenderer::getDisplayLatencyMs() {
+
+    //from the end of the gpu work to the photons: the wait for the vertical blank when the mode has one,
+    //then half a refresh until the scanout reaches the middle of the screen
+    float refreshMs = 1000.0f / static_cast<float>(std::max(pixWindow.getRefreshRate(), 1));
+    if(presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+    {
+        return 0.5f * refreshMs;
+    }
+
+    float latencyMs = refreshMs;
+
+    //fifo queues the frames in flight when they come faster than the display takes them
+    bool fifo = presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    if(fifo && (!framePacer.isLimiting() || *framePacer.getTargetFps() >= static_cast<float>(pixWindow.getRefreshRate())))
+    {
+        latencyMs += static_cast<float>(MAX_FRAME_DRAWS - 1) * refreshMs;
+    }
+
+    return latencyMs;
 }
 
 void PixelRenderer::preDraw() {
+    readBackPicks();
     imGuiParameters();
     double posX, posY;
     glfwGetCursorPos(pixWindow.getWindow(), &posX, &posY);
-    mouseCoord.x = (int)glm::clamp(posX, 0.0, 1024.0);
-    mouseCoord.y = (int)glm::clamp(posY, 0.0, 768.0);
     if(MPRESS_L || *ImGui::GetIO().MouseDown && guiItemHovered)
     {
-        lastClicked.x = mouseCoord.x;
-        lastClicked.y = mouseCoord.y;
+        lastClicked.x = (int)glm::max(posX, 0.0);
+        lastClicked.y = (int)glm::max(posY, 0.0);
+    }
+
+    //the cursor is in screen coordinates, the raytraced image has the size of the framebuffer (larger on high dpi displays)
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(pixWindow.getWindow(), &windowWidth, &windowHeight);
+    double scaleX = windowWidth > 0 ? (double)swapChainExtent.width / windowWidth : 1.0;
+    double scaleY = windowHeight > 0 ? (double)swapChainExtent.height / windowHeight : 1.0;
+    mouseCoord.x = (int)glm::clamp(posX * scaleX, 0.0, swapChainExtent.width - 1.0);
+    mouseCoord.y = (int)glm::clamp(posY * scaleY, 0.0, swapChainExtent.height - 1.0);
+
+    if(FULLSCREEN_TOGGLE)
+    {
+        //glfw reports the new framebuffer size through the callback, the swapchain is recreated after the next present
+        FULLSCREEN_TOGGLE = false;
+        pixWindow.toggleFullscreen();
+    }
+
+    //a middle click on the scene focuses on what is under the cursor, once its pick comes back
+    if(MPRESS_M)
+    {
+        MPRESS_M = false;
+        autoFocusFinished = false;
+        focusRequestFrame = computeFrameCount;
     }
 
 }
@@ -9,6 +9,19 @@ const bool enableValidationLayers = true;
 #include "PixelWindow.h"
 #include "PixelGraphicsPipeline.h"
 #include "PixelComputePipeline.h"
+#include "PixelDenoisePipeline.h"
+#include "PixelCullPipeline.h"
+#include "PixelMipmapPipeline.h"
+#include "PixelPresentPipeline.h"
+#include "PixelShaderCompiler.h"
+#include "PixelShaderGenerator.h"
+#include "PixelTextureStreamer.h"
+#include "PixelProfiler.h"
+#include "PixelShaderCompiler.h"
+#include "PixelTileScheduler.h"
+#include "PixelFramePacer.h"
+#include "PixelFrameGraph.h"
+#include "PixelJobSystem.h"
 #include "Utility.h"
 
 #include <imgui.h>
@@ -17,21 +30,40 @@ const bool enableValidationLayers = true;
 
 #include <vector>
 #include <set>
+#include <unordered_set>
 #include <algorithm>
 #include <iostream>
 #include <memory>
 #include <cstring>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 const int MAX_FRAME_DRAWS = 2; //we always have "MAX_FRAME_DRAWS" being drawing at once.
+static_assert(MAX_FRAME_DRAWS <= PICK_READBACK_SLOTS, "every frame in flight needs its own pick readback slot");
+static_assert(MAX_FRAME_DRAWS <= FRAME_GRAPH_FRAME_SLOTS, "every frame in flight needs its own frame graph command buffers");
+const uint32_t RECORD_DRAWS_PER_JOB = 256; //objects one secondary command buffer records
+const uint32_t RECORD_BENCHMARK_MAX_DRAWS = 100000;
 static float dofFocus = 13.152946438f;
 static bool autoFocus = false;
 static bool autoFocusFinished = true;
-static float deltaFocus = 0.0f;
 static glm::uvec2 mouseCoord = {0,0};
 static glm::uvec2 lastClicked = {28,156};
 static ImColor color = ImColor(0.0,0.0f,0.0f,1.0f);
-static int MAX_COMPUTE_SAMPLE = 1;
+static int MAX_COMPUTE_SAMPLE = 1; //samples per pixel the tiles refine the image to
 static bool guiItemHovered = false;
+static bool powerSaving = true;
+static bool denoiseEnabled = true;
+static int denoiseIterations = 4;
+static float denoiseStrength = DENOISE_COLOR_PHI;
+static bool temporalReprojection = true;
+static bool lowDiscrepancySampling = true;
+static float maxHistoryWeight = 32.0f; //the history behaves as an exponential moving average once this many samples are in
+static bool measureOverlap = false; //traces a full frame every frame so the overlap of the two queues shows in the profiler
+static bool gpuDrivenRendering = true; //only used when the device supports it
+
+const double IDLE_WAIT_TIMEOUT = 0.5; //seconds we block for events once the image has converged
+const int IDLE_GRACE_FRAMES = 3; //frames still drawn after an event so imgui can settle (hover, release...)
 
 class PixelRenderer
 {
@@ -76,6 +108,7 @@ private:
 
     //physical device features the logical device will be using
     VkPhysicalDeviceFeatures deviceFeatures = {};
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
 
 	VkInstance instance{};
 	VkQueue graphicsQueue{};
@@ -84,10 +117,22 @@ private:
 	VkSurfaceKHR surface{};
 	VkSwapchainKHR swapChain{};
     std::vector<VkFramebuffer> swapchainFramebuffers;
-    std::vector<VkCommandBuffer> commandBuffers;
-    std::vector<VkCommandBuffer> computeCommandBuffers;
     std::vector<std::unique_ptr<PixelGraphicsPipeline>> graphicsPipelines;
+    PixelShaderCompiler shaderCompiler; //every shader is compiled from its source and its pipeline rebuilt when it is saved
     PixelComputePipeline computePipeline;
+    PixelComputePipeline::RaytracedScene raytracedScene;
+    bool specializeScene = true; //trace the scene with a kernel generated for it, while it is small enough
+    bool sceneKernelSpecialized = false; //the kernel in use, it changes once the rebuilt one is swapped in
+    std::array<float, 2> sceneKernelMs{}; //full frame trace time of the last restart with the data driven and the generated kernel
+    PixelDenoisePipeline denoisePipeline;
+    PixelCullPipeline cullPipeline;
+    PixelMipmapPipeline mipmapPipeline;
+    PixelPresentPipeline presentPipeline; //the raytraced image to the swapchain, before the scenes and the gui
+    bool gpuDrivenSupported = false; //drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance
+    PixelTextureStreamer textureStreamer;
+    PixelTextureCache textureCache;
+    std::vector<TextureHandle> materialTextures; //sampled by shader.comp, always fully resident
+    bool memoryBudgetSupported = false; //VK_EXT_memory_budget, the streamer then stays within what the driver gives the process
 
     //images
     std::vector<PixelImage> swapChainImages;
@@ -98,10 +143,49 @@ private:
 	// Utility
 	VkFormat swapChainImageFormat{};
 	VkExtent2D swapChainExtent{};
+    uint32_t swapChainImageTotal = 0; //the uniform buffers and descriptor sets are allocated per swapchain image
 
     // Pools
     VkCommandPool graphicsCommandPool{};
-    VkCommandPool computeCommandPool{};
+
+    //the draws of the scenes only change with the swapchain, the scenes or the pipelines. they are recorded once per
+    //swapchain image into secondary command buffers, the display pass only records the present triangle and the gui and executes them.
+    //the objects of a scene are split in ranges that the job system records in parallel, each worker with its own pool
+    std::vector<std::vector<std::vector<VkCommandBuffer>>> staticCommandBuffers; //[swapchain image][scene][object range]
+    std::array<VkCommandBuffer, MAX_FRAME_DRAWS> guiCommandBuffers{};
+    std::vector<bool> staticObjectsVisible; //what the static command buffers were recorded with, a change re-records them
+    bool staticCommandsValid = false;
+    bool staticGpuDriven = false; //the static command buffers draw the lists of the cull pass instead of every object
+
+    //cpu time spent recording the graphics commands
+    struct RecordTiming{
+        float frameMs = 0.0f; //gui and primary command buffer, every frame
+        float staticMs = 0.0f; //the last re-record of the static command buffers, what every frame cost before
+        uint32_t staticCount = 0;
+    };
+    RecordTiming recordTiming;
+
+    struct RecordJob{
+        uint32_t imageIndex;
+        uint32_t sceneIndex;
+        uint32_t firstDraw;
+        uint32_t drawCount;
+        bool indirect = false; //the whole scene from its draw lists, the draws are ignored
+    };
+    struct RecordingContext{
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers; //allocated on demand, reused after the pool is reset
+        uint32_t used = 0;
+    };
+    PixelJobSystem jobSystem;
+    std::vector<RecordingContext> recordingContexts; //one per worker of the job system
+
+    struct RecordBenchmark{
+        uint32_t draws;
+        float singleMs = 0.0f;
+        float parallelMs = 0.0f;
+    };
+    std::vector<RecordBenchmark> recordBenchmarks;
 
     // gui ressources
     VkDescriptorPool imguiPool{};
@@ -117,12 +201,68 @@ private:
     //synchronization component
     std::vector<VkSemaphore> imageAvailableSemaphore;
     std::vector<VkSemaphore> renderFinishedSemaphore;
-    std::vector<VkSemaphore> computeFinishedSemaphore;
-    std::vector<VkFence> inFlightDrawFences;
-    std::vector<VkFence> inFlightComputeFences;
     int currentFrame = 0;
     std::array<glm::vec3, 512> randomArray;
 
+    //idle detection. the image is only recomputed when the compute parameters change
+    PixelProfiler profiler;
+    PixelComputePipeline::PObj lastRenderedPushObj{};
+    int lastRenderedDenoiseIterations = 0; //0 when the denoiser was off
+    float lastRenderedDenoiseStrength = 0.0f;
+    bool hasRendered = false;
+    int activeFramesRemaining = IDLE_GRACE_FRAMES;
+    uint32_t computeProfilerScope = UINT32_MAX;
+    uint32_t accumulatedSampleIndex = 0; //keeps the sample offsets moving from one frame to the next so the history does not see the same pattern twice
+    PixelTileScheduler tileScheduler;
+
+    //compute and graphics are ordered by the frame graph. the passes of a frame declare the images they use,
+    //the barriers, layout transitions and timeline waits between the queues are derived from that
+    PixelFrameGraph frameGraph;
+    uint32_t accumulatorResource = 0; //input texture, the accumulated color
+    uint32_t blueNoiseResource = 0; //uploaded through the graphics queue, handed to the compute one by its first trace
+    std::array<uint32_t, DISPLAY_BUFFER_COUNT> displayResources{}; //output textures, read by the present pass
+    std::array<uint32_t, DISPLAY_BUFFER_COUNT> outlineMaskResources{}; //custom textures, read by the present pass
+    uint32_t swapchainResource = 0;
+    uint32_t displayBuffer = 0; //written by the last outline pass, the next one writes the other
+
+    //gpu picking. every compute submission picks under the cursor, the result is read back once the compute timeline has reached its frame
+    std::array<bool, MAX_FRAME_DRAWS> pickPending{};
+    std::array<uint64_t, MAX_FRAME_DRAWS> pickValue{}; //compute timeline value of the frame that picked
+    std::array<bool, MAX_FRAME_DRAWS> pickOverGui{}; //the cursor was over the gui, not the scene
+    std::array<uint64_t, MAX_FRAME_DRAWS> pickFrame{};
+    uint64_t computeFrameCount = 0;
+    uint64_t focusRequestFrame = 0;
+    uint64_t latestPickFrame = 0;
+    PixelComputePipeline::PickResult latestPick{};
+    PixelComputePipeline::PickResult scenePick{}; //latest pick made with the cursor over the scene
+
+    //cost of the last swapchain recreation
+    struct ResizeTiming{
+        float waitMs = 0.0f; //waiting for the frames in flight
+        float recreateMs = 0.0f; //swapchain, framebuffers, depth buffer and compute images
+        VkExtent2D extent{};
+        uint32_t count = 0;
+    };
+    ResizeTiming lastResize;
+
+    //frame pacing. the render thread starts frames at the target rate, and while it waits for the next one
+    //the refinement thread keeps adding tiles to the image. the render mutex is held by whichever of the two is working
+    PixelFramePacer framePacer;
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR; //the one the swapchain was created with
+    std::vector<VkPresentModeKHR> supportedPresentModes;
+    bool presentModeChanged = false;
+    std::thread refinementThread;
+    std::mutex renderMutex;
+    std::condition_variable refinementWake;
+    bool refinementRequested = false;
+    double refinementDeadline = 0.0; //start of the next frame, the pacer itself belongs to the render thread
+    bool refinementThreadStop = false;
+    uint32_t refinedTilesSinceFrame = 0; //submitted by the refinement thread, composited by the next frame
+    uint32_t lastFrameRefinedTiles = 0;
+    VkCommandPool refinementCommandPool{}; //command pools are not shared between threads
+    VkCommandBuffer refinementCommandBuffer{}; //submitted through the frame graph, it counts on the compute timeline
+
     //objects
     std::vector<PixelScene> scenes;
 
@@ -133,23 +273,63 @@ private:
 	void createLogicalDevice();
 	void createSurface();
 	void createSwapChain();
+    void recreateSwapChain();
+    void cleanupSwapChainImages();
+    void reallocateImageResources(); //when the recreated swapchain has another number of images
     void createGraphicsPipelines();
     void createFramebuffers();
     void createCommandPools();
-    void createCommandBuffers();
-    void createComputeCommandBuffers();
 	void createScene();
     void createDepthBuffer();
 	void initializeScenes();
+    void createMaterials(); //of the ray traced objects, once the fallback texture exists
+    void createRaytracedScene();
+    void updateSceneKernel(); //generates scene.glsl for the scene, or goes back to the data driven one
     void createSynchronizationObjects();
-    void recordCommands(uint32_t currentImageIndex);
-    void recordComputeCommands(uint32_t currentImageIndex);
+    void recordCommands(VkCommandBuffer commandBuffer, uint32_t currentImageIndex);
+    void recordStaticCommands();
+    void invalidateStaticCommands(){staticCommandsValid = false;} //after a resize, a scene change or a pipeline reload
+    bool staticCommandsOutdated();
+    std::vector<VkCommandBuffer> recordJobs(const std::vector<RecordJob>& jobs, bool parallel); //one secondary per job, in the same order
+    void recordObjectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t sceneIndx, uint32_t firstDraw, uint32_t drawCount);
+    void recordIndirectDraws(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t sceneIndx);
+    void recordCullCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    bool isGpuDriven(){return gpuDrivenRendering && gpuDrivenSupported;}
+    void resetRecordingContexts();
+    VkCommandBuffer acquireRecordingCommandBuffer(uint32_t worker);
+    void benchmarkRecording();
+    void recordTraceCommands(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj pushObj, const PixelComputePipeline::CameraUniforms& camera,
+                             bool restart, bool denoise, const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds, uint32_t pickSlot);
+    void recordCameraUpdate(VkCommandBuffer commandBuffer, const PixelComputePipeline::CameraUniforms& camera);
+    void pushComputeSample(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj);
+    void recordPickCommands(VkCommandBuffer commandBuffer, uint32_t slot);
+    void readBackPicks();
+    void recordDenoiseCommands(VkCommandBuffer commandBuffer);
+    void recordOutlineCommands(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj, uint32_t targetBuffer);
+    void recordTileRounds(VkCommandBuffer commandBuffer, PixelComputePipeline::PObj& pushObj,
+                          const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds, bool profiled);
+    void recordRefinementCommands(PixelComputePipeline::PObj pushObj, const std::vector<std::vector<PixelTileScheduler::TileDispatch>>& rounds);
     VkCommandBuffer beginSingleUseCommandBuffer();
     void submitAndEndSingleUseCommandBuffer(VkCommandBuffer* commandBuffer);
 	QueueFamilyIndices setupQueueFamilies(VkPhysicalDevice device);
 	void init_io();
     void init_compute();
+    void initComputeImageLayouts();
+    void init_profiler();
+    void init_frameGraph();
+    void init_recording();
+    void init_culling();
+    void init_mipmaps();
+    void init_present();
+    void init_streaming();
+    void init_refinement();
+    void runRefinementThread();
+    void stopRefinementThread();
+    float getDisplayLatencyMs();
 	void preDraw();
+    bool isIdle();
+    uint32_t getTargetSamples();
+    bool needsRestart(const PixelComputePipeline::PObj& pushObj);
 
     //gui functions
     bool ColorPicker(const char* label, ImColor* color);
@@ -159,6 +339,8 @@ private:
 	//descriptor Set (for scene initialization)
 	void createDescriptorPool(PixelScene* pixScene);
 	void createDescriptorSets(PixelScene* pixScene);
+	void allocateImageDescriptorSets(PixelScene* pixScene); //the sets of every swapchain image, from the pool of the scene and of the cull pipeline
+    void updateObjectBufferDescriptor(PixelScene* pixScene, uint32_t imageIndex);
 	void createUniformBuffers(PixelScene* pixScene);
     void updateComputeTextureDescriptor();
 
@@ -177,12 +359,17 @@ private:
                      VkBuffer* buffer, VkDeviceMemory* bufferMemory);
     void copySrcBuffertoDstBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize);
     void copySrcBuffertoDstImage(VkBuffer srcBuffer, VkImage dstImageBuffer, uint32_t width, uint32_t height);
+    void copySrcBuffertoDstImageLevels(VkBuffer srcBuffer, PixelImage* pixImage); //every mip level of a compressed texture
+    void copySrcImagetoDstImage(VkCommandBuffer commandBuffer, PixelImage* srcImage, PixelImage* dstImage);
+    void copySrcImagetoDstImage(VkCommandBuffer commandBuffer, PixelImage* srcImage, PixelImage* dstImage, const std::vector<VkRect2D>& regions);
 
     void initializeObjectBuffers(PixelObject* pixObject);
+    void createGeometryBuffers(PixelScene* pixScene);
     void createVertexBuffer(PixelObject* pixObject);
     void createIndexBuffer(PixelObject* pixObject);
-    void createTextureBuffer(PixelImage* pixImage);
+    void createTextureBuffer(PixelImage* pixImage, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     void createTextureSampler();
+    void generateMipmaps(PixelImage* pixImage, VkImageLayout finalLayout);
 
 	//getter functions
 	SwapchainDetails getSwapChainDetails(VkPhysicalDevice device);
@@ -0,0 +1,381 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelSampler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <random>
+
+const float SAMPLER_PI = 3.14159265358979f;
+
+//the light samples read the blue-noise texture at another place so they are not correlated with the pixel samples
+const uint32_t BLUE_NOISE_LIGHT_OFFSET_X = 17;
+const uint32_t BLUE_NOISE_LIGHT_OFFSET_Y = 31;
+
+uint32_t PixelSampler::reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+uint32_t PixelSampler::laineKarrasPermutation(uint32_t x, uint32_t seed) {
+    //only ever flips a bit based on the bits below it, so in reversed order it is a nested uniform scramble (Burley 2020)
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint32_t PixelSampler::nestedUniformScramble(uint32_t x, uint32_t seed) {
+    return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+uint32_t PixelSampler::hashCombine(uint32_t seed, uint32_t value) {
+    return seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+uint32_t PixelSampler::sobol(uint32_t index, uint32_t dimension) {
+    //the first two dimensions of sobol are enough when every pair gets its own scrambling
+    if(dimension == 0)
+    {
+        return reverseBits(index);
+    }
+
+    uint32_t direction = 1u << 31;
+    uint32_t result = 0;
+    for(; index != 0; index >>= 1, direction ^= direction >> 1)
+    {
+        if(index & 1u)
+        {
+            result ^= direction;
+        }
+    }
+    return result;
+}
+
+glm::vec2 PixelSampler::sobolOwen(uint32_t sampleIndex, uint32_t dimensionPair, uint32_t seed) {
+    uint32_t pairSeed = hashCombine(seed, dimensionPair);
+
+    //shuffling the index decorrelates the pairs from each other, scrambling the values keeps the stratification of every power of two
+    uint32_t shuffledIndex = nestedUniformScramble(sampleIndex, pairSeed);
+    uint32_t x = nestedUniformScramble(sobol(shuffledIndex, 0), hashCombine(pairSeed, 0));
+    uint32_t y = nestedUniformScramble(sobol(shuffledIndex, 1), hashCombine(pairSeed, 1));
+
+    //24 bits so the float never rounds up to 1
+    return glm::vec2(static_cast<float>(x >> 8), static_cast<float>(y >> 8)) / 16777216.0f;
+}
+
+glm::vec2 PixelSampler::sampleDisk(glm::vec2 u) {
+    //concentric mapping (Shirley and Chiu 1997), keeps the stratification of the square on the unit disk
+    glm::vec2 offset = 2.0f * u - 1.0f;
+    if(offset.x == 0.0f && offset.y == 0.0f)
+    {
+        return {0.0f, 0.0f};
+    }
+
+    float radius;
+    float theta;
+    if(std::abs(offset.x) > std::abs(offset.y))
+    {
+        radius = offset.x;
+        theta = 0.25f * SAMPLER_PI * (offset.y / offset.x);
+    } else
+    {
+        radius = offset.y;
+        theta = 0.5f * SAMPLER_PI - 0.25f * SAMPLER_PI * (offset.x / offset.y);
+    }
+    return radius * glm::vec2(std::cos(theta), std::sin(theta));
+}
+
+std::vector<uint32_t> PixelSampler::generateRankMap(uint32_t size, uint32_t seed) {
+    const uint32_t count = size * size;
+    const float sigma = 1.5f;
+
+    //toroidal gaussian indexed by the offset between two texels, so the texture tiles without seams
+    std::vector<float> kernel(count);
+    for(uint32_t y = 0; y < size; y++)
+    {
+        for(uint32_t x = 0; x < size; x++)
+        {
+            float dx = static_cast<float>(std::min(x, size - x));
+            float dy = static_cast<float>(std::min(y, size - y));
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+
+    std::vector<uint8_t> pattern(count, 0);
+    std::vector<float> energy(count, 0.0f);
+
+    //the gaussian is negligible past a few sigmas, only the texels around the point are updated
+    const uint32_t splatRadius = std::min(static_cast<uint32_t>(std::ceil(5.0f * sigma)), size / 2);
+    auto splat = [&](uint32_t index, float sign) {
+        uint32_t px = index % size;
+        uint32_t py = index / size;
+        for(uint32_t dy = 0; dy <= 2 * splatRadius; dy++)
+        {
+            for(uint32_t dx = 0; dx <= 2 * splatRadius; dx++)
+            {
+                uint32_t offsetX = (dx + size - splatRadius) % size;
+                uint32_t offsetY = (dy + size - splatRadius) % size;
+                energy[((py + offsetY) % size) * size + (px + offsetX) % size] += sign * kernel[offsetY * size + offsetX];
+            }
+        }
+    };
+
+    //the point with the most neighbours and the empty texel with the fewest
+    auto tightestCluster = [&]() {
+        uint32_t best = 0;
+        float bestEnergy = -1.0f;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(pattern[i] && energy[i] > bestEnergy)
+            {
+                best = i;
+                bestEnergy = energy[i];
+            }
+        }
+        return best;
+    };
+    auto largestVoid = [&]() {
+        uint32_t best = 0;
+        float bestEnergy = std::numeric_limits<float>::max();
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(!pattern[i] && energy[i] < bestEnergy)
+            {
+                best = i;
+                bestEnergy = energy[i];
+            }
+        }
+        return best;
+    };
+
+    //initial binary pattern: a tenth of the texels at random, then spread out by moving points from clusters to voids
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    uint32_t initialCount = count / 10;
+    for(uint32_t i = 0; i < initialCount; i++)
+    {
+        pattern[order[i]] = 1;
+        splat(order[i], 1.0f);
+    }
+
+    for(uint32_t iteration = 0; iteration < count; iteration++)
+    {
+        uint32_t cluster = tightestCluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+
+        uint32_t emptiest = largestVoid();
+        pattern[emptiest] = 1;
+        splat(emptiest, 1.0f);
+
+        if(emptiest == cluster)
+        {
+            break;
+        }
+    }
+
+    std::vector<uint32_t> ranks(count, 0);
+    std::vector<uint8_t> initialPattern = pattern;
+    std::vector<float> initialEnergy = energy;
+
+    //the points of the initial pattern get the lowest ranks, the most clustered one last
+    for(uint32_t rank = initialCount; rank > 0; rank--)
+    {
+        uint32_t cluster = tightestCluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        ranks[cluster] = rank - 1;
+    }
+
+    //then every other texel, filling the largest void first
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for(uint32_t rank = initialCount; rank < count; rank++)
+    {
+        uint32_t emptiest = largestVoid();
+        pattern[emptiest] = 1;
+        splat(emptiest, 1.0f);
+        ranks[emptiest] = rank;
+    }
+
+    return ranks;
+}
+
+std::vector<uint8_t> PixelSampler::generateBlueNoise(uint32_t size, uint32_t seed) {
+    const uint32_t count = size * size;
+    std::vector<uint8_t> texels(count * 4);
+
+    for(uint32_t channel = 0; channel < 4; channel++)
+    {
+        std::vector<uint32_t> ranks = generateRankMap(size, hashCombine(seed, channel));
+        for(uint32_t i = 0; i < count; i++)
+        {
+            texels[i * 4 + channel] = static_cast<uint8_t>((ranks[i] * 256) / count);
+        }
+    }
+
+    return texels;
+}
+
+//shift of a dimension pair at a pixel, read the same way as blueNoiseShift in shader.comp
+static glm::vec2 blueNoiseShift(const std::vector<uint8_t>& blueNoise, uint32_t x, uint32_t y, uint32_t dimensionPair) {
+    if(dimensionPair == SAMPLER_DIMENSION_LIGHT)
+    {
+        x += BLUE_NOISE_LIGHT_OFFSET_X;
+        y += BLUE_NOISE_LIGHT_OFFSET_Y;
+    }
+
+    uint32_t texel = ((y % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE + (x % BLUE_NOISE_SIZE)) * 4;
+    uint32_t channel = dimensionPair == SAMPLER_DIMENSION_LENS ? 2 : 0;
+    return (glm::vec2(blueNoise[texel + channel], blueNoise[texel + channel + 1]) + 0.5f) / 256.0f;
+}
+
+//area of the unit pixel on the inside of an edge: dot(position - 0.5, normal) < distance
+static float pixelCoverage(glm::vec2 normal, float distance) {
+    std::vector<glm::vec2> corners = {{0.0f,0.0f}, {1.0f,0.0f}, {1.0f,1.0f}, {0.0f,1.0f}};
+    std::vector<glm::vec2> clipped;
+    for(size_t i = 0; i < corners.size(); i++)
+    {
+        glm::vec2 a = corners[i];
+        glm::vec2 b = corners[(i + 1) % corners.size()];
+        float sideA = glm::dot(a - 0.5f, normal) - distance;
+        float sideB = glm::dot(b - 0.5f, normal) - distance;
+        if(sideA < 0.0f)
+        {
+            clipped.push_back(a);
+        }
+        if((sideA < 0.0f) != (sideB < 0.0f))
+        {
+            clipped.push_back(a + (b - a) * (sideA / (sideA - sideB)));
+        }
+    }
+
+    float area = 0.0f;
+    for(size_t i = 0; i < clipped.size(); i++)
+    {
+        glm::vec2 a = clipped[i];
+        glm::vec2 b = clipped[(i + 1) % clipped.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return std::abs(area) * 0.5f;
+}
+
+//fraction of the unit disk on the outside of an edge: dot(position, normal) > distance
+static float diskCoverage(float distance) {
+    distance = std::clamp(distance, -1.0f, 1.0f);
+    return (std::acos(distance) - distance * std::sqrt(1.0f - distance * distance)) / SAMPLER_PI;
+}
+
+void PixelSampler::printConvergenceReport(std::ostream& out) {
+    const uint32_t pixelCount = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+    const uint32_t maxSamples = 256;
+
+    //every pixel sees a random edge through its footprint (geometry), through the lens (defocus) and through the light (soft shadow).
+    //the references are analytic, so the error of both schemes is measured against the exact value
+    std::mt19937 rng(SAMPLER_SEED); //fixed seed so two reports can be compared
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    struct Edge{
+        glm::vec2 normal;
+        float distance;
+        float reference;
+    };
+    enum Estimate{
+        PIXEL_OLD = 0, PIXEL_NEW, LENS_OLD, LENS_NEW, LIGHT_OLD, LIGHT_NEW, ESTIMATE_COUNT
+    };
+
+    auto randomNormal = [&]() {
+        float angle = 2.0f * SAMPLER_PI * uniform(rng);
+        return glm::vec2(std::cos(angle), std::sin(angle));
+    };
+
+    std::vector<Edge> pixelEdges(pixelCount);
+    std::vector<Edge> lensEdges(pixelCount);
+    std::vector<Edge> lightEdges(pixelCount);
+    for(uint32_t i = 0; i < pixelCount; i++)
+    {
+        pixelEdges[i].normal = randomNormal();
+        pixelEdges[i].distance = uniform(rng) - 0.5f;
+        pixelEdges[i].reference = pixelCoverage(pixelEdges[i].normal, pixelEdges[i].distance);
+
+        lensEdges[i].normal = randomNormal();
+        lensEdges[i].distance = 2.0f * uniform(rng) - 1.0f;
+        lensEdges[i].reference = diskCoverage(lensEdges[i].distance);
+
+        lightEdges[i].normal = randomNormal();
+        lightEdges[i].distance = 2.0f * uniform(rng) - 1.0f;
+        lightEdges[i].reference = diskCoverage(lightEdges[i].distance);
+    }
+
+    std::vector<uint8_t> blueNoise = generateBlueNoise(BLUE_NOISE_SIZE, SAMPLER_SEED);
+    std::vector<std::array<double, ESTIMATE_COUNT>> sums(pixelCount, std::array<double, ESTIMATE_COUNT>{});
+
+    out << "sampler convergence, RMSE over " << pixelCount << " pixels (old: fixed pixel corner, independent random lens samples, point light)" << std::endl;
+    out << std::setw(8) << "samples" << std::setw(22) << "pixel old/new" << std::setw(22) << "lens old/new" << std::setw(22) << "light old/new" << std::endl;
+
+    for(uint32_t sample = 0; sample < maxSamples; sample++)
+    {
+        for(uint32_t i = 0; i < pixelCount; i++)
+        {
+            uint32_t x = i % BLUE_NOISE_SIZE;
+            uint32_t y = i / BLUE_NOISE_SIZE;
+
+            glm::vec2 pixelSample = glm::fract(sobolOwen(sample, SAMPLER_DIMENSION_PIXEL, SAMPLER_SEED) + blueNoiseShift(blueNoise, x, y, SAMPLER_DIMENSION_PIXEL));
+            glm::vec2 lensSample = sampleDisk(glm::fract(sobolOwen(sample, SAMPLER_DIMENSION_LENS, SAMPLER_SEED) + blueNoiseShift(blueNoise, x, y, SAMPLER_DIMENSION_LENS)));
+            glm::vec2 lightSample = sampleDisk(glm::fract(sobolOwen(sample, SAMPLER_DIMENSION_LIGHT, SAMPLER_SEED) + blueNoiseShift(blueNoise, x, y, SAMPLER_DIMENSION_LIGHT)));
+            glm::vec2 randomLensSample = sampleDisk(glm::vec2(uniform(rng), uniform(rng)));
+
+            const Edge& pixelEdge = pixelEdges[i];
+            const Edge& lensEdge = lensEdges[i];
+            const Edge& lightEdge = lightEdges[i];
+            sums[i][PIXEL_OLD] += glm::dot(glm::vec2(-0.5f), pixelEdge.normal) < pixelEdge.distance ? 1.0 : 0.0;
+            sums[i][PIXEL_NEW] += glm::dot(pixelSample - 0.5f, pixelEdge.normal) < pixelEdge.distance ? 1.0 : 0.0;
+            sums[i][LENS_OLD] += glm::dot(randomLensSample, lensEdge.normal) > lensEdge.distance ? 1.0 : 0.0;
+            sums[i][LENS_NEW] += glm::dot(lensSample, lensEdge.normal) > lensEdge.distance ? 1.0 : 0.0;
+            sums[i][LIGHT_OLD] += 0.0f > lightEdge.distance ? 1.0 : 0.0;
+            sums[i][LIGHT_NEW] += glm::dot(lightSample, lightEdge.normal) > lightEdge.distance ? 1.0 : 0.0;
+        }
+
+        uint32_t sampleCount = sample + 1;
+        if((sampleCount & (sampleCount - 1)) != 0)
+        {
+            continue;
+        }
+
+        std::array<double, ESTIMATE_COUNT> squaredErrors{};
+        for(uint32_t i = 0; i < pixelCount; i++)
+        {
+            std::array<float, ESTIMATE_COUNT> references = {pixelEdges[i].reference, pixelEdges[i].reference,
+                                                            lensEdges[i].reference, lensEdges[i].reference,
+                                                            lightEdges[i].reference, lightEdges[i].reference};
+            for(uint32_t estimate = 0; estimate < ESTIMATE_COUNT; estimate++)
+            {
+                double error = sums[i][estimate] / sampleCount - references[estimate];
+                squaredErrors[estimate] += error * error;
+            }
+        }
+
+        out << std::setw(8) << sampleCount << std::fixed << std::setprecision(4);
+        for(uint32_t estimate = 0; estimate < ESTIMATE_COUNT; estimate += 2)
+        {
+            out << std::setw(12) << std::sqrt(squaredErrors[estimate] / pixelCount)
+                << " / " << std::setw(7) << std::sqrt(squaredErrors[estimate + 1] / pixelCount);
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELSAMPLER_H
+#define PIXELENGINE_PIXELSAMPLER_H
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+const uint32_t BLUE_NOISE_SIZE = 64; //the blue-noise texture is tiled over the image
+const uint32_t SAMPLER_SEED = 0x5bd1e995;
+
+//how shader.comp picks the sub-pixel, lens and light samples. has to match the defines in shader.comp
+enum SamplerMode{
+    SAMPLER_PINHOLE = 0, //no jitter at all, used when nothing is accumulated
+    SAMPLER_RANDOM = 1, //the gaussian lens offsets of randomArray, no pixel jitter and a point light
+    SAMPLER_SOBOL_BLUE_NOISE = 2 //owen-scrambled sobol, shifted per pixel by the blue-noise texture
+};
+
+//dimension pairs of the sobol sequence, one per 2D decision of a sample
+enum SamplerDimension{
+    SAMPLER_DIMENSION_PIXEL = 0,
+    SAMPLER_DIMENSION_LENS,
+    SAMPLER_DIMENSION_LIGHT
+};
+
+class PixelSampler {
+public:
+
+    //cpu version of the sampler in shader.comp, both have to give the same values
+    static glm::vec2 sobolOwen(uint32_t sampleIndex, uint32_t dimensionPair, uint32_t seed);
+    static glm::vec2 sampleDisk(glm::vec2 u);
+
+    //void-and-cluster blue noise (Ulichney 1993). every channel is an independent rank map, as RGBA8 texels
+    static std::vector<uint8_t> generateBlueNoise(uint32_t size, uint32_t seed);
+
+    //RMSE of the old and new sampling schemes against analytic references, for 1 to 256 samples per pixel
+    static void printConvergenceReport(std::ostream& out);
+
+private:
+    static uint32_t reverseBits(uint32_t x);
+    static uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed);
+    static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed);
+    static uint32_t hashCombine(uint32_t seed, uint32_t value);
+    static uint32_t sobol(uint32_t index, uint32_t dimension);
+    static std::vector<uint32_t> generateRankMap(uint32_t size, uint32_t seed);
+};
+
+
+#endif //PIXELENGINE_PIXELSAMPLER_H
@@ -6,10 +6,13 @@
 #include "glm/glm.hpp"
 #include "glm/ext/matrix_relational.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <cstdlib>
+#include <stdexcept>
 
-PixelScene::PixelScene(VkDevice device, VkPhysicalDevice physicalDevice) : m_device(device), m_physicalDevice(physicalDevice)
+PixelScene::PixelScene(VkDevice device, VkPhysicalDevice physicalDevice) : m_device(device), m_physicalDevice(physicalDevice),
+                                                                          textureRegistry(device, physicalDevice)
 {
     printf("PixelScene constructed\n");
     initialize();
@@ -18,24 +21,11 @@ PixelScene::PixelScene(VkDevice device, VkPhysicalDevice physicalDevice) : m_dev
 void PixelScene::cleanup()
 {
 
-#ifdef __APPLE__
-    free(modelTransferSpace);
-
-#else
-    _aligned_free(modelTransferSpace);
-#endif
-
-
     vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayouts[UBOS], nullptr);
-    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayouts[TEXTURES], nullptr);
-    for(int i = 0; i < uniformBuffers.size(); i++)
-    {
-        vkDestroyBuffer(m_device, dynamicUniformBuffers[i], nullptr);
-        vkFreeMemory(m_device, dynamicUniformBufferMemories[i], nullptr);
-        vkDestroyBuffer(m_device, uniformBuffers[i], nullptr);
-        vkFreeMemory(m_device, uniformBufferMemories[i], nullptr);
-    }
+    textureRegistry.cleanUp(); //its layout is the TEXTURES one
+    destroyGeometryBuffers();
+    destroyImageBuffers();
 
     for(auto& object : allObjects)
     {
@@ -68,16 +58,34 @@ VkDeviceMemory* PixelScene::getUniformBufferMemories(int index) {
 void PixelScene::resizeBuffers(size_t newSize) {
     uniformBuffers.resize(newSize);
     uniformBufferMemories.resize(newSize);
-    dynamicUniformBuffers.resize(newSize);
-    dynamicUniformBufferMemories.resize(newSize);
+    objectBuffers.resize(newSize);
     buffersUpdated.resize(newSize, false);
 }
 
-void PixelScene::addObject(PixelObject pixObject) {
-    if(pixObject.getTextures().size() > 0)
+void PixelScene::destroyImageBuffers() {
+    for(size_t i = 0; i < uniformBuffers.size(); i++)
     {
-        pixObject.setTextureIDOffset(getAllTextures().size());
+        destroyObjectBuffer(objectBuffers[i]);
+        vkDestroyBuffer(m_device, uniformBuffers[i], nullptr);
+        vkFreeMemory(m_device, uniformBufferMemories[i], nullptr);
     }
+
+    //resizeBuffers starts from nothing, the new buffers are all written before they are read
+    uniformBuffers.clear();
+    uniformBufferMemories.clear();
+    objectBuffers.clear();
+    buffersUpdated.clear();
+
+    //no frame is in flight, so the retired buffers are not read anymore either
+    destroyRetiredBuffers(UINT64_MAX);
+}
+
+void PixelScene::addObject(PixelObject pixObject) {
+    //the mesh goes at the end of the geometry pool
+    pixObject.setGeometryOffsets(static_cast<uint32_t>(allIndices.size()), static_cast<int32_t>(allVertices.size()));
+    allVertices.insert(allVertices.end(), pixObject.getVertices()->begin(), pixObject.getVertices()->end());
+    allIndices.insert(allIndices.end(), pixObject.getIndices()->begin(), pixObject.getIndices()->end());
+
     allObjects.push_back(pixObject);
 }
 
@@ -99,6 +107,11 @@ VkDescriptorSet* PixelScene::getUniformDescriptorSetAt(int index) {
 
 void PixelScene::resizeDesciptorSets(size_t newSize) {
     m_uniformDescriptorSets.resize(newSize);
+    m_cullDescriptorSets.resize(newSize);
+}
+
+VkDescriptorSet* PixelScene::getCullDescriptorSetAt(int index) {
+    return &m_cullDescriptorSets[index];
 }
 
 std::vector<VkDescriptorSet>* PixelScene::getUniformDescriptorSets() {
@@ -135,7 +148,6 @@ void PixelScene::updateUniformBuffer(uint32_t bufferIndex)
 void PixelScene::createDescriptorSetLayout() {
 
     VkDescriptorSetLayout uniformDescriptorSetLayout{};
-    VkDescriptorSetLayout textureDescriptorSetLayout{};
 
     //how data is bound to the shader in binding 0
     VkDescriptorSetLayoutBinding uniformBufferLayoutBinding{};
@@ -148,19 +160,11 @@ void PixelScene::createDescriptorSetLayout() {
     //how data is bound to the shader in binding 1
     VkDescriptorSetLayoutBinding dynamicBufferLayoutBinding{};
     dynamicBufferLayoutBinding.binding = 1; //binding point in shader
-    dynamicBufferLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    dynamicBufferLayoutBinding.descriptorCount = 1; //only binding one uniform buffer
+    dynamicBufferLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; //the object buffer, indexed by the shader
+    dynamicBufferLayoutBinding.descriptorCount = 1; //only binding one storage buffer
     dynamicBufferLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     dynamicBufferLayoutBinding.pImmutableSamplers = nullptr;
 
-    //how data is bound to the shader in binding 2
-    VkDescriptorSetLayoutBinding textureSamplerLayoutBinding{};
-    textureSamplerLayoutBinding.binding = 0; //binding point in shader
-    textureSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    textureSamplerLayoutBinding.descriptorCount = static_cast<uint32_t>(MAX_TEXTURE_PER_OBJECT); //only binding one combine image sampler buffer
-    textureSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    textureSamplerLayoutBinding.pImmutableSamplers = nullptr;
-
     std::array<VkDescriptorSetLayoutBinding, 2> descriptorSetLayoutBindings = {uniformBufferLayoutBinding, dynamicBufferLayoutBinding};
 
     //Create descriptor set layout given binding
@@ -175,20 +179,11 @@ void PixelScene::createDescriptorSetLayout() {
         throw std::runtime_error("Failed to create descriptor set layout for ubos");
     }
 
-    //Create descriptor set layout given binding
-    VkDescriptorSetLayoutCreateInfo textureDescriptorSetLayoutCreateInfo{};
-    textureDescriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    textureDescriptorSetLayoutCreateInfo.pBindings = &textureSamplerLayoutBinding;
-    textureDescriptorSetLayoutCreateInfo.bindingCount = 1;
-
-    result = vkCreateDescriptorSetLayout(m_device, &textureDescriptorSetLayoutCreateInfo, nullptr, &textureDescriptorSetLayout);
-    if(result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create descriptor set layout for textures");
-    }
+    //the textures are a bindless array, the registry owns its layout
+    textureRegistry.createDescriptorSetLayout();
 
     m_descriptorSetLayouts.push_back(uniformDescriptorSetLayout);
-    m_descriptorSetLayouts.push_back(textureDescriptorSetLayout);
+    m_descriptorSetLayouts.push_back(*textureRegistry.getDescriptorSetLayout());
 }
 
 PixelScene::UboVP PixelScene::getSceneVP() {
@@ -224,76 +219,220 @@ bool PixelScene::areMatricesEqual(glm::mat4 x, glm::mat4 y) {
     return true;
 }
 
-void PixelScene::allocateDynamicBufferTransferSpace()
-{
-    //calculate allignment
-    objectUBOAllignment = (sizeof(PixelObject::DynamicUBObj) + minUBOOffset - 1) & ~(minUBOOffset - 1); //right portion is our mask
+VkBuffer PixelScene::getObjectBuffer(int index) {
+    return objectBuffers[index].buffer;
+}
+
+void PixelScene::growObjectBuffer(uint32_t bufferIndex, uint64_t retireValue) {
+
+    //geometric growth, so adding objects one at a time only recreates the buffer a logarithmic number of times
+    ObjectBuffer& objectBuffer = objectBuffers[bufferIndex];
+    uint32_t capacity = std::max(objectBuffer.capacity, OBJECT_BUFFER_MIN_CAPACITY);
+    while(capacity < allObjects.size())
+    {
+        capacity *= 2;
+    }
+
+    retireBuffer(objectBuffer.buffer, objectBuffer.memory, retireValue);
+    retireBuffer(objectBuffer.drawBuffer, objectBuffer.drawMemory, retireValue);
+    retireBuffer(objectBuffer.countBuffer, objectBuffer.countMemory, retireValue);
+    //a new buffer holds nothing, every object is written to it the next time it is updated
+    objectBuffer = ObjectBuffer{};
+    objectBuffer.capacity = capacity;
+
+    VkDeviceSize bufferSize = sizeof(PixelObject::DynamicUBObj) * capacity;
+    createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &objectBuffer.buffer, &objectBuffer.memory);
+    vkMapMemory(m_device, objectBuffer.memory, 0, bufferSize, 0, reinterpret_cast<void**>(&objectBuffer.mapped));
+
+    //only the gpu reads and writes the draw lists. the counts are cleared with a fill before every cull
+    createBuffer(sizeof(VkDrawIndexedIndirectCommand) * capacity * MAX_DRAW_GROUPS,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 &objectBuffer.drawBuffer, &objectBuffer.drawMemory);
+    createBuffer(sizeof(uint32_t) * MAX_DRAW_GROUPS,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &objectBuffer.countBuffer, &objectBuffer.countMemory);
+}
+
+void PixelScene::retireBuffer(VkBuffer buffer, VkDeviceMemory memory, uint64_t retireValue) {
+
+    //a buffer that was never created has nothing to wait for
+    if(buffer != VK_NULL_HANDLE)
+    {
+        retiredBuffers.push_back({buffer, memory, retireValue});
+    }
+}
 
-    
-#ifdef __APPLE__
-//create memory for all the objects dynamic buffers;
-    modelTransferSpace = (PixelObject::DynamicUBObj*) aligned_alloc(minUBOOffset, objectUBOAllignment * MAX_OBJECTS);
-#else
-//create memory for all the objects dynamic buffers;
-    modelTransferSpace = (PixelObject::DynamicUBObj*) _aligned_malloc(objectUBOAllignment * MAX_OBJECTS, minUBOOffset);
-#endif
+void PixelScene::destroyRetiredBuffers(uint64_t completedValue) {
 
+    //freeing the memory of a mapped object buffer unmaps it
+    auto done = std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [this, completedValue](const RetiredBuffer& retired){
+        if(retired.value > completedValue)
+        {
+            return false;
+        }
+        vkDestroyBuffer(m_device, retired.buffer, nullptr);
+        vkFreeMemory(m_device, retired.memory, nullptr);
+        return true;
+    });
+    retiredBuffers.erase(done, retiredBuffers.end());
 }
 
-void PixelScene::getMinUBOOffset(VkPhysicalDevice physicalDevice) {
-    VkPhysicalDeviceProperties physicalDeviceProperties{};
-    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-    minUBOOffset = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+void PixelScene::destroyObjectBuffer(ObjectBuffer& objectBuffer) {
+
+    if(objectBuffer.buffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkUnmapMemory(m_device, objectBuffer.memory);
+    vkDestroyBuffer(m_device, objectBuffer.buffer, nullptr);
+    vkFreeMemory(m_device, objectBuffer.memory, nullptr);
+    vkDestroyBuffer(m_device, objectBuffer.drawBuffer, nullptr);
+    vkFreeMemory(m_device, objectBuffer.drawMemory, nullptr);
+    vkDestroyBuffer(m_device, objectBuffer.countBuffer, nullptr);
+    vkFreeMemory(m_device, objectBuffer.countMemory, nullptr);
+    objectBuffer = ObjectBuffer{};
 }
 
-VkBuffer *PixelScene::getDynamicUniformBuffers(int index) {
-    return &(dynamicUniformBuffers[index]);
+VkBuffer PixelScene::getDrawBuffer(int index) {
+    return objectBuffers[index].drawBuffer;
 }
 
-VkDeviceMemory *PixelScene::getDynamicUniformBufferMemories(int index) {
-    return &(dynamicUniformBufferMemories[index]);
+VkBuffer PixelScene::getDrawCountBuffer(int index) {
+    return objectBuffers[index].countBuffer;
 }
 
-VkDeviceSize PixelScene::getDynamicUniformBufferSize() const {
-    return objectUBOAllignment * MAX_OBJECTS;
+void PixelScene::retireGeometryBuffers(uint64_t retireValue) {
+
+    //the static draws bind the pool by handle, so the new one gets new buffers and the old ones wait for the frames in flight
+    retireBuffer(geometryVertexBuffer, geometryVertexBufferMemory, retireValue);
+    retireBuffer(geometryIndexBuffer, geometryIndexBufferMemory, retireValue);
+    geometryVertexBuffer = VK_NULL_HANDLE;
+    geometryVertexBufferMemory = VK_NULL_HANDLE;
+    geometryIndexBuffer = VK_NULL_HANDLE;
+    geometryIndexBufferMemory = VK_NULL_HANDLE;
+    uploadedGeometryVertices = 0;
 }
 
-VkDeviceSize PixelScene::getMinAlignment() const {
-    return objectUBOAllignment;
+void PixelScene::destroyGeometryBuffers() {
+
+    //destroying a null handle does nothing, the pool of an empty scene is never uploaded
+    vkDestroyBuffer(m_device, geometryVertexBuffer, nullptr);
+    vkFreeMemory(m_device, geometryVertexBufferMemory, nullptr);
+    vkDestroyBuffer(m_device, geometryIndexBuffer, nullptr);
+    vkFreeMemory(m_device, geometryIndexBufferMemory, nullptr);
+    geometryVertexBuffer = VK_NULL_HANDLE;
+    geometryVertexBufferMemory = VK_NULL_HANDLE;
+    geometryIndexBuffer = VK_NULL_HANDLE;
+    geometryIndexBufferMemory = VK_NULL_HANDLE;
+    uploadedGeometryVertices = 0;
 }
 
-void PixelScene::updateDynamicUniformBuffer(uint32_t bufferIndex) {
-    for(size_t i = 0; i<allObjects.size(); i++)
+void PixelScene::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* memory) {
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, buffer);
+    if(result != VK_SUCCESS)
     {
-        auto* currentPushM = (PixelObject::DynamicUBObj*)((uint64_t)modelTransferSpace + (i * objectUBOAllignment));
-        *currentPushM = *(allObjects[i].getDynamicUBObj());
+        throw std::runtime_error("failed to create a scene buffer");
     }
 
-    //map the whole chunk of memory data
-    void* data;
-    vkMapMemory(m_device, dynamicUniformBufferMemories[bufferIndex], 0, objectUBOAllignment * allObjects.size() , 0 , &data);
-    memcpy(data, modelTransferSpace, objectUBOAllignment * allObjects.size());
-    vkUnmapMemory(m_device, dynamicUniformBufferMemories[bufferIndex]);
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(m_device, *buffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_physicalDevice, memoryRequirements.memoryTypeBits, properties);
+
+    result = vkAllocateMemory(m_device, &allocateInfo, nullptr, memory);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate scene buffer memory");
+    }
+    vkBindBufferMemory(m_device, *buffer, *memory, 0);
+}
+
+void PixelScene::updateObjectBuffer(uint32_t bufferIndex) {
+
+    if(needsObjectBufferGrowth(bufferIndex))
+    {
+        throw std::runtime_error("the object buffer is too small, growObjectBuffer has to be called first");
+    }
+
+    //the buffer of this swapchain image only misses the changes made since it was last written
+    ObjectBuffer& objectBuffer = objectBuffers[bufferIndex];
+    objectBuffer.versions.resize(allObjects.size(), OBJECT_NOT_WRITTEN);
+    lastObjectWrites = 0;
+    for(size_t i = 0; i < allObjects.size(); i++)
+    {
+        uint64_t version = allObjects[i].getVersion();
+        if(objectBuffer.versions[i] != version)
+        {
+            objectBuffer.mapped[i] = allObjects[i].getObjectData();
+            objectBuffer.versions[i] = version;
+            lastObjectWrites++;
+        }
+    }
 }
 
 void PixelScene::initialize() {
-    getMinUBOOffset(m_physicalDevice);
-    allocateDynamicBufferTransferSpace();
     createDescriptorSetLayout();
 }
 
-std::vector<PixelImage> PixelScene::getAllTextures() {
-    std::vector<PixelImage> allTextures;
+void PixelScene::registerTextures() {
 
-    for(int i = 0 ; i < allObjects.size(); i++)
+    //the objects keep their indices, only the ones added since the last call are visited
+    for(; registeredObjects < allObjects.size(); registeredObjects++)
     {
-        for(int j = 0; j < allObjects[i].getTextures().size(); j++)
+        PixelObject& object = allObjects[registeredObjects];
+        for(uint32_t slot = 0; slot < object.getTextures()->size(); slot++)
         {
-            allTextures.push_back(allObjects[i].getTextures()[j]);
+            if(object.getTextureIndex(slot) == TEXTURE_NONE)
+            {
+                //a texture shared with an earlier object already has its index
+                PixelImage* texture = (*object.getTextures())[slot].get();
+                auto index = textureIndices.find(texture);
+                if(index == textureIndices.end())
+                {
+                    index = textureIndices.emplace(texture, textureRegistry.add(texture)).first;
+                }
+                object.setTextureIndex(slot, index->second);
+            }
         }
     }
+}
 
-    return allTextures;
+void PixelScene::reregisterTexture(PixelImage* texture) {
+
+    auto index = textureIndices.find(texture);
+    if(index == textureIndices.end())
+    {
+        return;
+    }
+
+    //the frames in flight keep sampling the old index until the registry retires it
+    uint32_t previousIndex = index->second;
+    index->second = textureRegistry.add(texture);
+    textureRegistry.remove(previousIndex);
+
+    for(size_t i = 0; i < registeredObjects; i++)
+    {
+        PixelObject& object = allObjects[i];
+        for(uint32_t slot = 0; slot < object.getTextures()->size(); slot++)
+        {
+            if((*object.getTextures())[slot].get() == texture)
+            {
+                object.setTextureIndex(slot, index->second);
+            }
+        }
+    }
 }
 
 std::vector<VkDescriptorSetLayout> *PixelScene::getAllDescriptorSetLayouts() {
@@ -301,5 +440,5 @@ std::vector<VkDescriptorSetLayout> *PixelScene::getAllDescriptorSetLayouts() {
 }
 
 VkDescriptorSet *PixelScene::getTextureDescriptorSet() {
-    return &m_textureDescriptorSet;
+    return textureRegistry.getDescriptorSet();
 }
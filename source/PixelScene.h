@@ -8,6 +8,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include "PixelObject.h"
+#include "PixelTextureRegistry.h"
+
+#include <unordered_map>
 
 
 static const glm::mat4 MAT4_IDENTITY = {1,0,0,0,
@@ -15,8 +18,9 @@ static const glm::mat4 MAT4_IDENTITY = {1,0,0,0,
                                         0,0,1,0,
                                         0,0,0,1};
 
-const int MAX_OBJECTS = 10;
-const int MAX_TEXTURE_PER_OBJECT = 16;
+const uint32_t OBJECT_BUFFER_MIN_CAPACITY = 64; //objects, the object buffers double from there
+const uint64_t OBJECT_NOT_WRITTEN = 0; //versions start at 1
+const uint32_t MAX_DRAW_GROUPS = 4; //graphics pipelines the gpu-driven draws of a scene are sorted into, one indirect list each
 enum DescSetLayoutIndex{
     UBOS,
     TEXTURES
@@ -44,15 +48,24 @@ public:
     VkDescriptorSet* getTextureDescriptorSet();
     std::vector<VkDescriptorSet>* getUniformDescriptorSets();
     static VkDeviceSize getUniformBufferSize();
-    VkDeviceSize getDynamicUniformBufferSize() const;
-    VkDeviceSize getMinAlignment() const;
     VkBuffer* getUniformBuffers(int index);
     VkDeviceMemory* getUniformBufferMemories(int index);
-    VkBuffer* getDynamicUniformBuffers(int index);
-    VkDeviceMemory* getDynamicUniformBufferMemories(int index);
+    VkBuffer getObjectBuffer(int index);
+    VkBuffer getDrawBuffer(int index);
+    VkBuffer getDrawCountBuffer(int index);
+    VkDeviceSize getDrawGroupOffset(int index, uint32_t group) const {return sizeof(VkDrawIndexedIndirectCommand) * objectBuffers[index].capacity * group;}
+    std::vector<PixelObject::Vertex>* getGeometryVertices(){return &allVertices;}
+    std::vector<uint32_t>* getGeometryIndices(){return &allIndices;}
+    VkBuffer* getGeometryVertexBuffer(){return &geometryVertexBuffer;}
+    VkDeviceMemory* getGeometryVertexBufferMemory(){return &geometryVertexBufferMemory;}
+    VkBuffer* getGeometryIndexBuffer(){return &geometryIndexBuffer;}
+    VkDeviceMemory* getGeometryIndexBufferMemory(){return &geometryIndexBufferMemory;}
+    VkDescriptorSet* getCullDescriptorSetAt(int index);
+    uint32_t getObjectCapacity(int index) const {return objectBuffers[index].capacity;}
+    uint32_t getLastObjectWrites() const {return lastObjectWrites;} //entries copied by the last updateObjectBuffer
     int getNumObjects();
     PixelObject* getObjectAt(int index);
-    std::vector<PixelImage> getAllTextures();
+    PixelTextureRegistry* getTextureRegistry(){return &textureRegistry;}
     UboVP getSceneVP();
 
     //setter functions
@@ -65,11 +78,26 @@ public:
 
     //update functons
     void updateUniformBuffer(uint32_t bufferIndex);
-    void updateDynamicUniformBuffer(uint32_t bufferIndex);
+    void registerTextures(); //gives the textures of the objects added since the last call an index in the registry
+    void reregisterTexture(PixelImage* texture); //a new index for a texture whose image changed, the objects using it are given it
+    void updateObjectBuffer(uint32_t bufferIndex);
+
+    //object buffers. each swapchain image grows its own when it is acquired, its descriptor sets have to be written again.
+    //the old buffers may still be read by the frames in flight, they are retired with the graphics timeline value they end at
+    bool needsObjectBufferGrowth(uint32_t bufferIndex) const {return objectBuffers[bufferIndex].capacity < allObjects.size();}
+    void growObjectBuffer(uint32_t bufferIndex, uint64_t retireValue);
+    void destroyRetiredBuffers(uint64_t completedValue); //the ones whose value the graphics timeline reached
+
+    //geometry pool. the renderer uploads it, objects added since then need a new upload
+    bool needsGeometryUpload() const {return uploadedGeometryVertices != allVertices.size();}
+    void setGeometryUploaded(){uploadedGeometryVertices = allVertices.size();}
+    void retireGeometryBuffers(uint64_t retireValue); //before a new upload, the frames in flight may still draw from them
+    void destroyGeometryBuffers();
 
     //helper functions
     void initialize();
     void resizeBuffers(size_t newSize);
+    void destroyImageBuffers(); //the uniform and object buffers of every swapchain image, none may be in use
     void resizeDesciptorSets(size_t newSize);
     static bool areMatricesEqual(glm::mat4 x, glm::mat4 y);
 
@@ -80,37 +108,69 @@ private:
 
     //objects
     std::vector<PixelObject> allObjects{};
+
+    //------GEOMETRY POOL
+    //the meshes of every object one after the other, so the gpu-driven draws of a scene bind a single vertex and index buffer.
+    //the indices stay relative to the mesh, a draw adds the vertex offset of its object
     std::vector<PixelObject::Vertex> allVertices{};
     std::vector<uint32_t> allIndices{};
+    VkBuffer geometryVertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory geometryVertexBufferMemory = VK_NULL_HANDLE;
+    VkBuffer geometryIndexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory geometryIndexBufferMemory = VK_NULL_HANDLE;
+    size_t uploadedGeometryVertices = 0;
 
     //helper functions
-    void getMinUBOOffset(VkPhysicalDevice physicalDevice);
-
-    //allocator functions
-    void allocateDynamicBufferTransferSpace();
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* memory);
 
     //------UNIFORM BUFFER
     UboVP sceneVP; //model view projection matrix
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBufferMemories;
-    std::vector<VkBuffer> dynamicUniformBuffers;
-    std::vector<VkDeviceMemory> dynamicUniformBufferMemories;
-    PixelObject::DynamicUBObj* modelTransferSpace{};
+    std::vector<bool> buffersUpdated;
 
-    //------TEXTURES
+    //------OBJECT BUFFERS
+    //per object data, one storage buffer per swapchain image. the vertex shaders index it with the instance index,
+    //every draw starts at the index of its object. the buffers keep their capacity, and only the entries of the objects
+    //that changed since a buffer was last written are copied into it.
+    //the cull pass of the swapchain image fills its draw lists from it, one list of capacity draws per draw group
+    struct ObjectBuffer{
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        PixelObject::DynamicUBObj* mapped = nullptr; //persistently mapped, host coherent
+        std::vector<uint64_t> versions; //of the object each entry was written from
+        VkBuffer drawBuffer = VK_NULL_HANDLE; //VkDrawIndexedIndirectCommand, written by the cull pass
+        VkDeviceMemory drawMemory = VK_NULL_HANDLE;
+        VkBuffer countBuffer = VK_NULL_HANDLE; //one draw count per group
+        VkDeviceMemory countMemory = VK_NULL_HANDLE;
+        uint32_t capacity = 0; //objects
+    };
+    std::vector<ObjectBuffer> objectBuffers;
+    void destroyObjectBuffer(ObjectBuffer& objectBuffer);
+
+    //------RETIRED BUFFERS
+    //replaced object buffers and geometry pools, destroyed once the graphics timeline passed the frames that read them
+    struct RetiredBuffer{
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        uint64_t value; //graphics timeline value after which no frame reads it
+    };
+    std::vector<RetiredBuffer> retiredBuffers;
+    void retireBuffer(VkBuffer buffer, VkDeviceMemory memory, uint64_t retireValue);
+    uint32_t lastObjectWrites = 0;
 
-    //utility (Dynamic Buffers)
-    VkDeviceSize minUBOOffset{}; //this is device specific and is a constant
-    size_t objectUBOAllignment{}; //this is a multiple of minUBOOffset and will depend on the size of the object's UBO
-    std::vector<bool> buffersUpdated;
+    //------TEXTURES
+    PixelTextureRegistry textureRegistry;
+    size_t registeredObjects = 0; //objects whose textures have an index in the registry
+    std::unordered_map<PixelImage*, uint32_t> textureIndices; //one index per texture, however many objects share it
 
     //vulkan component
     VkDevice m_device = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> m_uniformDescriptorSets{};
+    std::vector<VkDescriptorSet> m_cullDescriptorSets{}; //allocated from the pool of the cull pipeline, one per swapchain image
     std::vector<VkDescriptorSetLayout> m_descriptorSetLayouts{};
-    VkDescriptorSet m_textureDescriptorSet = VK_NULL_HANDLE;
 };
 
 
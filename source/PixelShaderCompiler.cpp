@@ -0,0 +1,454 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelShaderCompiler.h"
+
+#include <shaderc/shaderc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+//resolves the includes of a shader next to it, and keeps the files it opened so the watcher can check them. a generated include
+//is listed under the path of the file it replaces
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+public:
+    ShaderIncluder(std::vector<std::string>* files, std::map<std::string, std::string> generatedIncludes)
+            : m_files(files), m_generatedIncludes(std::move(generatedIncludes)) {}
+
+    struct Include{
+        std::string name;
+        std::string content;
+        shaderc_include_result result;
+    };
+
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type, const char*, size_t) override
+    {
+        auto* include = new Include();
+        include->name = SHADER_SOURCE_DIRECTORY + requestedSource;
+
+        auto generated = m_generatedIncludes.find(requestedSource);
+        std::ifstream file;
+        if(generated == m_generatedIncludes.end())
+        {
+            file.open(include->name, std::ios::binary);
+        }
+
+        if(generated == m_generatedIncludes.end() && !file.is_open())
+        {
+            //an empty name tells shaderc the include failed, the content is the message
+            include->content = "could not open " + include->name;
+            include->name.clear();
+        }
+        else
+        {
+            if(m_files != nullptr)
+            {
+                m_files->push_back(include->name);
+            }
+
+            if(file.is_open())
+            {
+                include->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            else
+            {
+                include->content = generated->second;
+                include->name += " (generated)"; //what the compiler messages call it
+            }
+        }
+
+        include->result.source_name = include->name.c_str();
+        include->result.source_name_length = include->name.size();
+        include->result.content = include->content.c_str();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+        return &include->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* data) override
+    {
+        delete static_cast<Include*>(data->user_data);
+    }
+
+private:
+    std::vector<std::string>* m_files;
+    std::map<std::string, std::string> m_generatedIncludes;
+};
+
+static shaderc_shader_kind shaderKind(const std::string& filename)
+{
+    std::string extension = std::filesystem::path(filename).extension().string();
+    if(extension == ".comp")
+    {
+        return shaderc_glsl_compute_shader;
+    }
+    if(extension == ".vert")
+    {
+        return shaderc_glsl_vertex_shader;
+    }
+    if(extension == ".frag")
+    {
+        return shaderc_glsl_fragment_shader;
+    }
+    throw std::runtime_error("unknown shader stage for " + filename);
+}
+
+static shaderc::CompileOptions compileOptions(std::vector<std::string>* files, const std::map<std::string, std::string>& generatedIncludes)
+{
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.SetIncluder(std::make_unique<ShaderIncluder>(files, generatedIncludes));
+    return options;
+}
+
+static std::vector<std::filesystem::file_time_type> writeTimes(const std::vector<std::string>& files)
+{
+    //a file that cannot be read, while an editor replaces it, gets the minimum time and is compared again at the next check
+    std::vector<std::filesystem::file_time_type> times;
+    for(const auto& file : files)
+    {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(file, error);
+        times.push_back(error ? std::filesystem::file_time_type::min() : time);
+    }
+    return times;
+}
+
+PixelShaderCompiler::~PixelShaderCompiler() {
+    stopWatching();
+}
+
+void PixelShaderCompiler::init(PixBackend* backend) {
+    m_backend = backend;
+
+    stopWatching();
+    m_stop = false;
+    m_thread = std::thread(&PixelShaderCompiler::watchLoop, this);
+}
+
+void PixelShaderCompiler::stopWatching() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    if(m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void PixelShaderCompiler::cleanUp() {
+    stopWatching();
+
+    //the pipelines built but never swapped in, and the ones still waiting for the frames in flight
+    for(const auto& reload : m_reloads)
+    {
+        vkDestroyPipeline(m_backend->logicalDevice, reload.pipeline, nullptr);
+    }
+    for(const auto& retired : m_retiredPipelines)
+    {
+        vkDestroyPipeline(m_backend->logicalDevice, retired.pipeline, nullptr);
+    }
+    m_reloads.clear();
+    m_retiredPipelines.clear();
+    m_shaders.clear();
+    m_newWatches.clear();
+    m_changedIncludes.clear();
+}
+
+std::string PixelShaderCompiler::preprocess(const std::string& filename, std::vector<std::string>* files) {
+
+    std::string sourcePath = SHADER_SOURCE_DIRECTORY + filename;
+    std::ifstream file(sourcePath, std::ios::binary);
+    if(!file.is_open())
+    {
+        throw std::runtime_error("failed to open the following file: " + sourcePath);
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if(files != nullptr)
+    {
+        files->push_back(sourcePath);
+    }
+
+    std::map<std::string, std::string> generatedIncludes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        generatedIncludes = m_generatedIncludes;
+    }
+
+    shaderc::Compiler compiler;
+    shaderc::PreprocessedSourceCompilationResult result = compiler.PreprocessGlsl(source.data(), source.size(), shaderKind(filename),
+                                                                                  filename.c_str(), compileOptions(files, generatedIncludes));
+    if(result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        throw std::runtime_error(result.GetErrorMessage());
+    }
+    return std::string(result.cbegin(), result.cend());
+}
+
+std::vector<uint32_t> PixelShaderCompiler::compile(const std::string& filename) {
+    return compile(filename, nullptr);
+}
+
+std::vector<uint32_t> PixelShaderCompiler::compile(const std::string& filename, std::vector<std::string>* files) {
+
+    //the preprocessed source has every include expanded, its hash changes with any of the files the shader is made of
+    std::string preprocessed = preprocess(filename, files);
+    shaderc_shader_kind kind = shaderKind(filename);
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for(char c : preprocessed)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * FNV_PRIME;
+    }
+    hash = (hash ^ static_cast<uint64_t>(kind)) * FNV_PRIME;
+    hash = (hash ^ SHADER_CACHE_VERSION) * FNV_PRIME;
+
+    char hashName[17];
+    std::snprintf(hashName, sizeof(hashName), "%016llx", static_cast<unsigned long long>(hash));
+    std::string cachePath = SHADER_CACHE_DIRECTORY + hashName + ".spv";
+
+    std::ifstream cached(cachePath, std::ios::binary | std::ios::ate);
+    if(cached.is_open() && cached.tellg() > 0 && cached.tellg() % sizeof(uint32_t) == 0)
+    {
+        std::vector<uint32_t> spirv(static_cast<size_t>(cached.tellg()) / sizeof(uint32_t));
+        cached.seekg(0);
+        cached.read(reinterpret_cast<char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+        if(cached)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.cacheHits++;
+            return spirv;
+        }
+    }
+
+    //the preprocessed source is what was hashed, a file saved in the meantime cannot end up in the cache under this hash.
+    //its line directives keep the messages pointing at the file and line of the error
+    double compileStart = glfwGetTime();
+    shaderc::Compiler compiler;
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(preprocessed.data(), preprocessed.size(), kind, filename.c_str(), "main",
+                                                                     compileOptions(nullptr, {}));
+    if(result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        throw std::runtime_error(result.GetErrorMessage());
+    }
+    std::vector<uint32_t> spirv(result.cbegin(), result.cend());
+
+    //a cache that cannot be written only costs a compile at the next start
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+    if(out.is_open())
+    {
+        out.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.compiled++;
+    m_stats.lastCompileMs = static_cast<float>((glfwGetTime() - compileStart) * 1000.0);
+    return spirv;
+}
+
+VkShaderModule PixelShaderCompiler::createShaderModule(const std::string& filename) {
+    return createShaderModule(compile(filename));
+}
+
+VkShaderModule PixelShaderCompiler::createShaderModule(const std::vector<uint32_t>& spirv) {
+
+    VkShaderModuleCreateInfo shaderCreateInfo = {};
+    shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderCreateInfo.codeSize = spirv.size() * sizeof(uint32_t);
+    shaderCreateInfo.pCode = spirv.data();
+
+    VkShaderModule shaderModule;
+    VkResult result = vkCreateShaderModule(m_backend->logicalDevice, &shaderCreateInfo, nullptr, &shaderModule);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create a shader module");
+    }
+
+    return shaderModule;
+}
+
+VkPipeline PixelShaderCompiler::createComputePipeline(VkPipelineLayout layout, const std::vector<uint32_t>& spirv) {
+
+    VkShaderModule shaderModule = createShaderModule(spirv);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = layout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(m_backend->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+
+    //we no longer need it once the pipeline has been created
+    vkDestroyShaderModule(m_backend->logicalDevice, shaderModule, nullptr);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create a compute pipeline");
+    }
+    return pipeline;
+}
+
+void PixelShaderCompiler::watch(const Watch& watch) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_newWatches.push_back(watch);
+}
+
+bool PixelShaderCompiler::hasPendingReloads() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_reloads.empty();
+}
+
+bool PixelShaderCompiler::applyReloads() {
+
+    std::vector<Reload> reloads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        reloads.swap(m_reloads);
+        m_stats.reloads += static_cast<uint32_t>(reloads.size());
+    }
+
+    //the frames in flight were recorded with the old pipelines, they are destroyed once those frames are done
+    for(const auto& reload : reloads)
+    {
+        m_retiredPipelines.push_back({reload.swap(reload.pipeline), m_frameCount});
+    }
+    m_frameCount++;
+
+    auto expired = std::remove_if(m_retiredPipelines.begin(), m_retiredPipelines.end(), [this](const RetiredPipeline& retired){
+        if(m_frameCount - retired.frame < SHADER_RETIRE_FRAMES)
+        {
+            return false;
+        }
+        vkDestroyPipeline(m_backend->logicalDevice, retired.pipeline, nullptr);
+        return true;
+    });
+    m_retiredPipelines.erase(expired, m_retiredPipelines.end());
+
+    return !reloads.empty();
+}
+
+void PixelShaderCompiler::setGeneratedInclude(const std::string& name, const std::string& source) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto generated = m_generatedIncludes.find(name);
+        std::string current = generated != m_generatedIncludes.end() ? generated->second : "";
+        if(source == current)
+        {
+            return;
+        }
+
+        if(source.empty())
+        {
+            m_generatedIncludes.erase(name);
+        }
+        else
+        {
+            m_generatedIncludes[name] = source;
+        }
+        m_changedIncludes.push_back(name);
+    }
+    m_wake.notify_all();
+}
+
+PixelShaderCompiler::Stats PixelShaderCompiler::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PixelShaderCompiler::watchLoop() {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_wake.wait_for(lock, std::chrono::duration<double>(SHADER_WATCH_INTERVAL), [this]{return m_stop || !m_changedIncludes.empty();});
+        if(m_stop)
+        {
+            break;
+        }
+        std::vector<Watch> newWatches;
+        std::vector<std::string> changedIncludes;
+        newWatches.swap(m_newWatches);
+        changedIncludes.swap(m_changedIncludes);
+        lock.unlock();
+
+        for(auto& shader : m_shaders)
+        {
+            bool includeChanged = std::any_of(changedIncludes.begin(), changedIncludes.end(), [&shader](const std::string& name){
+                return std::find(shader.files.begin(), shader.files.end(), SHADER_SOURCE_DIRECTORY + name) != shader.files.end();
+            });
+            if(includeChanged || (m_hotReload && writeTimes(shader.files) != shader.writeTimes))
+            {
+                rebuild(shader);
+            }
+        }
+
+        //the files of a new shader are the ones its pipeline was just built from, a change after this is picked up at the next check
+        for(const auto& watch : newWatches)
+        {
+            WatchedShader shader{watch, {}, {}};
+            try
+            {
+                preprocess(watch.filename, &shader.files);
+            }
+            catch(const std::runtime_error&)
+            {
+                shader.files = {SHADER_SOURCE_DIRECTORY + watch.filename};
+            }
+            shader.writeTimes = writeTimes(shader.files);
+            m_shaders.push_back(shader);
+        }
+
+        lock.lock();
+    }
+}
+
+void PixelShaderCompiler::rebuild(WatchedShader& shader) {
+
+    //the times are taken before the compile, a file saved again while it runs is compiled at the next check
+    shader.writeTimes = writeTimes(shader.files);
+
+    try
+    {
+        std::vector<std::string> files;
+        std::vector<uint32_t> spirv = compile(shader.watch.filename, &files);
+        VkPipeline pipeline = shader.watch.build(spirv);
+
+        //an include may have been added or removed
+        if(files != shader.files)
+        {
+            shader.files = files;
+            shader.writeTimes = writeTimes(files);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reloads.push_back({shader.watch.swap, pipeline});
+        m_stats.lastError.clear();
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cout<<"could not reload "<<shader.watch.filename<<", the old pipeline is kept:\n"<<e.what()<<std::endl;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.failures++;
+        m_stats.lastError = shader.watch.filename + ": " + e.what();
+    }
+
+    //the render loop sleeps while the image has converged
+    glfwPostEmptyEvent();
+}
@@ -0,0 +1,122 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELSHADERCOMPILER_H
+#define PIXELENGINE_PIXELSHADERCOMPILER_H
+
+#include "Utility.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const std::string SHADER_SOURCE_DIRECTORY = "shaders/";
+const std::string SHADER_CACHE_DIRECTORY = "shaders/cache/";
+const uint32_t SHADER_CACHE_VERSION = 1; //mixed into the hash, bumped when the compile options change
+const double SHADER_WATCH_INTERVAL = 0.25; //seconds between two checks of the watched sources
+const uint32_t SHADER_RETIRE_FRAMES = 4; //frames a replaced pipeline waits before it is destroyed, so no frame in flight still uses it
+
+//compiles the glsl sources of the shaders to SPIR-V at runtime with shaderc. the SPIR-V is cached on disk under the hash of the
+//preprocessed source, the includes resolved, so a shader that did not change is loaded without being compiled again.
+//the watched shaders are checked by a thread of their own. when one of their files is saved they are compiled and their new pipeline
+//is created on that thread, the render thread only swaps it in between two frames. a shader that fails to compile keeps its old pipeline
+class PixelShaderCompiler {
+public:
+    PixelShaderCompiler() = default;
+    PixelShaderCompiler(const PixelShaderCompiler&) = delete;
+    PixelShaderCompiler& operator=(const PixelShaderCompiler&) = delete;
+    ~PixelShaderCompiler();
+
+    //a shader rebuilt when its source or one of its includes changes. build creates the pipeline from the new SPIR-V on the watcher
+    //thread and may throw, swap installs it on the render thread and returns the pipeline it replaced. a graphics pipeline has one
+    //watch per stage, its build compiles the other stage itself
+    struct Watch{
+        std::string filename; //in SHADER_SOURCE_DIRECTORY
+        std::function<VkPipeline(const std::vector<uint32_t>& spirv)> build;
+        std::function<VkPipeline(VkPipeline pipeline)> swap;
+    };
+
+    struct Stats{
+        uint32_t compiled = 0;
+        uint32_t cacheHits = 0;
+        uint32_t reloads = 0; //pipelines swapped in
+        uint32_t failures = 0; //reloads that kept the old pipeline
+        float lastCompileMs = 0.0f; //the last shader that was not in the cache
+        std::string lastError; //empty once the shader that failed compiles again
+    };
+
+    void init(PixBackend* backend); //starts the watcher thread
+    void cleanUp(); //the device has to be idle
+
+    //throw with the compiler messages when the source does not compile
+    std::vector<uint32_t> compile(const std::string& filename);
+    VkShaderModule createShaderModule(const std::string& filename);
+    VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv); //from any thread
+    VkPipeline createComputePipeline(VkPipelineLayout layout, const std::vector<uint32_t>& spirv); //from any thread
+
+    void watch(const Watch& watch); //after the first pipeline of the shader was created
+    bool hasPendingReloads();
+    bool applyReloads(); //once per frame, before any command is recorded. true when a pipeline was replaced
+
+    //an include that resolves to this source instead of the file of the same name, until it is given an empty source. the watched
+    //shaders that include it are rebuilt in the background, even with the hot reload off
+    void setGeneratedInclude(const std::string& name, const std::string& source);
+
+    //getters
+    bool isHotReloading(){return m_hotReload;}
+    Stats getStats();
+
+    //setters
+    void setHotReload(bool hotReload){m_hotReload = hotReload;}
+
+private:
+
+    struct WatchedShader{
+        Watch watch;
+        std::vector<std::string> files; //the source and its includes, as of the last compile
+        std::vector<std::filesystem::file_time_type> writeTimes;
+    };
+
+    struct Reload{
+        std::function<VkPipeline(VkPipeline pipeline)> swap;
+        VkPipeline pipeline;
+    };
+
+    struct RetiredPipeline{
+        VkPipeline pipeline;
+        uint64_t frame; //the applyReloads it was replaced in
+    };
+
+    std::string preprocess(const std::string& filename, std::vector<std::string>* files); //the includes expanded, files gets the ones it read
+    std::vector<uint32_t> compile(const std::string& filename, std::vector<std::string>* files);
+    void stopWatching();
+    void watchLoop();
+    void rebuild(WatchedShader& shader);
+
+    PixBackend* m_backend{};
+    std::atomic<bool> m_hotReload{true}; //read by the watcher thread
+    Stats m_stats;
+    uint64_t m_frameCount = 0;
+
+    //the watched shaders belong to the watcher thread, the new watches and the reloads are handed over under the mutex
+    std::vector<WatchedShader> m_shaders;
+    std::vector<Watch> m_newWatches;
+    std::vector<Reload> m_reloads;
+    std::vector<RetiredPipeline> m_retiredPipelines; //render thread only
+    std::map<std::string, std::string> m_generatedIncludes; //by include name
+    std::vector<std::string> m_changedIncludes; //since the last check of the watcher thread
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+
+#endif //PIXELENGINE_PIXELSHADERCOMPILER_H
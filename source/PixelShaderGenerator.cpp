@@ -0,0 +1,60 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelShaderGenerator.h"
+
+#include <cmath>
+#include <cstdio>
+
+bool PixelShaderGenerator::canSpecialize(const PixelComputePipeline::RaytracedScene& scene) {
+    return scene.spheres.size() + scene.planes.size() <= SCENE_SPECIALIZE_MAX_PRIMITIVES;
+}
+
+std::string PixelShaderGenerator::glslFloat(float value) {
+    if(!std::isfinite(value))
+    {
+        throw std::runtime_error("a primitive of the scene has a value that is not finite");
+    }
+
+    //nine digits give back the same float, a value without a point or an exponent would be read as an int
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    std::string result = text;
+    if(result.find_first_of(".e") == std::string::npos)
+    {
+        result += ".0";
+    }
+    return result;
+}
+
+std::string PixelShaderGenerator::glslVec3(const glm::vec3& value) {
+    return "vec3(" + glslFloat(value.x) + ", " + glslFloat(value.y) + ", " + glslFloat(value.z) + ")";
+}
+
+std::string PixelShaderGenerator::generateScene(const PixelComputePipeline::RaytracedScene& scene) {
+
+    std::string source = "//generated by PixelShaderGenerator for " + std::to_string(scene.spheres.size()) + " spheres and " +
+                         std::to_string(scene.planes.size()) + " planes, in place of the data driven scene.glsl\n\n";
+
+    //same order as the loops of scene.glsl, so the closest hit is the same one when two are at the same distance
+    source += "HitData traceSpheres(Ray ray)\n{\n    HitData closest = noHit();\n";
+    for(const auto& sphere : scene.spheres)
+    {
+        source += "    closest = minHit(closest, hit(ray, Sphere(" + glslVec3(sphere.center) + ", " + glslFloat(sphere.radius) + ", " +
+                  glslFloat(sphere.metalFactor) + ", " + glslVec3(sphere.color) + ", " + std::to_string(sphere.objectId) + "u)));\n";
+    }
+    source += "    return closest;\n}\n\n";
+
+    source += "HitData tracePlanes(Ray ray)\n{\n    HitData closest = noHit();\n";
+    for(const auto& plane : scene.planes)
+    {
+        source += "    closest = minHit(closest, hit(ray, Checkerboard(" + glslVec3(plane.origin) + ", " + glslVec3(plane.normal) + ", " +
+                  glslVec3(plane.color1) + ", " + glslVec3(plane.color2) + ", " + glslFloat(plane.metalFactor) + ", " +
+                  std::to_string(plane.objectId) + "u)));\n";
+    }
+    source += "    return closest;\n}\n\n";
+
+    source += "HitData traceScene(Ray ray)\n{\n    return minHit(traceSpheres(ray), tracePlanes(ray));\n}\n";
+    return source;
+}
@@ -0,0 +1,30 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELSHADERGENERATOR_H
+#define PIXELENGINE_PIXELSHADERGENERATOR_H
+
+#include "PixelComputePipeline.h"
+
+#include <string>
+
+const std::string SCENE_INCLUDE = "scene.glsl"; //included by shader.comp and pick.comp
+const uint32_t SCENE_SPECIALIZE_MAX_PRIMITIVES = 16; //above it the straight-line kernel grows faster than it saves, the loop is kept
+
+//writes the scene.glsl of one scene. it has the functions of the data driven file on disk, with the primitives spelled as constants
+//and one test per primitive instead of a loop over the scene buffer. once the hit functions are inlined the compiler folds what
+//only depends on the primitive, and the kernel has no buffer loads and no loop left
+class PixelShaderGenerator {
+public:
+
+    static bool canSpecialize(const PixelComputePipeline::RaytracedScene& scene);
+    static std::string generateScene(const PixelComputePipeline::RaytracedScene& scene); //throws for a value glsl cannot spell
+
+private:
+    static std::string glslFloat(float value);
+    static std::string glslVec3(const glm::vec3& value);
+};
+
+
+#endif //PIXELENGINE_PIXELSHADERGENERATOR_H
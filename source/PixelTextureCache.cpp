@@ -0,0 +1,111 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelTextureCache.h"
+
+#include <fstream>
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+PixelTextureCache::PixelTextureCache(PixBackend* device) : m_device(device) {
+
+}
+
+//fnv-1a over the bytes of the file. the flags are hashed with them, the same file is encoded differently as a normal map
+//and a texture that is not streamed cannot share the image of one that is
+bool PixelTextureCache::hashFile(const std::string& fileLocation, bool normalMap, bool streamed, uint64_t* contentHash)
+{
+    std::ifstream file(fileLocation, std::ios::binary);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    std::vector<char> chunk(1 << 16);
+    while(file)
+    {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        for(std::streamsize i = 0; i < file.gcount(); i++)
+        {
+            hash = (hash ^ static_cast<uint8_t>(chunk[i])) * FNV_PRIME;
+        }
+    }
+    hash = (hash ^ (normalMap ? 1u : 0u) ^ (streamed ? 2u : 0u)) * FNV_PRIME;
+
+    *contentHash = hash;
+    return true;
+}
+
+TextureHandle PixelTextureCache::acquire(const std::string& filename, bool normalMap, bool streamed) {
+
+    std::string pathKey = filename + (normalMap ? ":normal" : "") + (streamed ? "" : ":resident");
+    auto byPath = m_byPath.find(pathKey);
+    if(byPath != m_byPath.end())
+    {
+        m_hits++;
+        return m_textures[byPath->second];
+    }
+
+    //a file that cannot be read is reported by loadTexture, with the same error as before
+    uint64_t contentHash = 0;
+    if(hashFile("Textures/" + filename, normalMap, streamed, &contentHash))
+    {
+        auto byContent = m_byContent.find(contentHash);
+        if(byContent != m_byContent.end())
+        {
+            m_hits++;
+            m_byPath[pathKey] = byContent->second;
+            return m_textures[byContent->second];
+        }
+    }
+
+    TextureHandle texture = std::make_shared<PixelImage>(m_device, 0, 0, false);
+    texture->setName(filename);
+    texture->loadTexture(filename, normalMap, streamed);
+
+    m_byPath[pathKey] = m_textures.size();
+    m_byContent[contentHash] = m_textures.size();
+    m_textures.push_back(texture);
+    return texture;
+}
+
+TextureHandle PixelTextureCache::acquirePacked(const std::string& redFilename, const std::string& greenFilename, bool streamed) {
+
+    std::string pathKey = redFilename + "+" + greenFilename + ":packed" + (streamed ? "" : ":resident");
+    auto byPath = m_byPath.find(pathKey);
+    if(byPath != m_byPath.end())
+    {
+        m_hits++;
+        return m_textures[byPath->second];
+    }
+
+    TextureHandle texture = std::make_shared<PixelImage>(m_device, 0, 0, false);
+    texture->setName(redFilename + "+" + greenFilename);
+    texture->loadPackedTexture(redFilename, greenFilename, streamed);
+
+    m_byPath[pathKey] = m_textures.size();
+    m_textures.push_back(texture);
+    return texture;
+}
+
+void PixelTextureCache::cleanUp() {
+    for(auto& texture : m_textures)
+    {
+        texture->cleanUp();
+    }
+    m_byPath.clear();
+    m_byContent.clear();
+    m_textures.clear();
+}
+
+uint32_t PixelTextureCache::getReferenceCount() const {
+    uint32_t references = 0;
+    for(const auto& texture : m_textures)
+    {
+        references += static_cast<uint32_t>(texture.use_count() - 1);
+    }
+    return references;
+}
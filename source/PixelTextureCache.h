@@ -0,0 +1,47 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELTEXTURECACHE_H
+#define PIXELENGINE_PIXELTEXTURECACHE_H
+
+#include "PixelImage.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+//what the objects hold instead of a copy of the image. a texture is shared by every object that uses it
+using TextureHandle = std::shared_ptr<PixelImage>;
+
+//the textures loaded from files, decoded and uploaded once however many objects use them. a texture is found by its path first,
+//then by the hash of the content of its file, so two copies of the same file share it as well.
+//the cache holds a reference to every texture it loaded and destroys them in cleanUp, once the objects have dropped theirs
+class PixelTextureCache {
+public:
+    explicit PixelTextureCache(PixBackend* device);
+    PixelTextureCache() = default;
+
+    TextureHandle acquire(const std::string& filename, bool normalMap = false, bool streamed = true);
+    TextureHandle acquirePacked(const std::string& redFilename, const std::string& greenFilename, bool streamed = true); //found by the paths only
+    void cleanUp(); //the device has to be idle
+
+    //getters
+    uint32_t getTextureCount() const {return static_cast<uint32_t>(m_textures.size());}
+    uint32_t getHitCount() const {return m_hits;} //acquires that found the texture already loaded
+    uint32_t getReferenceCount() const; //handles held by the objects
+
+private:
+
+    static bool hashFile(const std::string& fileLocation, bool normalMap, bool streamed, uint64_t* contentHash);
+
+    std::vector<TextureHandle> m_textures; //the only reference the cache holds, in the order they were loaded
+    std::unordered_map<std::string, size_t> m_byPath; //the path with the normal map and streamed flags, into m_textures
+    std::unordered_map<uint64_t, size_t> m_byContent;
+    uint32_t m_hits = 0;
+
+    PixBackend* m_device{};
+};
+
+
+#endif //PIXELENGINE_PIXELTEXTURECACHE_H
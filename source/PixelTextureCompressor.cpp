@@ -0,0 +1,765 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelTextureCompressor.h"
+#include "PixelJobSystem.h"
+
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+
+const uint32_t BLOCK_TEXELS = BC_BLOCK_DIM * BC_BLOCK_DIM;
+const uint32_t PRINCIPAL_AXIS_ITERATIONS = 8;
+const std::string TEXTURE_CACHE_STAMP_KEY = "pxSourceStamp";
+
+//KTX2 file layout, the header and index sections are fixed size
+const std::array<uint8_t, 12> KTX2_IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+const size_t KTX2_LEVEL_INDEX_OFFSET = 80;
+const size_t KTX2_LEVEL_INDEX_ENTRY = 24; //byte offset, byte length and uncompressed byte length, as 64 bit values
+const size_t KTX2_LEVEL_ALIGNMENT = 16;
+
+//weights of the 16 colors of a bc7 mode 6 palette, out of 64
+const std::array<uint32_t, 16> BC7_WEIGHTS = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+//writes the bits of a block from the least significant bit of the first byte on
+struct BlockBitWriter{
+    uint8_t* output;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t bitCount)
+    {
+        for(uint32_t i = 0; i < bitCount; i++, position++)
+        {
+            output[position / 8] |= static_cast<uint8_t>(((value >> i) & 1u) << (position % 8));
+        }
+    }
+};
+
+template<typename T>
+static void appendValue(std::vector<uint8_t>& bytes, T value)
+{
+    size_t offset = bytes.size();
+    bytes.resize(offset + sizeof(T));
+    memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+static bool readValue(const std::vector<uint8_t>& bytes, size_t offset, T* value)
+{
+    if(offset + sizeof(T) > bytes.size())
+    {
+        return false;
+    }
+    memcpy(value, bytes.data() + offset, sizeof(T));
+    return true;
+}
+
+//the principal axis of the texels, by power iteration on their covariance, and the extremes of their projection on it
+static void fitEndpoints(const float texels[BLOCK_TEXELS][4], uint32_t channels, float low[4], float high[4])
+{
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float minimum[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+    float maximum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        for(uint32_t c = 0; c < channels; c++)
+        {
+            mean[c] += texels[i][c] / BLOCK_TEXELS;
+            minimum[c] = std::min(minimum[c], texels[i][c]);
+            maximum[c] = std::max(maximum[c], texels[i][c]);
+        }
+    }
+
+    float covariance[4][4] = {};
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        for(uint32_t a = 0; a < channels; a++)
+        {
+            for(uint32_t b = 0; b < channels; b++)
+            {
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+    }
+
+    //the diagonal of the bounding box is close to the axis for most blocks, the iterations converge fast from it
+    float axis[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for(uint32_t c = 0; c < channels; c++)
+    {
+        axis[c] = maximum[c] - minimum[c];
+    }
+
+    for(uint32_t iteration = 0; iteration < PRINCIPAL_AXIS_ITERATIONS; iteration++)
+    {
+        float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float length = 0.0f;
+        for(uint32_t a = 0; a < channels; a++)
+        {
+            for(uint32_t b = 0; b < channels; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+
+        if(length <= 0.0f)
+        {
+            break; //a block of a single color, or the axis is already exact
+        }
+
+        for(uint32_t c = 0; c < channels; c++)
+        {
+            axis[c] = next[c] / std::sqrt(length);
+        }
+    }
+
+    float lowest = 0.0f;
+    float highest = 0.0f;
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        float projection = 0.0f;
+        for(uint32_t c = 0; c < channels; c++)
+        {
+            projection += (texels[i][c] - mean[c]) * axis[c];
+        }
+        lowest = std::min(lowest, projection);
+        highest = std::max(highest, projection);
+    }
+
+    for(uint32_t c = 0; c < channels; c++)
+    {
+        low[c] = std::clamp(mean[c] + axis[c] * lowest, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * highest, 0.0f, 255.0f);
+    }
+}
+
+//the palette entry closest to every texel
+template<uint32_t PaletteSize>
+static void fitIndices(const float texels[BLOCK_TEXELS][4], uint32_t channels, const float palette[PaletteSize][4], uint32_t indices[BLOCK_TEXELS])
+{
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        float bestDistance = std::numeric_limits<float>::max();
+        for(uint32_t p = 0; p < PaletteSize; p++)
+        {
+            float distance = 0.0f;
+            for(uint32_t c = 0; c < channels; c++)
+            {
+                float difference = texels[i][c] - palette[p][c];
+                distance += difference * difference;
+            }
+            if(distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[i] = p;
+            }
+        }
+    }
+}
+
+static void loadBlock(const uint8_t* block, float texels[BLOCK_TEXELS][4])
+{
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            texels[i][c] = block[i * 4 + c];
+        }
+    }
+}
+
+static uint16_t packRGB565(const float color[4])
+{
+    uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+    uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+    uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, float color[4])
+{
+    uint32_t r = (packed >> 11) & 31u;
+    uint32_t g = (packed >> 5) & 63u;
+    uint32_t b = packed & 31u;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+    color[3] = 255.0f;
+}
+
+VkFormat PixelTextureCompressor::chooseFormat(VkPhysicalDevice physicalDevice, bool hasAlpha, bool normalMap) {
+
+    if(normalMap && isSupported(physicalDevice, VK_FORMAT_BC5_UNORM_BLOCK))
+    {
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+
+    if(isSupported(physicalDevice, VK_FORMAT_BC7_UNORM_BLOCK))
+    {
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+
+    //565 endpoints band the normals too much, they stay uncompressed
+    if(normalMap)
+    {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    VkFormat format = hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    return isSupported(physicalDevice, format) ? format : VK_FORMAT_UNDEFINED;
+}
+
+bool PixelTextureCompressor::isSupported(VkPhysicalDevice physicalDevice, VkFormat format) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+
+    VkFormatFeatureFlags textureFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (formatProperties.optimalTilingFeatures & textureFeatures) == textureFeatures;
+}
+
+uint32_t PixelTextureCompressor::getBlockBytes(VkFormat format) {
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+VkDeviceSize PixelTextureCompressor::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+    VkDeviceSize blocksX = (width + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+    VkDeviceSize blocksY = (height + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+    return blocksX * blocksY * getBlockBytes(format);
+}
+
+uint32_t PixelTextureCompressor::getLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for(uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+bool PixelTextureCompressor::hasAlpha(const uint8_t* texels, size_t texelCount) {
+    for(size_t i = 0; i < texelCount; i++)
+    {
+        if(texels[i * 4 + 3] != 255)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PixelTextureCompressor::encodeBC1(const uint8_t* block, uint8_t* output) {
+
+    float texels[BLOCK_TEXELS][4];
+    loadBlock(block, texels);
+
+    float low[4];
+    float high[4];
+    fitEndpoints(texels, 3, low, high);
+
+    //the first endpoint has to be the larger one, a block with the smaller one first is decoded with 3 colors and black
+    uint16_t color0 = packRGB565(high);
+    uint16_t color1 = packRGB565(low);
+    if(color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    float palette[4][4];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    uint32_t indices[BLOCK_TEXELS] = {};
+    if(color0 != color1)
+    {
+        fitIndices<4>(texels, 3, palette, indices);
+    }
+
+    uint32_t packedIndices = 0;
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        packedIndices |= indices[i] << (2 * i);
+    }
+
+    memcpy(output, &color0, sizeof(color0));
+    memcpy(output + 2, &color1, sizeof(color1));
+    memcpy(output + 4, &packedIndices, sizeof(packedIndices));
+}
+
+void PixelTextureCompressor::encodeBC4(const uint8_t* block, uint32_t channel, uint8_t* output) {
+
+    float texels[BLOCK_TEXELS][4];
+    uint8_t minimum = 255;
+    uint8_t maximum = 0;
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        texels[i][0] = block[i * 4 + channel];
+        minimum = std::min(minimum, block[i * 4 + channel]);
+        maximum = std::max(maximum, block[i * 4 + channel]);
+    }
+
+    //the larger endpoint first selects the mode with 6 interpolated values
+    float palette[8][4] = {};
+    palette[0][0] = maximum;
+    palette[1][0] = minimum;
+    for(uint32_t i = 1; i < 7; i++)
+    {
+        palette[i + 1][0] = (static_cast<float>(7 - i) * maximum + static_cast<float>(i) * minimum) / 7.0f;
+    }
+
+    uint32_t indices[BLOCK_TEXELS] = {};
+    if(maximum != minimum)
+    {
+        fitIndices<8>(texels, 1, palette, indices);
+    }
+
+    uint64_t packedIndices = 0;
+    for(uint32_t i = 0; i < BLOCK_TEXELS; i++)
+    {
+        packedIndices |= static_cast<uint64_t>(indices[i]) << (3 * i);
+    }
+
+    output[0] = maximum;
+    output[1] = minimum;
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        output[2 + i] = static_cast<uint8_t>(packedIndices >> (8 * i));
+    }
+}
+
+void PixelTextureCompressor::encodeBC3(const uint8_t* block, uint8_t* output) {
+    encodeBC4(block, 3, output);
+    encodeBC1(block, output + 8); //bc3 always decodes its color block with 4 colors
+}
+
+void PixelTextureCompressor::encodeBC5(const uint8_t* block, uint8_t* output) {
+    encodeBC4(block, 0, output);
+    encodeBC4(block, 1, output + 8);
+}
+
+void PixelTextureCompressor::encodeBC7(const uint8_t* block, uint8_t* output) {
+
+    float texels[BLOCK_TEXELS][4];
+    loadBlock(block, texels);
+
+    std::array<float[4], 2> endpoints{};
+    fitEndpoints(texels, 4, endpoints[0], endpoints[1]);
+
+    //mode 6 endpoints are 7 bits per channel and a p-bit shared by the channels of the endpoint, it is picked to minimize the error
+    uint32_t quantized[2][4];
+    uint32_t pBits[2];
+    float palette[16][4];
+    for(uint32_t e = 0; e < 2; e++)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for(uint32_t p = 0; p < 2; p++)
+        {
+            uint32_t candidate[4];
+            float error = 0.0f;
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                candidate[c] = static_cast<uint32_t>(std::clamp(std::lround((endpoints[e][c] - static_cast<float>(p)) / 2.0f), 0L, 127L));
+                float difference = static_cast<float>((candidate[c] << 1) | p) - endpoints[e][c];
+                error += difference * difference;
+            }
+            if(error < bestError)
+            {
+                bestError = error;
+                pBits[e] = p;
+                memcpy(quantized[e], candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            uint32_t value0 = (quantized[0][c] << 1) | pBits[0];
+            uint32_t value1 = (quantized[1][c] << 1) | pBits[1];
+            palette[i][c] = static_cast<float>(((64 - BC7_WEIGHTS[i]) * value0 + BC7_WEIGHTS[i] * value1 + 32) >> 6);
+        }
+    }
+
+    uint32_t indices[BLOCK_TEXELS];
+    fitIndices<16>(texels, 4, palette, indices);
+
+    //the most significant bit of the first index is implied to be 0, the endpoints are swapped when it is not
+    if(indices[0] >= 8)
+    {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for(uint32_t& index : indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    memset(output, 0, 16);
+    BlockBitWriter writer{output};
+    writer.write(1u << 6, 7); //mode 6
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        writer.write(quantized[0][c], 7);
+        writer.write(quantized[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for(uint32_t i = 1; i < BLOCK_TEXELS; i++)
+    {
+        writer.write(indices[i], 4);
+    }
+}
+
+void PixelTextureCompressor::encodeBlock(VkFormat format, const uint8_t* block, uint8_t* output) {
+    switch(format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            encodeBC1(block, output);
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            encodeBC3(block, output);
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            encodeBC5(block, output);
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            encodeBC7(block, output);
+            break;
+        default:
+            throw std::runtime_error("texture format cannot be encoded on the cpu");
+    }
+}
+
+PixelTextureCompressor::CompressedTexture PixelTextureCompressor::compress(const uint8_t* texels, uint32_t width, uint32_t height, VkFormat format) {
+
+    if(getBlockBytes(format) == 0)
+    {
+        throw std::runtime_error("texture format cannot be encoded on the cpu");
+    }
+
+    //the mip chain, every level is the 2x2 box filter of the one above it
+    std::vector<std::vector<uint8_t>> levels(getLevelCount(width, height));
+    std::vector<std::array<uint32_t, 2>> extents(levels.size());
+    levels[0].assign(texels, texels + static_cast<size_t>(width) * height * 4);
+    extents[0] = {width, height};
+    for(size_t level = 1; level < levels.size(); level++)
+    {
+        uint32_t srcWidth = extents[level - 1][0];
+        uint32_t srcHeight = extents[level - 1][1];
+        uint32_t levelWidth = std::max(srcWidth / 2, 1u);
+        uint32_t levelHeight = std::max(srcHeight / 2, 1u);
+        const std::vector<uint8_t>& src = levels[level - 1];
+
+        levels[level].resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+        for(uint32_t y = 0; y < levelHeight; y++)
+        {
+            for(uint32_t x = 0; x < levelWidth; x++)
+            {
+                uint32_t x0 = std::min(2 * x, srcWidth - 1);
+                uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+                uint32_t y0 = std::min(2 * y, srcHeight - 1);
+                uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] +
+                                   src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+                    levels[level][(y * levelWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        extents[level] = {levelWidth, levelHeight};
+    }
+
+    CompressedTexture texture;
+    texture.format = format;
+    texture.width = width;
+    texture.height = height;
+
+    //one job per row of blocks of every level
+    struct BlockRow{
+        uint32_t level;
+        uint32_t row;
+    };
+    std::vector<BlockRow> rows;
+    VkDeviceSize size = 0;
+    for(uint32_t level = 0; level < levels.size(); level++)
+    {
+        texture.levelOffsets.push_back(size);
+        size += getLevelSize(format, extents[level][0], extents[level][1]);
+        for(uint32_t row = 0; row < (extents[level][1] + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM; row++)
+        {
+            rows.push_back({level, row});
+        }
+    }
+    texture.data.resize(size);
+
+    uint32_t blockBytes = getBlockBytes(format);
+    PixelJobSystem jobSystem;
+    jobSystem.init(0);
+    jobSystem.parallelFor(static_cast<uint32_t>(rows.size()), [&](uint32_t, uint32_t index) {
+        const BlockRow& blockRow = rows[index];
+        const std::vector<uint8_t>& levelTexels = levels[blockRow.level];
+        uint32_t levelWidth = extents[blockRow.level][0];
+        uint32_t levelHeight = extents[blockRow.level][1];
+        uint32_t blocksX = (levelWidth + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+        uint8_t* output = texture.data.data() + texture.levelOffsets[blockRow.level] + static_cast<VkDeviceSize>(blockRow.row) * blocksX * blockBytes;
+
+        std::array<uint8_t, BLOCK_TEXELS * 4> block{};
+        for(uint32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            //the blocks on the right and bottom edges repeat the last texels
+            for(uint32_t y = 0; y < BC_BLOCK_DIM; y++)
+            {
+                uint32_t texelY = std::min(blockRow.row * BC_BLOCK_DIM + y, levelHeight - 1);
+                for(uint32_t x = 0; x < BC_BLOCK_DIM; x++)
+                {
+                    uint32_t texelX = std::min(blockX * BC_BLOCK_DIM + x, levelWidth - 1);
+                    memcpy(&block[(y * BC_BLOCK_DIM + x) * 4], &levelTexels[(static_cast<size_t>(texelY) * levelWidth + texelX) * 4], 4);
+                }
+            }
+            encodeBlock(format, block.data(), output + blockX * blockBytes);
+        }
+    });
+
+    return texture;
+}
+
+std::string PixelTextureCompressor::getCachePath(const std::string& filename, bool normalMap) {
+    return TEXTURE_CACHE_DIRECTORY + filename + (normalMap ? ".normal" : "") + ".ktx2";
+}
+
+std::string PixelTextureCompressor::getSourceStamp(const std::string& fileLocation) {
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(fileLocation, error);
+    if(error)
+    {
+        return "";
+    }
+
+    auto writeTime = std::filesystem::last_write_time(fileLocation, error);
+    if(error)
+    {
+        return "";
+    }
+
+    return std::to_string(TEXTURE_CACHE_VERSION) + ":" + std::to_string(size) + ":" + std::to_string(writeTime.time_since_epoch().count());
+}
+
+//reads the header, the level index and the key/value data, and checks them against the stamp
+static bool readCacheHeader(std::ifstream& file, const std::string& sourceStamp, PixelTextureCompressor::CompressedTexture* info, std::vector<uint64_t>* levelIndex)
+{
+    if(sourceStamp.empty() || !file.is_open())
+    {
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    std::vector<uint8_t> bytes(KTX2_LEVEL_INDEX_OFFSET);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if(!file || memcmp(bytes.data(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0)
+    {
+        return false;
+    }
+
+    uint32_t format, width, height, levelCount, kvdOffset, kvdLength, keyValueLength;
+    readValue(bytes, 12, &format);
+    readValue(bytes, 20, &width);
+    readValue(bytes, 24, &height);
+    readValue(bytes, 40, &levelCount);
+    readValue(bytes, 56, &kvdOffset);
+    readValue(bytes, 60, &kvdLength);
+
+    //a cache file is only ever written with the full chain
+    if(PixelTextureCompressor::getBlockBytes(static_cast<VkFormat>(format)) == 0 || width == 0 || height == 0 ||
+       levelCount != PixelTextureCompressor::getLevelCount(width, height) ||
+       kvdOffset != KTX2_LEVEL_INDEX_OFFSET + levelCount * KTX2_LEVEL_INDEX_ENTRY || static_cast<uint64_t>(kvdOffset) + kvdLength > fileSize)
+    {
+        return false;
+    }
+
+    bytes.resize(kvdOffset + kvdLength);
+    file.read(reinterpret_cast<char*>(bytes.data() + KTX2_LEVEL_INDEX_OFFSET), static_cast<std::streamsize>(bytes.size() - KTX2_LEVEL_INDEX_OFFSET));
+    if(!file)
+    {
+        return false;
+    }
+
+    //the only key/value pair is the stamp of the source it was encoded from
+    std::string expectedKeyValue = TEXTURE_CACHE_STAMP_KEY + '\0' + sourceStamp;
+    if(!readValue(bytes, kvdOffset, &keyValueLength) || keyValueLength != expectedKeyValue.size() || kvdLength < keyValueLength + 4 ||
+       memcmp(bytes.data() + kvdOffset + 4, expectedKeyValue.data(), expectedKeyValue.size()) != 0)
+    {
+        return false;
+    }
+
+    info->format = static_cast<VkFormat>(format);
+    info->width = width;
+    info->height = height;
+
+    //byte offset and byte length of every level, checked against what the format and the size give
+    levelIndex->clear();
+    for(uint32_t level = 0; level < levelCount; level++)
+    {
+        uint64_t byteOffset = 0;
+        uint64_t byteLength = 0;
+        size_t entry = KTX2_LEVEL_INDEX_OFFSET + level * KTX2_LEVEL_INDEX_ENTRY;
+        readValue(bytes, entry, &byteOffset);
+        readValue(bytes, entry + 8, &byteLength);
+        if(byteLength != PixelTextureCompressor::getLevelSize(info->format, std::max(width >> level, 1u), std::max(height >> level, 1u)) ||
+           byteOffset + byteLength > fileSize)
+        {
+            return false;
+        }
+        levelIndex->push_back(byteOffset);
+        levelIndex->push_back(byteLength);
+    }
+
+    return true;
+}
+
+bool PixelTextureCompressor::readCacheInfo(const std::string& cachePath, const std::string& sourceStamp, CompressedTexture* info) {
+
+    std::ifstream file(cachePath, std::ios::binary);
+    std::vector<uint64_t> levelIndex;
+    CompressedTexture cached;
+    if(!readCacheHeader(file, sourceStamp, &cached, &levelIndex))
+    {
+        return false;
+    }
+
+    *info = std::move(cached);
+    return true;
+}
+
+bool PixelTextureCompressor::readCache(const std::string& cachePath, const std::string& sourceStamp, CompressedTexture* texture, uint32_t firstLevel) {
+
+    std::ifstream file(cachePath, std::ios::binary);
+    std::vector<uint64_t> levelIndex;
+    CompressedTexture cached;
+    if(!readCacheHeader(file, sourceStamp, &cached, &levelIndex))
+    {
+        return false;
+    }
+
+    uint32_t levelCount = static_cast<uint32_t>(levelIndex.size() / 2);
+    cached.firstLevel = std::min(firstLevel, levelCount - 1);
+    for(uint32_t level = cached.firstLevel; level < levelCount; level++)
+    {
+        size_t offset = cached.data.size();
+        cached.levelOffsets.push_back(offset);
+        cached.data.resize(offset + levelIndex[level * 2 + 1]);
+
+        file.seekg(static_cast<std::streamoff>(levelIndex[level * 2]));
+        file.read(reinterpret_cast<char*>(cached.data.data() + offset), static_cast<std::streamsize>(levelIndex[level * 2 + 1]));
+        if(!file)
+        {
+            return false;
+        }
+    }
+
+    *texture = std::move(cached);
+    return true;
+}
+
+void PixelTextureCompressor::dropLevels(CompressedTexture* texture, uint32_t firstLevel) {
+
+    if(firstLevel <= texture->firstLevel || texture->levelOffsets.empty())
+    {
+        return;
+    }
+
+    uint32_t dropped = std::min(firstLevel - texture->firstLevel, static_cast<uint32_t>(texture->levelOffsets.size()) - 1);
+    if(dropped == 0)
+    {
+        return;
+    }
+
+    VkDeviceSize droppedBytes = texture->levelOffsets[dropped];
+    texture->data.erase(texture->data.begin(), texture->data.begin() + static_cast<std::ptrdiff_t>(droppedBytes));
+    texture->data.shrink_to_fit();
+    texture->levelOffsets.erase(texture->levelOffsets.begin(), texture->levelOffsets.begin() + dropped);
+    for(VkDeviceSize& offset : texture->levelOffsets)
+    {
+        offset -= droppedBytes;
+    }
+    texture->firstLevel += dropped;
+}
+
+bool PixelTextureCompressor::writeCache(const std::string& cachePath, const std::string& sourceStamp, const CompressedTexture& texture) {
+
+    //only a full chain is cached
+    if(texture.firstLevel != 0)
+    {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+    if(error)
+    {
+        return false;
+    }
+
+    uint32_t levelCount = static_cast<uint32_t>(texture.levelOffsets.size());
+    std::string keyValue = TEXTURE_CACHE_STAMP_KEY + '\0' + sourceStamp;
+    uint32_t kvdOffset = static_cast<uint32_t>(KTX2_LEVEL_INDEX_OFFSET + levelCount * KTX2_LEVEL_INDEX_ENTRY);
+    uint32_t kvdLength = static_cast<uint32_t>(4 + (keyValue.size() + 3) / 4 * 4);
+    size_t dataOffset = (kvdOffset + kvdLength + KTX2_LEVEL_ALIGNMENT - 1) / KTX2_LEVEL_ALIGNMENT * KTX2_LEVEL_ALIGNMENT;
+
+    std::vector<uint8_t> bytes(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end());
+    appendValue<uint32_t>(bytes, texture.format);
+    appendValue<uint32_t>(bytes, 1); //type size, 1 for block compressed formats
+    appendValue<uint32_t>(bytes, texture.width);
+    appendValue<uint32_t>(bytes, texture.height);
+    appendValue<uint32_t>(bytes, 0); //depth
+    appendValue<uint32_t>(bytes, 0); //layers
+    appendValue<uint32_t>(bytes, 1); //faces
+    appendValue<uint32_t>(bytes, levelCount);
+    appendValue<uint32_t>(bytes, 0); //no supercompression
+
+    appendValue<uint32_t>(bytes, 0); //no data format descriptor
+    appendValue<uint32_t>(bytes, 0);
+    appendValue<uint32_t>(bytes, kvdOffset);
+    appendValue<uint32_t>(bytes, kvdLength);
+    appendValue<uint64_t>(bytes, 0); //no supercompression global data
+    appendValue<uint64_t>(bytes, 0);
+
+    for(uint32_t level = 0; level < levelCount; level++)
+    {
+        VkDeviceSize levelEnd = level + 1 < levelCount ? texture.levelOffsets[level + 1] : texture.data.size();
+        VkDeviceSize levelLength = levelEnd - texture.levelOffsets[level];
+        appendValue<uint64_t>(bytes, dataOffset + texture.levelOffsets[level]);
+        appendValue<uint64_t>(bytes, levelLength);
+        appendValue<uint64_t>(bytes, levelLength);
+    }
+
+    appendValue<uint32_t>(bytes, static_cast<uint32_t>(keyValue.size()));
+    bytes.insert(bytes.end(), keyValue.begin(), keyValue.end());
+    bytes.resize(dataOffset, 0);
+    bytes.insert(bytes.end(), texture.data.begin(), texture.data.end());
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,66 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELTEXTURECOMPRESSOR_H
+#define PIXELENGINE_PIXELTEXTURECOMPRESSOR_H
+
+#include "Utility.h"
+
+#include <string>
+#include <vector>
+
+const uint32_t BC_BLOCK_DIM = 4; //every bc format encodes 4x4 texels per block
+const uint32_t TEXTURE_CACHE_VERSION = 1; //bumped when the encoders change, so the old cache files are encoded again
+const std::string TEXTURE_CACHE_DIRECTORY = "Textures/cache/";
+
+//encodes RGBA8 textures to the bc formats on the cpu, once per texture. the result is kept next to the textures in a KTX2 layout
+//(without the data format descriptor, the format is enough for us) so the next runs upload it without decoding the source.
+//the blocks of all the levels are spread over a job system, and every encoder works on the 16 texels of a block
+//with fixed size loops the compiler can vectorize
+class PixelTextureCompressor {
+public:
+
+    struct CompressedTexture{
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0; //of level 0, whether it is loaded or not
+        uint32_t firstLevel = 0; //the first level in data
+        std::vector<VkDeviceSize> levelOffsets; //into data, one per mip level from firstLevel down to 1x1
+        std::vector<uint8_t> data;
+    };
+
+    //bc5 for normal maps, bc7 when it is supported and bc3 or bc1 depending on the alpha otherwise.
+    //VK_FORMAT_UNDEFINED when the device samples none of them, the texture is then uploaded uncompressed
+    static VkFormat chooseFormat(VkPhysicalDevice physicalDevice, bool hasAlpha, bool normalMap);
+    static bool isSupported(VkPhysicalDevice physicalDevice, VkFormat format);
+    static uint32_t getBlockBytes(VkFormat format); //0 for a format that is not a bc format we encode
+    static VkDeviceSize getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+    static bool hasAlpha(const uint8_t* texels, size_t texelCount);
+    static uint32_t getLevelCount(uint32_t width, uint32_t height); //down to 1x1
+
+    //builds the mip chain of the RGBA8 texels with a box filter and encodes every level
+    static CompressedTexture compress(const uint8_t* texels, uint32_t width, uint32_t height, VkFormat format);
+    static void dropLevels(CompressedTexture* texture, uint32_t firstLevel); //frees the levels before firstLevel, the last one is always kept
+
+    //cache. the stamp identifies the source file, a cache file whose stamp differs is stale.
+    //only the levels from firstLevel on are read, so a streamed texture never loads the levels it does not need
+    static std::string getCachePath(const std::string& filename, bool normalMap);
+    static std::string getSourceStamp(const std::string& fileLocation); //empty when the source does not exist
+    static bool readCacheInfo(const std::string& cachePath, const std::string& sourceStamp, CompressedTexture* info); //format and size, no data
+    static bool readCache(const std::string& cachePath, const std::string& sourceStamp, CompressedTexture* texture, uint32_t firstLevel = 0);
+    static bool writeCache(const std::string& cachePath, const std::string& sourceStamp, const CompressedTexture& texture);
+
+    //block encoders. a block is 16 RGBA8 texels in rows of 4
+    static void encodeBC1(const uint8_t* block, uint8_t* output); //8 bytes, opaque
+    static void encodeBC3(const uint8_t* block, uint8_t* output); //16 bytes, bc1 color and bc4 alpha
+    static void encodeBC5(const uint8_t* block, uint8_t* output); //16 bytes, bc4 red and bc4 green
+    static void encodeBC7(const uint8_t* block, uint8_t* output); //16 bytes, mode 6
+
+private:
+    static void encodeBC4(const uint8_t* block, uint32_t channel, uint8_t* output); //8 bytes, one channel
+    static void encodeBlock(VkFormat format, const uint8_t* block, uint8_t* output);
+};
+
+
+#endif //PIXELENGINE_PIXELTEXTURECOMPRESSOR_H
@@ -0,0 +1,179 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelTextureRegistry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PixelTextureRegistry::PixelTextureRegistry(VkDevice device, VkPhysicalDevice physicalDevice, VkShaderStageFlags stages): m_stages(stages), m_device(device), m_physicalDevice(physicalDevice) {
+
+}
+
+void PixelTextureRegistry::createDescriptorSetLayout() {
+
+    //the array is as large as the device allows for samplers updated after bind, up to MAX_BINDLESS_TEXTURES
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+
+    m_capacity = std::min({MAX_BINDLESS_TEXTURES,
+                           vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                           vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                           vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+                           vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages});
+    m_views.assign(m_capacity, VK_NULL_HANDLE);
+
+    VkDescriptorSetLayoutBinding textureSamplerLayoutBinding{};
+    textureSamplerLayoutBinding.binding = 0; //binding point in shader
+    textureSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textureSamplerLayoutBinding.descriptorCount = m_capacity;
+    textureSamplerLayoutBinding.stageFlags = m_stages;
+    textureSamplerLayoutBinding.pImmutableSamplers = nullptr;
+
+    //slots may be left unwritten, and written while the set is bound in recorded command buffers, as long as those do not sample them
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.pNext = &bindingFlagsInfo;
+    layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutCreateInfo.bindingCount = 1;
+    layoutCreateInfo.pBindings = &textureSamplerLayoutBinding;
+
+    VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_descriptorSetLayout);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor set layout for textures");
+    }
+}
+
+void PixelTextureRegistry::init(VkSampler sampler, PixelImage* fallbackTexture) {
+    m_sampler = sampler;
+    m_fallbackTexture = fallbackTexture;
+
+    //its own pool, the sets of an update after bind layout can only come from a pool created for them
+    VkDescriptorPoolSize samplerPoolSize{};
+    samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerPoolSize.descriptorCount = m_capacity;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolCreateInfo.maxSets = 1;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &samplerPoolSize;
+
+    VkResult result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool for textures");
+    }
+
+    VkDescriptorSetAllocateInfo setAllocateInfo{};
+    setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocateInfo.descriptorPool = m_descriptorPool;
+    setAllocateInfo.descriptorSetCount = 1;
+    setAllocateInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    result = vkAllocateDescriptorSets(m_device, &setAllocateInfo, &m_descriptorSet);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor set for textures");
+    }
+}
+
+void PixelTextureRegistry::cleanUp() {
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+}
+
+uint32_t PixelTextureRegistry::add(PixelImage* texture) {
+
+    uint32_t index;
+    if(!m_freeIndices.empty())
+    {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else if(m_nextIndex < m_capacity)
+    {
+        //the slots are handed out in order, everything from the next index on was never used
+        index = m_nextIndex++;
+    }
+    else
+    {
+        throw std::runtime_error("the texture registry is full");
+    }
+
+    m_count++;
+    replace(index, texture);
+    return index;
+}
+
+void PixelTextureRegistry::replace(uint32_t index, PixelImage* texture) {
+    //a texture that is not uploaded yet shows the fallback until it is replaced
+    m_views[index] = texture->hasBeenInitialized() ? texture->getImageView() : m_fallbackTexture->getImageView();
+    m_pendingWrites.push_back(index);
+}
+
+void PixelTextureRegistry::remove(uint32_t index) {
+    //writing the slot now would change what the pending frames sample, the view it points at is released by its owner
+    //once the index is retired
+    m_retiredIndices.push_back({index, m_flushCount});
+    m_count--;
+}
+
+uint32_t PixelTextureRegistry::flush() {
+
+    //the indices retired long enough ago are no longer sampled by any frame in flight
+    m_flushCount++;
+    auto retired = std::remove_if(m_retiredIndices.begin(), m_retiredIndices.end(), [this](const RetiredIndex& retiredIndex){
+        if(m_flushCount - retiredIndex.flush > TEXTURE_INDEX_RETIRE_FLUSHES)
+        {
+            m_freeIndices.push_back(retiredIndex.index);
+            return true;
+        }
+        return false;
+    });
+    m_retiredIndices.erase(retired, m_retiredIndices.end());
+
+    //a slot changed twice since the last flush is only written once, with its latest view
+    std::sort(m_pendingWrites.begin(), m_pendingWrites.end());
+    m_pendingWrites.erase(std::unique(m_pendingWrites.begin(), m_pendingWrites.end()), m_pendingWrites.end());
+
+    std::vector<VkDescriptorImageInfo> imageInfos(m_pendingWrites.size());
+    std::vector<VkWriteDescriptorSet> descriptorWrites(m_pendingWrites.size());
+    for(size_t i = 0; i < m_pendingWrites.size(); i++)
+    {
+        imageInfos[i].imageView = m_views[m_pendingWrites[i]];
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; //what is the image layout when in use
+        imageInfos[i].sampler = m_sampler;
+
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = m_descriptorSet;
+        descriptorWrites[i].dstBinding = 0; //matches layout(binding = 0)
+        descriptorWrites[i].dstArrayElement = m_pendingWrites[i]; //the slot of the texture
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+
+    if(!descriptorWrites.empty())
+    {
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    m_lastWrites = static_cast<uint32_t>(m_pendingWrites.size());
+    m_pendingWrites.clear();
+    return m_lastWrites;
+}
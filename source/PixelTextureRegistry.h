@@ -0,0 +1,74 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELTEXTUREREGISTRY_H
+#define PIXELENGINE_PIXELTEXTUREREGISTRY_H
+
+#include "PixelImage.h"
+
+#include <vector>
+
+const uint32_t MAX_BINDLESS_TEXTURES = 4096; //lowered to what the device allows
+const uint32_t TEXTURE_INDEX_RETIRE_FLUSHES = 4; //flushes a removed index waits before it is handed out again, so no frame in flight still samples it
+const uint32_t TEXTURE_NONE = UINT32_MAX;
+
+//the textures of a scene, or of the ray traced materials, in one bindless array (set 1, binding 0). every texture keeps the index
+//it was added at until it is removed, so the objects store it once and the array is never rewritten as a whole: flush only writes
+//the slots that changed since the last one. the binding is partially bound and updated after bind, the slots that were never
+//written are simply not sampled
+class PixelTextureRegistry {
+public:
+    PixelTextureRegistry() = default;
+    PixelTextureRegistry(VkDevice device, VkPhysicalDevice physicalDevice, VkShaderStageFlags stages = VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    //the layout is needed by the pipelines before the sampler and the fallback texture exist
+    void createDescriptorSetLayout();
+    void init(VkSampler sampler, PixelImage* fallbackTexture);
+    void cleanUp();
+
+    //indices. a texture that is streamed in gets the next free index. a removed one keeps its slot as it is, the frames in flight
+    //may still sample it, and the slot is only written again once the index is handed out to another texture
+    uint32_t add(PixelImage* texture);
+    void replace(uint32_t index, PixelImage* texture); //same index, e.g. a texture recreated at a new size. the device has to be idle if frames in flight sample it
+    void remove(uint32_t index);
+    uint32_t flush(); //writes the pending slots, once per frame before the submission. returns the number of writes
+
+    //getters
+    VkDescriptorSetLayout* getDescriptorSetLayout(){return &m_descriptorSetLayout;}
+    VkDescriptorSet* getDescriptorSet(){return &m_descriptorSet;}
+    uint32_t getCapacity() const {return m_capacity;}
+    uint32_t getCount() const {return m_count;}
+    uint32_t getLastWrites() const {return m_lastWrites;}
+
+private:
+
+    struct RetiredIndex{
+        uint32_t index;
+        uint64_t flush; //the last flush before it was removed
+    };
+
+    std::vector<VkImageView> m_views; //what every slot should point at, VK_NULL_HANDLE for the slots never handed out
+    std::vector<uint32_t> m_pendingWrites;
+    std::vector<uint32_t> m_freeIndices;
+    std::vector<RetiredIndex> m_retiredIndices;
+    uint32_t m_capacity = 0;
+    uint32_t m_count = 0;
+    uint32_t m_nextIndex = 0; //first slot never handed out
+    uint32_t m_lastWrites = 0;
+    uint64_t m_flushCount = 0;
+    VkShaderStageFlags m_stages = VK_SHADER_STAGE_FRAGMENT_BIT; //that sample the array
+
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    PixelImage* m_fallbackTexture = nullptr;
+
+    //vulkan component
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+};
+
+
+#endif //PIXELENGINE_PIXELTEXTUREREGISTRY_H
@@ -0,0 +1,423 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelTextureStreamer.h"
+#include "PixelCullPipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+PixelTextureStreamer::PixelTextureStreamer(PixBackend* backend, VkQueue queue, uint32_t queueFamily, bool memoryBudgetSupported) :
+        m_memoryBudgetSupported(memoryBudgetSupported), m_backend(backend), m_queue(queue), m_queueFamily(queueFamily) {
+
+}
+
+//diameter in pixels of the bounding sphere of the object, 0 when it is hidden or outside the frustum
+static float projectedSize(PixelObject* object, const std::array<glm::vec4, CULL_FRUSTUM_PLANES>& frustumPlanes, glm::vec3 cameraPos, float focalPixels)
+{
+    if(object->isHidden())
+    {
+        return 0.0f;
+    }
+
+    //the same sphere as the cull pass, it follows the transform and its radius grows with the largest scale
+    glm::mat4 M = object->getPushObj()->M;
+    glm::vec4 boundingSphere = object->getBoundingSphere();
+    glm::vec3 center = glm::vec3(M * glm::vec4(glm::vec3(boundingSphere), 1.0f));
+    float scale = std::max({glm::length(glm::vec3(M[0])), glm::length(glm::vec3(M[1])), glm::length(glm::vec3(M[2]))});
+    float radius = boundingSphere.w * scale;
+
+    for(const auto& plane : frustumPlanes)
+    {
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+        {
+            return 0.0f;
+        }
+    }
+
+    float distance = glm::length(center - cameraPos);
+    if(distance <= radius)
+    {
+        return std::numeric_limits<float>::max(); //the camera is inside it
+    }
+    return 2.0f * radius * focalPixels / distance;
+}
+
+//the level whose texels are about the size of a pixel, assuming the texture is spread once over the object
+static uint32_t desiredLevel(PixelImage* texture, float pixelSize)
+{
+    uint32_t tailLevel = texture->getTailLevel();
+    float texels = static_cast<float>(std::max(texture->getBaseWidth(), texture->getBaseHeight()));
+    if(pixelSize <= 0.0f)
+    {
+        return tailLevel;
+    }
+    if(pixelSize >= texels)
+    {
+        return 0;
+    }
+    return std::min(tailLevel, static_cast<uint32_t>(std::floor(std::log2(texels / pixelSize))));
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                         VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkImageMemoryBarrier imageMemoryBarrier{};
+    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.oldLayout = oldLayout;
+    imageMemoryBarrier.newLayout = newLayout;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image = image;
+    imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+    imageMemoryBarrier.srcAccessMask = srcAccess;
+    imageMemoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+void PixelTextureStreamer::init() {
+
+    //the uploads are recorded once and freed when their fence is signaled
+    VkCommandPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolCreateInfo.queueFamilyIndex = m_queueFamily;
+
+    VkResult result = vkCreateCommandPool(m_backend->logicalDevice, &poolCreateInfo, nullptr, &m_commandPool);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the texture streaming command pool");
+    }
+}
+
+void PixelTextureStreamer::cleanUp() {
+    collectUploads(true);
+    collectRetiredImages(true);
+    vkDestroyCommandPool(m_backend->logicalDevice, m_commandPool, nullptr);
+}
+
+void PixelTextureStreamer::update(std::vector<PixelScene>& scenes, VkExtent2D extent) {
+
+    m_frameCount++;
+    collectUploads(false);
+    collectRetiredImages(false);
+
+    //where every streamed texture should start, from the size of its objects on screen. a texture shared by several objects is counted once
+    std::vector<Residency> residencies;
+    std::unordered_map<PixelImage*, size_t> residencyIndices;
+    m_stats.residentBytes = 0;
+    m_stats.textureCount = 0;
+    m_stats.streamedCount = 0;
+    m_stats.partialCount = 0;
+    for(auto& scene : scenes)
+    {
+        PixelScene::UboVP sceneVP = scene.getSceneVP();
+        std::array<glm::vec4, CULL_FRUSTUM_PLANES> frustumPlanes = PixelCullPipeline::getPushObj(sceneVP.P * sceneVP.V, 0, 0, 0).frustumPlanes;
+        glm::vec3 cameraPos = glm::vec3(glm::inverse(sceneVP.V)[3]);
+        float focalPixels = std::abs(sceneVP.P[1][1]) * 0.5f * static_cast<float>(extent.height); //pixels per unit at a distance of 1
+
+        for(int i = 0; i < scene.getNumObjects(); i++)
+        {
+            PixelObject* object = scene.getObjectAt(i);
+            float pixelSize = -1.0f; //only projected for the objects with a streamed texture
+            for(uint32_t slot = 0; slot < object->getTextures()->size(); slot++)
+            {
+                PixelImage* texture = (*object->getTextures())[slot].get();
+                if(!texture->hasBeenInitialized() || object->getTextureIndex(slot) == TEXTURE_NONE)
+                {
+                    continue;
+                }
+
+                auto residencyIndex = residencyIndices.find(texture);
+                if(residencyIndex == residencyIndices.end())
+                {
+                    residencyIndex = residencyIndices.emplace(texture, residencies.size()).first;
+                    residencies.push_back({texture, {}, texture->getTailLevel(), 0.0f});
+                    m_stats.residentBytes += texture->getMemorySize();
+                    m_stats.textureCount++;
+                }
+
+                Residency& residency = residencies[residencyIndex->second];
+                if(std::find(residency.scenes.begin(), residency.scenes.end(), &scene) == residency.scenes.end())
+                {
+                    residency.scenes.push_back(&scene);
+                }
+                if(!texture->isStreamable())
+                {
+                    continue;
+                }
+
+                if(pixelSize < 0.0f)
+                {
+                    pixelSize = projectedSize(object, frustumPlanes, cameraPos, focalPixels);
+                }
+                residency.pixelSize = std::max(residency.pixelSize, pixelSize);
+                residency.desiredLevel = std::min(residency.desiredLevel, desiredLevel(texture, pixelSize));
+            }
+        }
+    }
+
+    //the textures that are always fully resident only count against the budget
+    residencies.erase(std::remove_if(residencies.begin(), residencies.end(), [](const Residency& residency){
+        return !residency.texture->isStreamable();
+    }), residencies.end());
+    for(const Residency& residency : residencies)
+    {
+        m_stats.streamedCount++;
+        m_stats.partialCount += residency.texture->getFirstResidentLevel() > residency.desiredLevel ? 1 : 0;
+    }
+
+    queryDriverBudget();
+    std::sort(residencies.begin(), residencies.end(), [](const Residency& a, const Residency& b){return a.pixelSize < b.pixelSize;});
+    uint32_t changes = 0;
+
+    //over the budget, the textures least on screen give back the levels they do not need first. the old images are freed
+    //a few frames later, they are not counted here so the next frames do not evict more than needed
+    VkDeviceSize residentBytes = m_stats.residentBytes;
+    for(const Residency& residency : residencies)
+    {
+        if(residentBytes <= m_stats.budgetBytes || changes >= TEXTURE_STREAM_CHANGES_PER_FRAME)
+        {
+            break;
+        }
+
+        PixelImage* texture = residency.texture;
+        VkDeviceSize previousSize = texture->getMemorySize();
+        if(texture->getFirstResidentLevel() < residency.desiredLevel && changeResidency(residency, residency.desiredLevel))
+        {
+            residentBytes = residentBytes - previousSize + texture->getMemorySize();
+            m_stats.streamedOut++;
+            changes++;
+        }
+    }
+
+    //the largest textures on screen get their levels first, straight to the one they need when it fits in the budget.
+    //the old image is still allocated until the frames in flight are done with it
+    VkDeviceSize usedBytes = residentBytes + m_stats.retiredBytes;
+    for(auto residency = residencies.rbegin(); residency != residencies.rend() && changes < TEXTURE_STREAM_CHANGES_PER_FRAME; residency++)
+    {
+        PixelImage* texture = residency->texture;
+        uint32_t firstLevel = texture->getFirstResidentLevel();
+        if(residency->pixelSize <= 0.0f || firstLevel <= residency->desiredLevel)
+        {
+            continue;
+        }
+
+        for(uint32_t level = residency->desiredLevel; level < firstLevel; level++)
+        {
+            if(usedBytes + texture->getResidentSize(level) > m_stats.budgetBytes)
+            {
+                continue;
+            }
+            if(changeResidency(*residency, level))
+            {
+                usedBytes += texture->getMemorySize();
+                m_stats.streamedIn++;
+                changes++;
+            }
+            break;
+        }
+    }
+
+    m_stats.pendingUploads = static_cast<uint32_t>(m_uploads.size());
+}
+
+void PixelTextureStreamer::queryDriverBudget() {
+
+    VkDeviceSize budgetBytes = static_cast<VkDeviceSize>(std::max(m_budgetMB, 0)) * 1024 * 1024;
+    m_stats.driverBudgetBytes = 0;
+    m_stats.driverUsageBytes = 0;
+
+    if(m_memoryBudgetSupported)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget{};
+        memoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = &memoryBudget;
+        vkGetPhysicalDeviceMemoryProperties2(m_backend->physicalDevice, &memoryProperties);
+
+        //the textures are device local
+        for(uint32_t heap = 0; heap < memoryProperties.memoryProperties.memoryHeapCount; heap++)
+        {
+            if(memoryProperties.memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                m_stats.driverBudgetBytes += memoryBudget.heapBudget[heap];
+                m_stats.driverUsageBytes += memoryBudget.heapUsage[heap];
+            }
+        }
+
+        //what the driver gives the process, less everything that is not one of the textures (the swapchain, the compute images, the buffers...)
+        VkDeviceSize textureBytes = m_stats.residentBytes + m_stats.retiredBytes;
+        VkDeviceSize otherBytes = m_stats.driverUsageBytes > textureBytes ? m_stats.driverUsageBytes - textureBytes : 0;
+        budgetBytes = std::min(budgetBytes, m_stats.driverBudgetBytes > otherBytes ? m_stats.driverBudgetBytes - otherBytes : 0);
+    }
+
+    m_stats.budgetBytes = budgetBytes;
+}
+
+bool PixelTextureStreamer::changeResidency(const Residency& residency, uint32_t firstLevel) {
+
+    PixelImage* texture = residency.texture;
+
+    PixelTextureCompressor::CompressedTexture levels;
+    if(!PixelTextureCompressor::readCache(texture->getCachePath(), texture->getSourceStamp(), &levels, firstLevel))
+    {
+        //the cache was deleted or encoded again since the texture was loaded, it keeps the levels it has
+        std::cout<<"could not read the texture cache "<<texture->getCachePath()<<", the texture is no longer streamed"<<std::endl;
+        texture->stopStreaming();
+        return false;
+    }
+
+    VkDeviceSize previousSize = texture->getMemorySize();
+    PixelImage::ImageHandles previous = texture->swapResidentLevels(std::move(levels));
+    recordUpload(texture);
+    texture->releaseHostData();
+
+    //the frames in flight sample the old index, the object buffers written from now on the new one
+    for(PixelScene* scene : residency.scenes)
+    {
+        scene->reregisterTexture(texture);
+    }
+
+    m_retiredImages.push_back({previous, previousSize, m_frameCount});
+    m_stats.retiredBytes += previousSize;
+    return true;
+}
+
+void PixelTextureStreamer::recordUpload(PixelImage* texture) {
+
+    Upload upload;
+    VkDeviceSize uploadSize = texture->getImageBufferSize();
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = uploadSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateBuffer(m_backend->logicalDevice, &bufferInfo, nullptr, &upload.stagingBuffer);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create a texture streaming staging buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(m_backend->logicalDevice, upload.stagingBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryTypeIndex(m_backend->physicalDevice, memoryRequirements.memoryTypeBits,
+                                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    result = vkAllocateMemory(m_backend->logicalDevice, &allocateInfo, nullptr, &upload.stagingMemory);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate texture streaming staging memory");
+    }
+    vkBindBufferMemory(m_backend->logicalDevice, upload.stagingBuffer, upload.stagingMemory, 0);
+
+    void* data;
+    vkMapMemory(m_backend->logicalDevice, upload.stagingMemory, 0, uploadSize, 0, &data);
+    memcpy(data, texture->getCompressedData(), static_cast<size_t>(uploadSize));
+    vkUnmapMemory(m_backend->logicalDevice, upload.stagingMemory);
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandPool = m_commandPool;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(m_backend->logicalDevice, &commandBufferAllocateInfo, &upload.commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+    imageBarrier(upload.commandBuffer, texture->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    //one region per resident level, packed one after the other in the staging buffer
+    std::vector<VkBufferImageCopy> bufferCopies(texture->getMipLevels());
+    for(uint32_t level = 0; level < texture->getMipLevels(); level++)
+    {
+        bufferCopies[level].bufferOffset = texture->getLevelOffset(level);
+        bufferCopies[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        bufferCopies[level].imageExtent = {std::max(texture->getWidth() >> level, 1u), std::max(texture->getHeight() >> level, 1u), 1};
+    }
+    vkCmdCopyBufferToImage(upload.commandBuffer, upload.stagingBuffer, texture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+
+    //the frames submitted after it on the same queue sample the image once the copy is done
+    imageBarrier(upload.commandBuffer, texture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    vkEndCommandBuffer(upload.commandBuffer);
+
+    VkFenceCreateInfo fenceCreateInfo{};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    result = vkCreateFence(m_backend->logicalDevice, &fenceCreateInfo, nullptr, &upload.fence);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create a texture streaming fence");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &upload.commandBuffer;
+
+    //not waited on, the staging buffer is freed by a later update once the fence is signaled
+    result = vkQueueSubmit(m_queue, 1, &submitInfo, upload.fence);
+    if(result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit a texture upload");
+    }
+
+    m_uploads.push_back(upload);
+}
+
+void PixelTextureStreamer::collectUploads(bool wait) {
+
+    auto done = std::remove_if(m_uploads.begin(), m_uploads.end(), [this, wait](const Upload& upload){
+        if(wait)
+        {
+            vkWaitForFences(m_backend->logicalDevice, 1, &upload.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        } else if(vkGetFenceStatus(m_backend->logicalDevice, upload.fence) != VK_SUCCESS)
+        {
+            return false;
+        }
+
+        vkDestroyFence(m_backend->logicalDevice, upload.fence, nullptr);
+        vkFreeCommandBuffers(m_backend->logicalDevice, m_commandPool, 1, &upload.commandBuffer);
+        vkDestroyBuffer(m_backend->logicalDevice, upload.stagingBuffer, nullptr);
+        vkFreeMemory(m_backend->logicalDevice, upload.stagingMemory, nullptr);
+        return true;
+    });
+    m_uploads.erase(done, m_uploads.end());
+}
+
+void PixelTextureStreamer::collectRetiredImages(bool all) {
+
+    //the same delay as the registry gives the index, no frame in flight samples the image anymore
+    auto done = std::remove_if(m_retiredImages.begin(), m_retiredImages.end(), [this, all](const RetiredImage& retired){
+        if(!all && m_frameCount - retired.frame <= TEXTURE_INDEX_RETIRE_FLUSHES)
+        {
+            return false;
+        }
+
+        vkDestroyImageView(m_backend->logicalDevice, retired.handles.imageView, nullptr);
+        vkDestroyImage(m_backend->logicalDevice, retired.handles.image, nullptr);
+        vkFreeMemory(m_backend->logicalDevice, retired.handles.memory, nullptr);
+        m_stats.retiredBytes -= retired.size;
+        return true;
+    });
+    m_retiredImages.erase(done, m_retiredImages.end());
+}
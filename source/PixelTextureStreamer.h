@@ -0,0 +1,94 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELTEXTURESTREAMER_H
+#define PIXELENGINE_PIXELTEXTURESTREAMER_H
+
+#include "PixelScene.h"
+
+#include <vector>
+
+const int TEXTURE_STREAM_DEFAULT_BUDGET_MB = 512;
+const uint32_t TEXTURE_STREAM_CHANGES_PER_FRAME = 2; //textures read from the cache and uploaded per frame, the reads block the render thread
+
+//keeps the levels of the streamed textures that are big enough on screen resident, within a budget of device memory.
+//the textures are loaded with their smallest levels only (PixelImage::loadTexture). every frame the bounding sphere of
+//each textured object is projected to find the level its texture needs, a texture shared by several objects needs the level
+//of the largest one. the largest textures on screen stream their levels in first and the ones least on screen give theirs back
+//when the budget is exceeded.
+//a texture that changes its levels gets a new image with a new index in the registry: the frames in flight keep sampling
+//the old one, which is destroyed once the registry hands its index out again
+class PixelTextureStreamer {
+public:
+    PixelTextureStreamer(PixBackend* backend, VkQueue queue, uint32_t queueFamily, bool memoryBudgetSupported);
+    PixelTextureStreamer() = default;
+
+    struct Stats{
+        VkDeviceSize residentBytes = 0; //every texture of the scenes, streamed or not
+        VkDeviceSize retiredBytes = 0; //old images still sampled by the frames in flight
+        VkDeviceSize budgetBytes = 0; //what the textures are allowed to use this frame
+        VkDeviceSize driverBudgetBytes = 0; //device local heaps, 0 without VK_EXT_memory_budget
+        VkDeviceSize driverUsageBytes = 0;
+        uint32_t textureCount = 0;
+        uint32_t streamedCount = 0; //textures read from the cache on demand
+        uint32_t partialCount = 0; //streamed textures missing levels they would use
+        uint32_t pendingUploads = 0;
+        uint32_t streamedIn = 0; //residency changes since the start
+        uint32_t streamedOut = 0;
+    };
+
+    void init();
+    void cleanUp(); //the device has to be idle
+    void update(std::vector<PixelScene>& scenes, VkExtent2D extent); //once per frame, before the object buffers are written
+
+    //getters
+    int* getBudgetMB(){return &m_budgetMB;}
+    bool isMemoryBudgetSupported(){return m_memoryBudgetSupported;}
+    const Stats& getStats(){return m_stats;}
+
+private:
+
+    //a texture and the level it should start at, for the largest of the objects using it
+    struct Residency{
+        PixelImage* texture;
+        std::vector<PixelScene*> scenes; //the scenes it is registered in
+        uint32_t desiredLevel;
+        float pixelSize; //of the object on screen, 0 when it is not visible
+    };
+
+    struct Upload{
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    };
+
+    struct RetiredImage{
+        PixelImage::ImageHandles handles;
+        VkDeviceSize size;
+        uint64_t frame; //the update it was replaced in
+    };
+
+    void collectUploads(bool wait);
+    void collectRetiredImages(bool all);
+    void queryDriverBudget(); //the part of the driver budget left for the textures
+    bool changeResidency(const Residency& residency, uint32_t firstLevel);
+    void recordUpload(PixelImage* texture);
+
+    int m_budgetMB = TEXTURE_STREAM_DEFAULT_BUDGET_MB;
+    bool m_memoryBudgetSupported = false;
+    Stats m_stats;
+    uint64_t m_frameCount = 0;
+    std::vector<Upload> m_uploads;
+    std::vector<RetiredImage> m_retiredImages;
+
+    //vulkan component
+    PixBackend* m_backend{};
+    VkQueue m_queue = VK_NULL_HANDLE; //graphics, the frames sampling the new images are submitted to it after the uploads
+    uint32_t m_queueFamily = 0;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+};
+
+
+#endif //PIXELENGINE_PIXELTEXTURESTREAMER_H
@@ -0,0 +1,154 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#include "PixelTileScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+void PixelTileScheduler::init(uint32_t width, uint32_t height) {
+    m_width = width;
+    m_height = height;
+
+    m_tiles.clear();
+    for(uint32_t y = 0; y < height; y += TILE_HEIGHT)
+    {
+        for(uint32_t x = 0; x < width; x += TILE_WIDTH)
+        {
+            Tile tile{};
+            tile.offset = {x, y};
+            m_tiles.push_back(tile);
+        }
+    }
+}
+
+void PixelTileScheduler::restart(bool continueSequence) {
+
+    //the next samples start where the most refined tile stopped, so no pixel sees the same sobol point twice
+    uint32_t maxSampleCount = 0;
+    for(auto& tile : m_tiles)
+    {
+        maxSampleCount = std::max(maxSampleCount, tile.sampleCount);
+        tile.sampleCount = 1;
+    }
+
+    m_sequenceOffset = continueSequence ? m_sequenceOffset + maxSampleCount : 0;
+}
+
+float PixelTileScheduler::priority(uint32_t tileIndex, glm::vec2 focusPoint) {
+    const Tile& tile = m_tiles[tileIndex];
+
+    glm::vec2 center = glm::vec2(tile.offset) + 0.5f * glm::vec2(TILE_WIDTH, TILE_HEIGHT);
+    float diagonal = glm::length(glm::vec2(m_width, m_height));
+    float distance = std::min(glm::length(center - focusPoint) / diagonal, 1.0f);
+
+    //lowest first: the tiles with the fewest samples, scaled up the farther they are from the focus point
+    return static_cast<float>(tile.sampleCount + 1) * (1.0f + TILE_PRIORITY_DISTANCE_WEIGHT * distance);
+}
+
+uint32_t PixelTileScheduler::tileBudget(bool fullFramePass) {
+
+    float availableTime = m_budgetMs - (fullFramePass ? m_fullFrameTimeEstimate : 0.0f);
+    uint32_t tileCount = availableTime > 0.0f ? static_cast<uint32_t>(availableTime / std::max(m_tileTimeEstimate, 0.001f)) : 0;
+
+    //a refinement frame always makes progress, even if a single tile is already over the budget
+    if(!fullFramePass)
+    {
+        tileCount = std::max(tileCount, 1u);
+    }
+
+    return std::min(tileCount, getTileCount() * MAX_TILE_ROUNDS);
+}
+
+std::vector<std::vector<PixelTileScheduler::TileDispatch>> PixelTileScheduler::scheduleBatch(glm::vec2 focusPoint, uint32_t targetSamples, bool fullFramePass) {
+
+    std::vector<std::vector<TileDispatch>> rounds = scheduleTiles(focusPoint, targetSamples, tileBudget(fullFramePass));
+
+    m_lastBatchSize = 0;
+    for(const auto& round : rounds)
+    {
+        m_lastBatchSize += static_cast<uint32_t>(round.size());
+    }
+
+    return rounds;
+}
+
+std::vector<std::vector<PixelTileScheduler::TileDispatch>> PixelTileScheduler::scheduleRefinement(glm::vec2 focusPoint, uint32_t targetSamples, float budgetMs) {
+
+    //unlike a frame, a refinement that does not fit a single tile is skipped
+    uint32_t budget = budgetMs > 0.0f ? static_cast<uint32_t>(budgetMs / std::max(m_tileTimeEstimate, 0.001f)) : 0;
+    return scheduleTiles(focusPoint, targetSamples, std::min(budget, getTileCount() * MAX_TILE_ROUNDS));
+}
+
+std::vector<std::vector<PixelTileScheduler::TileDispatch>> PixelTileScheduler::scheduleTiles(glm::vec2 focusPoint, uint32_t targetSamples, uint32_t budget) {
+
+    using QueueEntry = std::pair<float, uint32_t>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    for(uint32_t i = 0; i < getTileCount(); i++)
+    {
+        if(m_tiles[i].sampleCount < targetSamples)
+        {
+            queue.push({priority(i, focusPoint), i});
+        }
+    }
+
+    std::vector<std::vector<TileDispatch>> rounds;
+    std::vector<uint32_t> tileRounds(getTileCount(), 0);
+    uint32_t batchSize = 0;
+
+    while(batchSize < budget && !queue.empty())
+    {
+        uint32_t tileIndex = queue.top().second;
+        queue.pop();
+
+        //the n-th sample of a tile in this batch goes in the n-th round, after the copy of the previous one
+        uint32_t round = tileRounds[tileIndex]++;
+        if(round >= rounds.size())
+        {
+            rounds.resize(round + 1);
+        }
+
+        Tile& tile = m_tiles[tileIndex];
+        rounds[round].push_back({tileIndex, tile.sampleCount});
+        tile.sampleCount++;
+        batchSize++;
+
+        if(tile.sampleCount < targetSamples && tileRounds[tileIndex] < MAX_TILE_ROUNDS)
+        {
+            queue.push({priority(tileIndex, focusPoint), tileIndex});
+        }
+    }
+
+    return rounds;
+}
+
+void PixelTileScheduler::reportFullFrameTime(float milliseconds) {
+    m_fullFrameTimeEstimate += TILE_TIME_SMOOTHING * (milliseconds - m_fullFrameTimeEstimate);
+}
+
+void PixelTileScheduler::reportTileTime(float milliseconds, uint32_t tileCount) {
+    if(tileCount == 0)
+    {
+        return;
+    }
+
+    float tileTime = milliseconds / static_cast<float>(tileCount);
+    m_tileTimeEstimate += TILE_TIME_SMOOTHING * (tileTime - m_tileTimeEstimate);
+}
+
+bool PixelTileScheduler::isConverged(uint32_t targetSamples) {
+    return getMinSampleCount() >= targetSamples;
+}
+
+uint32_t PixelTileScheduler::getMinSampleCount() {
+    uint32_t minSampleCount = UINT32_MAX;
+    for(const auto& tile : m_tiles)
+    {
+        minSampleCount = std::min(minSampleCount, tile.sampleCount);
+    }
+    return m_tiles.empty() ? 0 : minSampleCount;
+}
@@ -0,0 +1,83 @@
+//
+// Created by hlahm on 2026-10-18.
+//
+
+#ifndef PIXELENGINE_PIXELTILESCHEDULER_H
+#define PIXELENGINE_PIXELTILESCHEDULER_H
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//a tile is 4x4 workgroups of shader.comp
+const uint32_t TILE_WIDTH = 128;
+const uint32_t TILE_HEIGHT = 96;
+const uint32_t MAX_TILE_ROUNDS = 16; //samples a tile can get in one frame, bounds the size of the compute command buffer
+const float DEFAULT_COMPUTE_BUDGET_MS = 12.0f; //leaves room for the graphics pass and the gui in a 16 ms frame
+const float TILE_PRIORITY_DISTANCE_WEIGHT = 3.0f; //the tile under the cursor gets up to this many times more samples than the farthest one
+const float TILE_TIME_SMOOTHING = 0.25f; //weight of a new gpu measurement in the time estimates
+
+//splits the raytraced image in tiles and decides which ones get a sample this frame.
+//the whole image is only dispatched when the view changes, every sample after that goes through the tiles within a gpu time budget
+class PixelTileScheduler {
+public:
+    PixelTileScheduler() = default;
+
+    struct Tile{
+        glm::uvec2 offset{}; //in pixels
+        uint32_t sampleCount = 0; //samples accumulated since the last full frame dispatch
+    };
+
+    //one sample of one tile. sampleCount is the number of samples the tile had before this one
+    struct TileDispatch{
+        uint32_t tileIndex;
+        uint32_t sampleCount;
+    };
+
+    void init(uint32_t width, uint32_t height);
+
+    //the full frame was just dispatched once. the sequence keeps going if the history was reprojected
+    void restart(bool continueSequence);
+
+    //tiles to dispatch this frame, grouped in rounds in which a tile appears at most once.
+    //the sample counts are updated right away, the batch is expected to be submitted
+    std::vector<std::vector<TileDispatch>> scheduleBatch(glm::vec2 focusPoint, uint32_t targetSamples, bool fullFramePass);
+
+    //tiles refined between two frames, they have to fit in the given time instead of the frame budget
+    std::vector<std::vector<TileDispatch>> scheduleRefinement(glm::vec2 focusPoint, uint32_t targetSamples, float budgetMs);
+
+    //gpu times read back by the profiler, a few frames late
+    void reportFullFrameTime(float milliseconds);
+    void reportTileTime(float milliseconds, uint32_t tileCount);
+
+    bool isConverged(uint32_t targetSamples);
+
+    //getters
+    const Tile& getTile(uint32_t tileIndex){return m_tiles[tileIndex];}
+    uint32_t getTileCount(){return static_cast<uint32_t>(m_tiles.size());}
+    uint32_t getMinSampleCount();
+    uint32_t getSequenceOffset(){return m_sequenceOffset;}
+    uint32_t getLastBatchSize(){return m_lastBatchSize;}
+    float getTileTimeEstimate(){return m_tileTimeEstimate;}
+    float getFullFrameTimeEstimate(){return m_fullFrameTimeEstimate;}
+    float* getBudget(){return &m_budgetMs;}
+
+private:
+    uint32_t tileBudget(bool fullFramePass);
+    std::vector<std::vector<TileDispatch>> scheduleTiles(glm::vec2 focusPoint, uint32_t targetSamples, uint32_t budget);
+    float priority(uint32_t tileIndex, glm::vec2 focusPoint);
+
+    std::vector<Tile> m_tiles;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_sequenceOffset = 0; //sobol index of the full frame sample, the tiles continue from there
+    uint32_t m_lastBatchSize = 0;
+
+    float m_budgetMs = DEFAULT_COMPUTE_BUDGET_MS;
+    float m_tileTimeEstimate = 0.5f; //until the first measurements come back
+    float m_fullFrameTimeEstimate = 4.0f;
+};
+
+
+#endif //PIXELENGINE_PIXELTILESCHEDULER_H
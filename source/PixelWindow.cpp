@@ -3,7 +3,9 @@
 PixelWindow::PixelWindow() :
 	windowName("Default Window"),
 	windowWidth(800),
-	windowHeight(600)
+	windowHeight(600),
+	windowPosX(0),
+	windowPosY(0)
 {
 	window = nullptr;
 }
@@ -24,11 +26,41 @@ void PixelWindow::initWindow(std::string wName, const int width, const int heigh
 
 	//set glfw to not work with OpenGL
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE); //the renderer recreates its swapchain when the framebuffer size changes
 
 	window = glfwCreateWindow(windowWidth, windowHeight, windowName.c_str(), nullptr, nullptr);
 }
 
+void PixelWindow::toggleFullscreen()
+{
+	if(isFullscreen())
+	{
+		glfwSetWindowMonitor(window, nullptr, windowPosX, windowPosY, windowWidth, windowHeight, GLFW_DONT_CARE);
+		return;
+	}
+
+	//keep the windowed placement to go back to it
+	glfwGetWindowPos(window, &windowPosX, &windowPosY);
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+
+	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+	const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+	glfwSetWindowMonitor(window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+}
+
+bool PixelWindow::isFullscreen()
+{
+	return glfwGetWindowMonitor(window) != nullptr;
+}
+
+int PixelWindow::getRefreshRate()
+{
+	//a window does not know which monitor it is on, the primary one is the best guess outside fullscreen
+	GLFWmonitor* monitor = isFullscreen() ? glfwGetWindowMonitor(window) : glfwGetPrimaryMonitor();
+	const GLFWvidmode* mode = monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
+	return mode != nullptr ? mode->refreshRate : 60;
+}
+
 GLFWwindow* PixelWindow::getWindow()
 {
 	return window;
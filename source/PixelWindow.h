@@ -17,6 +17,9 @@ public:
 
 	void initWindow(std::string wName = "Default Window", int width = 800, int height = 600);
 	bool shouldClose();
+	void toggleFullscreen();
+	bool isFullscreen();
+	int getRefreshRate();
 	GLFWwindow* getWindow();
 
 private:
@@ -24,5 +27,9 @@ private:
 	std::string windowName;
 	int windowWidth;
 	int windowHeight;
+
+	//windowed position and size, restored when leaving fullscreen
+	int windowPosX;
+	int windowPosY;
 };
 
@@ -9,6 +9,7 @@
 #define GLFW_INCLUDE_VULKAN //includes vulkan automatically
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <random>
 #include <fstream>
 #include <iostream>
@@ -198,8 +199,14 @@ static inline VkFormat chooseSupportedFormat(VkPhysicalDevice physicalDevice, co
     //return VK_NULL_HANDLE;
 }
 
-static inline VkPresentModeKHR chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes)
+static inline VkPresentModeKHR chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes, VkPresentModeKHR requestedMode)
 {
+    //the mode picked in the gui if the surface supports it, otherwise mailbox
+    if (std::find(presentationModes.begin(), presentationModes.end(), requestedMode) != presentationModes.end())
+    {
+        return requestedMode;
+    }
+
     for (const auto& presentationMode : presentationModes)
     {
         if (presentationMode == VK_PRESENT_MODE_MAILBOX_KHR)
@@ -236,27 +243,6 @@ static inline std::vector<char> readFile(const std::string& filename) {
     return outputBuffer;
 }
 
-static inline VkShaderModule addShaderModule(VkDevice device, const std::string &filename) {
-
-    std::vector<char> code = readFile(filename);
-
-    VkShaderModuleCreateInfo shaderCreateInfo = {};
-    shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderCreateInfo.codeSize = code.size();
-    shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    VkResult result = vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &shaderModule);
-    if(result != VK_SUCCESS)
-    {
-        std::string outMessage = "failed to create shader module from file: %s\n";
-        outMessage.append(filename);
-        throw std::runtime_error(outMessage);
-    }
-
-    return shaderModule;
-}
-
 static inline float random(float center, float stdDev)
 {
     std::normal_distribution<> d {center, stdDev};
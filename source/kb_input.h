@@ -24,6 +24,10 @@ static bool ENTER = false;
 static bool ENTER_FLAG = true;
 static bool ESC = false;
 static bool MPRESS_R_Release = true;
+static bool INPUT_RECEIVED = false; //set by every callback. the renderer uses it to leave its idle state
+static double INPUT_TIME = 0.0; //first event since the renderer last cleared INPUT_RECEIVED, the latency readout starts there
+static bool WINDOW_RESIZED = false; //the framebuffer changed size, the swapchain has to be recreated
+static bool FULLSCREEN_TOGGLE = false;
 
 //mouse events
 static bool MPRESS_R = false;
@@ -37,8 +41,17 @@ static bool MFLAG_M = true;
 static float FIT = 1.5f;
 static float GAIN = 2.0f;
 
+void static receiveInput() {
+    if (!INPUT_RECEIVED){
+        INPUT_TIME = glfwGetTime();
+    }
+    INPUT_RECEIVED = true;
+}
+
 void static key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
 
+    receiveInput();
+
     if (key == GLFW_KEY_W && action == GLFW_PRESS){
         UP_PRESS = true;
     } else if(key == GLFW_KEY_W && action == GLFW_RELEASE){
@@ -100,6 +113,10 @@ void static key_callback(GLFWwindow *window, int key, int scancode, int action,
         COM = false;
     }
 
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS){
+        FULLSCREEN_TOGGLE = true;
+    }
+
     if (key == GLFW_KEY_ENTER && action == GLFW_PRESS){
         ENTER = true;
     }
@@ -110,6 +127,8 @@ void static key_callback(GLFWwindow *window, int key, int scancode, int action,
 }
 void static mouse_callback(GLFWwindow *window, int button, int action, int mods) {
 
+    receiveInput();
+
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow)){
         MPRESS_L = true;
     } else {
@@ -143,5 +162,21 @@ void static mouse_callback(GLFWwindow *window, int button, int action, int mods)
 
 void static scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     //std::cout<<yoffset<<std::endl;
+    receiveInput();
     scroll += 2.0f*yoffset;
-}
\ No newline at end of file
+}
+
+void static cursor_callback(GLFWwindow* window, double xpos, double ypos) {
+    receiveInput();
+}
+
+//the window was exposed or restored and needs to be redrawn even if nothing else changed
+void static window_refresh_callback(GLFWwindow* window) {
+    receiveInput();
+}
+
+//glfw reports the size in pixels, which is what the swapchain is created with
+void static framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    receiveInput();
+    WINDOW_RESIZED = true;
+}
@@ -3,9 +3,16 @@
 
 #include "PixelScene.h"
 #include "PixelRenderer.h"
+#include "PixelSampler.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+    //headless: compares the old and new sampling schemes on the cpu, no window or device is created
+    if(argc > 1 && std::string(argv[1]) == "--sampler-report")
+    {
+        PixelSampler::printConvergenceReport(std::cout);
+        return 0;
+    }
 
 	PixelRenderer pixRenderer;
 